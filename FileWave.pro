@@ -1,4 +1,9 @@
-QT       += core gui
+QT       += core gui concurrent
+
+# Qt::SkipEmptyParts and the range constructors of the containers need Qt 5.14
+lessThan(QT_MAJOR_VERSION, 5)|if(equals(QT_MAJOR_VERSION, 5):lessThan(QT_MINOR_VERSION, 14)) {
+    error("Qt 5.14 or newer is required")
+}
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -15,18 +20,102 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# Optional decompressors of the compressed file preview, a format is not previewed without its library
+CONFIG += link_pkgconfig
+packagesExist(zlib) {
+    PKGCONFIG += zlib
+    DEFINES += FILEINSPECTOR_ZLIB
+}
+packagesExist(libzstd) {
+    PKGCONFIG += libzstd
+    DEFINES += FILEINSPECTOR_ZSTD
+}
+packagesExist(liblzma) {
+    PKGCONFIG += liblzma
+    DEFINES += FILEINSPECTOR_LZMA
+}
+
 SOURCES += \
+    archivepreview.cpp \
+    batchinspector.cpp \
+    batchio.cpp \
+    changetracker.cpp \
+    contentgrep.cpp \
+    contenthasher.cpp \
     detailwidget.cpp \
+    dirlister.cpp \
+    duplicatefinder.cpp \
+    duplicatesdialog.cpp \
+    filenameindex.cpp \
+    filesearch.cpp \
+    filesystemmodel.cpp \
+    findinfilesdialog.cpp \
+    foldersnapshot.cpp \
+    hexformatter.cpp \
+    hexviewer.cpp \
+    largefileviewer.cpp \
+    lineindex.cpp \
+    literalmatcher.cpp \
+    logtailer.cpp \
     main.cpp \
+    mimeclassifier.cpp \
+    namearena.cpp \
+    pathcompleter.cpp \
     pathinspectormain.cpp \
     pathinspectorwidget.cpp \
-    util.cpp
+    perfoverlay.cpp \
+    perftracer.cpp \
+    previewcache.cpp \
+    previewengine.cpp \
+    scanindex.cpp \
+    sizescanner.cpp \
+    snapshotdialog.cpp \
+    statcache.cpp \
+    treemaplayout.cpp \
+    treemapwidget.cpp \
+    util.cpp \
+    workstealingpool.cpp
 
 HEADERS += \
+    archivepreview.h \
+    batchinspector.h \
+    batchio.h \
+    changetracker.h \
+    contentgrep.h \
+    contenthasher.h \
     detailwidget.h \
+    dirlister.h \
+    duplicatefinder.h \
+    duplicatesdialog.h \
+    filenameindex.h \
+    filesearch.h \
+    filesystemmodel.h \
+    findinfilesdialog.h \
+    foldersnapshot.h \
+    hexformatter.h \
+    hexviewer.h \
+    largefileviewer.h \
+    lineindex.h \
+    literalmatcher.h \
+    logtailer.h \
+    mimeclassifier.h \
+    namearena.h \
+    pathcompleter.h \
     pathinspectormain.h \
     pathinspectorwidget.h \
-    util.h
+    perfoverlay.h \
+    perftracer.h \
+    previewcache.h \
+    previewengine.h \
+    previewtypes.h \
+    scanindex.h \
+    sizescanner.h \
+    snapshotdialog.h \
+    statcache.h \
+    treemaplayout.h \
+    treemapwidget.h \
+    util.h \
+    workstealingpool.h
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
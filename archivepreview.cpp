@@ -0,0 +1,903 @@
+#include "archivepreview.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QLocale>
+#include <QObject>
+#include <QStringList>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined( FILEINSPECTOR_ZLIB )
+#include <zlib.h>
+#endif
+#if defined( FILEINSPECTOR_ZSTD )
+#include <zstd.h>
+#endif
+#if defined( FILEINSPECTOR_LZMA )
+#include <lzma.h>
+#endif
+
+#include "hexformatter.h"
+
+namespace
+{
+  // Number of bytes read from a file or decompressed at once
+  constexpr qint64 chunkSize = 64 * 1024;
+  // Number of decompressed bytes previewed if the request does not limit the characters
+  constexpr qint64 defaultHeadSize = 64 * 1024;
+  // Number of leading decompressed bytes checked for binary contents
+  constexpr int binaryCheckSize = 4096;
+  // Size of a tar header and of the blocks of a tar archive
+  constexpr int tarBlockSize = 512;
+  // Number of bytes of a long name or an extended header of a tar member read at most, larger ones are skipped
+  constexpr qint64 maximumTarMetadataSize = 1024 * 1024;
+  // Size of the end of central directory record of a zip archive, without the comment
+  constexpr int zipEndSize = 22;
+  // Number of bytes at the end of a zip archive searched for the end of central directory record
+  constexpr qint64 zipTailSize = zipEndSize + 0xffff;
+  // Size of the fixed part of a zip central directory entry
+  constexpr int zipEntrySize = 46;
+  // Size of the fixed part of a zip64 end of central directory record
+  constexpr int zip64EndSize = 56;
+  // Size of the zip64 end of central directory locator
+  constexpr int zip64LocatorSize = 20;
+  // Interval between two intermediate listings, in ms
+  constexpr qint64 partialInterval = 200;
+#if defined( FILEINSPECTOR_LZMA )
+  // Memory an xz decoder may use at most, streams compressed with a larger dictionary are not previewed
+  constexpr uint64_t xzMemoryLimit = 256 * 1024 * 1024;
+#endif
+
+  /*!
+     Sequential source of bytes
+   */
+  class byteSource_c
+  {
+    public:
+      virtual ~byteSource_c() = default;
+
+      /*!
+         Reads up to \a size bytes into \a data
+         \param data output for the bytes
+         \param size number of the bytes
+         \return number of the bytes read, 0 at the end of the source or on an error
+       */
+      virtual qint64 read( char *data, qint64 size ) = 0;
+
+      /*!
+         Skips \a size bytes by reading them
+         \param size number of the bytes
+         \param isCancelled returns true once the skipping is not needed anymore
+         \return false if the source ended before or the skipping was cancelled
+       */
+      virtual bool skip( qint64 size, const std::function<bool()> &isCancelled )
+      {
+        std::vector<char> scratch( static_cast<size_t>( std::min( size, chunkSize ) ) );
+        while ( size > 0 )
+        {
+          if ( isCancelled() )
+            return false;
+
+          const qint64 bytesRead = read( scratch.data(), std::min( size, chunkSize ) );
+          if ( bytesRead <= 0 )
+            return false;
+          size -= bytesRead;
+        }
+        return true;
+      }
+  };
+
+  /*!
+     Reads exactly \a size bytes from \a source into \a data
+     \param source the source
+     \param data output for the bytes
+     \param size number of the bytes
+     \return false if the source ended before
+   */
+  bool readExactly( byteSource_c &source, char *data, qint64 size )
+  {
+    while ( size > 0 )
+    {
+      const qint64 bytesRead = source.read( data, size );
+      if ( bytesRead <= 0 )
+        return false;
+      data += bytesRead;
+      size -= bytesRead;
+    }
+    return true;
+  }
+
+  /*!
+     Bytes of an open file, skipped by seeking
+   */
+  class fileSource_c : public byteSource_c
+  {
+    private:
+      QFile &_file;
+
+    public:
+      explicit fileSource_c( QFile &file ) :
+        _file{ file }
+      {
+      }
+
+      qint64 read( char *data, qint64 size ) override
+      {
+        return std::max<qint64>( _file.read( data, size ), 0 );
+      }
+
+      bool skip( qint64 size, const std::function<bool()> & ) override
+      {
+        const qint64 position = _file.pos() + size;
+        return position <= _file.size() && _file.seek( position );
+      }
+  };
+
+  /*!
+     Bytes already read from a source followed by the rest of the source
+   */
+  class replaySource_c : public byteSource_c
+  {
+    private:
+      QByteArray _head;
+      int _position;
+      byteSource_c &_source;
+
+    public:
+      replaySource_c( const QByteArray &head, byteSource_c &source ) :
+        _head{ head },
+        _position{ 0 },
+        _source{ source }
+      {
+      }
+
+      qint64 read( char *data, qint64 size ) override
+      {
+        if ( _position >= _head.size() )
+          return _source.read( data, size );
+
+        const int length = static_cast<int>( std::min<qint64>( size, _head.size() - _position ) );
+        std::memcpy( data, _head.constData() + _position, static_cast<size_t>( length ) );
+        _position += length;
+        return length;
+      }
+  };
+
+#if defined( FILEINSPECTOR_ZLIB )
+  /*!
+     Decompressed bytes of a gzip stream, of all its members if concatenated
+   */
+  class gzipSource_c : public byteSource_c
+  {
+    private:
+      byteSource_c &_input;
+      std::vector<char> _inputBuffer;
+      z_stream _stream;
+      bool _initialized;
+      bool _ended;
+
+    public:
+      explicit gzipSource_c( byteSource_c &input ) :
+        _input{ input },
+        _inputBuffer( static_cast<size_t>( chunkSize ) )
+      {
+        std::memset( &_stream, 0, sizeof( _stream ) );
+        // 32 added to the window bits expects a gzip or zlib header
+        _initialized = inflateInit2( &_stream, MAX_WBITS + 32 ) == Z_OK;
+        _ended = !_initialized;
+      }
+
+      ~gzipSource_c() override
+      {
+        if ( _initialized )
+          inflateEnd( &_stream );
+      }
+
+      qint64 read( char *data, qint64 size ) override
+      {
+        if ( _ended )
+          return 0;
+
+        _stream.next_out = reinterpret_cast<Bytef *>( data );
+        _stream.avail_out = static_cast<uInt>( size );
+        while ( _stream.avail_out > 0 )
+        {
+          if ( _stream.avail_in == 0 )
+          {
+            const qint64 bytesRead = _input.read( _inputBuffer.data(), chunkSize );
+            if ( bytesRead <= 0 )
+            {
+              _ended = true;
+              break;
+            }
+            _stream.next_in = reinterpret_cast<Bytef *>( _inputBuffer.data() );
+            _stream.avail_in = static_cast<uInt>( bytesRead );
+          }
+
+          const int status = inflate( &_stream, Z_NO_FLUSH );
+          if ( status == Z_STREAM_END )
+          {
+            // a member ended, another one may follow, e.g. of a log compressed in parts
+            if ( inflateReset( &_stream ) != Z_OK )
+            {
+              _ended = true;
+              break;
+            }
+          }
+          else if ( status != Z_OK )
+          {
+            // trailing garbage or corrupted data ends the contents
+            _ended = true;
+            break;
+          }
+        }
+
+        return size - _stream.avail_out;
+      }
+  };
+#endif
+
+#if defined( FILEINSPECTOR_ZSTD )
+  /*!
+     Decompressed bytes of a zstd stream, of all its frames
+   */
+  class zstdSource_c : public byteSource_c
+  {
+    private:
+      byteSource_c &_input;
+      std::vector<char> _inputBuffer;
+      ZSTD_DStream *_stream;
+      ZSTD_inBuffer _inBuffer;
+      bool _ended;
+
+    public:
+      explicit zstdSource_c( byteSource_c &input ) :
+        _input{ input },
+        _inputBuffer( static_cast<size_t>( chunkSize ) ),
+        _stream{ ZSTD_createDStream() },
+        _inBuffer{ nullptr, 0, 0 },
+        _ended{ _stream == nullptr }
+      {
+        if ( _stream != nullptr )
+          _ended = ZSTD_isError( ZSTD_initDStream( _stream ) );
+      }
+
+      ~zstdSource_c() override
+      {
+        if ( _stream != nullptr )
+          ZSTD_freeDStream( _stream );
+      }
+
+      qint64 read( char *data, qint64 size ) override
+      {
+        if ( _ended )
+          return 0;
+
+        ZSTD_outBuffer outBuffer{ data, static_cast<size_t>( size ), 0 };
+        while ( outBuffer.pos < outBuffer.size )
+        {
+          if ( _inBuffer.pos == _inBuffer.size )
+          {
+            const qint64 bytesRead = _input.read( _inputBuffer.data(), chunkSize );
+            if ( bytesRead <= 0 )
+            {
+              _ended = true;
+              break;
+            }
+            _inBuffer = { _inputBuffer.data(), static_cast<size_t>( bytesRead ), 0 };
+          }
+
+          // frames exceeding the default window limit fail, which bounds the memory of the decoder
+          if ( ZSTD_isError( ZSTD_decompressStream( _stream, &outBuffer, &_inBuffer ) ) )
+          {
+            _ended = true;
+            break;
+          }
+        }
+
+        return static_cast<qint64>( outBuffer.pos );
+      }
+  };
+#endif
+
+#if defined( FILEINSPECTOR_LZMA )
+  /*!
+     Decompressed bytes of an xz stream, of all its concatenated streams
+   */
+  class xzSource_c : public byteSource_c
+  {
+    private:
+      byteSource_c &_input;
+      std::vector<char> _inputBuffer;
+      lzma_stream _stream;
+      bool _inputEnded;
+      bool _ended;
+
+    public:
+      explicit xzSource_c( byteSource_c &input ) :
+        _input{ input },
+        _inputBuffer( static_cast<size_t>( chunkSize ) ),
+        _stream LZMA_STREAM_INIT,
+        _inputEnded{ false }
+      {
+        _ended = lzma_stream_decoder( &_stream, xzMemoryLimit, LZMA_CONCATENATED ) != LZMA_OK;
+      }
+
+      ~xzSource_c() override
+      {
+        lzma_end( &_stream );
+      }
+
+      qint64 read( char *data, qint64 size ) override
+      {
+        if ( _ended )
+          return 0;
+
+        _stream.next_out = reinterpret_cast<uint8_t *>( data );
+        _stream.avail_out = static_cast<size_t>( size );
+        while ( _stream.avail_out > 0 )
+        {
+          if ( _stream.avail_in == 0 && !_inputEnded )
+          {
+            const qint64 bytesRead = _input.read( _inputBuffer.data(), chunkSize );
+            _inputEnded = bytesRead <= 0;
+            _stream.next_in = reinterpret_cast<const uint8_t *>( _inputBuffer.data() );
+            _stream.avail_in = static_cast<size_t>( std::max<qint64>( bytesRead, 0 ) );
+          }
+
+          // the concatenated streams are finished explicitly once the input ended
+          if ( lzma_code( &_stream, _inputEnded ? LZMA_FINISH : LZMA_RUN ) != LZMA_OK )
+          {
+            _ended = true;
+            break;
+          }
+        }
+
+        return size - static_cast<qint64>( _stream.avail_out );
+      }
+  };
+#endif
+
+  /*!
+     Parses a numeric field of a tar header, octal or base-256 for large values
+     \param field the field
+     \param length length of the field
+     \return the value, -1 if the field is not a number
+   */
+  qint64 parseTarNumber( const char *field, int length )
+  {
+    const auto *bytes = reinterpret_cast<const uchar *>( field );
+    if ( bytes[ 0 ] & 0x80 )
+    {
+      // base-256, negative values are not valid sizes
+      if ( bytes[ 0 ] & 0x40 )
+        return -1;
+      quint64 value = bytes[ 0 ] & 0x3f;
+      for ( int index = 1; index < length; index++ )
+      {
+        if ( value >> 55 )
+          return -1;
+        value = ( value << 8 ) | bytes[ index ];
+      }
+      return static_cast<qint64>( value );
+    }
+
+    int index = 0;
+    while ( index < length && ( field[ index ] == ' ' || field[ index ] == '\0' ) )
+      index++;
+    if ( index == length || field[ index ] < '0' || field[ index ] > '7' )
+      return -1;
+
+    qint64 value = 0;
+    for ( ; index < length && field[ index ] >= '0' && field[ index ] <= '7'; index++ )
+      value = value * 8 + ( field[ index ] - '0' );
+    return value;
+  }
+
+  /*!
+     \param block a block of 512 bytes
+     \return true if the block is a tar header with a valid checksum
+   */
+  bool isTarHeader( const char *block )
+  {
+    // the checksum is the sum of the header bytes, the checksum field counted as spaces
+    const qint64 checksum = parseTarNumber( block + 148, 8 );
+    if ( checksum <= 0 )
+      return false;
+
+    qint64 sum = 0;
+    for ( int index = 0; index < tarBlockSize; index++ )
+      sum += ( index >= 148 && index < 156 ) ? ' ' : static_cast<uchar>( block[ index ] );
+    return sum == checksum;
+  }
+
+  /*!
+     \param field a NUL padded text field of a tar header
+     \param length length of the field
+     \return the text
+   */
+  QString tarText( const char *field, int length )
+  {
+    return QString::fromUtf8( field, static_cast<int>( strnlen( field, static_cast<size_t>( length ) ) ) );
+  }
+
+  /*!
+     Parses the records "<length> <key>=<value>\n" of a pax extended header \a data
+     \param data the extended header
+     \param path receives the path record, unchanged if none
+     \param size receives the size record, unchanged if none
+   */
+  void parsePaxHeader( const QByteArray &data, QString &path, qint64 &size )
+  {
+    int position = 0;
+    while ( position < data.size() )
+    {
+      const int space = data.indexOf( ' ', position );
+      if ( space < 0 )
+        return;
+      bool valid = false;
+      const int length = data.mid( position, space - position ).toInt( &valid );
+      if ( !valid || length <= space - position || position + length > data.size() )
+        return;
+
+      // the record ends with a newline, not part of the value
+      const QByteArray record = data.mid( space + 1, position + length - space - 2 );
+      if ( record.startsWith( "path=" ) )
+        path = QString::fromUtf8( record.mid( 5 ) );
+      else if ( record.startsWith( "size=" ) )
+        size = record.mid( 5 ).toLongLong();
+      position += length;
+    }
+  }
+
+  /*!
+     Appends the listing line of a member to \a lines
+     \param lines the listing
+     \param name name of the member, folders ending with a slash
+     \param size size of the member, -1 for a link, ignored for folders
+   */
+  void appendMember( QStringList &lines, const QString &name, qint64 size )
+  {
+    if ( name.endsWith( '/' ) || size < 0 )
+      lines << name;
+    else
+      lines << QString( "%1  (%2)" ).arg( name ).arg( QLocale().formattedDataSize( size ) );
+  }
+
+  /*!
+     Lists the members of a tar archive read from \a source, skipping their data
+     \param source the archive
+     \param maxLines number of the members listed at most, -1 for all
+     \param isCancelled returns true once the listing is not needed anymore
+     \param partialListing receives intermediate listings, may be empty
+     \param lines receives the listing
+   */
+  void listTar( byteSource_c &source, int maxLines, const std::function<bool()> &isCancelled,
+                const std::function<void( const QString & )> &partialListing, QStringList &lines )
+  {
+    QElapsedTimer partialTimer;
+    partialTimer.start();
+
+    // attributes of the next member given by the metadata members preceding it
+    QString longName;
+    QString paxPath;
+    qint64 paxSize = -1;
+
+    char header[ tarBlockSize ];
+    while ( !isCancelled() && readExactly( source, header, tarBlockSize ) )
+    {
+      // the archive ends with zero blocks
+      if ( std::all_of( header, header + tarBlockSize, []( char byte ) { return byte == '\0'; } ) )
+        return;
+      if ( !isTarHeader( header ) )
+      {
+        lines << QObject::tr( "(damaged member header)" );
+        return;
+      }
+
+      const char type = header[ 156 ];
+      qint64 size = parseTarNumber( header + 124, 12 );
+      if ( size < 0 )
+      {
+        lines << QObject::tr( "(damaged member header)" );
+        return;
+      }
+      const qint64 paddedSize = ( size + tarBlockSize - 1 ) / tarBlockSize * tarBlockSize;
+
+      if ( ( type == 'L' || type == 'x' ) && size <= maximumTarMetadataSize )
+      {
+        QByteArray data( static_cast<int>( paddedSize ), Qt::Uninitialized );
+        if ( !readExactly( source, data.data(), paddedSize ) )
+          return;
+        data.truncate( static_cast<int>( size ) );
+        if ( type == 'L' )
+          longName = tarText( data.constData(), data.size() );
+        else
+          parsePaxHeader( data, paxPath, paxSize );
+        continue;
+      }
+      if ( type == 'L' || type == 'x' || type == 'K' || type == 'g' )
+      {
+        // oversized metadata, long link names and global headers are not listed
+        if ( !source.skip( paddedSize, isCancelled ) )
+          return;
+        continue;
+      }
+
+      if ( maxLines >= 0 && lines.size() >= maxLines )
+      {
+        lines << "...";
+        return;
+      }
+
+      QString name = !paxPath.isEmpty() ? paxPath : longName;
+      if ( name.isEmpty() )
+      {
+        // a ustar header splits long names into a prefix and a name
+        const QString prefix = ( std::memcmp( header + 257, "ustar", 5 ) == 0 ) ? tarText( header + 345, 155 )
+                                                                                 : QString();
+        name = tarText( header, 100 );
+        if ( !prefix.isEmpty() )
+          name = prefix + '/' + name;
+      }
+      if ( paxSize >= 0 )
+        size = paxSize;
+      if ( type == '5' && !name.endsWith( '/' ) )
+        name += '/';
+      if ( type == '2' )
+        name += " -> " + tarText( header + 157, 100 );
+      longName.clear();
+      paxPath.clear();
+      paxSize = -1;
+
+      appendMember( lines, name, ( type == '1' || type == '2' ) ? -1 : size );
+      if ( partialListing && partialTimer.elapsed() >= partialInterval )
+      {
+        partialListing( lines.join( "\n" ) );
+        partialTimer.restart();
+      }
+
+      // links and folders have no data
+      const qint64 dataSize = ( type == '1' || type == '2' || type == '5' ) ? 0 : size;
+      if ( !source.skip( ( dataSize + tarBlockSize - 1 ) / tarBlockSize * tarBlockSize, isCancelled ) )
+        return;
+    }
+  }
+
+  /*!
+     Lists the members of a zip archive given by \a file from its central directory
+     \param file the archive
+     \param maxLines number of the members listed at most, -1 for all
+     \param isCancelled returns true once the listing is not needed anymore
+     \param lines receives the listing
+     \return false if the central directory was not found
+   */
+  bool listZip( QFile &file, int maxLines, const std::function<bool()> &isCancelled, QStringList &lines )
+  {
+    const qint64 fileSize = file.size();
+    const qint64 tailOffset = std::max<qint64>( fileSize - zipTailSize, 0 );
+    if ( !file.seek( tailOffset ) )
+      return false;
+    const QByteArray tail = file.read( fileSize - tailOffset );
+
+    // the end of central directory record is followed by a comment of variable length
+    int endPosition = tail.size() - zipEndSize;
+    while ( endPosition >= 0 && std::memcmp( tail.constData() + endPosition, "PK\x05\x06", 4 ) != 0 )
+      endPosition--;
+    if ( endPosition < 0 )
+      return false;
+
+    const char *end = tail.constData() + endPosition;
+    quint64 entryCount = qFromLittleEndian<quint16>( end + 10 );
+    quint64 directorySize = qFromLittleEndian<quint32>( end + 12 );
+    quint64 directoryOffset = qFromLittleEndian<quint32>( end + 16 );
+    qint64 directoryEnd = tailOffset + endPosition;
+
+    const bool isZip64 = entryCount == 0xffff || directorySize == 0xffffffff || directoryOffset == 0xffffffff;
+    if ( isZip64 && endPosition >= zip64LocatorSize &&
+         std::memcmp( end - zip64LocatorSize, "PK\x06\x07", 4 ) == 0 )
+    {
+      const qint64 zip64EndOffset = qFromLittleEndian<qint64>( end - zip64LocatorSize + 8 );
+      char zip64End[ zip64EndSize ];
+      if ( !file.seek( zip64EndOffset ) || file.read( zip64End, zip64EndSize ) != zip64EndSize ||
+           std::memcmp( zip64End, "PK\x06\x06", 4 ) != 0 )
+        return false;
+
+      entryCount = qFromLittleEndian<quint64>( zip64End + 32 );
+      directorySize = qFromLittleEndian<quint64>( zip64End + 40 );
+      directoryOffset = qFromLittleEndian<quint64>( zip64End + 48 );
+      directoryEnd = zip64EndOffset;
+    }
+
+    // data prepended to the archive, e.g. a self-extractor, shifts the offsets recorded in it
+    const qint64 shift = directoryEnd - static_cast<qint64>( directoryOffset + directorySize );
+    if ( shift < 0 || !file.seek( static_cast<qint64>( directoryOffset ) + shift ) )
+      return false;
+
+    quint64 listed = 0;
+    for ( ; listed < entryCount && ( maxLines < 0 || lines.size() < maxLines ); listed++ )
+    {
+      if ( isCancelled() )
+        return true;
+
+      char entry[ zipEntrySize ];
+      if ( file.read( entry, zipEntrySize ) != zipEntrySize || std::memcmp( entry, "PK\x01\x02", 4 ) != 0 )
+      {
+        lines << QObject::tr( "(damaged central directory)" );
+        return true;
+      }
+
+      const int nameLength = qFromLittleEndian<quint16>( entry + 28 );
+      const int extraLength = qFromLittleEndian<quint16>( entry + 30 );
+      const int commentLength = qFromLittleEndian<quint16>( entry + 32 );
+      const QByteArray name = file.read( nameLength );
+      const QByteArray extra = file.read( extraLength );
+      if ( name.size() != nameLength || extra.size() != extraLength || !file.seek( file.pos() + commentLength ) )
+      {
+        lines << QObject::tr( "(damaged central directory)" );
+        return true;
+      }
+
+      quint64 size = qFromLittleEndian<quint32>( entry + 24 );
+      if ( size == 0xffffffff )
+      {
+        // the zip64 extended information holds the size, first of its fields
+        for ( int position = 0; position + 4 <= extra.size(); )
+        {
+          const quint16 id = qFromLittleEndian<quint16>( extra.constData() + position );
+          const int length = qFromLittleEndian<quint16>( extra.constData() + position + 2 );
+          if ( id == 0x0001 && length >= 8 && position + 4 + 8 <= extra.size() )
+          {
+            size = qFromLittleEndian<quint64>( extra.constData() + position + 4 );
+            break;
+          }
+          position += 4 + length;
+        }
+      }
+
+      appendMember( lines, QString::fromUtf8( name ), static_cast<qint64>( size ) );
+    }
+
+    if ( listed < entryCount )
+      lines << QObject::tr( "... %1 more" ).arg( entryCount - listed );
+    return true;
+  }
+
+  /*!
+     Reads the head of contents from \a source, as text or as a hex dump of binary contents
+     \param source the contents
+     \param maxChars number of the characters read at most, -1 for a default
+     \param maxLines number of the lines read at most, -1 for all
+     \param isCancelled returns true once the head is not needed anymore
+     \return the head
+   */
+  QString readHead( byteSource_c &source, int maxChars, int maxLines, const std::function<bool()> &isCancelled )
+  {
+    // a character takes a byte at least
+    const qint64 byteLimit = ( maxChars > 0 ) ? maxChars : defaultHeadSize;
+    QByteArray head;
+    std::vector<char> chunk( static_cast<size_t>( std::min( byteLimit, chunkSize ) ) );
+    int lineCount = 0;
+    bool truncated = true;
+    while ( head.size() < byteLimit && ( maxLines < 0 || lineCount < maxLines ) && !isCancelled() )
+    {
+      const qint64 bytesRead = source.read( chunk.data(), std::min<qint64>( static_cast<qint64>( chunk.size() ),
+                                                                            byteLimit - head.size() ) );
+      if ( bytesRead <= 0 )
+      {
+        truncated = false;
+        break;
+      }
+      head.append( chunk.data(), static_cast<int>( bytesRead ) );
+      lineCount += static_cast<int>( std::count( chunk.data(), chunk.data() + bytesRead, '\n' ) );
+    }
+
+    if ( head.left( binaryCheckSize ).contains( '\0' ) )
+    {
+      const int offsetDigits = hexFormatter_c::offsetDigits( head.size() );
+      QStringList rows;
+      for ( int offset = 0; offset < head.size() && ( maxLines < 0 || rows.size() < maxLines );
+            offset += hexFormatter_c::bytesPerRow )
+      {
+        rows << hexFormatter_c::formatRow( offset, offsetDigits, reinterpret_cast<const uchar *>( head.constData() ) +
+                                           offset, std::min( hexFormatter_c::bytesPerRow, head.size() - offset ) );
+      }
+      return rows.join( "\n" );
+    }
+
+    if ( maxLines >= 0 && lineCount >= maxLines )
+    {
+      int position = -1;
+      for ( int line = 0; line < maxLines; line++ )
+        position = head.indexOf( '\n', position + 1 );
+      head.truncate( position );
+    }
+
+    QString text = QString::fromUtf8( head );
+    if ( maxChars > 0 && text.size() > maxChars )
+      text.truncate( maxChars );
+    // a character split by the limit is not shown
+    if ( truncated && text.endsWith( QChar::ReplacementCharacter ) )
+      text.chop( 1 );
+    return text;
+  }
+
+  /*!
+     Previews decompressed contents from \a source, listing the members of a compressed tar archive
+     \param source the decompressed contents
+     \param maxChars number of the characters previewed at most
+     \param maxLines number of the lines previewed at most
+     \param isCancelled returns true once the preview is not needed anymore
+     \param partialContent receives intermediate listings, may be empty
+     \return the preview
+   */
+  QString previewContents( byteSource_c &source, int maxChars, int maxLines, const std::function<bool()> &isCancelled,
+                           const std::function<void( const QString & )> &partialContent )
+  {
+    QByteArray head( tarBlockSize, Qt::Uninitialized );
+    int headSize = 0;
+    while ( headSize < tarBlockSize )
+    {
+      const qint64 bytesRead = source.read( head.data() + headSize, tarBlockSize - headSize );
+      if ( bytesRead <= 0 )
+        break;
+      headSize += static_cast<int>( bytesRead );
+    }
+    head.truncate( headSize );
+
+    replaySource_c contents( head, source );
+    if ( head.size() == tarBlockSize && isTarHeader( head.constData() ) )
+    {
+      QStringList lines;
+      listTar( contents, maxLines, isCancelled, partialContent, lines );
+      return lines.join( "\n" );
+    }
+
+    return readHead( contents, maxChars, maxLines, isCancelled );
+  }
+}
+
+/*!
+   Detects the format of a file from its leading bytes \a head
+   \param head at least \em detectionSize leading bytes of the file, unless the file is shorter
+   \return the format, \em format_e::None if the file is neither compressed nor an archive
+ */
+archivePreview_c::format_e archivePreview_c::detect( const QByteArray &head )
+{
+  if ( head.startsWith( "\x1f\x8b" ) )
+    return format_e::Gzip;
+  if ( head.startsWith( "\x28\xb5\x2f\xfd" ) )
+    return format_e::Zstd;
+  if ( head.startsWith( QByteArray( "\xfd" "7zXZ\0", 6 ) ) )
+    return format_e::Xz;
+  if ( head.startsWith( "PK\x03\x04" ) || head.startsWith( "PK\x05\x06" ) )
+    return format_e::Zip;
+  if ( head.size() >= tarBlockSize && isTarHeader( head.constData() ) )
+    return format_e::Tar;
+  return format_e::None;
+}
+
+/*!
+   Detects the format of a file given at \a path
+   \param path path to the file
+   \return the format, \em format_e::None if the file is neither compressed nor an archive or cannot be read
+ */
+archivePreview_c::format_e archivePreview_c::detect( const QString &path )
+{
+  QFile file( path );
+  if ( !file.open( QIODevice::ReadOnly ) )
+    return format_e::None;
+
+  return detect( file.read( detectionSize ) );
+}
+
+/*!
+   \param format a format
+   \return true if files of the format can be previewed
+ */
+bool archivePreview_c::isSupported( format_e format )
+{
+  switch ( format )
+  {
+    case format_e::Gzip:
+#if defined( FILEINSPECTOR_ZLIB )
+      return true;
+#else
+      return false;
+#endif
+    case format_e::Zstd:
+#if defined( FILEINSPECTOR_ZSTD )
+      return true;
+#else
+      return false;
+#endif
+    case format_e::Xz:
+#if defined( FILEINSPECTOR_LZMA )
+      return true;
+#else
+      return false;
+#endif
+    case format_e::Tar:
+    case format_e::Zip:
+      return true;
+    case format_e::None:
+      break;
+  }
+  return false;
+}
+
+/*!
+   Previews a compressed file or an archive given at \a path
+   A compressed file is previewed by the head of its decompressed contents, or by the members of a compressed tar
+   archive. An archive is previewed by its members and their sizes.
+   \param path path to the file
+   \param format format of the file, see detect()
+   \param maxChars number of the decompressed characters previewed at most, -1 for a default
+   \param maxLines number of the lines or members previewed at most, -1 for all
+   \param isCancelled returns true once the preview is not needed anymore
+   \param partialContent receives intermediate listings of a slowly listed archive, may be empty
+   \param content receives the preview, may be incomplete if cancelled
+   \return false if the file cannot be read or its format is not supported
+ */
+bool archivePreview_c::preview( const QString &path, format_e format, int maxChars, int maxLines,
+                                const std::function<bool()> &isCancelled,
+                                const std::function<void( const QString & )> &partialContent, QString &content )
+{
+  if ( !isSupported( format ) )
+    return false;
+
+  QFile file( path );
+  if ( !file.open( QIODevice::ReadOnly ) )
+    return false;
+
+  fileSource_c fileSource( file );
+  switch ( format )
+  {
+    case format_e::Gzip:
+    {
+#if defined( FILEINSPECTOR_ZLIB )
+      gzipSource_c source( fileSource );
+      content = previewContents( source, maxChars, maxLines, isCancelled, partialContent );
+#endif
+      return true;
+    }
+    case format_e::Zstd:
+    {
+#if defined( FILEINSPECTOR_ZSTD )
+      zstdSource_c source( fileSource );
+      content = previewContents( source, maxChars, maxLines, isCancelled, partialContent );
+#endif
+      return true;
+    }
+    case format_e::Xz:
+    {
+#if defined( FILEINSPECTOR_LZMA )
+      xzSource_c source( fileSource );
+      content = previewContents( source, maxChars, maxLines, isCancelled, partialContent );
+#endif
+      return true;
+    }
+    case format_e::Tar:
+    {
+      QStringList lines;
+      listTar( fileSource, maxLines, isCancelled, partialContent, lines );
+      content = lines.join( "\n" );
+      return true;
+    }
+    case format_e::Zip:
+    {
+      QStringList lines;
+      if ( !listZip( file, maxLines, isCancelled, lines ) )
+        return false;
+      content = lines.join( "\n" );
+      return true;
+    }
+    case format_e::None:
+      break;
+  }
+  return false;
+}
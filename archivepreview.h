@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+#include <functional>
+
+/*!
+   Previews compressed files and archives without extracting them
+   A gzip, zstd or xz compressed file is decompressed as a stream, only up to the bytes filling the preview, shown
+   as text or, for binary contents, as a hex dump. The members of a tar archive, compressed or not, are listed from
+   their headers, the data of the members are skipped. The members of a zip archive are listed from its central
+   directory. Files are read in fixed size chunks, so the memory needed does not depend on the size of the archive,
+   and the work stops as soon as it is cancelled. The decompressors are optional, a compressed file whose
+   decompressor is not built in is not previewed.
+ */
+class archivePreview_c
+{
+  public:
+    enum class format_e
+    {
+      None,
+      Gzip,
+      Zstd,
+      Xz,
+      Tar,
+      Zip
+    };
+
+    // Number of leading bytes needed to detect a format
+    static constexpr int detectionSize = 512;
+
+    static format_e detect( const QByteArray & );
+    static format_e detect( const QString & );
+    static bool isSupported( format_e );
+    static QString formatName( format_e );
+
+    static bool preview( const QString &, format_e, int, int, const std::function<bool()> &,
+                         const std::function<void( const QString & )> &, QString & );
+};
@@ -0,0 +1,663 @@
+#include "batchinspector.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined( Q_OS_UNIX )
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "dirlister.h"
+#include "mimeclassifier.h"
+#include "statcache.h"
+#include "util.h"
+#include "workstealingpool.h"
+
+namespace
+{
+  // Output buffer size of a worker, written out once exceeded
+  constexpr size_t outputChunkSize = 1024 * 1024;
+  // Command line switch selecting the headless inspection
+  constexpr char batchOption[] = "--batch";
+
+  /*!
+     Folder of the traversal
+     A folder is complete once it is listed and all of its sub-folders are complete.
+   */
+  struct dirNode_s
+  {
+    std::shared_ptr<dirNode_s> parent;
+    // Path to the folder, as given to the file system
+    std::string path;
+    quint64 device;
+    // Modification time in ms since epoch
+    qint64 modified;
+    // Recursive size of the folder content counted so far
+    std::atomic<qint64> bytes{ 0 };
+    // Listing of the folder and incomplete sub-folders
+    std::atomic<int> pending{ 1 };
+  };
+
+  /*!
+     Attributes of a reported entry
+   */
+  struct entryRecord_s
+  {
+    const char *type;
+    qint64 size;
+    qint64 modified;
+    QString mimeName;
+    QString text;
+  };
+
+  /*!
+     Appends a text \a text to an output buffer as a JSON string
+     \param buffer the output buffer
+     \param text UTF-8 encoded text
+   */
+  void appendJsonString( std::string &buffer, const QByteArray &text )
+  {
+    static const char hexDigits[] = "0123456789abcdef";
+
+    buffer += '"';
+    for ( const char character : text )
+    {
+      const unsigned char byte = static_cast<unsigned char>( character );
+      if ( byte == '"' || byte == '\\' )
+      {
+        buffer += '\\';
+        buffer += character;
+      }
+      else if ( byte < 0x20 )
+      {
+        buffer += "\\u00";
+        buffer += hexDigits[ byte >> 4 ];
+        buffer += hexDigits[ byte & 0x0f ];
+      }
+      else
+      {
+        buffer += character;
+      }
+    }
+    buffer += '"';
+  }
+
+  /*!
+     Appends a text \a text to an output buffer as a CSV field, quoted if needed
+     \param buffer the output buffer
+     \param text UTF-8 encoded text
+   */
+  void appendCsvField( std::string &buffer, const QByteArray &text )
+  {
+    const bool needsQuotes = std::any_of( text.begin(), text.end(), []( char character )
+    {
+      return character == ',' || character == '"' || character == '\r' || character == '\n';
+    } );
+    if ( !needsQuotes )
+    {
+      buffer.append( text.constData(), static_cast<size_t>( text.size() ) );
+      return;
+    }
+
+    buffer += '"';
+    for ( const char character : text )
+    {
+      if ( character == '"' )
+        buffer += '"';
+      buffer += character;
+    }
+    buffer += '"';
+  }
+
+  /*!
+     Converts a path \a path as given to the file system to UTF-8
+     \param path the path
+     \return UTF-8 encoded path
+   */
+  QByteArray utf8Path( const std::string &path )
+  {
+    const bool isAscii = std::all_of( path.begin(), path.end(), []( char character )
+    {
+      return static_cast<unsigned char>( character ) < 0x80;
+    } );
+    if ( isAscii )
+      return QByteArray::fromRawData( path.data(), static_cast<int>( path.size() ) );
+
+    return QFile::decodeName( path.c_str() ).toUtf8();
+  }
+
+#if defined( Q_OS_UNIX )
+  /*!
+     \param entryStat attributes of an entry
+     \return modification time of the entry in ms since epoch
+   */
+  qint64 modificationTime( const struct stat &entryStat )
+  {
+#if defined( Q_OS_DARWIN )
+    return static_cast<qint64>( entryStat.st_mtimespec.tv_sec ) * 1000 + entryStat.st_mtimespec.tv_nsec / 1000000;
+#else
+    return static_cast<qint64>( entryStat.st_mtim.tv_sec ) * 1000 + entryStat.st_mtim.tv_nsec / 1000000;
+#endif
+  }
+
+  /*!
+     \param mode mode of an entry
+     \return type of the entry as reported
+   */
+  const char *entryType( mode_t mode )
+  {
+    if ( S_ISREG( mode ) )
+      return "file";
+    if ( S_ISDIR( mode ) )
+      return "dir";
+    if ( S_ISLNK( mode ) )
+      return "symlink";
+    return "other";
+  }
+
+  /*!
+     \param entryStat attributes of an entry, a symbolic link not followed
+     \return the attributes as taken by the classification and the preview, so they do not stat the entry again
+   */
+  statCache_c::status_s fileStatus( const struct stat &entryStat )
+  {
+    statCache_c::status_s status;
+    status.exists = true;
+    status.isDir = S_ISDIR( entryStat.st_mode );
+    status.isFile = S_ISREG( entryStat.st_mode );
+    status.size = entryStat.st_size;
+#if defined( Q_OS_DARWIN )
+    status.modified = static_cast<qint64>( entryStat.st_mtimespec.tv_sec ) * 1000000000 +
+                      entryStat.st_mtimespec.tv_nsec;
+#else
+    status.modified = static_cast<qint64>( entryStat.st_mtim.tv_sec ) * 1000000000 + entryStat.st_mtim.tv_nsec;
+#endif
+    status.device = static_cast<quint64>( entryStat.st_dev );
+    status.inode = static_cast<quint64>( entryStat.st_ino );
+    return status;
+  }
+#else
+  /*!
+     \param entryInfo attributes of an entry, a symbolic link not followed
+     \return the attributes as taken by the classification and the preview, so they do not stat the entry again
+   */
+  statCache_c::status_s fileStatus( const QFileInfo &entryInfo )
+  {
+    statCache_c::status_s status;
+    status.exists = true;
+    status.isDir = entryInfo.isDir() && !entryInfo.isSymLink();
+    status.isFile = entryInfo.isFile() && !entryInfo.isSymLink();
+    status.size = entryInfo.size();
+    status.modified = entryInfo.lastModified().toMSecsSinceEpoch() * 1000000;
+    return status;
+  }
+#endif
+}
+
+/*!
+   Shared state of an inspection
+ */
+struct batchInspector_c::inspectState_s
+{
+  batchOptions_s options;
+  FILE *output = nullptr;
+  std::mutex outputMutex;
+  // Output buffer of every worker
+  std::vector<std::string> buffers;
+  // MIME classifier of every worker, so the workers do not contend for the memo
+  std::vector<std::unique_ptr<mimeClassifier_c>> classifiers;
+  std::atomic<qint64> errorCount{ 0 };
+  // Writing the output failed, further records are dropped
+  std::atomic<bool> writeFailed{ false };
+};
+
+namespace
+{
+  using inspectState_t = batchInspector_c::inspectState_s;
+
+  /*!
+     Writes out an output buffer \a buffer, reporting a failed write once
+     \param state the inspection state
+     \param buffer the output buffer, emptied
+   */
+  void flushBuffer( inspectState_t &state, std::string &buffer )
+  {
+    if ( buffer.empty() )
+      return;
+
+    std::lock_guard<std::mutex> locker( state.outputMutex );
+    if ( !state.writeFailed && std::fwrite( buffer.data(), 1, buffer.size(), state.output ) != buffer.size() )
+    {
+      state.writeFailed = true;
+      std::fprintf( stderr, "Cannot write the records: %s\n", std::strerror( errno ) );
+    }
+    buffer.clear();
+  }
+
+  /*!
+     Reports an entry given at \a path
+     \param state the inspection state
+     \param worker index of the worker reporting the entry
+     \param path path to the entry
+     \param record attributes of the entry
+   */
+  void appendRecord( inspectState_t &state, int worker, const std::string &path, const entryRecord_s &record )
+  {
+    std::string &buffer = state.buffers[ static_cast<size_t>( worker ) ];
+    const bool withMime = state.options.detectMime;
+    const bool withText = state.options.previewSize > 0;
+
+    if ( state.options.format == batchOptions_s::format_e::JsonLines )
+    {
+      buffer += "{\"path\":";
+      appendJsonString( buffer, utf8Path( path ) );
+      buffer += ",\"type\":\"";
+      buffer += record.type;
+      buffer += "\",\"size\":";
+      buffer += std::to_string( record.size );
+      buffer += ",\"modified\":";
+      buffer += std::to_string( record.modified );
+      if ( withMime && !record.mimeName.isEmpty() )
+      {
+        buffer += ",\"mime\":";
+        appendJsonString( buffer, record.mimeName.toUtf8() );
+      }
+      if ( withText && !record.text.isEmpty() )
+      {
+        buffer += ",\"text\":";
+        appendJsonString( buffer, record.text.toUtf8() );
+      }
+      buffer += "}\n";
+    }
+    else
+    {
+      appendCsvField( buffer, utf8Path( path ) );
+      buffer += ',';
+      buffer += record.type;
+      buffer += ',';
+      buffer += std::to_string( record.size );
+      buffer += ',';
+      buffer += std::to_string( record.modified );
+      if ( withMime )
+      {
+        buffer += ',';
+        appendCsvField( buffer, record.mimeName.toUtf8() );
+      }
+      if ( withText )
+      {
+        buffer += ',';
+        appendCsvField( buffer, record.text.toUtf8() );
+      }
+      buffer += '\n';
+    }
+
+    if ( buffer.size() >= outputChunkSize )
+      flushBuffer( state, buffer );
+  }
+
+  /*!
+     Reports an error of an entry given at \a path on stderr
+     \param state the inspection state
+     \param path path to the entry
+     \param error the errno value
+   */
+  void reportError( inspectState_t &state, const std::string &path, int error )
+  {
+    state.errorCount++;
+    std::lock_guard<std::mutex> locker( state.outputMutex );
+    std::fprintf( stderr, "%s: %s\n", path.c_str(), std::strerror( error ) );
+  }
+
+  /*!
+     Reports a non-folder entry given at \a path, detecting its MIME type and previewing it if requested
+     \param state the inspection state
+     \param worker index of the worker reporting the entry
+     \param path path to the entry
+     \param record attributes of the entry, the MIME type and the preview are filled in
+     \param status attributes of the entry as listed, only a regular file is classified and previewed
+   */
+  void inspectFile( inspectState_t &state, int worker, const std::string &path, entryRecord_s &record,
+                    const statCache_c::status_s &status )
+  {
+    if ( status.isFile && ( state.options.detectMime || state.options.previewSize > 0 ) )
+    {
+      const QString filePath = QFile::decodeName( path.c_str() );
+      const mimeClassifier_c::mimeClass_s mimeClass =
+        state.classifiers[ static_cast<size_t>( worker ) ]->classify( filePath, status );
+      record.mimeName = mimeClass.mimeName;
+      if ( mimeClass.isText && state.options.previewSize > 0 )
+        record.text = fileInspector_n::util_n::getTextFileContent( filePath, status, state.options.previewSize );
+    }
+
+    appendRecord( state, worker, path, record );
+  }
+
+  /*!
+     Completes a folder \a node once its listing and all of its sub-folders are done, and then its parents
+     \param state the inspection state
+     \param worker index of the worker completing the folder
+     \param node the folder
+   */
+  void completeDirectory( inspectState_t &state, int worker, std::shared_ptr<dirNode_s> node )
+  {
+    while ( node && node->pending.fetch_sub( 1 ) == 1 )
+    {
+      const qint64 bytes = node->bytes;
+      appendRecord( state, worker, node->path, { "dir", bytes, node->modified, QString(), QString() } );
+
+      node = node->parent;
+      if ( node )
+        node->bytes += bytes;
+    }
+  }
+
+  /*!
+     Lists a folder \a node, reporting its files and submitting a task for every sub-folder
+     \param state the inspection state
+     \param pool the pool running the inspection
+     \param worker index of the worker listing the folder
+     \param node the folder
+   */
+  void inspectDirectory( const std::shared_ptr<inspectState_t> &state, workStealingPool_c &pool, int worker,
+                         const std::shared_ptr<dirNode_s> &node )
+  {
+    // the records could not be written anyway
+    if ( state->writeFailed )
+    {
+      completeDirectory( *state, worker, node );
+      return;
+    }
+
+    const std::string prefix = ( node->path.back() == '/' ) ? node->path : node->path + '/';
+    qint64 bytes = 0;
+
+#if defined( Q_OS_UNIX )
+    const int dirFd = open( node->path.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC );
+    if ( dirFd < 0 )
+    {
+      reportError( *state, node->path, errno );
+      completeDirectory( *state, worker, node );
+      return;
+    }
+
+    dirLister_c::readEntries( dirFd, [&]( const char *name, unsigned char )
+    {
+      std::string entryPath = prefix + name;
+      struct stat entryStat;
+      if ( fstatat( dirFd, name, &entryStat, AT_SYMLINK_NOFOLLOW ) != 0 )
+      {
+        reportError( *state, entryPath, errno );
+        return true;
+      }
+
+      if ( S_ISDIR( entryStat.st_mode ) )
+      {
+        if ( state->options.oneFileSystem && static_cast<quint64>( entryStat.st_dev ) != node->device )
+          return true;
+
+        auto child = std::make_shared<dirNode_s>();
+        child->parent = node;
+        child->path = std::move( entryPath );
+        child->device = static_cast<quint64>( entryStat.st_dev );
+        child->modified = modificationTime( entryStat );
+        node->pending++;
+        pool.submit( [state, &pool, child]( int childWorker )
+        {
+          inspectDirectory( state, pool, childWorker, child );
+        } );
+        return true;
+      }
+
+      entryRecord_s record{ entryType( entryStat.st_mode ), static_cast<qint64>( entryStat.st_size ),
+                            modificationTime( entryStat ), QString(), QString() };
+      bytes += record.size;
+      inspectFile( *state, worker, entryPath, record, fileStatus( entryStat ) );
+      return true;
+    } );
+
+    close( dirFd );
+#else
+    QDirIterator dirIt( QFile::decodeName( node->path.c_str() ), QDir::AllEntries | QDir::Hidden | QDir::System |
+                        QDir::NoDotAndDotDot );
+    while ( dirIt.hasNext() )
+    {
+      dirIt.next();
+      const QFileInfo entryInfo = dirIt.fileInfo();
+      std::string entryPath = prefix + QFile::encodeName( dirIt.fileName() ).toStdString();
+      if ( entryInfo.isDir() && !entryInfo.isSymLink() )
+      {
+        auto child = std::make_shared<dirNode_s>();
+        child->parent = node;
+        child->path = std::move( entryPath );
+        child->device = node->device;
+        child->modified = entryInfo.lastModified().toMSecsSinceEpoch();
+        node->pending++;
+        pool.submit( [state, &pool, child]( int childWorker )
+        {
+          inspectDirectory( state, pool, childWorker, child );
+        } );
+        continue;
+      }
+
+      entryRecord_s record{ entryInfo.isSymLink() ? "symlink" : ( entryInfo.isFile() ? "file" : "other" ),
+                            entryInfo.size(), entryInfo.lastModified().toMSecsSinceEpoch(), QString(), QString() };
+      bytes += record.size;
+      inspectFile( *state, worker, entryPath, record, fileStatus( entryInfo ) );
+    }
+#endif
+
+    node->bytes += bytes;
+    completeDirectory( *state, worker, node );
+  }
+
+  /*!
+     Starts the inspection of a root given at \a rootPath
+     \param state the inspection state
+     \param pool the pool running the inspection
+     \param worker index of the worker starting the inspection
+     \param rootPath path to the root
+   */
+  void inspectRoot( const std::shared_ptr<inspectState_t> &state, workStealingPool_c &pool, int worker,
+                    const std::string &rootPath )
+  {
+#if defined( Q_OS_UNIX )
+    struct stat rootStat;
+    if ( lstat( rootPath.c_str(), &rootStat ) != 0 )
+    {
+      reportError( *state, rootPath, errno );
+      return;
+    }
+
+    if ( !S_ISDIR( rootStat.st_mode ) )
+    {
+      entryRecord_s record{ entryType( rootStat.st_mode ), static_cast<qint64>( rootStat.st_size ),
+                            modificationTime( rootStat ), QString(), QString() };
+      inspectFile( *state, worker, rootPath, record, fileStatus( rootStat ) );
+      return;
+    }
+
+    auto node = std::make_shared<dirNode_s>();
+    node->path = rootPath;
+    node->device = static_cast<quint64>( rootStat.st_dev );
+    node->modified = modificationTime( rootStat );
+#else
+    const QFileInfo rootInfo( QFile::decodeName( rootPath.c_str() ) );
+    if ( !rootInfo.exists() )
+    {
+      reportError( *state, rootPath, ENOENT );
+      return;
+    }
+
+    if ( !rootInfo.isDir() || rootInfo.isSymLink() )
+    {
+      entryRecord_s record{ rootInfo.isSymLink() ? "symlink" : "file", rootInfo.size(),
+                            rootInfo.lastModified().toMSecsSinceEpoch(), QString(), QString() };
+      inspectFile( *state, worker, rootPath, record, fileStatus( rootInfo ) );
+      return;
+    }
+
+    auto node = std::make_shared<dirNode_s>();
+    node->path = rootPath;
+    node->device = 0;
+    node->modified = rootInfo.lastModified().toMSecsSinceEpoch();
+#endif
+
+    inspectDirectory( state, pool, worker, node );
+  }
+}
+
+/*!
+   C-tor
+   \param options the inspection options
+ */
+batchInspector_c::batchInspector_c( const batchOptions_s &options ) :
+  _options{ options }
+{
+}
+
+/*!
+   Inspects the roots, writing the records to \a output
+   \param output the output stream
+   \return 0 on success, 1 if some entries could not be inspected or the output could not be written
+ */
+int batchInspector_c::inspect( FILE *output )
+{
+  // the traversal is bound by the file system latency rather than by the processors
+  const int threadCount = ( _options.threadCount > 0 ) ? _options.threadCount
+                                                         : qMax( 4, QThread::idealThreadCount() * 2 );
+
+  auto state = std::make_shared<inspectState_s>();
+  state->options = _options;
+  state->output = output;
+  state->buffers.resize( static_cast<size_t>( threadCount ) );
+  for ( int worker = 0; worker < threadCount; worker++ )
+    state->classifiers.push_back( std::make_unique<mimeClassifier_c>() );
+
+  if ( _options.format == batchOptions_s::format_e::Csv )
+  {
+    std::string header = "path,type,size,modified";
+    if ( _options.detectMime )
+      header += ",mime";
+    if ( _options.previewSize > 0 )
+      header += ",text";
+    header += '\n';
+    flushBuffer( *state, header );
+  }
+
+  {
+    workStealingPool_c pool( threadCount );
+    for ( const auto &root : _options.roots )
+    {
+      const std::string rootPath = QFile::encodeName( QDir::cleanPath( root ) ).toStdString();
+      pool.submit( [state, &pool, rootPath]( int worker ) { inspectRoot( state, pool, worker, rootPath ); } );
+    }
+    pool.wait();
+  }
+
+  for ( auto &buffer : state->buffers )
+    flushBuffer( *state, buffer );
+  if ( std::fflush( output ) != 0 && !state->writeFailed )
+  {
+    state->writeFailed = true;
+    std::fprintf( stderr, "Cannot write the records: %s\n", std::strerror( errno ) );
+  }
+
+  return ( state->errorCount > 0 || state->writeFailed ) ? 1 : 0;
+}
+
+/*!
+   Checks if the application is started for a headless inspection
+   \param argc number of the command line arguments
+   \param argv the command line arguments
+   \return true if the batch switch is given
+ */
+bool batchInspector_c::isBatchMode( int argc, char *argv[] )
+{
+  for ( int index = 1; index < argc; index++ )
+  {
+    if ( std::strcmp( argv[ index ], batchOption ) == 0 )
+      return true;
+  }
+  return false;
+}
+
+/*!
+   Runs a headless inspection configured by command line arguments \a arguments
+   A \em QCoreApplication is to exist, invalid arguments end the application with a usage message.
+   \param arguments the command line arguments
+   \return exit code of the application
+ */
+int batchInspector_c::runBatch( const QStringList &arguments )
+{
+  QCommandLineParser parser;
+  parser.setApplicationDescription( "Headless inspection of file system trees" );
+  parser.addHelpOption();
+  parser.addOptions(
+  {
+    { "batch", "Inspects the paths without the user interface." },
+    { "format", "Output format, jsonl or csv.", "format", "jsonl" },
+    { "mime", "Detects the MIME type of every file." },
+    { "preview", "Includes the first <chars> characters of every text file.", "chars", "0" },
+    { "jobs", "Number of parallel workers.", "count", "0" },
+    { { "x", "one-file-system" }, "Does not cross file system boundaries." },
+    { { "o", "output" }, "Writes the records to <file> instead of stdout.", "file" }
+  } );
+  parser.addPositionalArgument( "paths", "Files and folders to inspect, the current folder if none.", "[paths...]" );
+  parser.process( arguments );
+
+  batchOptions_s options;
+  options.roots = parser.positionalArguments();
+  if ( options.roots.isEmpty() )
+    options.roots.append( QDir::currentPath() );
+
+  const QString format = parser.value( "format" );
+  if ( format != "jsonl" && format != "csv" )
+  {
+    std::fprintf( stderr, "Unknown format: %s\n", qPrintable( format ) );
+    return 2;
+  }
+  if ( format == "csv" )
+    options.format = batchOptions_s::format_e::Csv;
+
+  options.detectMime = parser.isSet( "mime" );
+  options.previewSize = qMax( 0, parser.value( "preview" ).toInt() );
+  options.threadCount = qMax( 0, parser.value( "jobs" ).toInt() );
+  options.oneFileSystem = parser.isSet( "one-file-system" );
+  options.outputPath = parser.value( "output" );
+
+  FILE *output = stdout;
+  if ( !options.outputPath.isEmpty() )
+  {
+    output = std::fopen( QFile::encodeName( options.outputPath ).constData(), "wb" );
+    if ( output == nullptr )
+    {
+      std::fprintf( stderr, "%s: %s\n", qPrintable( options.outputPath ), std::strerror( errno ) );
+      return 2;
+    }
+  }
+
+  int exitCode = batchInspector_c( options ).inspect( output );
+  if ( output != stdout && std::fclose( output ) != 0 )
+  {
+    std::fprintf( stderr, "%s: %s\n", qPrintable( options.outputPath ), std::strerror( errno ) );
+    exitCode = 1;
+  }
+
+  return exitCode;
+}
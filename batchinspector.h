@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QStringList>
+
+#include <cstdio>
+
+/*!
+   Options of a headless inspection
+ */
+struct batchOptions_s
+{
+  enum class format_e
+  {
+    JsonLines,
+    Csv
+  };
+
+  // Paths to the inspected files and folders
+  QStringList roots;
+  format_e format = format_e::JsonLines;
+  // MIME type of every file is detected
+  bool detectMime = false;
+  // Number of characters of a text file preview, 0 for none
+  int previewSize = 0;
+  // Number of workers, 0 for a default based on the processor count
+  int threadCount = 0;
+  // The traversal does not cross file system boundaries
+  bool oneFileSystem = false;
+  // Path to the output file, stdout if empty
+  QString outputPath;
+};
+
+/*!
+   Headless inspection of file system trees for scripts and servers
+   Every entry below the roots, hidden ones included, is reported as a record of a JSON Lines or CSV stream with
+   its path, type, size and modification time, optionally with its MIME type and the start of a text file.
+   Folders are traversed in parallel on a \em workStealingPool_c, every worker formats its records into its own
+   buffer written out in large chunks. The records therefore come in no particular order, a folder record may come
+   before or after the records of its content; it carries the recursive size of the folder. Symbolic links are
+   reported, not followed. A failed write of the output stops the inspection.
+ */
+class batchInspector_c
+{
+  public:
+    struct inspectState_s;
+
+  private:
+    batchOptions_s _options;
+
+  public:
+    explicit batchInspector_c( const batchOptions_s & );
+
+    int inspect( FILE * );
+
+    static bool isBatchMode( int, char *[] );
+    static int runBatch( const QStringList & );
+};
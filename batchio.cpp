@@ -0,0 +1,617 @@
+#include "batchio.h"
+
+#include <QFile>
+#include <QFuture>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+
+#if defined( Q_OS_UNIX )
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined( Q_OS_LINUX ) && __has_include( <linux/io_uring.h> )
+#define FILEINSPECTOR_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#endif
+
+namespace
+{
+  // Environment variable, 0 turns io_uring off
+  constexpr char ioUringVariable[] = "FILEINSPECTOR_IO_URING";
+  // Number of operations blocking at once on the fallback pool, bound by the latency rather than the processors
+  constexpr int fallbackThreadCount = 32;
+  // Batches smaller than this run on the calling thread
+  constexpr size_t inlineBatchSize = 4;
+  // Number of bytes read by a single request at most
+  constexpr qint64 maximumReadLength = 1024 * 1024 * 1024;
+
+  /*!
+     \return pool running the batches without io_uring
+   */
+  QThreadPool &fallbackPool()
+  {
+    static QThreadPool pool;
+    static const bool configured = []()
+    {
+      pool.setMaxThreadCount( fallbackThreadCount );
+      return true;
+    }();
+    Q_UNUSED( configured )
+    return pool;
+  }
+
+  /*!
+     Reads a part of a file given at \a request with blocking calls
+     \param request the read, receives the result
+   */
+  void readFile( batchIo_c::readRequest_s &request )
+  {
+    const qint64 length = std::min( request.length, maximumReadLength );
+#if defined( Q_OS_UNIX )
+    const int fileFd = open( request.path.c_str(), O_RDONLY | O_CLOEXEC );
+    if ( fileFd < 0 )
+    {
+      request.error = errno;
+      return;
+    }
+
+    request.data.resize( static_cast<int>( length ) );
+    qint64 bytesRead = 0;
+    while ( bytesRead < length )
+    {
+      const ssize_t result = pread( fileFd, request.data.data() + bytesRead, static_cast<size_t>( length - bytesRead ),
+                                    request.offset + bytesRead );
+      if ( result < 0 && errno == EINTR )
+        continue;
+      if ( result < 0 )
+        request.error = errno;
+      if ( result <= 0 )
+        break;
+      bytesRead += result;
+    }
+    request.data.resize( request.error == 0 ? static_cast<int>( bytesRead ) : 0 );
+    close( fileFd );
+#else
+    QFile file( QFile::decodeName( request.path.c_str() ) );
+    if ( !file.open( QIODevice::ReadOnly ) || !file.seek( request.offset ) )
+    {
+      request.error = ENOENT;
+      return;
+    }
+    request.data = file.read( length );
+#endif
+  }
+
+  /*!
+     Asks the kernel to read a part of a file given at \a request into the page cache in the background
+     \param request the read, receives the error only
+   */
+  void adviseFile( batchIo_c::readRequest_s &request )
+  {
+#if defined( Q_OS_UNIX )
+    const int fileFd = open( request.path.c_str(), O_RDONLY | O_CLOEXEC );
+    if ( fileFd < 0 )
+    {
+      request.error = errno;
+      return;
+    }
+
+#if defined( Q_OS_DARWIN )
+    // macOS has no posix_fadvise, a read advisory covers at most INT_MAX bytes
+    radvisory advisory;
+    advisory.ra_offset = request.offset;
+    advisory.ra_count = static_cast<int>( std::min<qint64>( request.length, std::numeric_limits<int>::max() ) );
+    request.error = ( fcntl( fileFd, F_RDADVISE, &advisory ) == 0 ) ? 0 : errno;
+#else
+    request.error = posix_fadvise( fileFd, request.offset, request.length, POSIX_FADV_WILLNEED );
+#endif
+    close( fileFd );
+#else
+    Q_UNUSED( request )
+#endif
+  }
+
+#if defined( FILEINSPECTOR_IO_URING )
+  /*!
+     Converts attributes \a result of statx to a \a status of stat
+     \param result the statx attributes
+     \param status receives the stat attributes
+   */
+  void toStatus( const struct statx &result, struct stat &status )
+  {
+    std::memset( &status, 0, sizeof( status ) );
+    status.st_dev = makedev( result.stx_dev_major, result.stx_dev_minor );
+    status.st_ino = result.stx_ino;
+    status.st_mode = result.stx_mode;
+    status.st_nlink = result.stx_nlink;
+    status.st_uid = result.stx_uid;
+    status.st_gid = result.stx_gid;
+    status.st_rdev = makedev( result.stx_rdev_major, result.stx_rdev_minor );
+    status.st_size = static_cast<off_t>( result.stx_size );
+    status.st_blksize = static_cast<blksize_t>( result.stx_blksize );
+    status.st_blocks = static_cast<blkcnt_t>( result.stx_blocks );
+    status.st_atim.tv_sec = result.stx_atime.tv_sec;
+    status.st_atim.tv_nsec = result.stx_atime.tv_nsec;
+    status.st_mtim.tv_sec = result.stx_mtime.tv_sec;
+    status.st_mtim.tv_nsec = result.stx_mtime.tv_nsec;
+    status.st_ctim.tv_sec = result.stx_ctime.tv_sec;
+    status.st_ctim.tv_nsec = result.stx_ctime.tv_nsec;
+  }
+#endif
+}
+
+#if defined( FILEINSPECTOR_IO_URING )
+/*!
+   An io_uring with its submission and completion queues mapped
+ */
+struct batchIo_c::ring_s
+{
+  int fd = -1;
+  void *sqRing = MAP_FAILED;
+  size_t sqRingSize = 0;
+  void *cqRing = MAP_FAILED;
+  size_t cqRingSize = 0;
+  io_uring_sqe *sqes = static_cast<io_uring_sqe *>( MAP_FAILED );
+  size_t sqesSize = 0;
+
+  unsigned *sqHead = nullptr;
+  unsigned *sqTail = nullptr;
+  unsigned sqMask = 0;
+  unsigned *sqArray = nullptr;
+  unsigned *cqHead = nullptr;
+  unsigned *cqTail = nullptr;
+  unsigned cqMask = 0;
+  io_uring_cqe *cqes = nullptr;
+  unsigned entries = 0;
+  // The kernel supports IORING_OP_FADVISE, which came later than the other operations
+  bool fadviseSupported = false;
+
+  ~ring_s()
+  {
+    if ( sqes != MAP_FAILED )
+      munmap( sqes, sqesSize );
+    if ( cqRing != MAP_FAILED && cqRing != sqRing )
+      munmap( cqRing, cqRingSize );
+    if ( sqRing != MAP_FAILED )
+      munmap( sqRing, sqRingSize );
+    if ( fd >= 0 )
+      close( fd );
+  }
+
+  /*!
+     Creates the ring and checks the kernel supports the operations of the batches
+     \return false if io_uring is not available or not permitted, e.g. by a container policy
+   */
+  bool setup()
+  {
+    io_uring_params params;
+    std::memset( &params, 0, sizeof( params ) );
+    fd = static_cast<int>( syscall( __NR_io_uring_setup, ringEntries, &params ) );
+    if ( fd < 0 )
+      return false;
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof( io_uring_cqe );
+    if ( params.features & IORING_FEAT_SINGLE_MMAP )
+      sqRingSize = cqRingSize = std::max( sqRingSize, cqRingSize );
+
+    sqRing = mmap( nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING );
+    if ( sqRing == MAP_FAILED )
+      return false;
+    cqRing = ( params.features & IORING_FEAT_SINGLE_MMAP ) ?
+             sqRing : mmap( nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                            IORING_OFF_CQ_RING );
+    if ( cqRing == MAP_FAILED )
+      return false;
+    sqesSize = params.sq_entries * sizeof( io_uring_sqe );
+    sqes = static_cast<io_uring_sqe *>( mmap( nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                              fd, IORING_OFF_SQES ) );
+    if ( sqes == MAP_FAILED )
+      return false;
+
+    auto *sqBase = static_cast<char *>( sqRing );
+    auto *cqBase = static_cast<char *>( cqRing );
+    sqHead = reinterpret_cast<unsigned *>( sqBase + params.sq_off.head );
+    sqTail = reinterpret_cast<unsigned *>( sqBase + params.sq_off.tail );
+    sqMask = *reinterpret_cast<unsigned *>( sqBase + params.sq_off.ring_mask );
+    sqArray = reinterpret_cast<unsigned *>( sqBase + params.sq_off.array );
+    cqHead = reinterpret_cast<unsigned *>( cqBase + params.cq_off.head );
+    cqTail = reinterpret_cast<unsigned *>( cqBase + params.cq_off.tail );
+    cqMask = *reinterpret_cast<unsigned *>( cqBase + params.cq_off.ring_mask );
+    cqes = reinterpret_cast<io_uring_cqe *>( cqBase + params.cq_off.cqes );
+    entries = params.sq_entries;
+
+    // the operations of the batches came with different kernel versions
+    constexpr unsigned probedOpCount = 256;
+    std::vector<char> probeBuffer( sizeof( io_uring_probe ) + probedOpCount * sizeof( io_uring_probe_op ), 0 );
+    auto *probe = reinterpret_cast<io_uring_probe *>( probeBuffer.data() );
+    if ( syscall( __NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, probedOpCount ) < 0 )
+      return false;
+    const auto isSupported = [probe]( unsigned op )
+    {
+      return op <= probe->last_op && ( probe->ops[ op ].flags & IO_URING_OP_SUPPORTED );
+    };
+    for ( const unsigned op : { IORING_OP_STATX, IORING_OP_OPENAT, IORING_OP_READ } )
+    {
+      if ( !isSupported( op ) )
+        return false;
+    }
+    fadviseSupported = isSupported( IORING_OP_FADVISE );
+
+    return true;
+  }
+};
+#else
+/*!
+   Placeholder of a ring where io_uring is not available
+ */
+struct batchIo_c::ring_s
+{
+};
+#endif
+
+/*!
+   C-tor
+   Creates a ring, unless io_uring is not available or turned off.
+ */
+batchIo_c::batchIo_c()
+{
+#if defined( FILEINSPECTOR_IO_URING )
+  if ( qgetenv( ioUringVariable ) == "0" )
+    return;
+
+  _ring = std::make_unique<ring_s>();
+  if ( !_ring->setup() )
+    _ring.reset();
+#endif
+}
+
+/*!
+   D-tor
+ */
+batchIo_c::~batchIo_c() = default;
+
+/*!
+   Provides the batches of the calling thread, a ring is not shared among threads
+   \return the batches
+ */
+batchIo_c &batchIo_c::forThread()
+{
+  thread_local batchIo_c batchIo;
+  return batchIo;
+}
+
+/*!
+   \return true if the batches are submitted through an io_uring
+ */
+bool batchIo_c::usesIoUring() const
+{
+  return _ring != nullptr;
+}
+
+#if defined( Q_OS_UNIX )
+/*!
+   Stats entries \a requests at once
+   \param requests the stats, receive the results
+ */
+void batchIo_c::stat( std::vector<statRequest_s> &requests )
+{
+  std::vector<char> completed( requests.size(), 0 );
+
+#if defined( FILEINSPECTOR_IO_URING )
+  if ( _ring && requests.size() >= inlineBatchSize )
+  {
+    std::vector<struct statx> results( requests.size() );
+    const bool ringDone = runOnRing( requests.size(), [&]( size_t index, io_uring_sqe &sqe )
+    {
+      sqe.opcode = IORING_OP_STATX;
+      sqe.fd = requests[ index ].dirFd;
+      sqe.addr = reinterpret_cast<quint64>( requests[ index ].name );
+      sqe.len = STATX_BASIC_STATS;
+      sqe.off = reinterpret_cast<quint64>( &results[ index ] );
+      sqe.statx_flags = static_cast<__u32>( requests[ index ].flags );
+    }, [&]( size_t index, int result )
+    {
+      requests[ index ].error = ( result < 0 ) ? -result : 0;
+      if ( result >= 0 )
+        toStatus( results[ index ], requests[ index ].status );
+      completed[ index ] = 1;
+    } );
+    if ( ringDone )
+      return;
+  }
+#endif
+
+  runOnPool( requests.size(), [&]( size_t index )
+  {
+    if ( completed[ index ] )
+      return;
+
+    statRequest_s &request = requests[ index ];
+    request.error = ( fstatat( request.dirFd, request.name, &request.status, request.flags ) == 0 ) ? 0 : errno;
+  } );
+}
+#endif
+
+/*!
+   Reads parts of files \a requests at once
+   The files are opened, read and closed in three batches, every file by a single read.
+   \param requests the reads, receive the results
+ */
+void batchIo_c::read( std::vector<readRequest_s> &requests )
+{
+  std::vector<char> completed( requests.size(), 0 );
+  for ( auto &request : requests )
+  {
+    request.error = 0;
+    request.data.clear();
+  }
+
+#if defined( FILEINSPECTOR_IO_URING )
+  if ( _ring && requests.size() >= inlineBatchSize )
+  {
+    std::vector<int> fileFds;
+    std::vector<size_t> opened;
+    bool ringDone = openOnRing( requests, fileFds, opened, completed );
+    for ( const size_t index : opened )
+      requests[ index ].data.resize( static_cast<int>( std::min( requests[ index ].length, maximumReadLength ) ) );
+
+    // a read may return fewer bytes than requested before the end of the file, the rest is read again
+    std::vector<qint64> filled( requests.size(), 0 );
+    std::vector<size_t> pending = opened;
+    while ( ringDone && !pending.empty() )
+    {
+      std::vector<size_t> shortReads;
+      ringDone = runOnRing( pending.size(), [&]( size_t position, io_uring_sqe &sqe )
+      {
+        const size_t index = pending[ position ];
+        readRequest_s &request = requests[ index ];
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = fileFds[ index ];
+        sqe.addr = reinterpret_cast<quint64>( request.data.data() + filled[ index ] );
+        sqe.len = static_cast<__u32>( request.data.size() - filled[ index ] );
+        sqe.off = static_cast<quint64>( request.offset + filled[ index ] );
+      }, [&]( size_t position, int result )
+      {
+        const size_t index = pending[ position ];
+        readRequest_s &request = requests[ index ];
+        if ( result > 0 )
+        {
+          filled[ index ] += result;
+          if ( filled[ index ] < request.data.size() )
+          {
+            shortReads.push_back( index );
+            return;
+          }
+        }
+        request.error = ( result < 0 ) ? -result : 0;
+        request.data.resize( ( result < 0 ) ? 0 : static_cast<int>( filled[ index ] ) );
+        completed[ index ] = 1;
+      } );
+      pending = std::move( shortReads );
+    }
+
+    for ( const size_t index : opened )
+      close( fileFds[ index ] );
+    if ( ringDone )
+      return;
+
+    for ( size_t index = 0; index < requests.size(); index++ )
+    {
+      if ( !completed[ index ] )
+      {
+        requests[ index ].error = 0;
+        requests[ index ].data.clear();
+      }
+    }
+  }
+#endif
+
+  runOnPool( requests.size(), [&]( size_t index )
+  {
+    if ( !completed[ index ] )
+      readFile( requests[ index ] );
+  } );
+}
+
+/*!
+   Asks the kernel to read parts of files \a requests into the page cache in the background, all of them at once
+   Nothing is read into memory of the process, the call does not wait for the storage.
+   \param requests the parts of the files, receive the errors only
+ */
+void batchIo_c::readAhead( std::vector<readRequest_s> &requests )
+{
+  std::vector<char> completed( requests.size(), 0 );
+  for ( auto &request : requests )
+  {
+    request.error = 0;
+    request.data.clear();
+  }
+
+#if defined( FILEINSPECTOR_IO_URING )
+  if ( _ring && _ring->fadviseSupported && requests.size() >= inlineBatchSize )
+  {
+    std::vector<int> fileFds;
+    std::vector<size_t> opened;
+    bool ringDone = openOnRing( requests, fileFds, opened, completed );
+    if ( ringDone )
+    {
+      ringDone = runOnRing( opened.size(), [&]( size_t position, io_uring_sqe &sqe )
+      {
+        const readRequest_s &request = requests[ opened[ position ] ];
+        sqe.opcode = IORING_OP_FADVISE;
+        sqe.fd = fileFds[ opened[ position ] ];
+        sqe.off = static_cast<quint64>( request.offset );
+        sqe.len = static_cast<__u32>( std::min( request.length, maximumReadLength ) );
+        sqe.fadvise_advice = POSIX_FADV_WILLNEED;
+      }, [&]( size_t position, int result )
+      {
+        requests[ opened[ position ] ].error = ( result < 0 ) ? -result : 0;
+        completed[ opened[ position ] ] = 1;
+      } );
+    }
+
+    for ( const size_t index : opened )
+      close( fileFds[ index ] );
+    if ( ringDone )
+      return;
+  }
+#endif
+
+  runOnPool( requests.size(), [&]( size_t index )
+  {
+    if ( !completed[ index ] )
+      adviseFile( requests[ index ] );
+  } );
+}
+
+/*!
+   Opens files \a requests for reading through the ring of the thread
+   \param requests the files, receive the open errors
+   \param fileFds receives the descriptors of the files by request, -1 for a file not opened
+   \param opened receives the indexes of the opened files
+   \param completed marks the requests failed to open
+   \return false if the ring failed
+ */
+bool batchIo_c::openOnRing( std::vector<readRequest_s> &requests, std::vector<int> &fileFds,
+                            std::vector<size_t> &opened, std::vector<char> &completed )
+{
+  fileFds.assign( requests.size(), -1 );
+  opened.clear();
+
+#if defined( FILEINSPECTOR_IO_URING )
+  const bool ringDone = runOnRing( requests.size(), [&]( size_t index, io_uring_sqe &sqe )
+  {
+    sqe.opcode = IORING_OP_OPENAT;
+    sqe.fd = AT_FDCWD;
+    sqe.addr = reinterpret_cast<quint64>( requests[ index ].path.c_str() );
+    sqe.open_flags = O_RDONLY | O_CLOEXEC;
+  }, [&]( size_t index, int result )
+  {
+    if ( result >= 0 )
+    {
+      fileFds[ index ] = result;
+    }
+    else
+    {
+      requests[ index ].error = -result;
+      completed[ index ] = 1;
+    }
+  } );
+
+  for ( size_t index = 0; index < requests.size(); index++ )
+  {
+    if ( fileFds[ index ] >= 0 )
+      opened.push_back( index );
+  }
+
+  return ringDone;
+#else
+  Q_UNUSED( completed )
+  return false;
+#endif
+}
+
+/*!
+   Runs \a count operations through the ring of the thread, keeping as many of them in flight as the ring holds
+   \param count number of the operations
+   \param prepare fills the submission entry of an operation given by its index
+   \param complete receives the result of an operation given by its index, a negative error number on failure
+   \return false if the ring failed, the operations not completed are to be run otherwise
+ */
+bool batchIo_c::runOnRing( size_t count, const std::function<void( size_t, io_uring_sqe & )> &prepare,
+                           const std::function<void( size_t, int )> &complete )
+{
+#if defined( FILEINSPECTOR_IO_URING )
+  ring_s &ring = *_ring;
+  size_t prepared = 0;
+  size_t completedCount = 0;
+  while ( completedCount < count )
+  {
+    // the submission queue is filled up to the number of operations the ring holds
+    unsigned tail = *ring.sqTail;
+    while ( prepared < count && prepared - completedCount < ring.entries )
+    {
+      const unsigned slot = tail & ring.sqMask;
+      io_uring_sqe &sqe = ring.sqes[ slot ];
+      std::memset( &sqe, 0, sizeof( sqe ) );
+      prepare( prepared, sqe );
+      sqe.user_data = prepared;
+      ring.sqArray[ slot ] = slot;
+      tail++;
+      prepared++;
+    }
+    __atomic_store_n( ring.sqTail, tail, __ATOMIC_RELEASE );
+
+    const unsigned pending = tail - __atomic_load_n( ring.sqHead, __ATOMIC_ACQUIRE );
+    const long submitted = syscall( __NR_io_uring_enter, ring.fd, pending, 1, IORING_ENTER_GETEVENTS, nullptr, 0 );
+    if ( submitted < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY )
+    {
+      // nothing in flight anymore, the ring is given up
+      if ( prepared - completedCount == pending )
+      {
+        _ring.reset();
+        return false;
+      }
+    }
+
+    unsigned head = *ring.cqHead;
+    const unsigned completionTail = __atomic_load_n( ring.cqTail, __ATOMIC_ACQUIRE );
+    for ( ; head != completionTail; head++ )
+    {
+      const io_uring_cqe &cqe = ring.cqes[ head & ring.cqMask ];
+      complete( static_cast<size_t>( cqe.user_data ), cqe.res );
+      completedCount++;
+    }
+    __atomic_store_n( ring.cqHead, head, __ATOMIC_RELEASE );
+  }
+
+  return true;
+#else
+  Q_UNUSED( count )
+  Q_UNUSED( prepare )
+  Q_UNUSED( complete )
+  return false;
+#endif
+}
+
+/*!
+   Runs \a count blocking operations split among the workers of the fallback pool and waits for them
+   \param count number of the operations
+   \param operation runs an operation given by its index
+ */
+void batchIo_c::runOnPool( size_t count, const std::function<void( size_t )> &operation )
+{
+  if ( count < inlineBatchSize )
+  {
+    for ( size_t index = 0; index < count; index++ )
+      operation( index );
+    return;
+  }
+
+  const size_t chunkCount = std::min( count, static_cast<size_t>( fallbackThreadCount ) );
+  std::vector<QFuture<void>> futures;
+  futures.reserve( chunkCount );
+  for ( size_t chunk = 0; chunk < chunkCount; chunk++ )
+  {
+    const size_t first = count * chunk / chunkCount;
+    const size_t last = count * ( chunk + 1 ) / chunkCount;
+    futures.push_back( QtConcurrent::run( &fallbackPool(), [&operation, first, last]()
+    {
+      for ( size_t index = first; index < last; index++ )
+        operation( index );
+    } ) );
+  }
+
+  for ( auto &future : futures )
+    future.waitForFinished();
+}
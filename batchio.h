@@ -0,0 +1,91 @@
+#pragma once
+
+#include <QByteArray>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined( Q_OS_UNIX )
+#include <sys/stat.h>
+#endif
+
+struct io_uring_sqe;
+
+/*!
+   Batched file system operations
+   A batch of stats, reads or read-aheads is put in flight at once rather than one call after another, so on a cold cache or on
+   high-latency storage the latencies of the operations overlap. On Linux the operations are submitted through an
+   io_uring, a ring per thread, keeping up to \em ringEntries of them in flight. Where io_uring is not available,
+   not permitted or disabled by the FILEINSPECTOR_IO_URING=0 environment variable, a batch is split among the
+   workers of a shared thread pool instead. The results do not depend on the way a batch was run.
+ */
+class batchIo_c
+{
+  public:
+#if defined( Q_OS_UNIX )
+    /*!
+       Stat of an entry relative to a folder
+     */
+    struct statRequest_s
+    {
+      // Descriptor of the folder
+      int dirFd = -1;
+      // NUL terminated name of the entry, stays valid while the batch runs
+      const char *name = nullptr;
+      // AT_SYMLINK_NOFOLLOW not to follow a symbolic link, 0 otherwise
+      int flags = 0;
+      // Result: 0 on success, the error number otherwise
+      int error = 0;
+      // Result: attributes of the entry
+      struct stat status;
+    };
+#endif
+
+    /*!
+       Read of a part of a file
+     */
+    struct readRequest_s
+    {
+      // Encoded path to the file
+      std::string path;
+      qint64 offset = 0;
+      qint64 length = 0;
+      // Result: 0 on success, the error number otherwise
+      int error = 0;
+      // Result: the bytes read, shorter than requested at the end of the file
+      QByteArray data;
+    };
+
+    // Number of operations in flight at most per ring
+    static constexpr unsigned ringEntries = 256;
+
+  private:
+    struct ring_s;
+
+    // Ring of the thread, empty if io_uring is not used
+    std::unique_ptr<ring_s> _ring;
+
+  public:
+    batchIo_c();
+    ~batchIo_c();
+
+    batchIo_c( const batchIo_c & ) = delete;
+    batchIo_c &operator=( const batchIo_c & ) = delete;
+
+    static batchIo_c &forThread();
+
+    bool usesIoUring() const;
+#if defined( Q_OS_UNIX )
+    void stat( std::vector<statRequest_s> & );
+#endif
+    void read( std::vector<readRequest_s> & );
+    void readAhead( std::vector<readRequest_s> & );
+
+  private:
+    bool openOnRing( std::vector<readRequest_s> &, std::vector<int> &, std::vector<size_t> &, std::vector<char> & );
+    bool runOnRing( size_t, const std::function<void( size_t, io_uring_sqe & )> &,
+                    const std::function<void( size_t, int )> & );
+    static void runOnPool( size_t, const std::function<void( size_t )> & );
+};
@@ -0,0 +1,52 @@
+# Benchmarks of the listing, preview and classification hot paths
+# Build with: qmake benchmark.pro && make, run with: ./filewave-benchmark --help
+QT       += core gui concurrent
+
+# The sources of the application need Qt 5.14, see FileWave.pro
+lessThan(QT_MAJOR_VERSION, 5)|if(equals(QT_MAJOR_VERSION, 5):lessThan(QT_MINOR_VERSION, 14)) {
+    error("Qt 5.14 or newer is required")
+}
+
+CONFIG += c++1z console
+CONFIG -= app_bundle
+
+TARGET = filewave-benchmark
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    benchmarkrunner.cpp \
+    main.cpp \
+    treegenerator.cpp \
+    ../batchio.cpp \
+    ../contenthasher.cpp \
+    ../dirlister.cpp \
+    ../foldersnapshot.cpp \
+    ../hexformatter.cpp \
+    ../lineindex.cpp \
+    ../literalmatcher.cpp \
+    ../mimeclassifier.cpp \
+    ../namearena.cpp \
+    ../perftracer.cpp \
+    ../statcache.cpp \
+    ../util.cpp \
+    ../workstealingpool.cpp
+
+HEADERS += \
+    benchmarkrunner.h \
+    treegenerator.h \
+    ../batchio.h \
+    ../contenthasher.h \
+    ../dirlister.h \
+    ../foldersnapshot.h \
+    ../hexformatter.h \
+    ../lineindex.h \
+    ../literalmatcher.h \
+    ../mimeclassifier.h \
+    ../namearena.h \
+    ../perftracer.h \
+    ../statcache.h \
+    ../util.h \
+    ../workstealingpool.h
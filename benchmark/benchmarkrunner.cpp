@@ -0,0 +1,163 @@
+#include "benchmarkrunner.h"
+
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+  // Upper bound of the calls of an operation, keeps the samples of very fast operations in memory bounds
+  constexpr qint64 maximumSampleCount = 10 * 1000 * 1000;
+
+  std::atomic<qint64> allocationCount{ 0 };
+  std::atomic<qint64> allocatedBytes{ 0 };
+
+  /*!
+     \param samples sorted call durations
+     \param percentile the percentile, 0 to 100
+     \return duration of the percentile, in ns
+   */
+  qint64 percentileOf( const std::vector<qint64> &samples, double percentile )
+  {
+    const size_t index = static_cast<size_t>( percentile / 100.0 * static_cast<double>( samples.size() - 1 ) + 0.5 );
+    return samples[ std::min( index, samples.size() - 1 ) ];
+  }
+}
+
+#if defined( __GLIBC__ )
+// The heap functions are interposed to count allocations of the benchmarked calls, Qt containers included
+extern "C"
+{
+  void *__libc_malloc( size_t );
+  void *__libc_calloc( size_t, size_t );
+  void *__libc_realloc( void *, size_t );
+
+  void *malloc( size_t size )
+  {
+    allocationCount.fetch_add( 1, std::memory_order_relaxed );
+    allocatedBytes.fetch_add( static_cast<qint64>( size ), std::memory_order_relaxed );
+    return __libc_malloc( size );
+  }
+
+  void *calloc( size_t count, size_t size )
+  {
+    allocationCount.fetch_add( 1, std::memory_order_relaxed );
+    allocatedBytes.fetch_add( static_cast<qint64>( count * size ), std::memory_order_relaxed );
+    return __libc_calloc( count, size );
+  }
+
+  void *realloc( void *pointer, size_t size )
+  {
+    allocationCount.fetch_add( 1, std::memory_order_relaxed );
+    allocatedBytes.fetch_add( static_cast<qint64>( size ), std::memory_order_relaxed );
+    return __libc_realloc( pointer, size );
+  }
+}
+#endif
+
+/*!
+   C-tor
+   \param output output of the records
+   \param minimumIterations minimum number of calls of an operation
+   \param minimumTime minimum time spent calling an operation, in ms
+   \param filter only benchmarks with names containing the filter are run, all if empty
+ */
+benchmarkRunner_c::benchmarkRunner_c( FILE *output, qint64 minimumIterations, qint64 minimumTime,
+                                      const QString &filter ) :
+  _output{ output },
+  _minimumIterations{ minimumIterations },
+  _minimumTime{ minimumTime },
+  _filter{ filter }
+{
+}
+
+/*!
+   \param name name of a benchmark
+   \return true if the benchmark is to run
+ */
+bool benchmarkRunner_c::isSelected( const QString &name ) const
+{
+  return _filter.isEmpty() || name.contains( _filter );
+}
+
+/*!
+   Benchmarks an operation \a operation and reports its statistics
+   The operation is called once before the measurement, to warm up caches.
+   \param name name of the benchmark
+   \param unit unit of the items a call processes, e.g. entries or bytes
+   \param itemsPerCall number of the items a call processes
+   \param operation the operation
+   \param maximumIterations upper bound of the calls, -1 for none
+ */
+void benchmarkRunner_c::run( const QString &name, const QString &unit, double itemsPerCall,
+                             const operation_t &operation, qint64 maximumIterations )
+{
+  if ( !isSelected( name ) )
+    return;
+
+  std::fprintf( stderr, "%s...\n", qPrintable( name ) );
+  operation( 0 );
+
+  const qint64 iterationLimit = ( maximumIterations > 0 ) ? std::min( maximumIterations, maximumSampleCount )
+                                                          : maximumSampleCount;
+  std::vector<qint64> samples;
+  samples.reserve( static_cast<size_t>( std::min<qint64>( iterationLimit, 1024 * 1024 ) ) );
+
+  const qint64 allocationsBefore = allocationCount;
+  const qint64 bytesBefore = allocatedBytes;
+
+  QElapsedTimer totalTimer;
+  totalTimer.start();
+  QElapsedTimer callTimer;
+  for ( qint64 iteration = 1; static_cast<qint64>( samples.size() ) < iterationLimit; iteration++ )
+  {
+    if ( !samples.empty() && static_cast<qint64>( samples.size() ) >= _minimumIterations &&
+         totalTimer.elapsed() >= _minimumTime )
+      break;
+
+    callTimer.start();
+    operation( iteration );
+    samples.push_back( callTimer.nsecsElapsed() );
+  }
+
+  const double totalTime = static_cast<double>( totalTimer.nsecsElapsed() );
+  const double callCount = static_cast<double>( samples.size() );
+  const double allocationsPerCall = static_cast<double>( allocationCount - allocationsBefore ) / callCount;
+  const double bytesPerCall = static_cast<double>( allocatedBytes - bytesBefore ) / callCount;
+
+  qint64 sampleSum = 0;
+  for ( const qint64 sample : samples )
+    sampleSum += sample;
+  std::sort( samples.begin(), samples.end() );
+
+  const double throughput = ( sampleSum > 0 ) ? itemsPerCall * callCount * 1e9 / static_cast<double>( sampleSum ) : 0;
+  std::fprintf( _output, "{\"benchmark\":\"%s\",\"iterations\":%lld,\"mean_ns\":%.0f,\"min_ns\":%lld,"
+                "\"p50_ns\":%lld,\"p90_ns\":%lld,\"p99_ns\":%lld,\"max_ns\":%lld,\"throughput\":%.1f,"
+                "\"throughput_unit\":\"%s/s\",\"total_ms\":%.1f",
+                qPrintable( name ), static_cast<long long>( samples.size() ),
+                static_cast<double>( sampleSum ) / callCount, static_cast<long long>( samples.front() ),
+                static_cast<long long>( percentileOf( samples, 50 ) ),
+                static_cast<long long>( percentileOf( samples, 90 ) ),
+                static_cast<long long>( percentileOf( samples, 99 ) ), static_cast<long long>( samples.back() ),
+                throughput, qPrintable( unit ), totalTime / 1e6 );
+  if ( countsAllocations() )
+    std::fprintf( _output, ",\"allocations_per_call\":%.1f,\"allocated_bytes_per_call\":%.0f",
+                  allocationsPerCall, bytesPerCall );
+  std::fprintf( _output, "}\n" );
+  std::fflush( _output );
+}
+
+/*!
+   \return true if the heap allocations are counted, i.e. with glibc
+ */
+bool benchmarkRunner_c::countsAllocations()
+{
+#if defined( __GLIBC__ )
+  return true;
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QString>
+
+#include <cstdio>
+#include <functional>
+
+/*!
+   Runs benchmarks and reports their statistics as JSON Lines
+   An operation is timed call by call, until both the minimum number of calls and the minimum time are reached.
+   Every benchmark gives one record with latency percentiles of a call, the throughput of the items a call
+   processes and, with glibc, the number and size of the heap allocations per call.
+ */
+class benchmarkRunner_c
+{
+  public:
+    // A benchmarked call, receives the index of the call
+    using operation_t = std::function<void( qint64 )>;
+
+  private:
+    // Output of the records
+    FILE *_output;
+    // Minimum number of calls of an operation
+    qint64 _minimumIterations;
+    // Minimum time spent calling an operation, in ms
+    qint64 _minimumTime;
+    // Only benchmarks with names containing the filter are run
+    QString _filter;
+
+  public:
+    benchmarkRunner_c( FILE *, qint64, qint64, const QString & = QString() );
+
+    bool isSelected( const QString & ) const;
+    void run( const QString &, const QString &, double, const operation_t &, qint64 = -1 );
+
+    static bool countsAllocations();
+};
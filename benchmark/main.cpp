@@ -0,0 +1,306 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+#include <QMimeDatabase>
+#include <QTemporaryDir>
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#if defined( Q_OS_UNIX )
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "batchio.h"
+#include "benchmarkrunner.h"
+#include "contenthasher.h"
+#include "dirlister.h"
+#include "foldersnapshot.h"
+#include "hexformatter.h"
+#include "lineindex.h"
+#include "literalmatcher.h"
+#include "mimeclassifier.h"
+#include "statcache.h"
+#include "treegenerator.h"
+#include "util.h"
+
+namespace
+{
+  // Number of characters of a text file preview, as requested by a typical preview pane
+  constexpr int previewSize = 4096;
+  // Number of folder entries of a preview, as requested by a typical preview pane
+  constexpr int previewLines = 100;
+}
+
+/*!
+   Benchmarks the listing, preview and classification hot paths over generated trees
+   Prints a JSON Lines record per benchmark, preceded by a record of the run parameters.
+ */
+int main( int argc, char *argv[] )
+{
+  QCoreApplication a( argc, argv );
+  QCoreApplication::setApplicationName( "filewave-benchmark" );
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription( "Benchmarks of the listing, preview and classification hot paths" );
+  parser.addHelpOption();
+  parser.addOptions(
+  {
+    { "root", "Generates the trees in <folder> and keeps them for later runs.", "folder" },
+    { "wide-entries", "Number of the entries of the wide folder.", "count", "1000000" },
+    { "depth", "Number of the nested folders of the deep tree.", "count", "256" },
+    { "text-size", "Size of the huge text file in MiB.", "MiB", "512" },
+    { "blobs", "Number of the binary blobs.", "count", "1000" },
+    { "mixed", "Number of the small files of mixed kinds.", "count", "10000" },
+    { "min-iterations", "Minimum number of calls of a benchmark.", "count", "5" },
+    { "min-time", "Minimum time of a benchmark in ms.", "ms", "1000" },
+    { "filter", "Runs only benchmarks with names containing <text>.", "text" },
+    { { "o", "output" }, "Writes the records to <file> instead of stdout.", "file" }
+  } );
+  parser.process( a );
+
+  // the timings of a hash not matching XXH64 would be meaningless
+  if ( !contentHasher_c::selfTest() )
+  {
+    std::fprintf( stderr, "contentHasher_c does not match the XXH64 reference vectors\n" );
+    return 1;
+  }
+
+  std::unique_ptr<QTemporaryDir> temporaryDir;
+  QString rootPath = parser.value( "root" );
+  if ( rootPath.isEmpty() )
+  {
+    temporaryDir = std::make_unique<QTemporaryDir>();
+    rootPath = temporaryDir->path();
+  }
+
+  FILE *output = stdout;
+  if ( parser.isSet( "output" ) )
+  {
+    output = std::fopen( QFile::encodeName( parser.value( "output" ) ).constData(), "w" );
+    if ( output == nullptr )
+    {
+      std::fprintf( stderr, "Cannot open %s\n", qPrintable( parser.value( "output" ) ) );
+      return 1;
+    }
+  }
+
+  const int wideEntries = parser.value( "wide-entries" ).toInt();
+  const int depth = parser.value( "depth" ).toInt();
+  const qint64 textSize = parser.value( "text-size" ).toLongLong() * 1024 * 1024;
+  const int blobCount = parser.value( "blobs" ).toInt();
+  const int mixedCount = parser.value( "mixed" ).toInt();
+
+  std::fprintf( output, "{\"run\":{\"timestamp\":\"%s\",\"qt\":\"%s\",\"wide_entries\":%d,\"depth\":%d,"
+                "\"text_bytes\":%lld,\"blobs\":%d,\"mixed\":%d,\"allocations_counted\":%s}}\n",
+                qPrintable( QDateTime::currentDateTimeUtc().toString( Qt::ISODate ) ), qVersion(), wideEntries, depth,
+                static_cast<long long>( textSize ), blobCount, mixedCount,
+                benchmarkRunner_c::countsAllocations() ? "true" : "false" );
+
+  std::fprintf( stderr, "Generating trees in %s...\n", qPrintable( rootPath ) );
+  treeGenerator_c generator( rootPath );
+  const QString widePath = generator.createWideFolder( wideEntries );
+  const QString deepPath = generator.createDeepFolder( depth, 4 );
+  const QString textPath = generator.createTextFile( textSize );
+  const QStringList blobPaths = generator.createBinaryBlobs( blobCount, 64 * 1024 );
+  const QStringList mixedPaths = generator.createMixedFiles( mixedCount );
+
+  benchmarkRunner_c runner( output, parser.value( "min-iterations" ).toLongLong(),
+                            parser.value( "min-time" ).toLongLong(), parser.value( "filter" ) );
+  using namespace fileInspector_n::util_n;
+
+  // listing
+  runner.run( "getDirContent/wide/all", "entries", wideEntries, [&]( qint64 )
+  {
+    getDirContent( widePath );
+  } );
+  runner.run( "getDirContent/wide/preview", "entries", previewLines, [&]( qint64 )
+  {
+    getDirContent( widePath, previewLines );
+  } );
+  runner.run( "dirLister/wide/all", "entries", wideEntries, [&]( qint64 )
+  {
+    dirLister_c lister;
+    lister.list( widePath );
+  } );
+  runner.run( "getDirContent/deep/innermost", "entries", 4, [&]( qint64 )
+  {
+    getDirContent( deepPath );
+  } );
+
+#if defined( Q_OS_UNIX )
+  // stats of the wide folder entries, one after another and batched
+  {
+    dirLister_c lister;
+    lister.list( widePath );
+    const int dirFd = open( QFile::encodeName( widePath ).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+    runner.run( "fstatat/wide/sequential", "entries", lister.count(), [&]( qint64 )
+    {
+      struct stat entryStat;
+      for ( int index = 0; index < lister.count(); index++ )
+        fstatat( dirFd, lister.names().name( index ), &entryStat, AT_SYMLINK_NOFOLLOW );
+    } );
+    runner.run( "batchIo/wide/stat", "entries", lister.count(), [&]( qint64 )
+    {
+      std::vector<batchIo_c::statRequest_s> requests( static_cast<size_t>( lister.count() ) );
+      for ( int index = 0; index < lister.count(); index++ )
+      {
+        requests[ static_cast<size_t>( index ) ].dirFd = dirFd;
+        requests[ static_cast<size_t>( index ) ].name = lister.names().name( index );
+        requests[ static_cast<size_t>( index ) ].flags = AT_SYMLINK_NOFOLLOW;
+      }
+      batchIo_c::forThread().stat( requests );
+    } );
+    if ( dirFd >= 0 )
+      close( dirFd );
+  }
+#endif
+
+  // snapshots, a capture of the wide folder and its comparison with an equal one
+  runner.run( "folderSnapshot/wide/capture", "entries", wideEntries, [&]( qint64 )
+  {
+    const std::atomic<bool> cancelled{ false };
+    folderSnapshot_c snapshot;
+    snapshot.capture( widePath, false, cancelled );
+  } );
+  {
+    const std::atomic<bool> cancelled{ false };
+    folderSnapshot_c older;
+    folderSnapshot_c newer;
+    older.capture( widePath, false, cancelled );
+    newer.capture( widePath, false, cancelled );
+    runner.run( "folderSnapshot/wide/diff", "entries", wideEntries, [&]( qint64 )
+    {
+      folderSnapshot_c::diff( older, newer, cancelled );
+    } );
+  }
+
+  // path validation, served by the stat cache after the first call, and cold, stat-ing every path
+  runner.run( "isValid/deep/folder/cached", "paths", 1, [&]( qint64 )
+  {
+    isValid( deepPath, true );
+  } );
+  runner.run( "isValid/deep/folder/cold", "paths", 1, [&]( qint64 )
+  {
+    statCache_c::instance().invalidate( deepPath );
+    isValid( deepPath, true );
+  } );
+  if ( !mixedPaths.isEmpty() )
+  {
+    runner.run( "isValid/mixed/file/cached", "paths", 1, [&]( qint64 iteration )
+    {
+      isValid( mixedPaths.at( static_cast<int>( iteration % mixedPaths.size() ) ), false );
+    } );
+    runner.run( "isValid/mixed/file/cold", "paths", 1, [&]( qint64 iteration )
+    {
+      const QString &path = mixedPaths.at( static_cast<int>( iteration % mixedPaths.size() ) );
+      statCache_c::instance().invalidate( path );
+      isValid( path, false );
+    } );
+  }
+
+  // text preview
+  runner.run( "getTextFileContent/huge/head", "calls", 1, [&]( qint64 )
+  {
+    getTextFileContent( textPath, previewSize );
+  } );
+  runner.run( "getTextFileWindow/huge/random", "calls", 1, [&]( qint64 iteration )
+  {
+    const qint64 offset = ( iteration * 2654435761LL ) % qMax<qint64>( 1, textSize - previewSize );
+    getTextFileWindow( textPath, offset, previewSize );
+  } );
+  runner.run( "lineIndex/huge/build", "bytes", static_cast<double>( textSize ), [&]( qint64 )
+  {
+    QFile file( textPath );
+    if ( !file.open( QIODevice::ReadOnly | QIODevice::Unbuffered ) )
+      return;
+
+    const std::atomic<bool> cancelled{ false };
+    lineIndex_c lineIndex;
+    lineIndex.build( file, file.size(), cancelled, []() {} );
+  } );
+  runner.run( "literalMatcher/huge/absent", "bytes", static_cast<double>( textSize ), [&]( qint64 )
+  {
+    QFile file( textPath );
+    if ( !file.open( QIODevice::ReadOnly ) )
+      return;
+
+    const uchar *data = file.map( 0, file.size() );
+    const literalMatcher_c matcher( "quantum", false );
+    matcher.find( reinterpret_cast<const char *>( data ), file.size() );
+  } );
+  runner.run( "contentHasher/huge", "bytes", static_cast<double>( textSize ), [&]( qint64 )
+  {
+    QFile file( textPath );
+    if ( !file.open( QIODevice::ReadOnly ) )
+      return;
+
+    const uchar *data = file.map( 0, file.size() );
+    contentHasher_c::hash( data, static_cast<size_t>( file.size() ) );
+  } );
+
+  // hex preview, a viewport of rows at a random offset
+  if ( !blobPaths.isEmpty() )
+  {
+    runner.run( "hexFormatter/blob/viewport", "rows", 64, [&]( qint64 iteration )
+    {
+      QFile file( blobPaths.at( static_cast<int>( iteration % blobPaths.size() ) ) );
+      if ( !file.open( QIODevice::ReadOnly ) || file.size() < 64 * hexFormatter_c::bytesPerRow )
+        return;
+
+      const uchar *data = file.map( 0, file.size() );
+      const qint64 rowOffset = ( iteration * 2654435761LL ) % ( file.size() / hexFormatter_c::bytesPerRow - 63 );
+      for ( qint64 row = rowOffset; row < rowOffset + 64; row++ )
+        hexFormatter_c::formatRow( row * hexFormatter_c::bytesPerRow, 8, data + row * hexFormatter_c::bytesPerRow,
+                                   hexFormatter_c::bytesPerRow );
+    } );
+  }
+
+  // classification, the former per-selection MIME probe against the classifier
+  const auto mimeDatabaseProbe = [&]( const QStringList &paths )
+  {
+    return [&paths]( qint64 iteration )
+    {
+      const QMimeDatabase mimeDatabase;
+      isTextMimeType( mimeDatabase.mimeTypeForFile( paths.at( static_cast<int>( iteration % paths.size() ) ) ) );
+    };
+  };
+  const auto coldClassification = [&]( const QStringList &paths )
+  {
+    return [&paths]( qint64 iteration )
+    {
+      mimeClassifier_c classifier;
+      classifier.classify( paths.at( static_cast<int>( iteration % paths.size() ) ) );
+    };
+  };
+  mimeClassifier_c memoClassifier;
+  const auto memoClassification = [&]( const QStringList &paths )
+  {
+    return [&paths, &memoClassifier]( qint64 iteration )
+    {
+      memoClassifier.classify( paths.at( static_cast<int>( iteration % paths.size() ) ) );
+    };
+  };
+
+  if ( !mixedPaths.isEmpty() )
+  {
+    runner.run( "mimeDatabase/mixed", "files", 1, mimeDatabaseProbe( mixedPaths ) );
+    runner.run( "mimeClassifier/mixed/cold", "files", 1, coldClassification( mixedPaths ) );
+    runner.run( "mimeClassifier/mixed/memo", "files", 1, memoClassification( mixedPaths ) );
+  }
+  if ( !blobPaths.isEmpty() )
+  {
+    runner.run( "mimeDatabase/blobs", "files", 1, mimeDatabaseProbe( blobPaths ) );
+    runner.run( "mimeClassifier/blobs/cold", "files", 1, coldClassification( blobPaths ) );
+  }
+
+  if ( output != stdout )
+    std::fclose( output );
+
+  return 0;
+}
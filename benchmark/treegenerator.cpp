@@ -0,0 +1,260 @@
+#include "treegenerator.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <cstring>
+
+#if defined( Q_OS_UNIX )
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+  // Name of the file marking a completely generated tree
+  constexpr char completeMarker[] = ".complete";
+  // Size of a chunk of a generated large file
+  constexpr qint64 chunkSize = 4 * 1024 * 1024;
+
+  /*!
+     \param folderPath path to a generated folder
+     \return true if the folder was completely generated before
+   */
+  bool isComplete( const QString &folderPath )
+  {
+    return QFileInfo::exists( QDir( folderPath ).filePath( completeMarker ) );
+  }
+
+  /*!
+     Marks a generated folder given at \a folderPath as complete
+     \param folderPath path to the folder
+   */
+  void markComplete( const QString &folderPath )
+  {
+    QFile marker( QDir( folderPath ).filePath( completeMarker ) );
+    marker.open( QIODevice::WriteOnly );
+  }
+}
+
+/*!
+   C-tor
+   \param rootPath folder the trees are created in
+ */
+treeGenerator_c::treeGenerator_c( const QString &rootPath ) :
+  _rootPath{ rootPath },
+  _random{ 20240101 }
+{
+  QDir().mkpath( _rootPath );
+}
+
+/*!
+   Creates a folder with \a entryCount entries, every hundredth of them a sub-folder, the others empty files
+   \param entryCount number of the entries
+   \return path to the folder
+ */
+QString treeGenerator_c::createWideFolder( int entryCount )
+{
+  const QString folderPath = QDir( _rootPath ).filePath( QString( "wide-%1" ).arg( entryCount ) );
+  if ( isComplete( folderPath ) )
+    return folderPath;
+
+  QDir().mkpath( folderPath );
+  const QDir folderDir( folderPath );
+  for ( int index = 0; index < entryCount; index++ )
+  {
+    const QString entryName = QString( "entry-%1" ).arg( index, 7, 10, QChar( '0' ) );
+    if ( index % 100 == 0 )
+    {
+      folderDir.mkdir( entryName );
+      continue;
+    }
+
+#if defined( Q_OS_UNIX )
+    const int fileFd = open( QFile::encodeName( folderDir.filePath( entryName + ".txt" ) ).constData(),
+                             O_WRONLY | O_CREAT | O_CLOEXEC, 0644 );
+    if ( fileFd >= 0 )
+      close( fileFd );
+#else
+    QFile file( folderDir.filePath( entryName + ".txt" ) );
+    file.open( QIODevice::WriteOnly );
+#endif
+  }
+
+  markComplete( folderPath );
+  return folderPath;
+}
+
+/*!
+   Creates a chain of \a depth nested folders with \a filesPerLevel small text files on every level
+   \param depth number of the nested folders
+   \param filesPerLevel number of the files of every folder
+   \return path to the innermost folder
+ */
+QString treeGenerator_c::createDeepFolder( int depth, int filesPerLevel )
+{
+  const QString topPath = QDir( _rootPath ).filePath( QString( "deep-%1-%2" ).arg( depth ).arg( filesPerLevel ) );
+  QString folderPath = topPath;
+  for ( int level = 0; level < depth; level++ )
+    folderPath += "/d";
+
+  if ( isComplete( topPath ) )
+    return folderPath;
+
+  QDir().mkpath( folderPath );
+  QString levelPath = topPath;
+  for ( int level = 0; level <= depth; level++ )
+  {
+    for ( int index = 0; index < filesPerLevel; index++ )
+      writeFile( QDir( levelPath ).filePath( QString( "file-%1.txt" ).arg( index ) ), textBytes( 256 ) );
+    levelPath += "/d";
+  }
+
+  markComplete( topPath );
+  return folderPath;
+}
+
+/*!
+   Creates a text file of \a size bytes with lines of varying length, some of them with multi-byte characters
+   \param size size of the file
+   \return path to the file
+ */
+QString treeGenerator_c::createTextFile( qint64 size )
+{
+  const QString filePath = QDir( _rootPath ).filePath( QString( "text-%1.txt" ).arg( size ) );
+  if ( QFileInfo( filePath ).size() == size )
+    return filePath;
+
+  QFile file( filePath );
+  if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    return filePath;
+
+  for ( qint64 written = 0; written < size; )
+  {
+    const QByteArray chunk = textBytes( qMin( chunkSize, size - written ) );
+    file.write( chunk );
+    written += chunk.size();
+  }
+
+  return filePath;
+}
+
+/*!
+   Creates \a count files of \a size random bytes, named with binary, misleading and no extensions
+   \param count number of the files
+   \param size size of a file
+   \return paths to the files
+ */
+QStringList treeGenerator_c::createBinaryBlobs( int count, qint64 size )
+{
+  static const char *const suffixes[] = { ".bin", ".dat", "", ".png", ".log" };
+
+  const QString folderPath = QDir( _rootPath ).filePath( QString( "blobs-%1-%2" ).arg( count ).arg( size ) );
+  const bool complete = isComplete( folderPath );
+  QDir().mkpath( folderPath );
+
+  QStringList paths;
+  for ( int index = 0; index < count; index++ )
+  {
+    const QString filePath = QDir( folderPath ).filePath( QString( "blob-%1%2" ).arg( index ).
+                                                          arg( suffixes[ index % 5 ] ) );
+    if ( !complete )
+      writeFile( filePath, randomBytes( size ) );
+    paths.append( filePath );
+  }
+
+  markComplete( folderPath );
+  return paths;
+}
+
+/*!
+   Creates \a count small files of the kinds met in a typical folder: source files, text files without a known
+   extension, Latin-1 text, binaries, empty files
+   \param count number of the files
+   \return paths to the files
+ */
+QStringList treeGenerator_c::createMixedFiles( int count )
+{
+  static const char *const suffixes[] = { ".cpp", ".py", ".md", ".conf", "", ".txt", ".png", ".dat", ".rc" };
+
+  const QString folderPath = QDir( _rootPath ).filePath( QString( "mixed-%1" ).arg( count ) );
+  const bool complete = isComplete( folderPath );
+  QDir().mkpath( folderPath );
+
+  QStringList paths;
+  for ( int index = 0; index < count; index++ )
+  {
+    const int kind = index % 9;
+    const QString filePath = QDir( folderPath ).filePath( QString( "file-%1%2" ).arg( index ).arg( suffixes[ kind ] ) );
+    paths.append( filePath );
+    if ( complete )
+      continue;
+
+    const qint64 size = 512 + static_cast<qint64>( _random() % ( 16 * 1024 ) );
+    QByteArray content;
+    if ( kind == 6 || kind == 7 )
+      content = randomBytes( size );
+    else if ( kind == 5 )
+      content = textBytes( size ).replace( 'e', '\xe9' );
+    else if ( kind != 8 )
+      content = textBytes( size );
+    writeFile( filePath, content );
+  }
+
+  markComplete( folderPath );
+  return paths;
+}
+
+/*!
+   Writes a file given at \a filePath with content \a content
+   \param filePath path to the file
+   \param content the content
+   \return true on success
+ */
+bool treeGenerator_c::writeFile( const QString &filePath, const QByteArray &content )
+{
+  QFile file( filePath );
+  return file.open( QIODevice::WriteOnly | QIODevice::Truncate ) && file.write( content ) == content.size();
+}
+
+/*!
+   \param size number of the bytes
+   \return random bytes
+ */
+QByteArray treeGenerator_c::randomBytes( qint64 size )
+{
+  QByteArray bytes( static_cast<int>( size ), Qt::Uninitialized );
+  for ( int index = 0; index < bytes.size(); index += static_cast<int>( sizeof( quint64 ) ) )
+  {
+    const quint64 value = _random();
+    const int length = qMin( static_cast<int>( sizeof( value ) ), bytes.size() - index );
+    std::memcpy( bytes.data() + index, &value, static_cast<size_t>( length ) );
+  }
+  return bytes;
+}
+
+/*!
+   \param size number of the bytes
+   \return text of lines 0 to 160 characters long, about every fiftieth of them with multi-byte characters
+ */
+QByteArray treeGenerator_c::textBytes( qint64 size )
+{
+  static const char words[] = "lorem ipsum dolor sit amet consectetur adipiscing elit sed do eiusmod tempor ";
+  constexpr int wordsLength = static_cast<int>( sizeof( words ) - 1 );
+
+  QByteArray text;
+  text.reserve( static_cast<int>( size ) );
+  while ( text.size() < size )
+  {
+    const int lineLength = static_cast<int>( _random() % 161 );
+    const int start = static_cast<int>( _random() % wordsLength );
+    for ( int index = 0; index < lineLength; index++ )
+      text.append( words[ ( start + index ) % wordsLength ] );
+    if ( _random() % 50 == 0 )
+      text.append( "\xc3\xa9\xe2\x82\xac" );
+    text.append( '\n' );
+  }
+  text.truncate( static_cast<int>( size ) );
+  return text;
+}
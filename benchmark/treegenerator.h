@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+#include <random>
+
+/*!
+   Generates synthetic file system trees for the benchmarks
+   Every tree is created below a root folder, an existing tree of the same parameters is reused, so repeated runs
+   against a kept root skip the generation.
+ */
+class treeGenerator_c
+{
+  private:
+    // Folder the trees are created in
+    QString _rootPath;
+    // Source of the generated content, seeded for reproducible trees
+    std::mt19937_64 _random;
+
+  public:
+    explicit treeGenerator_c( const QString & );
+
+    QString createWideFolder( int );
+    QString createDeepFolder( int, int );
+    QString createTextFile( qint64 );
+    QStringList createBinaryBlobs( int, qint64 );
+    QStringList createMixedFiles( int );
+
+  private:
+    bool writeFile( const QString &, const QByteArray & );
+    QByteArray randomBytes( qint64 );
+    QByteArray textBytes( qint64 );
+};
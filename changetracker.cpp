@@ -0,0 +1,533 @@
+#include "changetracker.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <QtConcurrent>
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#if defined( Q_OS_LINUX )
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/fanotify.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+  // Interval collecting changes into a single batch, in ms
+  constexpr int coalesceInterval = 300;
+  // Interval between two polls of the folders that cannot be watched, in ms
+  constexpr int pollInterval = 2000;
+  // Maximum number of resolved file handles kept
+  constexpr int maximumHandlePaths = 16 * 1024;
+  // Size of the event read buffer
+  constexpr size_t eventBufferSize = 64 * 1024;
+
+#if defined( Q_OS_LINUX )
+  constexpr uint32_t inotifyMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_CLOSE_WRITE |
+                                   IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+#endif
+
+  /*!
+     \param path absolute path to an entry
+     \return absolute path to the folder containing the entry
+   */
+  QString parentPath( const QString &path )
+  {
+    return QFileInfo( path ).absolutePath();
+  }
+
+  /*!
+     Resolves a folder file handle \a handle reported by fanotify to a path
+     \param mountFd descriptor of a folder on the file system of the handle
+     \param handle the file handle including its header
+     \param handlePaths resolved folder paths by file handle, extended by the resolved path
+     \return absolute path to the folder, empty if the folder is gone
+   */
+  QString handlePath( int mountFd, const QByteArray &handle, QHash<QByteArray, QString> &handlePaths )
+  {
+    const auto handlePathIt = handlePaths.constFind( handle );
+    if ( handlePathIt != handlePaths.constEnd() )
+      return handlePathIt.value();
+
+    QString path;
+
+#if defined( Q_OS_LINUX ) && defined( FAN_REPORT_DFID_NAME )
+    QByteArray handleCopy( handle );
+    const int dirFd = open_by_handle_at( mountFd, reinterpret_cast<struct file_handle *>( handleCopy.data() ),
+                                         O_PATH | O_CLOEXEC );
+    if ( dirFd < 0 )
+      return {};
+
+    char linkTarget[ 4096 ];
+    const QByteArray fdLink = "/proc/self/fd/" + QByteArray::number( dirFd );
+    const ssize_t linkLength = readlink( fdLink.constData(), linkTarget, sizeof( linkTarget ) );
+    close( dirFd );
+    if ( linkLength <= 0 || linkLength == sizeof( linkTarget ) )
+      return {};
+
+    path = QFile::decodeName( QByteArray( linkTarget, static_cast<int>( linkLength ) ) );
+#else
+    Q_UNUSED( mountFd )
+#endif
+
+    if ( handlePaths.size() >= maximumHandlePaths )
+      handlePaths.clear();
+    handlePaths.insert( handle, path );
+
+    return path;
+  }
+}
+
+Q_LOGGING_CATEGORY( changeTrackerLog, "fileinspector.changetracker", QtInfoMsg )
+
+/*!
+   C-tor
+   \param parent parent object
+ */
+changeTracker_c::changeTracker_c( QObject *parent ) :
+  QObject( parent ),
+  _inotifyFd{ -1 },
+  _inotifyNotifier{ nullptr },
+  _fanotifyFd{ -1 },
+  _fanotifyMountFd{ -1 },
+  _fanotifyStopFd{ -1 },
+  _pollTimer{ nullptr },
+  _flushTimer{ nullptr },
+  _watchLimitReported{ false }
+{
+  _flushTimer = new QTimer( this );
+  _flushTimer->setSingleShot( true );
+  _flushTimer->setInterval( coalesceInterval );
+  connect( _flushTimer, &QTimer::timeout, this, &changeTracker_c::flushChanges );
+
+  _pollTimer = new QTimer( this );
+  _pollTimer->setInterval( pollInterval );
+  connect( _pollTimer, &QTimer::timeout, this, &changeTracker_c::pollFolders );
+
+  _fanotifyPool.setMaxThreadCount( 1 );
+
+#if defined( Q_OS_LINUX )
+  _inotifyFd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+  if ( _inotifyFd >= 0 )
+  {
+    _inotifyNotifier = new QSocketNotifier( _inotifyFd, QSocketNotifier::Read, this );
+    connect( _inotifyNotifier, QOverload<int>::of( &QSocketNotifier::activated ),
+             this, &changeTracker_c::readInotifyEvents );
+  }
+  else
+  {
+    qCWarning( changeTrackerLog ) << "inotify is not available, watched folders are polled";
+  }
+#endif
+}
+
+/*!
+   D-tor
+ */
+changeTracker_c::~changeTracker_c()
+{
+  stopTrackingTree();
+
+#if defined( Q_OS_LINUX )
+  if ( _inotifyFd >= 0 )
+    close( _inotifyFd );
+#endif
+}
+
+/*!
+   Starts watching a folder given at \a path
+   Watch requests are counted, the folder is watched until every request is withdrawn by \em unwatch.
+   \param path absolute path to the folder
+ */
+void changeTracker_c::watch( const QString &path )
+{
+  if ( path.isEmpty() )
+    return;
+
+  if ( _watchCounts[ path ]++ > 0 )
+    return;
+
+  if ( !addWatch( path ) )
+    poll( path );
+}
+
+/*!
+   Withdraws a watch request of a folder given at \a path
+   \param path absolute path to the folder
+ */
+void changeTracker_c::unwatch( const QString &path )
+{
+  const auto watchCountIt = _watchCounts.find( path );
+  if ( watchCountIt == _watchCounts.end() )
+    return;
+
+  if ( --watchCountIt.value() > 0 )
+    return;
+
+  _watchCounts.erase( watchCountIt );
+  removeWatch( path );
+  _polledPaths.remove( path );
+  if ( _polledPaths.isEmpty() )
+    _pollTimer->stop();
+}
+
+/*!
+   Stops watching all the folders
+ */
+void changeTracker_c::unwatchAll()
+{
+  const auto watchedPaths = _watchCounts.keys();
+  for ( const auto &path : watchedPaths )
+    removeWatch( path );
+
+  _watchCounts.clear();
+  _polledPaths.clear();
+  _pollTimer->stop();
+}
+
+/*!
+   Starts tracking a whole folder tree given at \a path, replacing the tracked tree
+   The tree is tracked through a fanotify mark of its file system, which requires administrative privileges. The
+   kernel cannot mark a subtree, so the events of the whole file system are read on a worker thread, which resolves
+   them to paths and passes on those inside the tree only.
+   \param path absolute path to the root folder of the tree
+   \return false if the tree cannot be tracked, only the watched folders are then reported
+ */
+bool changeTracker_c::trackTree( const QString &path )
+{
+  stopTrackingTree();
+
+#if defined( Q_OS_LINUX ) && defined( FAN_REPORT_DFID_NAME )
+  const QByteArray encodedPath = QFile::encodeName( path );
+
+  _fanotifyFd = fanotify_init( FAN_CLASS_NOTIF | FAN_REPORT_DFID_NAME | FAN_NONBLOCK | FAN_CLOEXEC,
+                               O_RDONLY | O_CLOEXEC );
+  if ( _fanotifyFd < 0 )
+  {
+    qCDebug( changeTrackerLog ) << "fanotify is not permitted, tracking watched folders only";
+    return false;
+  }
+
+  const uint64_t mask = FAN_CREATE | FAN_DELETE | FAN_MOVED_FROM | FAN_MOVED_TO | FAN_MODIFY | FAN_ATTRIB |
+                        FAN_ONDIR;
+  _fanotifyMountFd = open( encodedPath.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+  _fanotifyStopFd = eventfd( 0, EFD_CLOEXEC );
+  if ( _fanotifyMountFd < 0 || _fanotifyStopFd < 0 ||
+       fanotify_mark( _fanotifyFd, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, mask, AT_FDCWD, encodedPath.constData() ) != 0 )
+  {
+    qCDebug( changeTrackerLog ) << "cannot mark the file system of" << path << "for fanotify";
+    stopTrackingTree();
+    return false;
+  }
+
+  _trackedTree = path;
+  QtConcurrent::run( &_fanotifyPool, [this, fanotifyFd = _fanotifyFd, stopFd = _fanotifyStopFd,
+                                      mountFd = _fanotifyMountFd, path]()
+  {
+    readFanotifyEvents( fanotifyFd, stopFd, mountFd, path );
+  } );
+  return true;
+#else
+  Q_UNUSED( path )
+  return false;
+#endif
+}
+
+/*!
+   \return true if a whole folder tree is tracked
+ */
+bool changeTracker_c::isTrackingTree() const
+{
+  return !_trackedTree.isEmpty();
+}
+
+/*!
+   Places an inotify watch on a folder given at \a path
+   \param path absolute path to the folder
+   \return false if the folder cannot be watched
+ */
+bool changeTracker_c::addWatch( const QString &path )
+{
+#if defined( Q_OS_LINUX )
+  if ( _inotifyFd < 0 )
+    return false;
+
+  const int watchDescriptor = inotify_add_watch( _inotifyFd, QFile::encodeName( path ).constData(), inotifyMask );
+  if ( watchDescriptor < 0 )
+  {
+    if ( errno == ENOSPC && !_watchLimitReported )
+    {
+      qCWarning( changeTrackerLog ) << "inotify watch limit reached, further folders are polled; raise"
+                                    << "fs.inotify.max_user_watches to watch them";
+      _watchLimitReported = true;
+    }
+    return false;
+  }
+
+  _watchPaths.insert( watchDescriptor, path );
+  _watchDescriptors.insert( path, watchDescriptor );
+  return true;
+#else
+  Q_UNUSED( path )
+  return false;
+#endif
+}
+
+/*!
+   Removes an inotify watch of a folder given at \a path
+   \param path absolute path to the folder
+ */
+void changeTracker_c::removeWatch( const QString &path )
+{
+  const auto watchDescriptorIt = _watchDescriptors.find( path );
+  if ( watchDescriptorIt == _watchDescriptors.end() )
+    return;
+
+#if defined( Q_OS_LINUX )
+  inotify_rm_watch( _inotifyFd, watchDescriptorIt.value() );
+#endif
+  _watchPaths.remove( watchDescriptorIt.value() );
+  _watchDescriptors.erase( watchDescriptorIt );
+}
+
+/*!
+   Starts polling a folder given at \a path for modification
+   \param path absolute path to the folder
+ */
+void changeTracker_c::poll( const QString &path )
+{
+  _polledPaths.insert( path, QFileInfo( path ).lastModified().toMSecsSinceEpoch() );
+  if ( !_pollTimer->isActive() )
+    _pollTimer->start();
+}
+
+/*!
+   Stops tracking the folder tree
+ */
+void changeTracker_c::stopTrackingTree()
+{
+#if defined( Q_OS_LINUX )
+  if ( _fanotifyStopFd >= 0 )
+  {
+    const uint64_t stop = 1;
+    if ( write( _fanotifyStopFd, &stop, sizeof( stop ) ) != sizeof( stop ) )
+      qCWarning( changeTrackerLog ) << "cannot stop the fanotify reader:" << std::strerror( errno );
+  }
+  _fanotifyPool.waitForDone();
+
+  if ( _fanotifyFd >= 0 )
+    close( _fanotifyFd );
+  if ( _fanotifyMountFd >= 0 )
+    close( _fanotifyMountFd );
+  if ( _fanotifyStopFd >= 0 )
+    close( _fanotifyStopFd );
+#endif
+
+  _fanotifyFd = -1;
+  _fanotifyMountFd = -1;
+  _fanotifyStopFd = -1;
+  _trackedTree.clear();
+}
+
+/*!
+   Queues a change of an entry named \a name in a folder given at \a directory
+   \param directory absolute path to the folder
+   \param name name of the changed entry, empty if the folder itself changed
+ */
+void changeTracker_c::addChange( const QString &directory, const QString &name )
+{
+  _changedDirectories.insert( directory );
+  _changedEntries.insert( name.isEmpty() ? directory : directory + '/' + name );
+
+  // the batch is not postponed by further events, so a steady stream of changes is still reported
+  if ( !_flushTimer->isActive() )
+    _flushTimer->start();
+}
+
+/*!
+   Slot to read pending inotify events
+ */
+void changeTracker_c::readInotifyEvents()
+{
+#if defined( Q_OS_LINUX )
+  alignas( struct inotify_event ) char buffer[ eventBufferSize ];
+
+  for ( ;; )
+  {
+    const ssize_t length = read( _inotifyFd, buffer, sizeof( buffer ) );
+    if ( length <= 0 )
+      break;
+
+    for ( ssize_t position = 0; position < length; )
+    {
+      const auto *event = reinterpret_cast<const struct inotify_event *>( buffer + position );
+      position += static_cast<ssize_t>( sizeof( struct inotify_event ) + event->len );
+
+      if ( event->mask & IN_Q_OVERFLOW )
+      {
+        // events were lost, every watched folder has to be refreshed
+        for ( const auto &path : qAsConst( _watchPaths ) )
+          addChange( path, {} );
+        continue;
+      }
+
+      const auto watchPathIt = _watchPaths.constFind( event->wd );
+      if ( watchPathIt == _watchPaths.constEnd() )
+        continue;
+
+      const QString directory = watchPathIt.value();
+      if ( event->mask & ( IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED ) )
+      {
+        addChange( parentPath( directory ), QFileInfo( directory ).fileName() );
+        if ( event->mask & IN_IGNORED )
+        {
+          _watchPaths.remove( event->wd );
+          _watchDescriptors.remove( directory );
+        }
+        continue;
+      }
+
+      addChange( directory, ( event->len > 0 ) ? QFile::decodeName( event->name ) : QString() );
+    }
+  }
+#endif
+}
+
+/*!
+   Reads the fanotify events of the tracked tree until stopped, runs on the fanotify reader
+   Each read is resolved to the changes inside the tree, which are queued on the thread of the tracker.
+   \param fanotifyFd the fanotify instance
+   \param stopFd event descriptor stopping the reader once written
+   \param mountFd descriptor of the root folder of the tree, resolves the file handles
+   \param tree absolute path to the root folder of the tree
+ */
+void changeTracker_c::readFanotifyEvents( int fanotifyFd, int stopFd, int mountFd, const QString &tree )
+{
+#if defined( Q_OS_LINUX ) && defined( FAN_REPORT_DFID_NAME )
+  alignas( struct fanotify_event_metadata ) char buffer[ eventBufferSize ];
+  // resolved folder paths by file handle
+  QHash<QByteArray, QString> handlePaths;
+  const QString treePrefix = ( tree == "/" ) ? tree : tree + '/';
+
+  for ( ;; )
+  {
+    struct pollfd pollFds[ 2 ] = { { fanotifyFd, POLLIN, 0 }, { stopFd, POLLIN, 0 } };
+    if ( ::poll( pollFds, 2, -1 ) < 0 )
+    {
+      if ( errno == EINTR )
+        continue;
+      qCWarning( changeTrackerLog ) << "cannot wait for fanotify events:" << std::strerror( errno );
+      return;
+    }
+    if ( pollFds[ 1 ].revents != 0 )
+      return;
+
+    // changes as pairs of the folder path and the entry name, empty if the folder itself changed
+    std::vector<std::pair<QString, QString>> changes;
+
+    for ( ;; )
+    {
+      ssize_t length = read( fanotifyFd, buffer, sizeof( buffer ) );
+      if ( length <= 0 )
+        break;
+
+      const auto *metadata = reinterpret_cast<const struct fanotify_event_metadata *>( buffer );
+      for ( ; FAN_EVENT_OK( metadata, length ); metadata = FAN_EVENT_NEXT( metadata, length ) )
+      {
+        if ( metadata->fd >= 0 )
+          close( metadata->fd );
+
+        if ( metadata->mask & FAN_Q_OVERFLOW )
+        {
+          changes.emplace_back( tree, QString() );
+          continue;
+        }
+
+        if ( metadata->event_len < metadata->metadata_len + sizeof( struct fanotify_event_info_fid ) )
+          continue;
+
+        const auto *fid = reinterpret_cast<const struct fanotify_event_info_fid *>(
+                            reinterpret_cast<const char *>( metadata ) + metadata->metadata_len );
+        if ( fid->hdr.info_type != FAN_EVENT_INFO_TYPE_DFID_NAME )
+          continue;
+
+        const auto *handle = reinterpret_cast<const struct file_handle *>( fid->handle );
+        const int handleSize = static_cast<int>( sizeof( struct file_handle ) + handle->handle_bytes );
+        const char *name = reinterpret_cast<const char *>( handle->f_handle + handle->handle_bytes );
+
+        // a renamed or removed folder invalidates the resolved paths below it
+        if ( ( metadata->mask & FAN_ONDIR ) && ( metadata->mask & ( FAN_MOVED_FROM | FAN_MOVED_TO | FAN_DELETE ) ) )
+          handlePaths.clear();
+
+        const QByteArray handleData( reinterpret_cast<const char *>( handle ), handleSize );
+        const QString directory = handlePath( mountFd, handleData, handlePaths );
+        if ( directory.isEmpty() || !( directory == tree || directory.startsWith( treePrefix ) ) )
+          continue;
+
+        changes.emplace_back( directory, ( std::strcmp( name, "." ) != 0 ) ? QFile::decodeName( name ) : QString() );
+      }
+    }
+
+    if ( changes.empty() )
+      continue;
+
+    QMetaObject::invokeMethod( this, [this, tree, changes = std::move( changes )]()
+    {
+      // changes of a tree no longer tracked are dropped
+      if ( _trackedTree != tree )
+        return;
+
+      for ( const auto &change : changes )
+        addChange( change.first, change.second );
+    }, Qt::QueuedConnection );
+  }
+#else
+  Q_UNUSED( fanotifyFd )
+  Q_UNUSED( stopFd )
+  Q_UNUSED( mountFd )
+  Q_UNUSED( tree )
+#endif
+}
+
+/*!
+   Slot to poll the folders that cannot be watched
+ */
+void changeTracker_c::pollFolders()
+{
+  for ( auto polledPathIt = _polledPaths.begin(); polledPathIt != _polledPaths.end(); ++polledPathIt )
+  {
+    const qint64 modified = QFileInfo( polledPathIt.key() ).lastModified().toMSecsSinceEpoch();
+    if ( modified != polledPathIt.value() )
+    {
+      polledPathIt.value() = modified;
+      addChange( polledPathIt.key(), {} );
+    }
+  }
+}
+
+/*!
+   Slot to report the queued changes as a single batch
+ */
+void changeTracker_c::flushChanges()
+{
+  if ( _changedDirectories.isEmpty() && _changedEntries.isEmpty() )
+    return;
+
+  const QStringList directories( _changedDirectories.begin(), _changedDirectories.end() );
+  const QStringList entries( _changedEntries.begin(), _changedEntries.end() );
+  _changedDirectories.clear();
+  _changedEntries.clear();
+
+  emit pathsChanged( directories, entries );
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+class QSocketNotifier;
+class QTimer;
+
+/*!
+   Tracks changes of watched folders and reports them in coalesced batches
+   Every watched folder gets an inotify watch; a folder tree can additionally be tracked as a whole through
+   a fanotify file system mark, where the process is permitted to place one. As the mark covers the whole file
+   system, its events are read and resolved to paths on a worker thread, which drops the events outside the tree.
+   Events arriving within a short interval are merged into a single \em pathsChanged, so a burst of writes costs
+   one refresh.
+   Folders that cannot be watched, e.g. once the inotify watch limit is hit or on platforms without inotify,
+   are polled for modification instead.
+ */
+class changeTracker_c : public QObject
+{
+  Q_OBJECT
+
+  private:
+    // inotify instance, -1 if not available
+    int _inotifyFd;
+    QSocketNotifier *_inotifyNotifier;
+    // Watched folders by watch descriptor and the other way round
+    QHash<int, QString> _watchPaths;
+    QHash<QString, int> _watchDescriptors;
+    // Number of watch requests of every watched folder
+    QHash<QString, int> _watchCounts;
+    // fanotify instance tracking a folder tree, -1 if not tracking
+    int _fanotifyFd;
+    // Descriptor of the tracked tree, resolves file handles reported by fanotify
+    int _fanotifyMountFd;
+    // Wakes the fanotify reader to stop it, -1 if not tracking
+    int _fanotifyStopFd;
+    // Runs the fanotify reader
+    QThreadPool _fanotifyPool;
+    QString _trackedTree;
+    // Folders polled for modification and their last modification time
+    QHash<QString, qint64> _polledPaths;
+    QTimer *_pollTimer;
+    // Changes waiting for the next batch
+    QSet<QString> _changedDirectories;
+    QSet<QString> _changedEntries;
+    QTimer *_flushTimer;
+    // The watch limit was reported
+    bool _watchLimitReported;
+
+  public:
+    changeTracker_c( QObject * = nullptr );
+    virtual ~changeTracker_c();
+
+    void watch( const QString & );
+    void unwatch( const QString & );
+    void unwatchAll();
+    bool trackTree( const QString & );
+    bool isTrackingTree() const;
+
+  private:
+    bool addWatch( const QString & );
+    void removeWatch( const QString & );
+    void poll( const QString & );
+    void stopTrackingTree();
+    void readFanotifyEvents( int, int, int, const QString & );
+    void addChange( const QString &, const QString & );
+
+  private slots:
+    void readInotifyEvents();
+    void pollFolders();
+    void flushChanges();
+
+  signals:
+    // Folders with a changed entry and the changed entries, created, removed, renamed or written
+    void pathsChanged( const QStringList &directories, const QStringList &entries );
+};
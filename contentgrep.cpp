@@ -0,0 +1,398 @@
+#include "contentgrep.h"
+
+#include <QDirIterator>
+#include <QFile>
+#include <QMutex>
+#include <QRegularExpression>
+#include <QTimer>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <string>
+
+#if defined( Q_OS_UNIX )
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "dirlister.h"
+#include "literalmatcher.h"
+#include "mimeclassifier.h"
+#include "util.h"
+#include "workstealingpool.h"
+
+namespace
+{
+  // Interval between two deliveries of hits, in ms
+  constexpr int deliveryInterval = 100;
+  // Number of bytes of a line kept with a hit
+  constexpr qint64 maximumHitTextLength = 256;
+  // Number of bytes of a file read at once
+  constexpr qint64 chunkSize = 1024 * 1024;
+}
+
+/*!
+   Shared state of a single search
+ */
+struct contentGrep_c::grepState_s
+{
+  grepRequest_s request;
+  // Literal every matching line contains, may be empty for a regular expression
+  std::unique_ptr<literalMatcher_c> matcher;
+  QRegularExpression expression;
+  std::atomic<bool> cancelled{ false };
+  // Set once the search is cancelled or reached the hit limit
+  std::atomic<bool> stopped{ false };
+  std::atomic<qint64> filesSearched{ 0 };
+  std::atomic<qint64> filesSkipped{ 0 };
+  std::atomic<int> hitCount{ 0 };
+  // Hits not delivered yet
+  QMutex pendingMutex;
+  QVector<grepHit_s> pendingHits;
+};
+
+namespace
+{
+  using grepState_t = contentGrep_c::grepState_s;
+
+  /*!
+     Searches a file given at \a path
+     The file is read in chunks of whole lines rather than mapped, so a file truncated while searched just ends the
+     search early. A line longer than a chunk is searched in parts.
+     \param state the search state
+     \param path path to the file
+   */
+  void grepFile( grepState_t &state, const std::string &path )
+  {
+    if ( state.stopped )
+      return;
+
+    QFile file( QFile::decodeName( path.c_str() ) );
+    if ( !file.open( QIODevice::ReadOnly ) || file.size() <= 0 )
+      return;
+
+    QByteArray buffer( static_cast<int>( chunkSize ), Qt::Uninitialized );
+    char *data = buffer.data();
+    qint64 filled = 0;
+    bool atEnd = false;
+    // Byte offset of the buffer in the file
+    qint64 bufferOffset = 0;
+
+    const auto fillBuffer = [&]()
+    {
+      while ( filled < chunkSize && !atEnd )
+      {
+        const qint64 count = file.read( data + filled, chunkSize - filled );
+        if ( count <= 0 )
+          atEnd = true;
+        else
+          filled += count;
+      }
+    };
+
+    fillBuffer();
+    if ( filled == 0 )
+      return;
+
+    if ( !mimeClassifier_c::classifyData( file.fileName(), data, filled ).isText )
+    {
+      state.filesSkipped++;
+      return;
+    }
+    state.filesSearched++;
+
+    const bool useExpression = state.request.regularExpression;
+    QVector<grepHit_s> hits;
+    qint64 lineNumber = 0;
+    qint64 lineCountedTo = 0;
+    // Number of bytes of complete lines in the buffer
+    qint64 size = 0;
+
+    // returns false once the search is to stop
+    const auto addHit = [&]( qint64 lineStart, qint64 lineEnd )
+    {
+      lineNumber += std::count( data + lineCountedTo, data + lineStart, '\n' );
+      lineCountedTo = lineStart;
+
+      qint64 textEnd = qMin( lineEnd, lineStart + maximumHitTextLength );
+      if ( textEnd > lineStart && data[ textEnd - 1 ] == '\r' )
+        textEnd--;
+
+      if ( state.hitCount++ >= contentGrep_c::maximumHits )
+      {
+        state.stopped = true;
+        return false;
+      }
+
+      hits.append( { file.fileName(), lineNumber, bufferOffset + lineStart,
+                     QString::fromUtf8( data + lineStart, static_cast<int>( textEnd - lineStart ) ) } );
+      return true;
+    };
+
+    const auto lineMatches = [&]( qint64 lineStart, qint64 lineEnd )
+    {
+      return !useExpression || state.expression.match(
+               QString::fromUtf8( data + lineStart, static_cast<int>( lineEnd - lineStart ) ) ).hasMatch();
+    };
+
+    const auto lineEndFrom = [data, &size]( qint64 position )
+    {
+      const void *newLine = std::memchr( data + position, '\n', static_cast<size_t>( size - position ) );
+      return ( newLine != nullptr ) ? static_cast<const char *>( newLine ) - data : size;
+    };
+
+    while ( filled > 0 && !state.stopped )
+    {
+      // the last line is searched once complete, unless the file ends or the line fills the buffer
+      size = filled;
+      if ( !atEnd )
+      {
+        qint64 completeSize = filled;
+        while ( completeSize > 0 && data[ completeSize - 1 ] != '\n' )
+          completeSize--;
+        if ( completeSize > 0 )
+          size = completeSize;
+      }
+
+      qint64 from = 0;
+      while ( from < size && !state.stopped )
+      {
+        qint64 lineStart = from;
+        if ( !state.matcher->isEmpty() )
+        {
+          // the search position is always a line start, so is the backward scan bounded by it
+          const qint64 position = state.matcher->find( data, size, from );
+          if ( position < 0 )
+            break;
+
+          lineStart = position;
+          while ( lineStart > from && data[ lineStart - 1 ] != '\n' )
+            lineStart--;
+        }
+
+        const qint64 lineEnd = lineEndFrom( lineStart );
+        if ( lineMatches( lineStart, lineEnd ) && !addHit( lineStart, lineEnd ) )
+          break;
+
+        from = lineEnd + 1;
+      }
+
+      lineNumber += std::count( data + lineCountedTo, data + size, '\n' );
+      lineCountedTo = 0;
+
+      std::memmove( data, data + size, static_cast<size_t>( filled - size ) );
+      filled -= size;
+      bufferOffset += size;
+      fillBuffer();
+    }
+
+    if ( !hits.isEmpty() )
+    {
+      QMutexLocker locker( &state.pendingMutex );
+      state.pendingHits += hits;
+    }
+  }
+
+  /*!
+     Lists a folder given at \a path, submitting a task for every file and every sub-folder
+     Hidden entries are skipped like in the tree, symbolic links are not followed.
+     \param state the search state
+     \param pool the pool running the search
+     \param path path to the folder
+   */
+  void grepDirectory( const std::shared_ptr<grepState_t> &state, workStealingPool_c &pool, const std::string &path )
+  {
+    if ( state->stopped )
+      return;
+
+    const std::string prefix = ( !path.empty() && path.back() == '/' ) ? path : path + '/';
+    const auto submitEntry = [&]( const char *name, bool isDir )
+    {
+      std::string entryPath = prefix + name;
+      if ( isDir )
+        pool.submit( [state, &pool, entryPath]( int ) { grepDirectory( state, pool, entryPath ); } );
+      else
+        pool.submit( [state, entryPath]( int ) { grepFile( *state, entryPath ); } );
+    };
+
+#if defined( Q_OS_UNIX )
+    const int dirFd = open( path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+    if ( dirFd < 0 )
+      return;
+
+    dirLister_c::readEntries( dirFd, [&]( const char *name, unsigned char dType )
+    {
+      if ( name[ 0 ] == '.' )
+        return true;
+
+      if ( dType == DT_UNKNOWN )
+      {
+        struct stat entryStat;
+        if ( fstatat( dirFd, name, &entryStat, AT_SYMLINK_NOFOLLOW ) != 0 )
+          return true;
+        dType = S_ISDIR( entryStat.st_mode ) ? DT_DIR : ( S_ISREG( entryStat.st_mode ) ? DT_REG : DT_UNKNOWN );
+      }
+
+      if ( dType == DT_DIR || dType == DT_REG )
+        submitEntry( name, dType == DT_DIR );
+      return true;
+    }, [&state]() { return !state->stopped; } );
+
+    close( dirFd );
+#else
+    QDirIterator dirIt( QFile::decodeName( path.c_str() ), QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot |
+                        QDir::NoSymLinks );
+    while ( dirIt.hasNext() && !state->stopped )
+    {
+      dirIt.next();
+      submitEntry( QFile::encodeName( dirIt.fileName() ).constData(), dirIt.fileInfo().isDir() );
+    }
+#endif
+  }
+}
+
+/*!
+   C-tor
+   \param parent parent object
+ */
+contentGrep_c::contentGrep_c( QObject *parent ) :
+  QObject( parent ),
+  _deliveryTimer{ nullptr }
+{
+  _deliveryTimer = new QTimer( this );
+  _deliveryTimer->setInterval( deliveryInterval );
+  connect( _deliveryTimer, &QTimer::timeout, this, &contentGrep_c::deliverHits );
+}
+
+/*!
+   D-tor
+   Cancels the current search and waits for all the searches to wind down.
+ */
+contentGrep_c::~contentGrep_c()
+{
+  cancel();
+  for ( auto &grepFuture : _grepFutures )
+    grepFuture.waitForFinished();
+}
+
+/*!
+   Starts a search given at \a request, abandoning the current one
+   \param request the search parameters
+   \return false if the pattern is not a valid regular expression
+ */
+bool contentGrep_c::start( const grepRequest_s &request )
+{
+  cancel();
+
+  _grepFutures.erase( std::remove_if( _grepFutures.begin(), _grepFutures.end(),
+                                      []( const QFuture<void> &grepFuture ) { return grepFuture.isFinished(); } ),
+                      _grepFutures.end() );
+
+  if ( request.pattern.isEmpty() )
+    return false;
+
+  auto state = std::make_shared<grepState_s>();
+  state->request = request;
+
+  QString literal = request.pattern;
+  const auto isAscii = []( const QString &text )
+  {
+    return std::all_of( text.begin(), text.end(), []( QChar character ) { return character.unicode() < 0x80; } );
+  };
+
+  // the literal matcher folds ASCII letters only, other literals ignoring case are verified by an expression
+  if ( !request.regularExpression && !request.caseSensitive && !isAscii( literal ) )
+  {
+    state->request.regularExpression = true;
+    state->request.pattern = QRegularExpression::escape( literal );
+  }
+
+  if ( state->request.regularExpression )
+  {
+    state->expression.setPattern( state->request.pattern );
+    if ( !request.caseSensitive )
+      state->expression.setPatternOptions( QRegularExpression::CaseInsensitiveOption );
+    if ( !state->expression.isValid() )
+      return false;
+
+    literal = fileInspector_n::util_n::getRequiredLiteral( state->request.pattern );
+    if ( !request.caseSensitive && !isAscii( literal ) )
+      literal.clear();
+  }
+  state->matcher = std::make_unique<literalMatcher_c>( literal.toUtf8(), request.caseSensitive );
+
+  _state = state;
+
+  _grepFutures.append( QtConcurrent::run( [this, state]()
+  {
+    {
+      workStealingPool_c pool;
+      const std::string folderPath = QFile::encodeName( state->request.folderPath ).toStdString();
+      pool.submit( [state, &pool, folderPath]( int ) { grepDirectory( state, pool, folderPath ); } );
+      pool.wait();
+    }
+
+    if ( state->cancelled )
+      return;
+
+    QMetaObject::invokeMethod( this, [this, state]()
+    {
+      if ( state != _state )
+        return;
+
+      _deliveryTimer->stop();
+      deliverHits();
+      _state.reset();
+      emit finished( state->hitCount <= maximumHits );
+    }, Qt::QueuedConnection );
+  } ) );
+
+  _deliveryTimer->start();
+  return true;
+}
+
+/*!
+   Abandons the current search
+ */
+void contentGrep_c::cancel()
+{
+  _deliveryTimer->stop();
+
+  if ( _state )
+  {
+    _state->cancelled = true;
+    _state->stopped = true;
+    _state.reset();
+  }
+}
+
+/*!
+   \return true if a search is in progress
+ */
+bool contentGrep_c::isRunning() const
+{
+  return _state != nullptr;
+}
+
+/*!
+   Slot to deliver the hits found since the last delivery
+ */
+void contentGrep_c::deliverHits()
+{
+  if ( !_state )
+    return;
+
+  QVector<grepHit_s> hits;
+  {
+    QMutexLocker locker( &_state->pendingMutex );
+    hits.swap( _state->pendingHits );
+  }
+
+  if ( !hits.isEmpty() )
+    emit hitsFound( hits );
+  emit progressUpdated( _state->filesSearched, _state->filesSkipped );
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <QFuture>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include <memory>
+
+class QTimer;
+
+/*!
+   Parameters of a content search
+ */
+struct grepRequest_s
+{
+  // Absolute path to the searched folder
+  QString folderPath;
+  QString pattern;
+  // The pattern is a regular expression rather than a literal
+  bool regularExpression = false;
+  bool caseSensitive = false;
+};
+
+/*!
+   Line matching a content search
+ */
+struct grepHit_s
+{
+  // Absolute path to the file
+  QString path;
+  // Zero-based line number
+  qint64 line = 0;
+  // Byte offset of the line
+  qint64 offset = 0;
+  // The line, shortened if too long
+  QString text;
+};
+
+/*!
+   Searches contents of the text files below a folder in the background
+   Every sub-folder and every file is a task of a \em workStealingPool_c. Files are read in chunks of whole lines,
+   files of a non-text MIME type are skipped. A literal, or the longest literal a regular expression requires, is found
+   with \em literalMatcher_c and only the lines containing it are matched against the expression.
+   Hits are delivered periodically through \em hitsFound while the search is running.
+ */
+class contentGrep_c : public QObject
+{
+  Q_OBJECT
+
+  public:
+    // Maximum number of hits of a single search
+    static constexpr int maximumHits = 10000;
+
+    struct grepState_s;
+
+  private:
+    // State of the current search
+    std::shared_ptr<grepState_s> _state;
+    // The current search and cancelled searches possibly still winding down
+    QList<QFuture<void>> _grepFutures;
+    // Triggers delivery of the hits found so far
+    QTimer *_deliveryTimer;
+
+  public:
+    contentGrep_c( QObject * = nullptr );
+    virtual ~contentGrep_c();
+
+    bool start( const grepRequest_s & );
+    void cancel();
+    bool isRunning() const;
+
+  private slots:
+    void deliverHits();
+
+  signals:
+    void hitsFound( const QVector<grepHit_s> & );
+    // Number of the searched files and of the skipped non-text files
+    void progressUpdated( qint64, qint64 );
+    // Reports the end of a search, false if it stopped at the hit limit
+    void finished( bool );
+};
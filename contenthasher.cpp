@@ -0,0 +1,227 @@
+#include "contenthasher.h"
+
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+  constexpr quint64 prime1 = 0x9E3779B185EBCA87ULL;
+  constexpr quint64 prime2 = 0xC2B2AE3D27D4EB4FULL;
+  constexpr quint64 prime3 = 0x165667B19E3779F9ULL;
+  constexpr quint64 prime4 = 0x85EBCA77C2B2AE63ULL;
+  constexpr quint64 prime5 = 0x27D4EB2F165667C5ULL;
+
+  inline quint64 rotateLeft( quint64 value, int bits )
+  {
+    return ( value << bits ) | ( value >> ( 64 - bits ) );
+  }
+
+  inline quint64 read64( const uchar *data )
+  {
+    quint64 value;
+    std::memcpy( &value, data, sizeof( value ) );
+    return qFromLittleEndian( value );
+  }
+
+  inline quint32 read32( const uchar *data )
+  {
+    quint32 value;
+    std::memcpy( &value, data, sizeof( value ) );
+    return qFromLittleEndian( value );
+  }
+
+  inline quint64 round( quint64 accumulator, quint64 input )
+  {
+    accumulator += input * prime2;
+    accumulator = rotateLeft( accumulator, 31 );
+    return accumulator * prime1;
+  }
+
+  inline quint64 mergeRound( quint64 hash, quint64 accumulator )
+  {
+    hash ^= round( 0, accumulator );
+    return hash * prime1 + prime4;
+  }
+
+  /*!
+     Hashes the 32-byte stripes of \a data into \a accumulators
+     \param accumulators the stripe accumulators
+     \param data the data
+     \param size number of the bytes, a multiple of 32
+   */
+  void consumeStripes( std::array<quint64, 4> &accumulators, const uchar *data, size_t size )
+  {
+    quint64 accumulator0 = accumulators[ 0 ];
+    quint64 accumulator1 = accumulators[ 1 ];
+    quint64 accumulator2 = accumulators[ 2 ];
+    quint64 accumulator3 = accumulators[ 3 ];
+
+    for ( const uchar *end = data + size; data < end; data += 32 )
+    {
+      accumulator0 = round( accumulator0, read64( data ) );
+      accumulator1 = round( accumulator1, read64( data + 8 ) );
+      accumulator2 = round( accumulator2, read64( data + 16 ) );
+      accumulator3 = round( accumulator3, read64( data + 24 ) );
+    }
+
+    accumulators = { accumulator0, accumulator1, accumulator2, accumulator3 };
+  }
+}
+
+/*!
+   C-tor
+   \param seed seed of the hash
+ */
+contentHasher_c::contentHasher_c( quint64 seed )
+{
+  reset( seed );
+}
+
+/*!
+   Starts a new hash
+   \param seed seed of the hash
+ */
+void contentHasher_c::reset( quint64 seed )
+{
+  _seed = seed;
+  _accumulators = { seed + prime1 + prime2, seed + prime2, seed, seed - prime1 };
+  _length = 0;
+  _pendingSize = 0;
+}
+
+/*!
+   Hashes the next \a size bytes of the data, given at \a data
+   \param data the bytes
+   \param size number of the bytes
+ */
+void contentHasher_c::update( const void *data, size_t size )
+{
+  const uchar *bytes = static_cast<const uchar *>( data );
+  _length += size;
+
+  if ( _pendingSize > 0 )
+  {
+    const size_t taken = std::min( size, _pending.size() - _pendingSize );
+    std::memcpy( _pending.data() + _pendingSize, bytes, taken );
+    _pendingSize += taken;
+    bytes += taken;
+    size -= taken;
+
+    if ( _pendingSize < _pending.size() )
+      return;
+    consumeStripes( _accumulators, _pending.data(), _pending.size() );
+    _pendingSize = 0;
+  }
+
+  const size_t stripeBytes = size & ~static_cast<size_t>( 31 );
+  consumeStripes( _accumulators, bytes, stripeBytes );
+
+  _pendingSize = size - stripeBytes;
+  std::memcpy( _pending.data(), bytes + stripeBytes, _pendingSize );
+}
+
+/*!
+   \return hash of the bytes fed so far, further bytes may still be fed
+ */
+quint64 contentHasher_c::digest() const
+{
+  quint64 hash;
+  if ( _length >= _pending.size() )
+  {
+    hash = rotateLeft( _accumulators[ 0 ], 1 ) + rotateLeft( _accumulators[ 1 ], 7 ) +
+           rotateLeft( _accumulators[ 2 ], 12 ) + rotateLeft( _accumulators[ 3 ], 18 );
+    for ( const quint64 accumulator : _accumulators )
+      hash = mergeRound( hash, accumulator );
+  }
+  else
+    hash = _seed + prime5;
+
+  hash += _length;
+
+  const uchar *data = _pending.data();
+  const uchar *end = data + _pendingSize;
+  for ( ; data + 8 <= end; data += 8 )
+  {
+    hash ^= round( 0, read64( data ) );
+    hash = rotateLeft( hash, 27 ) * prime1 + prime4;
+  }
+  if ( data + 4 <= end )
+  {
+    hash ^= static_cast<quint64>( read32( data ) ) * prime1;
+    hash = rotateLeft( hash, 23 ) * prime2 + prime3;
+    data += 4;
+  }
+  for ( ; data < end; data++ )
+  {
+    hash ^= *data * prime5;
+    hash = rotateLeft( hash, 11 ) * prime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= prime2;
+  hash ^= hash >> 29;
+  hash *= prime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+/*!
+   Hashes \a size bytes given at \a data at once
+   \param data the bytes
+   \param size number of the bytes
+   \param seed seed of the hash
+   \return the hash
+ */
+quint64 contentHasher_c::hash( const void *data, size_t size, quint64 seed )
+{
+  contentHasher_c hasher( seed );
+  hasher.update( data, size );
+  return hasher.digest();
+}
+
+/*!
+   Checks the hash against reference vectors of XXH64, hashed at once and fed in pieces
+   \return false if any digest differs from the reference
+ */
+bool contentHasher_c::selfTest()
+{
+  /*!
+     Reference digest of a text
+   */
+  struct vector_s
+  {
+    const char *text;
+    quint64 seed;
+    quint64 digest;
+  };
+
+  static const vector_s vectors[] =
+  {
+    { "", 0, 0xEF46DB3751D8E999ULL },
+    { "a", 0, 0xD24EC4F1A98C6E5BULL },
+    { "abc", 0, 0x44BC2CF5AD770999ULL },
+    { "abc", 1, 0xBEA9CA8199328908ULL },
+    { "Nobody inspects the spammish repetition", 0, 0xFBCEA83C8A378BF1ULL }
+  };
+
+  for ( const vector_s &vector : vectors )
+  {
+    if ( hash( vector.text, std::strlen( vector.text ), vector.seed ) != vector.digest )
+      return false;
+  }
+
+  // every byte value four times and a tail, covering the stripes, the 8, 4 and 1 byte rounds
+  uchar data[ 4 * 256 + 3 ];
+  for ( size_t index = 0; index < 4 * 256; index++ )
+    data[ index ] = static_cast<uchar>( index );
+  std::memcpy( data + 4 * 256, "xyz", 3 );
+  constexpr quint64 dataDigest = 0xE146CB31B65BC21AULL;
+
+  contentHasher_c hasher;
+  for ( size_t offset = 0; offset < sizeof( data ); offset += 7 )
+    hasher.update( data + offset, std::min<size_t>( 7, sizeof( data ) - offset ) );
+
+  return hash( data, sizeof( data ) ) == dataDigest && hasher.digest() == dataDigest;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include <array>
+#include <cstddef>
+
+/*!
+   Fast non-cryptographic 64-bit hash of file contents, the XXH64 algorithm
+   Data may be fed in pieces of any size, the digest equals the one of the data hashed at once. Several GB/s per
+   core, so hashing keeps up with sequential reads. Equal digests mark contents as very likely equal, not as equal
+   beyond doubt. \em selfTest checks the digests against reference vectors of XXH64.
+ */
+class contentHasher_c
+{
+  private:
+    quint64 _seed;
+    // Accumulators of the 32-byte stripes
+    std::array<quint64, 4> _accumulators;
+    // Number of the bytes hashed so far
+    quint64 _length;
+    // Bytes not filling a stripe yet
+    std::array<uchar, 32> _pending;
+    size_t _pendingSize;
+
+  public:
+    explicit contentHasher_c( quint64 = 0 );
+
+    void reset( quint64 = 0 );
+    void update( const void *, size_t );
+    quint64 digest() const;
+
+    static quint64 hash( const void *, size_t, quint64 = 0 );
+    static bool selfTest();
+};
@@ -1,15 +1,42 @@
 #include "detailwidget.h"
 
-#include <QFileInfo>
+#include <QFontDatabase>
+#include <QLabel>
 #include <QLineEdit>
-#include <QMimeDatabase>
+#include <QLocale>
+#include <QPlainTextEdit>
 #include <QPushButton>
+#include <QScrollBar>
 #include <QTextEdit>
 #include <QHBoxLayout>
+#include <QStackedLayout>
+#include <QTextCursor>
+#include <QTimer>
 #include <QVBoxLayout>
+#include <QtConcurrent>
 
+#include "hexviewer.h"
+#include "largefileviewer.h"
+#include "logtailer.h"
+#include "pathcompleter.h"
+#include "perftracer.h"
+#include "previewengine.h"
+#include "sizescanner.h"
+#include "statcache.h"
 #include "util.h"
 
+namespace
+{
+  // Pause of the typing in ms, after which an edited path not in the stat cache is validated
+  constexpr int pathValidationDelay = 150;
+  // Number of path validation workers, more than one so a validation hanging on a slow mount does not block the next
+  constexpr int pathValidationThreadCount = 2;
+  // Number of the last lines of a followed text file shown once it is followed
+  constexpr int tailLineCount = 1000;
+  // Number of the lines of a followed text file kept at most, the oldest ones are dropped
+  constexpr int maximumTailLines = 50000;
+}
+
 /*!
    C-tor
    \param parent parent widget
@@ -17,11 +44,24 @@
 detailWidget_c::detailWidget_c( QWidget *parent ) :
   QWidget( parent ),
   _pathLine{ nullptr },
+  _pathCompleter{ nullptr },
   _pathListButton{ nullptr },
+  _sizeSummary{ nullptr },
   _previewSize{ 0, 0 },
-  _preview{ nullptr }
+  _preview{ nullptr },
+  _fileViewer{ nullptr },
+  _hexViewer{ nullptr },
+  _tailView{ nullptr },
+  _previewLayout{ nullptr },
+  _logTailer{ nullptr },
+  _logFollowed{ false },
+  _previewEngine{ nullptr },
+  _pathValidationTimer{ nullptr },
+  _pathValidationGeneration{ 0 },
+  _pendingLine{ -1 }
 {
   _pathLine = new QLineEdit( this );
+  _pathCompleter = new pathCompleter_c( _pathLine, this );
 
   _pathListButton = new QPushButton( tr( "List" ), this );
   _pathListButton->setDisabled( true );
@@ -30,10 +70,25 @@ detailWidget_c::detailWidget_c( QWidget *parent ) :
   listBoxLayout->addWidget( _pathLine );
   listBoxLayout->addWidget( _pathListButton );
 
+  _sizeSummary = new QLabel( this );
+  _sizeSummary->setWordWrap( true );
+  _sizeSummary->setTextInteractionFlags( Qt::TextSelectableByMouse );
+  _sizeSummary->hide();
+
   _preview = new QTextEdit;
+  _fileViewer = new largeFileViewer_c;
+  _hexViewer = new hexViewer_c;
+  _tailView = new QPlainTextEdit;
+  _tailView->setReadOnly( true );
+  _tailView->setLineWrapMode( QPlainTextEdit::NoWrap );
+  _tailView->setMaximumBlockCount( maximumTailLines );
+  _tailView->setFont( QFontDatabase::systemFont( QFontDatabase::FixedFont ) );
 
-  QVBoxLayout *detailsLayout = new QVBoxLayout;
-  detailsLayout->addWidget( _preview );
+  _previewLayout = new QStackedLayout;
+  _previewLayout->addWidget( _preview );
+  _previewLayout->addWidget( _fileViewer );
+  _previewLayout->addWidget( _hexViewer );
+  _previewLayout->addWidget( _tailView );
 
   QVBoxLayout *mainLayout = new QVBoxLayout;
   QMargins mainLayoutMargins = mainLayout->contentsMargins();
@@ -43,7 +98,8 @@ detailWidget_c::detailWidget_c( QWidget *parent ) :
   mainLayout->setContentsMargins( mainLayoutMargins );
 
   mainLayout->addLayout( listBoxLayout );
-  mainLayout->addLayout( detailsLayout );
+  mainLayout->addWidget( _sizeSummary );
+  mainLayout->addLayout( _previewLayout );
 
   setLayout( mainLayout );
 
@@ -51,8 +107,21 @@ detailWidget_c::detailWidget_c( QWidget *parent ) :
   setupPathValidPalette();
   setupPathNotValidPalette();
 
+  _pathValidationPool.setMaxThreadCount( pathValidationThreadCount );
+  _pathValidationTimer = new QTimer( this );
+  _pathValidationTimer->setSingleShot( true );
+  _pathValidationTimer->setInterval( pathValidationDelay );
+  connect( _pathValidationTimer, &QTimer::timeout, this, &detailWidget_c::validateEditedPath );
+
   connect( _pathLine, &QLineEdit::textChanged, this, &detailWidget_c::pathLineTextChanged );
   connect( _pathListButton, &QPushButton::clicked, this, &detailWidget_c::listManuallyEditedPath );
+
+  _previewEngine = new previewEngine_c( this );
+  connect( _previewEngine, &previewEngine_c::previewReady, this, &detailWidget_c::showPreview );
+
+  _logTailer = new logTailer_c( this );
+  connect( _logTailer, &logTailer_c::tailReset, this, &detailWidget_c::showTail );
+  connect( _logTailer, &logTailer_c::tailAppended, this, &detailWidget_c::appendTail );
 }
 
 /*!
@@ -92,48 +161,74 @@ bool detailWidget_c::isPathValidForListing( const QString &path ) const
   return fileInspector_n::util_n::isValid( path, true );
 }
 
+/*!
+   Enables the listing of the path in \em _pathLine and marks the path as valid, or the opposite
+   \param valid true if the path is valid for listing
+ */
+void detailWidget_c::setPathValidForListing( bool valid )
+{
+  _pathListButton->setEnabled( valid );
+  _pathLine->setPalette( valid ? _pathValidPalette : _pathNotValidPalette );
+}
+
 /*!
    Handles details of the file system entry given at \a selectionPath
    \param selectionPath absolute path to the file system entry
+   The preview is produced asynchronously by \em _previewEngine, see \em showPreview.
    For a folder, a short listing is given in the preview pane
-   For a text file, small portion is read and displayed in the preview pane
-   For other files, file attributes name, size and type are displayed.
+   For a text file, the file is opened in the text file viewer, or its last lines are followed in the follow mode
+   For a compressed file or an archive, the head of the decompressed contents or the members are given in the preview
+   pane, file attributes name, size and type are displayed above.
+   For other files, the file is opened in the hex viewer, file attributes name, size and type are displayed above.
  */
 void detailWidget_c::handleSelectionDetails( const QString &selectionPath )
 {
   _preview->clear();
+  _fileViewer->clear();
+  _hexViewer->clear();
+  _logTailer->stop();
+  _tailView->clear();
+  _sizeSummary->clear();
+  _sizeSummary->hide();
 
-  if ( !QFileInfo::exists( selectionPath ) )
-    return;
+  requestPreview( selectionPath );
+}
 
-  if ( fileInspector_n::util_n::isValid( selectionPath, false ) )
-  {
-    QMimeDatabase mdb;
-    QMimeType mime = mdb.mimeTypeForFile( selectionPath );
+/*!
+   \param path absolute path to a file system entry
+   \return parameters of a preview of the entry, fitting the preview pane
+ */
+previewRequest_s detailWidget_c::previewRequestFor( const QString &path ) const
+{
+  previewRequest_s request;
+  request.path = path;
+  request.maxContentSize = fileInspector_n::util_n::getMaxContentSize( _previewSize, _preview->currentFont() );
+  request.maxContentLines = fileInspector_n::util_n::getMaxContentLines( _previewSize, _preview->currentFont() );
+  request.readTextContent = false;
+  return request;
+}
 
-    if ( mime.inherits( "text/plain" ) )
-    {
-      const int maxPreviewContentSize = fileInspector_n::util_n::getMaxContentSize( _previewSize, _preview->currentFont() );
+/*!
+   Requests a preview of the file system entry given at \a path from \em _previewEngine
+   \param path absolute path to the file system entry
+ */
+void detailWidget_c::requestPreview( const QString &path )
+{
+  _previewEngine->requestPreview( previewRequestFor( path ) );
+}
 
-      QString fileContent = fileInspector_n::util_n::getTextFileContent( selectionPath, maxPreviewContentSize );
-      if ( !fileContent.isEmpty() )
-        _preview->setText( fileContent );
-    }
-    else
-    {
-      QFileInfo selectionFileInfo( selectionPath );
-      _preview->setText( QString( "Name: %1\nType: %2\nSize: %3" ).arg( selectionPath ).arg( mime.name() ).
-                         arg( selectionFileInfo.size() ) );
-    }
-  }
-  else if ( fileInspector_n::util_n::isValid( selectionPath, true ) )
-  {
-    const int maxPreviewLines = fileInspector_n::util_n::getMaxContentLines( _previewSize, _preview->currentFont() );
+/*!
+   Slot to prefetch previews of the file system entries given at \a paths, likely to be selected next
+   \param paths absolute paths to the entries, the most likely first
+ */
+void detailWidget_c::prefetchPreviews( const QStringList &paths )
+{
+  QVector<previewRequest_s> requests;
+  requests.reserve( paths.size() );
+  for ( const auto &path : paths )
+    requests.append( previewRequestFor( path ) );
 
-    QStringList folderContent = fileInspector_n::util_n::getDirContent( selectionPath, maxPreviewLines );
-    if ( !folderContent.isEmpty() )
-      _preview->setText( folderContent.join( "\n" ) );
-  }
+  _previewEngine->prefetch( requests );
 }
 
 /*!
@@ -149,22 +244,149 @@ void detailWidget_c::handleSelectionPath( const QString &selectionPath )
   }
 }
 
+/*!
+   Slot to display the recursive size of the selected folder
+   \param result totals of the folder size scan
+ */
+void detailWidget_c::handleSizeScanUpdate( const sizeScanResult_s &result )
+{
+  if ( result.path != _pathLine->text() )
+    return;
+
+  const QLocale locale;
+  QString summary = tr( "%1 in %2 files, %3 folders" ).arg( locale.formattedDataSize( result.totalBytes ) ).
+                    arg( locale.toString( result.fileCount ) ).arg( locale.toString( result.dirCount ) );
+  if ( !result.complete )
+    summary += tr( " (scanning...)" );
+
+  QStringList largestChildren;
+  for ( int index = 0; index < result.children.size() && index < sizeScanner_c::largestChildrenCount; index++ )
+  {
+    const auto &child = result.children.at( index );
+    largestChildren << QString( "%1%2 %3" ).arg( child.name ).arg( child.isDir ? "/" : "" ).
+                       arg( locale.formattedDataSize( child.bytes ) );
+  }
+  if ( !largestChildren.isEmpty() )
+    summary += tr( "\nLargest: %1" ).arg( largestChildren.join( ", " ) );
+
+  _sizeSummary->setText( summary );
+  _sizeSummary->show();
+}
+
+/*!
+   Slot to refresh the preview if the shown entry is among changed entries \a paths
+   Cached previews of the changed entries are dropped. A viewed file is refreshed in place, keeping the scroll
+   position. A followed file is not refreshed, its changes are followed.
+   \param paths absolute paths to the changed entries
+ */
+void detailWidget_c::refreshPaths( const QStringList &paths )
+{
+  for ( const auto &path : paths )
+  {
+    _previewEngine->cache().remove( path );
+    statCache_c::instance().invalidate( path );
+  }
+
+  const QString selectionPath = _pathLine->text();
+  if ( !selectionPath.isEmpty() && paths.contains( selectionPath ) && _logTailer->path() != selectionPath )
+  {
+    _preview->clear();
+    if ( _fileViewer->filePath() != selectionPath )
+      _fileViewer->clear();
+    if ( _hexViewer->filePath() != selectionPath )
+      _hexViewer->clear();
+    requestPreview( selectionPath );
+  }
+}
+
+/*!
+   Slot to show a line \a line of a text file given at \a path in the text file viewer
+   If the file is not viewed yet, the line is shown once the file preview, requested by the selection, is ready.
+   \param path absolute path to the file
+   \param line zero-based line number
+ */
+void detailWidget_c::showPathLine( const QString &path, qint64 line )
+{
+  if ( _fileViewer->filePath() == path )
+  {
+    _pendingLinePath.clear();
+    _pendingLine = -1;
+    _fileViewer->scrollToLine( line );
+    return;
+  }
+
+  _pendingLinePath = path;
+  _pendingLine = line;
+}
+
+/*!
+   Slot to turn the follow mode on or off, see \em logTailer_c
+   In the follow mode, the last lines of a selected text file are shown and new lines are appended as the file
+   grows. A text file viewed when the mode is turned on is followed at once, a followed file is viewed again when
+   the mode is turned off.
+   \param followed true to follow the selected text files
+ */
+void detailWidget_c::setLogFollowed( bool followed )
+{
+  _logFollowed = followed;
+  if ( followed )
+  {
+    const QString path = _fileViewer->filePath();
+    if ( !path.isEmpty() && _previewLayout->currentWidget() == _fileViewer )
+    {
+      _logTailer->follow( path, tailLineCount );
+      _previewLayout->setCurrentWidget( _tailView );
+    }
+    return;
+  }
+
+  const QString path = _logTailer->path();
+  _logTailer->stop();
+  _tailView->clear();
+  // the viewer opens the file again and indexes its lines anew, including the lines appended meanwhile
+  if ( !path.isEmpty() && _fileViewer->setFile( path ) )
+    _previewLayout->setCurrentWidget( _fileViewer );
+}
+
 /*!
    Slot to handle changes in the path display and edit line \em _pathLine
+   A path in the stat cache is validated right away, otherwise the listing is disabled until the typing pauses and
+   the path is validated on a worker, see \em validateEditedPath.
    \param newPath content of the path display line
  */
 void detailWidget_c::pathLineTextChanged( const QString &newPath )
 {
-  if ( isPathValidForListing( newPath ) )
+  _pathValidationGeneration++;
+
+  statCache_c::status_s pathStatus;
+  if ( newPath.isEmpty() || statCache_c::instance().peek( newPath, pathStatus ) )
   {
-    _pathListButton->setEnabled( true );
-    _pathLine->setPalette( _pathValidPalette );
+    _pathValidationTimer->stop();
+    setPathValidForListing( pathStatus.exists && pathStatus.isDir );
+    return;
   }
-  else
+
+  _pathListButton->setEnabled( false );
+  _pathValidationTimer->start();
+}
+
+/*!
+   Slot to validate the path in \em _pathLine on a worker
+   The outcome is dropped if the path is edited again in the meantime.
+ */
+void detailWidget_c::validateEditedPath()
+{
+  const QString path = _pathLine->text();
+  const quint64 generation = _pathValidationGeneration;
+  QtConcurrent::run( &_pathValidationPool, [this, path, generation]()
   {
-    _pathListButton->setEnabled( false );
-    _pathLine->setPalette( _pathNotValidPalette );
-  }
+    const bool valid = isPathValidForListing( path );
+    QMetaObject::invokeMethod( this, [this, generation, valid]()
+    {
+      if ( generation == _pathValidationGeneration )
+        setPathValidForListing( valid );
+    }, Qt::QueuedConnection );
+  } );
 }
 
 /*!
@@ -174,3 +396,91 @@ void detailWidget_c::listManuallyEditedPath()
 {
   emit listPath( _pathLine->text() );
 }
+
+/*!
+   Slot to display a preview produced by \em _previewEngine
+   \param result the preview of the latest selection
+ */
+void detailWidget_c::showPreview( const previewResult_s &result )
+{
+  if ( result.kind == previewResult_s::kind_e::TextFile && _logFollowed )
+  {
+    if ( _logTailer->path() != result.path )
+      _logTailer->follow( result.path, tailLineCount );
+    _previewLayout->setCurrentWidget( _tailView );
+    return;
+  }
+
+  // a viewed file is reloaded in place, keeping the scroll position
+  const bool textViewed = ( _fileViewer->filePath() == result.path );
+  if ( result.kind == previewResult_s::kind_e::TextFile &&
+       ( textViewed ? _fileViewer->reload() : _fileViewer->setFile( result.path ) ) )
+  {
+    _previewLayout->setCurrentWidget( _fileViewer );
+    if ( result.path == _pendingLinePath )
+    {
+      _fileViewer->scrollToLine( _pendingLine );
+      _pendingLinePath.clear();
+      _pendingLine = -1;
+    }
+    return;
+  }
+
+  const bool hexViewed = ( _hexViewer->filePath() == result.path );
+  if ( result.kind == previewResult_s::kind_e::OtherFile && result.size > 0 &&
+       ( hexViewed ? _hexViewer->reload() : _hexViewer->setFile( result.path ) ) )
+  {
+    _previewLayout->setCurrentWidget( _hexViewer );
+    _sizeSummary->setText( result.summary );
+    _sizeSummary->show();
+    return;
+  }
+
+  if ( result.kind == previewResult_s::kind_e::Archive )
+  {
+    // decompressed contents are shown as they are, never as rich text
+    _previewLayout->setCurrentWidget( _preview );
+    _sizeSummary->setText( result.summary );
+    _sizeSummary->show();
+    const perfScope_c layoutScope( perfTracer_c::operation_e::TextLayout );
+    _preview->setPlainText( result.content );
+    return;
+  }
+
+  _previewLayout->setCurrentWidget( _preview );
+  if ( !result.content.isEmpty() )
+  {
+    const perfScope_c layoutScope( perfTracer_c::operation_e::TextLayout );
+    _preview->setText( result.content );
+  }
+}
+
+/*!
+   Slot to show the last lines \a text of the followed file, replacing the shown lines
+   \param text the lines
+ */
+void detailWidget_c::showTail( const QString &text )
+{
+  const perfScope_c layoutScope( perfTracer_c::operation_e::TextLayout );
+  _tailView->setPlainText( text );
+  _tailView->verticalScrollBar()->setValue( _tailView->verticalScrollBar()->maximum() );
+}
+
+/*!
+   Slot to append lines \a text of the followed file, a batch of them at once
+   The view keeps to the end, unless it was scrolled away from it.
+   \param text the lines
+ */
+void detailWidget_c::appendTail( const QString &text )
+{
+  QScrollBar *scrollBar = _tailView->verticalScrollBar();
+  const bool atEnd = scrollBar->value() == scrollBar->maximum();
+
+  const perfScope_c layoutScope( perfTracer_c::operation_e::TextLayout );
+  QTextCursor cursor( _tailView->document() );
+  cursor.movePosition( QTextCursor::End );
+  cursor.insertText( text );
+
+  if ( atEnd )
+    scrollBar->setValue( scrollBar->maximum() );
+}
@@ -1,17 +1,34 @@
 #pragma once
 
 #include <QPalette>
+#include <QStringList>
+#include <QThreadPool>
 #include <QWidget>
 
+class hexViewer_c;
+class largeFileViewer_c;
+class logTailer_c;
+class pathCompleter_c;
+class previewEngine_c;
+class QLabel;
 class QLineEdit;
+class QPlainTextEdit;
 class QPushButton;
+class QStackedLayout;
 class QTextEdit;
+class QTimer;
+
+struct previewRequest_s;
+struct previewResult_s;
+struct sizeScanResult_s;
 
 /*!
    Widget class to define file system selection details
    If the selection is a folder, brief listing of the folder content is displayed in the preview pane
-   If the selection is a text file, small portion of its contect is displayed in the preview pane
+   If the selection is a text file, its content is displayed in a scrollable viewer
+   For a compressed file or an archive, the head of its decompressed contents or its members are displayed
    For other files, name, size and type file attributes are displayed in the preview pane
+   In the follow mode, the last lines of a selected text file are displayed instead, growing with the file.
    The class makes it possible for a user to see the selection absolute path and type in another path for a listing.
  */
 class detailWidget_c : public QWidget
@@ -21,16 +38,43 @@ class detailWidget_c : public QWidget
   private:
     // Selection absolute path
     QLineEdit *_pathLine;
+    // Completes the paths typed into the path line
+    pathCompleter_c *_pathCompleter;
     // List button
     QPushButton *_pathListButton;
+    // Recursive size of the selected folder, or attributes of the file shown in the hex viewer or of the archive
+    QLabel *_sizeSummary;
     // Size of the preview pane
     QSize _previewSize;
     // Preview pane
     QTextEdit *_preview;
+    // Text file viewer
+    largeFileViewer_c *_fileViewer;
+    // Hex viewer of the other files
+    hexViewer_c *_hexViewer;
+    // Last lines of a followed text file
+    QPlainTextEdit *_tailView;
+    // Switches between the preview pane, the text file viewer, the hex viewer and the followed lines
+    QStackedLayout *_previewLayout;
+    // Follows the end of the selected text file
+    logTailer_c *_logTailer;
+    // Selected text files are followed rather than viewed
+    bool _logFollowed;
+    // Worker-backed preview producer
+    previewEngine_c *_previewEngine;
     // Palette for a path, that is valid for the listing, i.e. a folder
     QPalette _pathValidPalette;
     // Palette for a path, that is not valid for the listing, i.e. a file
     QPalette _pathNotValidPalette;
+    // Delays the validation of an edited path until the typing pauses
+    QTimer *_pathValidationTimer;
+    // Validates edited paths, so a slow mount does not block the UI
+    QThreadPool _pathValidationPool;
+    // Generation of the latest edit of the path, validations of older edits are dropped
+    quint64 _pathValidationGeneration;
+    // File and line to show once the file preview is ready, the line is -1 if none
+    QString _pendingLinePath;
+    qint64 _pendingLine;
 
   public:
     detailWidget_c( QWidget * = nullptr );
@@ -43,14 +87,26 @@ class detailWidget_c : public QWidget
 
   private:
     bool isPathValidForListing( const QString & ) const;
+    void setPathValidForListing( bool );
     void handleSelectionDetails( const QString & );
+    previewRequest_s previewRequestFor( const QString & ) const;
+    void requestPreview( const QString & );
 
   public slots:
     void handleSelectionPath( const QString & );
+    void handleSizeScanUpdate( const sizeScanResult_s & );
+    void refreshPaths( const QStringList & );
+    void showPathLine( const QString &, qint64 );
+    void prefetchPreviews( const QStringList & );
+    void setLogFollowed( bool );
 
   private slots:
     void pathLineTextChanged( const QString & );
+    void validateEditedPath();
     void listManuallyEditedPath();
+    void showPreview( const previewResult_s & );
+    void showTail( const QString & );
+    void appendTail( const QString & );
 
   signals:
     void listPath( const QString & );
@@ -0,0 +1,289 @@
+#include "dirlister.h"
+
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+
+#include "perftracer.h"
+
+#if defined( Q_OS_UNIX )
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#endif
+
+#if defined( Q_OS_LINUX )
+#include <sys/syscall.h>
+#endif
+
+namespace
+{
+#if defined( Q_OS_LINUX )
+  // Size of the buffer for a single batch of folder entries
+  constexpr size_t direntBufferSize = 64 * 1024;
+
+  /*!
+     Folder entry record as returned by getdents64
+   */
+  struct linuxDirent64_s
+  {
+    quint64 d_ino;
+    qint64 d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[ 1 ];
+  };
+#endif
+
+  // Number of entries listed between two calls of the batch handler, if the batch size is not given by the system
+  constexpr int entriesPerBatch = 256;
+
+#if defined( Q_OS_UNIX )
+  /*!
+     Classifies an entry \a name of a folder opened as \a dirFd
+     Symbolic links are followed, broken links and special files are skipped.
+     \param dirFd descriptor of the folder
+     \param name name of the entry
+     \param dType entry type reported by the folder
+     \param type output for the entry type
+     \return false if the entry is to be skipped
+   */
+  bool classifyEntry( int dirFd, const char *name, unsigned char dType, dirLister_c::entryType_e &type )
+  {
+    if ( dType == DT_DIR || dType == DT_REG )
+    {
+      type = ( dType == DT_DIR ) ? dirLister_c::entryType_e::Directory : dirLister_c::entryType_e::File;
+      return true;
+    }
+
+    if ( dType != DT_LNK && dType != DT_UNKNOWN )
+      return false;
+
+    struct stat entryStat;
+    if ( fstatat( dirFd, name, &entryStat, 0 ) != 0 )
+      return false;
+
+    if ( S_ISDIR( entryStat.st_mode ) )
+      type = dirLister_c::entryType_e::Directory;
+    else if ( S_ISREG( entryStat.st_mode ) )
+      type = dirLister_c::entryType_e::File;
+    else
+      return false;
+
+    return true;
+  }
+#endif
+}
+
+/*!
+   C-tor
+ */
+dirLister_c::dirLister_c() :
+  _complete{ false }
+{
+}
+
+/*!
+   Lists a folder given at \a path
+   \param path path to the folder
+   \param maximumEntries number of entries to stop at. If -1 given, the whole folder is listed
+   \param batchListed called after every listed batch, returning false stops the listing
+   \return false if the folder could not be opened
+ */
+bool dirLister_c::list( const QString &path, int maximumEntries, const batchHandler_t &batchListed )
+{
+  const perfScope_c listingScope( perfTracer_c::operation_e::DirListing );
+  _names.clear();
+  _types.clear();
+  _complete = false;
+
+  bool proceed = ( maximumEntries != 0 );
+  const auto append = [this, maximumEntries]( const char *name, int length, entryType_e type )
+  {
+    _names.append( name, length );
+    _types.push_back( type );
+    return maximumEntries == -1 || count() < maximumEntries;
+  };
+
+#if defined( Q_OS_UNIX )
+  const QByteArray encodedPath = QFile::encodeName( path );
+  const int dirFd = open( encodedPath.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+  if ( dirFd < 0 )
+    return false;
+
+  if ( proceed )
+  {
+    _complete = readEntries( dirFd, [&]( const char *name, unsigned char dType )
+    {
+      entryType_e type;
+      // hidden entries are skipped
+      if ( name[ 0 ] == '.' || !classifyEntry( dirFd, name, dType, type ) )
+        return true;
+      return append( name, static_cast<int>( std::strlen( name ) ), type );
+    }, batchListed );
+  }
+
+  close( dirFd );
+#else
+  if ( !QFileInfo( path ).isDir() )
+    return false;
+
+  QDirIterator dirIt( path, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot | QDir::AllDirs );
+  int batchCount = 0;
+  while ( proceed )
+  {
+    if ( !dirIt.hasNext() )
+    {
+      _complete = true;
+      break;
+    }
+
+    dirIt.next();
+    const QByteArray name = QFile::encodeName( dirIt.fileName() );
+    proceed = append( name.constData(), name.size(),
+                      dirIt.fileInfo().isDir() ? entryType_e::Directory : entryType_e::File );
+
+    if ( proceed && batchListed && ++batchCount % entriesPerBatch == 0 )
+      proceed = batchListed();
+  }
+#endif
+
+  return true;
+}
+
+/*!
+   \return number of listed entries
+ */
+int dirLister_c::count() const
+{
+  return _names.size();
+}
+
+/*!
+   \return true if the folder was listed up to its end
+ */
+bool dirLister_c::isComplete() const
+{
+  return _complete;
+}
+
+/*!
+   \return names of the listed entries
+ */
+const nameArena_c &dirLister_c::names() const
+{
+  return _names;
+}
+
+/*!
+   \param index index of the entry
+   \return type of the entry
+ */
+dirLister_c::entryType_e dirLister_c::type( int index ) const
+{
+  return _types[ static_cast<size_t>( index ) ];
+}
+
+/*!
+   Formats the listed entries of a folder given at \a dirPath as absolute paths, sub-folders first
+   \param dirPath path to the listed folder
+   \param maximumLines number of maximum lines. If reached, the last line is replaced with an ellipsis
+   \return the entry paths
+ */
+QStringList dirLister_c::entryPaths( const QString &dirPath, int maximumLines ) const
+{
+  const QString prefix = dirPath.endsWith( '/' ) ? dirPath : dirPath + '/';
+  const bool truncated = ( maximumLines != -1 && count() >= maximumLines );
+  const int shownCount = truncated ? maximumLines - 1 : count();
+
+  QStringList retvalue;
+  retvalue.reserve( shownCount + 1 );
+
+  for ( const auto listedType : { entryType_e::Directory, entryType_e::File } )
+  {
+    for ( int index = 0; index < count() && retvalue.size() < shownCount; index++ )
+    {
+      if ( type( index ) == listedType )
+        retvalue << prefix + _names.toString( index );
+    }
+  }
+
+  if ( truncated )
+    retvalue << "...";
+
+  return retvalue;
+}
+
+#if defined( Q_OS_UNIX )
+/*!
+   Reads entries of a folder opened as \a dirFd, except for the dot entries
+   On Linux, the entries are read in large batches with getdents64, elsewhere readdir is used.
+   \param dirFd descriptor of the folder, stays open
+   \param entryRead called for every entry, returning false stops the reading
+   \param batchRead called after every batch of entries, returning false stops the reading
+   \return true if the folder was read up to its end
+ */
+bool dirLister_c::readEntries( int dirFd, const entryHandler_t &entryRead, const batchHandler_t &batchRead )
+{
+  const auto isDotEntry = []( const char *name )
+  {
+    return name[ 0 ] == '.' && ( name[ 1 ] == '\0' || ( name[ 1 ] == '.' && name[ 2 ] == '\0' ) );
+  };
+
+#if defined( Q_OS_LINUX )
+  std::vector<char> buffer( direntBufferSize );
+  while ( true )
+  {
+    const long bytesRead = syscall( SYS_getdents64, dirFd, buffer.data(), buffer.size() );
+    if ( bytesRead <= 0 )
+      return bytesRead == 0;
+
+    for ( long position = 0; position < bytesRead; )
+    {
+      const auto *dirent = reinterpret_cast<const linuxDirent64_s *>( buffer.data() + position );
+      position += dirent->d_reclen;
+
+      if ( !isDotEntry( dirent->d_name ) && !entryRead( dirent->d_name, dirent->d_type ) )
+        return false;
+    }
+
+    if ( batchRead && !batchRead() )
+      return false;
+  }
+#else
+  const int readFd = dup( dirFd );
+  DIR *dir = ( readFd >= 0 ) ? fdopendir( readFd ) : nullptr;
+  if ( dir == nullptr )
+  {
+    if ( readFd >= 0 )
+      close( readFd );
+    return false;
+  }
+
+  bool complete = false;
+  int batchCount = 0;
+  while ( true )
+  {
+    const struct dirent *entry = readdir( dir );
+    if ( entry == nullptr )
+    {
+      complete = true;
+      break;
+    }
+
+    if ( !isDotEntry( entry->d_name ) && !entryRead( entry->d_name, entry->d_type ) )
+      break;
+
+    if ( batchRead && ++batchCount % entriesPerBatch == 0 && !batchRead() )
+      break;
+  }
+
+  // closes the duplicated descriptor as well
+  closedir( dir );
+  return complete;
+#endif
+}
+#endif
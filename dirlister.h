@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QStringList>
+
+#include <functional>
+#include <vector>
+
+#include "namearena.h"
+
+/*!
+   Single-pass listing of a folder
+   Entries are read in large batches straight from the file system, using the entry type reported by the
+   folder itself and only falling back to a stat for symbolic links and unknown types. The names are kept in
+   a \em nameArena_c. After every batch a handler is called, which makes it possible to display the entries
+   while the listing is still in progress. The listing stops once the requested number of entries is reached.
+   Like the Qt folder iteration used before, hidden entries, broken links and special files are skipped.
+ */
+class dirLister_c
+{
+  public:
+    enum class entryType_e : quint8
+    {
+      Directory,
+      File
+    };
+
+    // Called after every listed batch, returning false stops the listing
+    using batchHandler_t = std::function<bool()>;
+#if defined( Q_OS_UNIX )
+    // Called for every folder entry with its name and the type reported by the folder, returning false stops the listing
+    using entryHandler_t = std::function<bool( const char *, unsigned char )>;
+#endif
+
+  private:
+    // Names of the listed entries
+    nameArena_c _names;
+    // Types of the listed entries
+    std::vector<entryType_e> _types;
+    // True if the folder was listed up to its end
+    bool _complete;
+
+  public:
+    dirLister_c();
+
+    bool list( const QString &, int = -1, const batchHandler_t & = {} );
+
+    int count() const;
+    bool isComplete() const;
+    const nameArena_c &names() const;
+    entryType_e type( int ) const;
+
+    QStringList entryPaths( const QString &, int = -1 ) const;
+
+#if defined( Q_OS_UNIX )
+    static bool readEntries( int, const entryHandler_t &, const batchHandler_t & = {} );
+#endif
+};
@@ -0,0 +1,601 @@
+#include "duplicatefinder.h"
+
+#include <QDirIterator>
+#include <QFile>
+#include <QTimer>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#if defined( Q_OS_UNIX )
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "contenthasher.h"
+#include "dirlister.h"
+#include "workstealingpool.h"
+
+namespace
+{
+  // Interval between two progress reports, in ms
+  constexpr int progressInterval = 200;
+  // Bytes read at once while hashing or comparing a file in full
+  constexpr qint64 fullHashReadSize = 1024 * 1024;
+
+  /*!
+     A regular file found by the scan
+   */
+  struct fileEntry_s
+  {
+    std::string path;
+    qint64 size = 0;
+    // Identity of the file, zero where not available
+    quint64 device = 0;
+    quint64 inode = 0;
+    quint64 hash = 0;
+    // The hash covers the whole file
+    bool fullyHashed = false;
+  };
+}
+
+/*!
+   Shared state of a single search
+ */
+struct duplicateFinder_c::finderState_s
+{
+  // Absolute path to the searched folder
+  QString folderPath;
+  std::atomic<bool> cancelled{ false };
+  std::atomic<int> stage{ static_cast<int>( stage_e::Scanning ) };
+  // Progress of the stage and its total
+  std::atomic<qint64> done{ 0 };
+  std::atomic<qint64> total{ 0 };
+  // Files found by the scan, a list per worker, each filled by its worker only
+  std::vector<std::vector<fileEntry_s>> files;
+};
+
+namespace
+{
+  using finderState_t = duplicateFinder_c::finderState_s;
+  using candidateGroups_t = std::vector<std::vector<fileEntry_s *>>;
+
+  /*!
+     Adds a file to the files found by the worker, the lists are merged once the scan is finished
+     \param state the search state
+     \param worker index of the worker
+     \param file the file
+   */
+  void addFile( finderState_t &state, int worker, fileEntry_s &&file )
+  {
+    state.done++;
+    state.files[ static_cast<size_t>( worker ) ].push_back( std::move( file ) );
+  }
+
+  /*!
+     Lists a folder given at \a path, collecting the non-empty regular files and submitting a task for every
+     sub-folder
+     \param state the search state
+     \param pool the pool running the scan
+     \param worker index of the worker
+     \param path path to the folder
+   */
+  void scanDirectory( const std::shared_ptr<finderState_t> &state, workStealingPool_c &pool, int worker,
+                      const std::string &path )
+  {
+    if ( state->cancelled )
+      return;
+
+    const std::string prefix = ( !path.empty() && path.back() == '/' ) ? path : path + '/';
+    const auto submitDirectory = [&]( const std::string &directoryPath )
+    {
+      pool.submit( [state, &pool, directoryPath]( int nextWorker )
+      {
+        scanDirectory( state, pool, nextWorker, directoryPath );
+      } );
+    };
+
+#if defined( Q_OS_UNIX )
+    const int dirFd = open( path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+    if ( dirFd < 0 )
+      return;
+
+    dirLister_c::readEntries( dirFd, [&]( const char *name, unsigned char dType )
+    {
+      if ( name[ 0 ] == '.' )
+        return true;
+
+      if ( dType == DT_DIR )
+      {
+        submitDirectory( prefix + name );
+        return true;
+      }
+      if ( dType != DT_REG && dType != DT_UNKNOWN )
+        return true;
+
+      // the size is needed anyway, so the stat also settles unknown types
+      struct stat entryStat;
+      if ( fstatat( dirFd, name, &entryStat, AT_SYMLINK_NOFOLLOW ) != 0 )
+        return true;
+
+      if ( S_ISDIR( entryStat.st_mode ) )
+        submitDirectory( prefix + name );
+      else if ( S_ISREG( entryStat.st_mode ) && entryStat.st_size > 0 )
+      {
+        fileEntry_s file;
+        file.path = prefix + name;
+        file.size = entryStat.st_size;
+        file.device = static_cast<quint64>( entryStat.st_dev );
+        file.inode = static_cast<quint64>( entryStat.st_ino );
+        addFile( *state, worker, std::move( file ) );
+      }
+      return true;
+    }, [&state]() { return !state->cancelled; } );
+
+    close( dirFd );
+#else
+    QDirIterator dirIt( QFile::decodeName( path.c_str() ), QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot |
+                        QDir::NoSymLinks );
+    while ( dirIt.hasNext() && !state->cancelled )
+    {
+      dirIt.next();
+      const QFileInfo fileInfo = dirIt.fileInfo();
+      const std::string entryPath = QFile::encodeName( fileInfo.absoluteFilePath() ).toStdString();
+      if ( fileInfo.isDir() )
+        submitDirectory( entryPath );
+      else if ( fileInfo.isFile() && fileInfo.size() > 0 )
+      {
+        fileEntry_s file;
+        file.path = entryPath;
+        file.size = fileInfo.size();
+        addFile( *state, worker, std::move( file ) );
+      }
+    }
+#endif
+  }
+
+  /*!
+     Hashes a few KB at the start and at the end of a file given at \a file, the whole file if small enough
+     \param file the file
+     \return false if the file cannot be read
+   */
+  bool hashPartially( fileEntry_s &file )
+  {
+    QFile content( QFile::decodeName( file.path.c_str() ) );
+    if ( !content.open( QIODevice::ReadOnly ) )
+      return false;
+
+    constexpr qint64 partialBytes = duplicateFinder_c::partialHashBytes;
+    const bool whole = file.size <= 2 * partialBytes;
+    QByteArray data = content.read( whole ? file.size : partialBytes );
+    if ( !whole && content.seek( file.size - partialBytes ) )
+      data += content.read( partialBytes );
+
+    if ( data.size() != std::min( file.size, 2 * partialBytes ) )
+      return false;
+
+    file.hash = contentHasher_c::hash( data.constData(), static_cast<size_t>( data.size() ) );
+    file.fullyHashed = whole;
+    return true;
+  }
+
+  /*!
+     Hashes a whole file given at \a file
+     \param state the search state, receives the progress
+     \param file the file
+     \return false if the file cannot be read or the search was cancelled
+   */
+  bool hashFully( finderState_t &state, fileEntry_s &file )
+  {
+    QFile content( QFile::decodeName( file.path.c_str() ) );
+    if ( !content.open( QIODevice::ReadOnly ) )
+      return false;
+
+#if defined( Q_OS_UNIX ) && !defined( Q_OS_DARWIN )
+    // macOS has no posix_fadvise, its read-ahead follows sequential reads by itself
+    posix_fadvise( content.handle(), 0, 0, POSIX_FADV_SEQUENTIAL );
+#endif
+
+    // read in chunks rather than mapped, a file shrunk since the scan would fault on its mapped pages past the end
+    contentHasher_c hasher;
+    for ( qint64 offset = 0; offset < file.size; )
+    {
+      if ( state.cancelled )
+        return false;
+
+      const qint64 chunkSize = std::min( fullHashReadSize, file.size - offset );
+      const QByteArray data = content.read( chunkSize );
+      if ( data.size() != chunkSize )
+        return false;
+
+      hasher.update( data.constData(), static_cast<size_t>( chunkSize ) );
+      offset += chunkSize;
+      state.done += chunkSize;
+    }
+
+    file.hash = hasher.digest();
+    file.fullyHashed = true;
+    return true;
+  }
+
+  /*!
+     Compares the contents of files \a file and \a other of an equal size byte by byte
+     \param state the search state, receives the progress
+     \param file the file
+     \param other the other file
+     \param equal receives true if the contents are equal
+     \return false if either file cannot be read or the search was cancelled
+   */
+  bool compareContents( finderState_t &state, const fileEntry_s &file, const fileEntry_s &other, bool &equal )
+  {
+    QFile content( QFile::decodeName( file.path.c_str() ) );
+    QFile otherContent( QFile::decodeName( other.path.c_str() ) );
+    if ( !content.open( QIODevice::ReadOnly ) || !otherContent.open( QIODevice::ReadOnly ) )
+      return false;
+
+#if defined( Q_OS_UNIX ) && !defined( Q_OS_DARWIN )
+    posix_fadvise( content.handle(), 0, 0, POSIX_FADV_SEQUENTIAL );
+    posix_fadvise( otherContent.handle(), 0, 0, POSIX_FADV_SEQUENTIAL );
+#endif
+
+    equal = true;
+    for ( qint64 offset = 0; offset < file.size; )
+    {
+      if ( state.cancelled )
+        return false;
+
+      const qint64 chunkSize = std::min( fullHashReadSize, file.size - offset );
+      const QByteArray data = content.read( chunkSize );
+      const QByteArray otherData = otherContent.read( chunkSize );
+      if ( data.size() != chunkSize || otherData.size() != chunkSize )
+        return false;
+
+      state.done += chunkSize;
+      if ( data != otherData )
+      {
+        // the rest is not read, but counted as done
+        state.done += file.size - offset - chunkSize;
+        equal = false;
+        return true;
+      }
+      offset += chunkSize;
+    }
+
+    return true;
+  }
+
+  /*!
+     Splits every group given at \a groups of equal full hashes by comparing the contents of its files
+     Every file is compared to the first file of each of the subgroups found so far, so a hash collision does not
+     pass for a duplicate. The files that cannot be read are dropped.
+     \param state the search state
+     \param groups the groups
+     \return the groups of files of equal contents, of more than one file each
+   */
+  candidateGroups_t splitByContent( finderState_t &state, const candidateGroups_t &groups )
+  {
+    std::vector<candidateGroups_t> subgroups( groups.size() );
+
+    {
+      workStealingPool_c pool;
+      for ( size_t index = 0; index < groups.size(); index++ )
+      {
+        pool.submit( [&state, &groups, &subgroups, index]( int )
+        {
+          candidateGroups_t &equalGroups = subgroups[ index ];
+          for ( fileEntry_s *file : groups[ index ] )
+          {
+            bool placed = false;
+            for ( auto &equalGroup : equalGroups )
+            {
+              bool equal = false;
+              if ( !compareContents( state, *equalGroup.front(), *file, equal ) )
+              {
+                placed = true;
+                break;
+              }
+              if ( equal )
+              {
+                equalGroup.push_back( file );
+                placed = true;
+                break;
+              }
+            }
+            if ( !placed )
+              equalGroups.push_back( { file } );
+          }
+        } );
+      }
+      pool.wait();
+    }
+
+    candidateGroups_t result;
+    for ( auto &equalGroups : subgroups )
+    {
+      for ( auto &equalGroup : equalGroups )
+      {
+        if ( equalGroup.size() > 1 )
+          result.push_back( std::move( equalGroup ) );
+      }
+    }
+    return result;
+  }
+
+  /*!
+     Splits every group given at \a groups by the file hashes, keeping the groups of more than one file
+     \param groups groups of files of an equal size
+     \return the refined groups
+   */
+  candidateGroups_t splitByHash( const candidateGroups_t &groups )
+  {
+    candidateGroups_t result;
+    for ( const auto &group : groups )
+    {
+      std::vector<fileEntry_s *> files = group;
+      std::sort( files.begin(), files.end(), []( const fileEntry_s *left, const fileEntry_s *right )
+      {
+        return left->hash < right->hash;
+      } );
+
+      for ( auto first = files.begin(); first != files.end(); )
+      {
+        auto last = std::find_if( first, files.end(), [first]( const fileEntry_s *file )
+        {
+          return file->hash != ( *first )->hash;
+        } );
+        if ( last - first > 1 )
+          result.emplace_back( first, last );
+        first = last;
+      }
+    }
+    return result;
+  }
+
+  /*!
+     Hashes every file of the groups given at \a groups in parallel, dropping the files that cannot be read
+     \param state the search state
+     \param groups the groups
+     \param hash hashes a file, returns false if it cannot be read
+   */
+  template<typename hashFunction_t>
+  void hashGroups( finderState_t &state, candidateGroups_t &groups, const hashFunction_t &hash )
+  {
+    std::vector<char> readable;
+    std::vector<fileEntry_s *> files;
+    for ( const auto &group : groups )
+      files.insert( files.end(), group.begin(), group.end() );
+    readable.resize( files.size(), 0 );
+
+    {
+      workStealingPool_c pool;
+      for ( size_t index = 0; index < files.size(); index++ )
+      {
+        pool.submit( [&state, &files, &readable, &hash, index]( int )
+        {
+          if ( !state.cancelled )
+            readable[ index ] = hash( *files[ index ] ) ? 1 : 0;
+        } );
+      }
+      pool.wait();
+    }
+
+    size_t index = 0;
+    for ( auto &group : groups )
+    {
+      std::vector<fileEntry_s *> readableFiles;
+      for ( fileEntry_s *file : group )
+        if ( readable[ index++ ] )
+          readableFiles.push_back( file );
+      group.swap( readableFiles );
+    }
+  }
+
+  /*!
+     Runs the search
+     \param state the search state
+     \return the duplicates, the most reclaimable bytes first
+   */
+  QVector<duplicateGroup_s> findDuplicates( const std::shared_ptr<finderState_t> &state )
+  {
+    {
+      workStealingPool_c pool;
+      state->files.resize( static_cast<size_t>( pool.threadCount() ) );
+      const std::string folderPath = QFile::encodeName( state->folderPath ).toStdString();
+      pool.submit( [state, &pool, folderPath]( int worker ) { scanDirectory( state, pool, worker, folderPath ); } );
+      pool.wait();
+    }
+    if ( state->cancelled )
+      return {};
+
+    std::vector<fileEntry_s *> files;
+    for ( auto &workerFiles : state->files )
+      for ( fileEntry_s &file : workerFiles )
+        files.push_back( &file );
+
+    // hard links share their contents rather than duplicating them
+    std::sort( files.begin(), files.end(), []( const fileEntry_s *left, const fileEntry_s *right )
+    {
+      return std::tie( left->size, left->device, left->inode, left->path ) <
+             std::tie( right->size, right->device, right->inode, right->path );
+    } );
+    files.erase( std::unique( files.begin(), files.end(), []( const fileEntry_s *left, const fileEntry_s *right )
+    {
+      return left->inode != 0 && left->device == right->device && left->inode == right->inode;
+    } ), files.end() );
+
+    candidateGroups_t groups;
+    qint64 partialTotal = 0;
+    for ( auto first = files.begin(); first != files.end(); )
+    {
+      auto last = std::find_if( first, files.end(), [first]( const fileEntry_s *file )
+      {
+        return file->size != ( *first )->size;
+      } );
+      if ( last - first > 1 )
+      {
+        groups.emplace_back( first, last );
+        partialTotal += ( last - first ) * std::min( ( *first )->size, 2 * duplicateFinder_c::partialHashBytes );
+      }
+      first = last;
+    }
+
+    state->done = 0;
+    state->total = partialTotal;
+    state->stage = static_cast<int>( duplicateFinder_c::stage_e::PartialHashing );
+    hashGroups( *state, groups, [state]( fileEntry_s &file )
+    {
+      const bool hashed = hashPartially( file );
+      state->done += std::min( file.size, 2 * duplicateFinder_c::partialHashBytes );
+      return hashed;
+    } );
+    groups = splitByHash( groups );
+    if ( state->cancelled )
+      return {};
+
+    qint64 fullTotal = 0;
+    for ( const auto &group : groups )
+      if ( !group.front()->fullyHashed )
+        fullTotal += group.front()->size * static_cast<qint64>( group.size() );
+
+    state->done = 0;
+    state->total = fullTotal;
+    state->stage = static_cast<int>( duplicateFinder_c::stage_e::FullHashing );
+    hashGroups( *state, groups, [state]( fileEntry_s &file )
+    {
+      return file.fullyHashed || hashFully( *state, file );
+    } );
+    groups = splitByHash( groups );
+    if ( state->cancelled )
+      return {};
+
+    qint64 compareTotal = 0;
+    for ( const auto &group : groups )
+      compareTotal += group.front()->size * static_cast<qint64>( group.size() - 1 );
+
+    state->done = 0;
+    state->total = compareTotal;
+    state->stage = static_cast<int>( duplicateFinder_c::stage_e::Verifying );
+    groups = splitByContent( *state, groups );
+    if ( state->cancelled )
+      return {};
+
+    QVector<duplicateGroup_s> duplicates;
+    duplicates.reserve( static_cast<int>( groups.size() ) );
+    for ( const auto &group : groups )
+    {
+      duplicateGroup_s duplicate;
+      duplicate.size = group.front()->size;
+      duplicate.hash = group.front()->hash;
+      for ( const fileEntry_s *file : group )
+        duplicate.paths.append( QFile::decodeName( file->path.c_str() ) );
+      duplicate.paths.sort();
+      duplicate.reclaimableBytes = duplicate.size * ( duplicate.paths.size() - 1 );
+      duplicates.append( duplicate );
+    }
+
+    std::sort( duplicates.begin(), duplicates.end(), []( const duplicateGroup_s &left, const duplicateGroup_s &right )
+    {
+      return left.reclaimableBytes > right.reclaimableBytes;
+    } );
+    return duplicates;
+  }
+}
+
+/*!
+   C-tor
+   \param parent parent object
+ */
+duplicateFinder_c::duplicateFinder_c( QObject *parent ) :
+  QObject( parent ),
+  _progressTimer{ nullptr }
+{
+  _progressTimer = new QTimer( this );
+  _progressTimer->setInterval( progressInterval );
+  connect( _progressTimer, &QTimer::timeout, this, &duplicateFinder_c::reportProgress );
+}
+
+/*!
+   D-tor
+   Cancels the current search and waits for all the searches to wind down.
+ */
+duplicateFinder_c::~duplicateFinder_c()
+{
+  cancel();
+  for ( auto &finderFuture : _finderFutures )
+    finderFuture.waitForFinished();
+}
+
+/*!
+   Starts a search for duplicates below a folder given at \a folderPath, abandoning the current one
+   \param folderPath absolute path to the folder
+ */
+void duplicateFinder_c::start( const QString &folderPath )
+{
+  cancel();
+
+  _finderFutures.erase( std::remove_if( _finderFutures.begin(), _finderFutures.end(),
+                                        []( const QFuture<void> &finderFuture ) { return finderFuture.isFinished(); } ),
+                        _finderFutures.end() );
+
+  auto state = std::make_shared<finderState_s>();
+  state->folderPath = folderPath;
+  _state = state;
+
+  _finderFutures.append( QtConcurrent::run( [this, state]()
+  {
+    const QVector<duplicateGroup_s> duplicates = findDuplicates( state );
+    if ( state->cancelled )
+      return;
+
+    QMetaObject::invokeMethod( this, [this, state, duplicates]()
+    {
+      if ( state != _state )
+        return;
+
+      _progressTimer->stop();
+      _state.reset();
+      emit finished( duplicates );
+    }, Qt::QueuedConnection );
+  } ) );
+
+  _progressTimer->start();
+}
+
+/*!
+   Abandons the current search
+ */
+void duplicateFinder_c::cancel()
+{
+  _progressTimer->stop();
+
+  if ( _state )
+  {
+    _state->cancelled = true;
+    _state.reset();
+  }
+}
+
+/*!
+   \return true if a search is in progress
+ */
+bool duplicateFinder_c::isRunning() const
+{
+  return _state != nullptr;
+}
+
+/*!
+   Slot to report progress of the current search
+ */
+void duplicateFinder_c::reportProgress()
+{
+  if ( !_state )
+    return;
+
+  emit progressUpdated( static_cast<stage_e>( _state->stage.load() ), _state->done, _state->total );
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <QFuture>
+#include <QList>
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+
+#include <memory>
+
+class QTimer;
+
+/*!
+   Files of equal contents
+ */
+struct duplicateGroup_s
+{
+  // Size of every file of the group
+  qint64 size = 0;
+  // Content hash of every file of the group
+  quint64 hash = 0;
+  // Absolute paths to the files, sorted
+  QStringList paths;
+  // Bytes freed by keeping a single file of the group
+  qint64 reclaimableBytes = 0;
+};
+
+/*!
+   Finds files of equal contents below a folder in the background
+   The search narrows the candidates in stages, every stage reading more of fewer files: files are grouped by size
+   first, files of a shared size are hashed over a few KB at their start and end, and only files still sharing size and
+   partial hash are hashed in full. Files sharing the full hash are finally compared byte by byte, so a hash collision
+   is not reported as a duplicate. Every stage runs its files as tasks of a \em workStealingPool_c, the scan collects
+   the files of every worker apart and merges them once finished. Whole files are hashed in chunks read with sequential
+   read-ahead, so the kernel reads the next part of a file while the current one is hashed, and a file shrunk since the
+   scan only ends its hashing early. Hard links to the same file are counted once, hidden entries are skipped like in
+   the tree and symbolic links are not followed.
+ */
+class duplicateFinder_c : public QObject
+{
+  Q_OBJECT
+
+  public:
+    enum class stage_e
+    {
+      Scanning,
+      PartialHashing,
+      FullHashing,
+      Verifying
+    };
+
+    // Number of bytes hashed at either end of a file by the partial hash
+    static constexpr qint64 partialHashBytes = 4096;
+
+    struct finderState_s;
+
+  private:
+    // State of the current search
+    std::shared_ptr<finderState_s> _state;
+    // The current search and cancelled searches possibly still winding down
+    QList<QFuture<void>> _finderFutures;
+    // Triggers the progress reports
+    QTimer *_progressTimer;
+
+  public:
+    duplicateFinder_c( QObject * = nullptr );
+    virtual ~duplicateFinder_c();
+
+    void start( const QString & );
+    void cancel();
+    bool isRunning() const;
+
+  private slots:
+    void reportProgress();
+
+  signals:
+    // Stage of the search, the progress of the stage and its total, in files while scanning, in bytes otherwise
+    void progressUpdated( duplicateFinder_c::stage_e, qint64, qint64 );
+    // Reports the end of a search with the duplicates found, the most reclaimable bytes first
+    void finished( const QVector<duplicateGroup_s> & );
+};
@@ -0,0 +1,153 @@
+#include "duplicatesdialog.h"
+
+#include <QDir>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLocale>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+/*!
+   C-tor
+   Starts the search right away.
+   \param folderPath absolute path to the searched folder
+   \param parent parent widget
+ */
+duplicatesDialog_c::duplicatesDialog_c( const QString &folderPath, QWidget *parent ) :
+  QDialog( parent ),
+  _folderPath{ folderPath },
+  _findButton{ nullptr },
+  _groupTree{ nullptr },
+  _statusLabel{ nullptr },
+  _duplicateFinder{ nullptr }
+{
+  setAttribute( Qt::WA_DeleteOnClose );
+  setWindowTitle( tr( "Duplicates in %1" ).arg( QDir::toNativeSeparators( folderPath ) ) );
+
+  _groupTree = new QTreeWidget( this );
+  _groupTree->setColumnCount( 2 );
+  _groupTree->setHeaderLabels( { tr( "File" ), tr( "Reclaimable" ) } );
+  _groupTree->setUniformRowHeights( true );
+  _groupTree->header()->setSectionResizeMode( 0, QHeaderView::Stretch );
+  _groupTree->header()->setStretchLastSection( false );
+
+  _statusLabel = new QLabel( this );
+  _findButton = new QPushButton( this );
+
+  QHBoxLayout *statusLayout = new QHBoxLayout;
+  statusLayout->addWidget( _statusLabel, 1 );
+  statusLayout->addWidget( _findButton );
+
+  QVBoxLayout *mainLayout = new QVBoxLayout;
+  mainLayout->addWidget( _groupTree );
+  mainLayout->addLayout( statusLayout );
+  setLayout( mainLayout );
+  resize( 720, 480 );
+
+  _duplicateFinder = new duplicateFinder_c( this );
+
+  connect( _findButton, &QPushButton::clicked, this, &duplicatesDialog_c::handleFindButton );
+  connect( _groupTree, &QTreeWidget::itemActivated, this, &duplicatesDialog_c::handleItemActivated );
+  connect( _duplicateFinder, &duplicateFinder_c::progressUpdated, this, &duplicatesDialog_c::handleProgress );
+  connect( _duplicateFinder, &duplicateFinder_c::finished, this, &duplicatesDialog_c::handleFinished );
+
+  handleFindButton();
+}
+
+/*!
+   Slot to start a search, or to stop the running one
+ */
+void duplicatesDialog_c::handleFindButton()
+{
+  if ( _duplicateFinder->isRunning() )
+  {
+    _duplicateFinder->cancel();
+    _findButton->setText( tr( "Find" ) );
+    _statusLabel->setText( tr( "Stopped" ) );
+    return;
+  }
+
+  _groupTree->clear();
+  _duplicateFinder->start( _folderPath );
+  _findButton->setText( tr( "Stop" ) );
+  _statusLabel->setText( tr( "Scanning..." ) );
+}
+
+/*!
+   Slot to show progress of the search
+   \param stage the stage of the search
+   \param done progress of the stage, in files while scanning, in bytes otherwise
+   \param total total of the stage, in bytes
+ */
+void duplicatesDialog_c::handleProgress( duplicateFinder_c::stage_e stage, qint64 done, qint64 total )
+{
+  const QLocale locale;
+  switch ( stage )
+  {
+    case duplicateFinder_c::stage_e::Scanning:
+      _statusLabel->setText( tr( "Scanning... %1 files" ).arg( locale.toString( done ) ) );
+      break;
+    case duplicateFinder_c::stage_e::PartialHashing:
+      _statusLabel->setText( tr( "Comparing files of equal size... %1 of %2" ).
+                             arg( locale.formattedDataSize( done ) ).arg( locale.formattedDataSize( total ) ) );
+      break;
+    case duplicateFinder_c::stage_e::FullHashing:
+      _statusLabel->setText( tr( "Comparing contents... %1 of %2" ).
+                             arg( locale.formattedDataSize( done ) ).arg( locale.formattedDataSize( total ) ) );
+      break;
+    case duplicateFinder_c::stage_e::Verifying:
+      _statusLabel->setText( tr( "Verifying duplicates... %1 of %2" ).
+                             arg( locale.formattedDataSize( done ) ).arg( locale.formattedDataSize( total ) ) );
+      break;
+  }
+}
+
+/*!
+   Slot to list the duplicates \a duplicates found by the search
+   \param duplicates the duplicate groups, the most reclaimable bytes first
+ */
+void duplicatesDialog_c::handleFinished( const QVector<duplicateGroup_s> &duplicates )
+{
+  const QLocale locale;
+  const QDir folderDir( _folderPath );
+  qint64 reclaimableBytes = 0;
+  QList<QTreeWidgetItem *> groupItems;
+  groupItems.reserve( duplicates.size() );
+  for ( const auto &duplicate : duplicates )
+  {
+    QTreeWidgetItem *groupItem = new QTreeWidgetItem;
+    groupItem->setText( 0, tr( "%1 files of %2" ).arg( duplicate.paths.size() ).
+                        arg( locale.formattedDataSize( duplicate.size ) ) );
+    groupItem->setText( 1, locale.formattedDataSize( duplicate.reclaimableBytes ) );
+    groupItem->setTextAlignment( 1, Qt::AlignRight | Qt::AlignVCenter );
+
+    for ( const QString &path : duplicate.paths )
+    {
+      QTreeWidgetItem *fileItem = new QTreeWidgetItem( groupItem );
+      fileItem->setText( 0, QDir::toNativeSeparators( folderDir.relativeFilePath( path ) ) );
+      fileItem->setData( 0, Qt::UserRole, path );
+    }
+
+    reclaimableBytes += duplicate.reclaimableBytes;
+    groupItems.append( groupItem );
+  }
+  _groupTree->addTopLevelItems( groupItems );
+  _groupTree->resizeColumnToContents( 1 );
+
+  _findButton->setText( tr( "Find" ) );
+  _statusLabel->setText( tr( "%1 duplicate groups, %2 reclaimable" ).arg( locale.toString( duplicates.size() ) ).
+                         arg( locale.formattedDataSize( reclaimableBytes ) ) );
+}
+
+/*!
+   Slot to report an activated file \a item
+   \param item the activated item, a group or a file
+ */
+void duplicatesDialog_c::handleItemActivated( QTreeWidgetItem *item )
+{
+  const QString path = item->data( 0, Qt::UserRole ).toString();
+  if ( !path.isEmpty() )
+    emit fileActivated( path );
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QDialog>
+#include <QVector>
+
+#include "duplicatefinder.h"
+
+class QLabel;
+class QPushButton;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+/*!
+   Dialog finding files of equal contents below a folder
+   The duplicates found by \em duplicateFinder_c are listed in groups, the most reclaimable bytes first. An activated
+   file is reported through \em fileActivated.
+ */
+class duplicatesDialog_c : public QDialog
+{
+  Q_OBJECT
+
+  private:
+    // Absolute path to the searched folder
+    QString _folderPath;
+    // Starts or stops the search
+    QPushButton *_findButton;
+    // Duplicate groups with their files
+    QTreeWidget *_groupTree;
+    // Progress and summary of the search
+    QLabel *_statusLabel;
+    // Background duplicate search
+    duplicateFinder_c *_duplicateFinder;
+
+  public:
+    duplicatesDialog_c( const QString &, QWidget * = nullptr );
+    virtual ~duplicatesDialog_c() = default;
+
+  private slots:
+    void handleFindButton();
+    void handleProgress( duplicateFinder_c::stage_e, qint64, qint64 );
+    void handleFinished( const QVector<duplicateGroup_s> & );
+    void handleItemActivated( QTreeWidgetItem * );
+
+  signals:
+    // Absolute path to the activated file
+    void fileActivated( const QString & );
+};
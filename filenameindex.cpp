@@ -0,0 +1,690 @@
+#include "filenameindex.h"
+
+#include <QDirIterator>
+#include <QFile>
+#include <QRegularExpression>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#if defined( Q_OS_UNIX )
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "dirlister.h"
+#include "util.h"
+#include "workstealingpool.h"
+
+namespace
+{
+  // Number of entries searched between two checks of cancellation
+  constexpr quint32 cancelCheckInterval = 4096;
+
+  /*!
+     \param byte a name byte
+     \return the byte with ASCII letters folded to lower case
+   */
+  inline uchar foldByte( uchar byte )
+  {
+    return ( byte >= 'A' && byte <= 'Z' ) ? static_cast<uchar>( byte + ( 'a' - 'A' ) ) : byte;
+  }
+
+  /*!
+     \param name a name
+     \param position position of the trigram within the name
+     \return trigram of case-folded bytes of the name at the position
+   */
+  inline quint32 trigramAt( const char *name, int position )
+  {
+    return ( static_cast<quint32>( foldByte( static_cast<uchar>( name[ position ] ) ) ) << 16 ) |
+           ( static_cast<quint32>( foldByte( static_cast<uchar>( name[ position + 1 ] ) ) ) << 8 ) |
+           static_cast<quint32>( foldByte( static_cast<uchar>( name[ position + 2 ] ) ) );
+  }
+
+  /*!
+     \param trigram a trigram
+     \param shardCount number of the posting shards
+     \return the shard of the trigram
+   */
+  inline size_t shardOf( quint32 trigram, size_t shardCount )
+  {
+    return ( static_cast<size_t>( trigram ) * 2654435761u ) % shardCount;
+  }
+
+  /*!
+     \param text a text
+     \return the text encoded as a file name, with ASCII letters folded to lower case
+   */
+  QByteArray foldedName( const QString &text )
+  {
+    QByteArray folded = QFile::encodeName( text );
+    for ( auto &byte : folded )
+      byte = static_cast<char>( foldByte( static_cast<uchar>( byte ) ) );
+    return folded;
+  }
+
+  /*!
+     Checks if a name \a name contains a case-folded literal \a literal, ignoring ASCII case
+     \param name the name
+     \param length length of the name
+     \param literal the case-folded literal
+     \return true if the name contains the literal
+   */
+  bool containsFolded( const char *name, int length, const QByteArray &literal )
+  {
+    const int literalLength = literal.size();
+    for ( int start = 0; start + literalLength <= length; start++ )
+    {
+      int matched = 0;
+      while ( matched < literalLength &&
+              foldByte( static_cast<uchar>( name[ start + matched ] ) ) == static_cast<uchar>( literal[ matched ] ) )
+        matched++;
+      if ( matched == literalLength )
+        return true;
+    }
+    return false;
+  }
+
+  /*!
+     Extracts the longest literal every name matching a glob pattern \a pattern contains
+     \param pattern the glob pattern
+     \return the literal, empty if there is none
+   */
+  QString globLiteral( const QString &pattern )
+  {
+    QString longest;
+    QString current;
+    bool inBracket = false;
+    for ( const QChar character : pattern )
+    {
+      if ( inBracket )
+      {
+        inBracket = ( character != ']' );
+        continue;
+      }
+
+      if ( character == '*' || character == '?' || character == '[' )
+      {
+        inBracket = ( character == '[' );
+        if ( current.size() > longest.size() )
+          longest = current;
+        current.clear();
+        continue;
+      }
+
+      current += character;
+    }
+
+    return ( current.size() > longest.size() ) ? current : longest;
+  }
+
+  /*!
+     Entry collected by the parallel build
+   */
+  struct buildRecord_s
+  {
+    quint32 id;
+    quint32 parent;
+    int nameIndex;
+    quint8 flags;
+  };
+
+  /*!
+     Records collected by a single build thread
+   */
+  struct buildBuffer_s
+  {
+    std::vector<buildRecord_s> records;
+    nameArena_c names;
+  };
+
+  /*!
+     Lists non-hidden entries of a folder given at \a path
+     \param path path to the folder
+     \param entryListed called for every entry with its name and type, returning false stops the listing
+     \param proceed polled between batches of entries, returning false stops the listing
+   */
+  void listEntries( const std::string &path, const std::function<bool( const char *, bool )> &entryListed,
+                    const std::function<bool()> &proceed )
+  {
+#if defined( Q_OS_UNIX )
+    const int dirFd = open( path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+    if ( dirFd < 0 )
+      return;
+
+    dirLister_c::readEntries( dirFd, [&]( const char *name, unsigned char dType )
+    {
+      // hidden entries are not shown by the tree either
+      if ( name[ 0 ] == '.' )
+        return true;
+
+      bool isDir = ( dType == DT_DIR );
+      if ( dType == DT_UNKNOWN )
+      {
+        struct stat entryStat;
+        if ( fstatat( dirFd, name, &entryStat, AT_SYMLINK_NOFOLLOW ) != 0 )
+          return true;
+        isDir = S_ISDIR( entryStat.st_mode );
+      }
+
+      return entryListed( name, isDir );
+    }, proceed );
+
+    close( dirFd );
+#else
+    QDirIterator dirIt( QFile::decodeName( path.c_str() ), QDir::AllEntries | QDir::System | QDir::NoDotAndDotDot );
+    while ( dirIt.hasNext() && proceed() )
+    {
+      dirIt.next();
+      const QFileInfo entryInfo = dirIt.fileInfo();
+      if ( !entryListed( QFile::encodeName( entryInfo.fileName() ).constData(),
+                         entryInfo.isDir() && !entryInfo.isSymLink() ) )
+        break;
+    }
+#endif
+  }
+
+  /*!
+     \param parentPath path to a folder
+     \param name name of an entry of the folder
+     \return path to the entry
+   */
+  std::string childPath( const std::string &parentPath, const char *name )
+  {
+    return ( !parentPath.empty() && parentPath.back() == '/' ) ? parentPath + name : parentPath + '/' + name;
+  }
+}
+
+/*!
+   C-tor
+ */
+fileNameIndex_c::fileNameIndex_c() :
+  _removedCount{ 0 }
+{
+}
+
+/*!
+   Builds an index of a folder tree given at \a rootPath
+   Sub-folders are listed in parallel on a \em workStealingPool_c, symbolic links are not followed and hidden
+   entries are skipped.
+   \param rootPath absolute path to the root folder of the tree
+   \param cancelled set to abandon the build
+   \return the index, empty if the build was abandoned
+ */
+std::unique_ptr<fileNameIndex_c> fileNameIndex_c::build( const QString &rootPath, const std::atomic<bool> &cancelled )
+{
+  workStealingPool_c pool;
+  std::vector<buildBuffer_s> buffers( static_cast<size_t>( pool.threadCount() ) + 1 );
+  std::atomic<quint32> nextId{ 1 };
+
+  const std::string encodedRoot = QFile::encodeName( rootPath ).toStdString();
+  buildBuffer_s &rootBuffer = buffers.back();
+  rootBuffer.records.push_back( { 0, invalidId, rootBuffer.names.append( encodedRoot.c_str(),
+                                                                          static_cast<int>( encodedRoot.size() ) ),
+                                  Directory } );
+
+  const auto proceed = [&cancelled]() { return !cancelled; };
+
+  std::function<void( int, const std::string &, quint32 )> listDirectory;
+  listDirectory = [&]( int worker, const std::string &path, quint32 id )
+  {
+    buildBuffer_s &buffer = buffers[ static_cast<size_t>( worker ) ];
+    listEntries( path, [&]( const char *name, bool isDir )
+    {
+      const quint32 childId = nextId++;
+      buffer.records.push_back( { childId, id, buffer.names.append( name, static_cast<int>( std::strlen( name ) ) ),
+                                  static_cast<quint8>( isDir ? Directory : 0 ) } );
+      if ( isDir )
+      {
+        std::string subPath = childPath( path, name );
+        pool.submit( [&listDirectory, subPath, childId]( int subWorker )
+        {
+          listDirectory( subWorker, subPath, childId );
+        } );
+      }
+      return true;
+    }, proceed );
+  };
+
+  pool.submit( [&listDirectory, &encodedRoot]( int worker )
+  {
+    listDirectory( worker, encodedRoot, 0 );
+  } );
+  pool.wait();
+
+  if ( cancelled )
+    return {};
+
+  // entries ordered by id, a parent always precedes its children
+  const quint32 entryCount = nextId;
+  std::vector<const buildRecord_s *> records( entryCount, nullptr );
+  std::vector<const nameArena_c *> recordNames( entryCount, nullptr );
+  for ( const auto &buffer : buffers )
+  {
+    for ( const auto &record : buffer.records )
+    {
+      records[ record.id ] = &record;
+      recordNames[ record.id ] = &buffer.names;
+    }
+  }
+
+  auto index = std::make_unique<fileNameIndex_c>();
+  index->_rootPath = rootPath;
+  index->_parents.resize( entryCount, invalidId );
+  index->_firstChildren.resize( entryCount, invalidId );
+  index->_nextSiblings.resize( entryCount, invalidId );
+  index->_flags.resize( entryCount, Removed );
+
+  qint64 nameBytes = 0;
+  for ( const auto &buffer : buffers )
+  {
+    for ( int nameIndex = 0; nameIndex < buffer.names.size(); nameIndex++ )
+      nameBytes += buffer.names.length( nameIndex );
+  }
+  index->_names.reserve( static_cast<int>( entryCount ), static_cast<int>( nameBytes ) );
+
+  for ( quint32 id = 0; id < entryCount; id++ )
+  {
+    const buildRecord_s *record = records[ id ];
+    if ( record == nullptr )
+    {
+      // keeps the ids aligned with the name indices
+      index->_names.append( "", 0 );
+      index->_removedCount++;
+      continue;
+    }
+
+    const nameArena_c &names = *recordNames[ id ];
+    index->_names.append( names.name( record->nameIndex ), names.length( record->nameIndex ) );
+    index->_parents[ id ] = record->parent;
+    index->_flags[ id ] = record->flags;
+  }
+
+  for ( quint32 id = entryCount - 1; id > 0; id-- )
+  {
+    const quint32 parent = index->_parents[ id ];
+    if ( parent == invalidId )
+      continue;
+    index->_nextSiblings[ id ] = index->_firstChildren[ parent ];
+    index->_firstChildren[ parent ] = id;
+  }
+  buffers.clear();
+
+  // every worker fills its own shard of the posting lists
+  const size_t shardCount = static_cast<size_t>( pool.threadCount() );
+  index->_shards.resize( shardCount );
+  fileNameIndex_c *indexPtr = index.get();
+  for ( size_t shard = 0; shard < shardCount; shard++ )
+  {
+    pool.submit( [indexPtr, shard, shardCount, entryCount]( int )
+    {
+      postings_t &postings = indexPtr->_shards[ shard ];
+      for ( quint32 id = 1; id < entryCount; id++ )
+      {
+        const char *name = indexPtr->_names.name( static_cast<int>( id ) );
+        const int length = indexPtr->_names.length( static_cast<int>( id ) );
+        for ( int position = 0; position + 3 <= length; position++ )
+        {
+          const quint32 trigram = trigramAt( name, position );
+          if ( shardOf( trigram, shardCount ) != shard )
+            continue;
+
+          std::vector<quint32> &ids = postings[ trigram ];
+          if ( ids.empty() || ids.back() != id )
+            ids.push_back( id );
+        }
+      }
+    } );
+  }
+  pool.wait();
+
+  return index;
+}
+
+/*!
+   \return absolute path to the root folder of the index
+ */
+QString fileNameIndex_c::rootPath() const
+{
+  return _rootPath;
+}
+
+/*!
+   \return number of the entries, including the removed ones
+ */
+qint64 fileNameIndex_c::count() const
+{
+  QReadLocker locker( &_lock );
+  return static_cast<qint64>( _flags.size() );
+}
+
+/*!
+   \return number of the entries removed by refreshes
+ */
+qint64 fileNameIndex_c::removedCount() const
+{
+  QReadLocker locker( &_lock );
+  return _removedCount;
+}
+
+/*!
+   Searches names matching a pattern \a pattern, ignoring case
+   A substring is looked up in the posting lists; a glob pattern or a regular expression is matched against
+   the candidates containing its longest literal, or against all the names if it has none.
+   \param pattern the searched pattern
+   \param mode how the pattern is matched, a glob and a regular expression have to match the whole name
+   \param isCancelled polled to abandon the search
+   \param matchFound called for every match
+ */
+void fileNameIndex_c::search( const QString &pattern, matchMode_e mode, const std::function<bool()> &isCancelled,
+                              const matchHandler_t &matchFound ) const
+{
+  if ( pattern.isEmpty() )
+    return;
+
+  QRegularExpression expression;
+  QByteArray literal;
+  switch ( mode )
+  {
+    case matchMode_e::Substring:
+      literal = foldedName( pattern );
+      break;
+    case matchMode_e::Glob:
+      expression.setPattern( QRegularExpression::wildcardToRegularExpression( pattern ) );
+      literal = foldedName( globLiteral( pattern ) );
+      break;
+    case matchMode_e::RegularExpression:
+      expression.setPattern( pattern );
+      literal = foldedName( fileInspector_n::util_n::getRequiredLiteral( pattern ) );
+      break;
+  }
+
+  if ( mode != matchMode_e::Substring )
+  {
+    expression.setPatternOptions( QRegularExpression::CaseInsensitiveOption );
+    if ( !expression.isValid() )
+      return;
+
+    // the expression ignores the case of any letter, the literal is folded for ASCII letters only
+    const auto isNonAscii = []( char byte ) { return static_cast<uchar>( byte ) >= 0x80; };
+    if ( std::any_of( literal.cbegin(), literal.cend(), isNonAscii ) )
+      literal.clear();
+  }
+
+  QReadLocker locker( &_lock );
+
+  const auto matches = [&]( quint32 id )
+  {
+    if ( _flags[ id ] & Removed )
+      return false;
+
+    const char *name = _names.name( static_cast<int>( id ) );
+    if ( !literal.isEmpty() && !containsFolded( name, _names.length( static_cast<int>( id ) ), literal ) )
+      return false;
+
+    return mode == matchMode_e::Substring || expression.match( QFile::decodeName( name ) ).hasMatch();
+  };
+
+  std::vector<quint32> candidateIds;
+  const bool useCandidates = literal.size() >= 3 && candidates( literal, candidateIds );
+  const quint32 entryCount = static_cast<quint32>( _flags.size() );
+  const quint32 searchCount = useCandidates ? static_cast<quint32>( candidateIds.size() ) : entryCount;
+
+  for ( quint32 position = useCandidates ? 0 : 1; position < searchCount; position++ )
+  {
+    if ( position % cancelCheckInterval == 0 && isCancelled() )
+      return;
+
+    const quint32 id = useCandidates ? candidateIds[ position ] : position;
+    if ( matches( id ) && !matchFound( pathOf( id ) ) )
+      return;
+  }
+}
+
+/*!
+   Brings entries of a folder given at \a path up to date with the file system
+   The folder is listed again; entries no longer present are marked as removed with their sub-trees, new entries
+   are appended with their sub-trees. The file system is read without blocking searches.
+   \param path absolute path to the folder
+ */
+void fileNameIndex_c::refreshDirectory( const QString &path )
+{
+  /*!
+     Entry to append, its parent is either an existing entry or another pending entry
+   */
+  struct pendingEntry_s
+  {
+    std::string name;
+    quint32 parent;
+    int pendingParent;
+    bool isDir;
+  };
+
+  quint32 dirId = invalidId;
+  std::unordered_map<std::string, quint32> existingChildren;
+  {
+    QReadLocker locker( &_lock );
+    dirId = find( path );
+    if ( dirId == invalidId || !( _flags[ dirId ] & Directory ) )
+      return;
+
+    for ( quint32 childId = _firstChildren[ dirId ]; childId != invalidId; childId = _nextSiblings[ childId ] )
+    {
+      if ( !( _flags[ childId ] & Removed ) )
+        existingChildren.emplace( _names.name( static_cast<int>( childId ) ), childId );
+    }
+  }
+
+  const auto proceed = []() { return true; };
+  std::vector<pendingEntry_s> pending;
+  std::function<void( const std::string &, int )> listSubtree;
+  listSubtree = [&]( const std::string &subPath, int pendingParent )
+  {
+    listEntries( subPath, [&]( const char *name, bool isDir )
+    {
+      pending.push_back( { name, invalidId, pendingParent, isDir } );
+      if ( isDir )
+        listSubtree( childPath( subPath, name ), static_cast<int>( pending.size() ) - 1 );
+      return true;
+    }, proceed );
+  };
+
+  const std::string encodedPath = QFile::encodeName( path ).toStdString();
+  std::vector<quint32> removedIds;
+  listEntries( encodedPath, [&]( const char *name, bool isDir )
+  {
+    const auto existingIt = existingChildren.find( name );
+    if ( existingIt != existingChildren.end() )
+    {
+      const bool wasDir = _flags[ existingIt->second ] & Directory;
+      if ( wasDir == isDir )
+      {
+        existingChildren.erase( existingIt );
+        return true;
+      }
+    }
+
+    pending.push_back( { name, dirId, -1, isDir } );
+    if ( isDir )
+      listSubtree( childPath( encodedPath, name ), static_cast<int>( pending.size() ) - 1 );
+    return true;
+  }, proceed );
+
+  // the remaining children are gone, or changed their type
+  for ( const auto &existingChild : existingChildren )
+    removedIds.push_back( existingChild.second );
+
+  if ( removedIds.empty() && pending.empty() )
+    return;
+
+  QWriteLocker locker( &_lock );
+
+  for ( const quint32 removedId : removedIds )
+    markRemoved( removedId );
+
+  std::vector<quint32> pendingIds( pending.size(), invalidId );
+  for ( size_t pendingIndex = 0; pendingIndex < pending.size(); pendingIndex++ )
+  {
+    const pendingEntry_s &entry = pending[ pendingIndex ];
+    const quint32 parent = ( entry.pendingParent >= 0 ) ? pendingIds[ static_cast<size_t>( entry.pendingParent ) ]
+                                                        : entry.parent;
+    const quint32 id = static_cast<quint32>( _flags.size() );
+    pendingIds[ pendingIndex ] = id;
+
+    _names.append( entry.name.c_str(), static_cast<int>( entry.name.size() ) );
+    _parents.push_back( parent );
+    _firstChildren.push_back( invalidId );
+    _nextSiblings.push_back( _firstChildren[ parent ] );
+    _firstChildren[ parent ] = id;
+    _flags.push_back( entry.isDir ? Directory : 0 );
+    addTrigrams( id );
+  }
+}
+
+/*!
+   Rebuilds an absolute path to an entry \a id, the caller holds the lock
+   \param id id of the entry
+   \return the path
+ */
+QString fileNameIndex_c::pathOf( quint32 id ) const
+{
+  QByteArray path;
+  std::vector<quint32> ancestors;
+  for ( quint32 ancestor = id; ancestor != invalidId; ancestor = _parents[ ancestor ] )
+    ancestors.push_back( ancestor );
+
+  for ( auto ancestorIt = ancestors.rbegin(); ancestorIt != ancestors.rend(); ++ancestorIt )
+  {
+    if ( !path.isEmpty() && !path.endsWith( '/' ) )
+      path += '/';
+    path += _names.name( static_cast<int>( *ancestorIt ) );
+  }
+
+  return QFile::decodeName( path );
+}
+
+/*!
+   Finds an entry given at an absolute path \a path, the caller holds the lock
+   \param path absolute path to the entry
+   \return id of the entry, \em invalidId if not indexed
+ */
+quint32 fileNameIndex_c::find( const QString &path ) const
+{
+  if ( _flags.empty() )
+    return invalidId;
+
+  if ( path == _rootPath )
+    return 0;
+
+  const QString rootPrefix = _rootPath.endsWith( '/' ) ? _rootPath : _rootPath + '/';
+  if ( !path.startsWith( rootPrefix ) )
+    return invalidId;
+
+  quint32 id = 0;
+  const auto components = path.midRef( rootPrefix.size() ).split( '/', Qt::SkipEmptyParts );
+  for ( const auto &component : components )
+  {
+    const QByteArray encodedComponent = QFile::encodeName( component.toString() );
+    quint32 childId = _firstChildren[ id ];
+    while ( childId != invalidId && ( ( _flags[ childId ] & Removed ) ||
+                                      std::strcmp( _names.name( static_cast<int>( childId ) ),
+                                                   encodedComponent.constData() ) != 0 ) )
+      childId = _nextSiblings[ childId ];
+
+    if ( childId == invalidId )
+      return invalidId;
+    id = childId;
+  }
+
+  return id;
+}
+
+/*!
+   Collects ids of the entries containing all the trigrams of a case-folded literal \a literal
+   \param literal the literal, at least 3 bytes long
+   \param candidateIds the ids, ascending
+   \return true if the candidates were collected
+ */
+bool fileNameIndex_c::candidates( const QByteArray &literal, std::vector<quint32> &candidateIds ) const
+{
+  if ( _shards.empty() )
+    return false;
+
+  std::vector<const std::vector<quint32> *> postingLists;
+  for ( int position = 0; position + 3 <= literal.size(); position++ )
+  {
+    const quint32 trigram = trigramAt( literal.constData(), position );
+    const postings_t &postings = _shards[ shardOf( trigram, _shards.size() ) ];
+    const auto postingsIt = postings.find( trigram );
+    if ( postingsIt == postings.end() )
+    {
+      candidateIds.clear();
+      return true;
+    }
+    postingLists.push_back( &postingsIt->second );
+  }
+
+  std::sort( postingLists.begin(), postingLists.end(),
+             []( const std::vector<quint32> *left, const std::vector<quint32> *right )
+  {
+    return left->size() < right->size();
+  } );
+  postingLists.erase( std::unique( postingLists.begin(), postingLists.end() ), postingLists.end() );
+
+  candidateIds = *postingLists.front();
+  std::vector<quint32> intersection;
+  for ( size_t listIndex = 1; listIndex < postingLists.size() && !candidateIds.empty(); listIndex++ )
+  {
+    intersection.clear();
+    std::set_intersection( candidateIds.begin(), candidateIds.end(), postingLists[ listIndex ]->begin(),
+                           postingLists[ listIndex ]->end(), std::back_inserter( intersection ) );
+    candidateIds.swap( intersection );
+  }
+
+  return true;
+}
+
+/*!
+   Adds trigrams of a new entry \a id to the posting lists, the caller holds the write lock
+   \param id id of the entry, higher than the ids of all the indexed entries
+ */
+void fileNameIndex_c::addTrigrams( quint32 id )
+{
+  if ( _shards.empty() )
+    return;
+
+  const char *name = _names.name( static_cast<int>( id ) );
+  const int length = _names.length( static_cast<int>( id ) );
+  for ( int position = 0; position + 3 <= length; position++ )
+  {
+    const quint32 trigram = trigramAt( name, position );
+    std::vector<quint32> &ids = _shards[ shardOf( trigram, _shards.size() ) ][ trigram ];
+    if ( ids.empty() || ids.back() != id )
+      ids.push_back( id );
+  }
+}
+
+/*!
+   Marks an entry \a id and its sub-tree as removed, the caller holds the write lock
+   \param id id of the entry
+ */
+void fileNameIndex_c::markRemoved( quint32 id )
+{
+  std::vector<quint32> pendingIds{ id };
+  while ( !pendingIds.empty() )
+  {
+    const quint32 removedId = pendingIds.back();
+    pendingIds.pop_back();
+    if ( _flags[ removedId ] & Removed )
+      continue;
+
+    _flags[ removedId ] |= Removed;
+    _removedCount++;
+    for ( quint32 childId = _firstChildren[ removedId ]; childId != invalidId; childId = _nextSiblings[ childId ] )
+      pendingIds.push_back( childId );
+  }
+}
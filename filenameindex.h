@@ -0,0 +1,83 @@
+#pragma once
+
+#include <QReadWriteLock>
+#include <QString>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "namearena.h"
+
+/*!
+   In-memory index of entry names of a folder tree for substring, glob and regular expression searches
+   Names are kept in a single arena with parent links, a path is rebuilt on demand. Every name is split into
+   trigrams of case-folded bytes, each trigram maps to the ascending list of ids of the entries containing it.
+   A search intersects the lists of the trigrams of the searched literal and verifies only the remaining
+   candidates, so it costs far less than a scan of all the names.
+   The index is built in parallel, the posting lists are sharded by trigram and every shard is filled by its own
+   worker. Folders are refreshed in place; removed entries are marked, new ones are appended.
+   Searches may run concurrently with a refresh; refreshes must not run concurrently with each other.
+ */
+class fileNameIndex_c
+{
+  public:
+    enum class matchMode_e
+    {
+      Substring,
+      Glob,
+      RegularExpression
+    };
+
+    // Receives an absolute path of a match, returning false stops the search
+    using matchHandler_t = std::function<bool( const QString & )>;
+
+  private:
+    enum entryFlag_e : quint8
+    {
+      Directory = 0x01,
+      Removed = 0x02
+    };
+
+    using postings_t = std::unordered_map<quint32, std::vector<quint32>>;
+
+    QString _rootPath;
+    // Entry names, indexed by entry id. The entry 0 is the root folder, named with its absolute path
+    nameArena_c _names;
+    std::vector<quint32> _parents;
+    std::vector<quint32> _firstChildren;
+    std::vector<quint32> _nextSiblings;
+    std::vector<quint8> _flags;
+    qint64 _removedCount;
+    // Posting lists sharded by trigram
+    std::vector<postings_t> _shards;
+    // Guards the entries against a concurrent refresh
+    mutable QReadWriteLock _lock;
+
+  public:
+    // Id of a non-existing entry
+    static constexpr quint32 invalidId = 0xFFFFFFFF;
+
+    fileNameIndex_c();
+
+    fileNameIndex_c( const fileNameIndex_c & ) = delete;
+    fileNameIndex_c &operator=( const fileNameIndex_c & ) = delete;
+
+    static std::unique_ptr<fileNameIndex_c> build( const QString &, const std::atomic<bool> & );
+
+    QString rootPath() const;
+    qint64 count() const;
+    qint64 removedCount() const;
+
+    void search( const QString &, matchMode_e, const std::function<bool()> &, const matchHandler_t & ) const;
+    void refreshDirectory( const QString & );
+
+  private:
+    QString pathOf( quint32 ) const;
+    quint32 find( const QString & ) const;
+    bool candidates( const QByteArray &, std::vector<quint32> & ) const;
+    void addTrigrams( quint32 );
+    void markRemoved( quint32 );
+};
@@ -0,0 +1,226 @@
+#include "filesearch.h"
+
+#include <QElapsedTimer>
+#include <QtConcurrent>
+
+#include "util.h"
+
+namespace
+{
+  // Matches delivered at once at most
+  constexpr int resultBatchSize = 256;
+  // Longest time matches are held back before delivery, in ms
+  constexpr qint64 resultBatchInterval = 50;
+}
+
+/*!
+   C-tor
+   \param parent parent object
+ */
+fileSearch_c::fileSearch_c( QObject *parent ) :
+  QObject( parent ),
+  _indexGeneration{ 0 },
+  _searchGeneration{ 0 },
+  _pendingMode{ fileNameIndex_c::matchMode_e::Substring }
+{
+  _indexPool.setMaxThreadCount( 1 );
+  _searchPool.setMaxThreadCount( 1 );
+}
+
+/*!
+   D-tor
+   Abandons the running build and search and waits for them to wind down.
+ */
+fileSearch_c::~fileSearch_c()
+{
+  ++_indexGeneration;
+  ++_searchGeneration;
+  if ( _buildCancelled )
+    *_buildCancelled = true;
+
+  _searchPool.waitForDone();
+  _indexPool.waitForDone();
+}
+
+/*!
+   Starts indexing a folder given at \a rootPath, replacing the current index
+   \param rootPath absolute path to the folder
+ */
+void fileSearch_c::setRootPath( const QString &rootPath )
+{
+  if ( rootPath == _rootPath && ( _index || _buildCancelled ) )
+    return;
+
+  if ( _buildCancelled )
+    *_buildCancelled = true;
+
+  _rootPath = rootPath;
+  _index.reset();
+  cancelSearch();
+
+  const quint64 generation = ++_indexGeneration;
+  auto cancelled = std::make_shared<std::atomic<bool>>( false );
+  _buildCancelled = cancelled;
+
+  QtConcurrent::run( &_indexPool, [this, rootPath, generation, cancelled]()
+  {
+    if ( *cancelled )
+      return;
+
+    std::shared_ptr<fileNameIndex_c> index = fileNameIndex_c::build( rootPath, *cancelled );
+    if ( !index )
+      return;
+
+    QMetaObject::invokeMethod( this, [this, index, generation]()
+    {
+      if ( generation != _indexGeneration.load() )
+        return;
+
+      _index = index;
+      _buildCancelled.reset();
+      emit indexReady( index->count() );
+
+      if ( !_pendingPattern.isEmpty() )
+        search( _pendingPattern, _pendingMode );
+    }, Qt::QueuedConnection );
+  } );
+}
+
+/*!
+   \return absolute path to the indexed folder
+ */
+QString fileSearch_c::rootPath() const
+{
+  return _rootPath;
+}
+
+/*!
+   \return true if the index is built
+ */
+bool fileSearch_c::isReady() const
+{
+  return _index != nullptr;
+}
+
+/*!
+   Starts a search of a pattern \a pattern, superseding the running one
+   \param pattern the pattern
+   \param mode how the pattern is matched
+ */
+void fileSearch_c::search( const QString &pattern, fileNameIndex_c::matchMode_e mode )
+{
+  const quint64 generation = ++_searchGeneration;
+  _pendingPattern.clear();
+
+  if ( pattern.isEmpty() )
+    return;
+
+  if ( !_index )
+  {
+    _pendingPattern = pattern;
+    _pendingMode = mode;
+    return;
+  }
+
+  QtConcurrent::run( &_searchPool, [this, index = _index, pattern, mode, generation]()
+  {
+    const auto isCancelled = [this, generation]() { return isSearchStale( generation ); };
+    const auto postResults = [this, generation]( const QStringList &paths )
+    {
+      QMetaObject::invokeMethod( this, [this, paths, generation]()
+      {
+        if ( !isSearchStale( generation ) )
+          emit resultsFound( paths );
+      }, Qt::QueuedConnection );
+    };
+
+    QStringList batch;
+    int matchCount = 0;
+    QElapsedTimer batchTimer;
+    batchTimer.start();
+
+    index->search( pattern, mode, isCancelled, [&]( const QString &path )
+    {
+      batch.append( path );
+      matchCount++;
+      if ( batch.size() >= resultBatchSize || batchTimer.elapsed() >= resultBatchInterval )
+      {
+        postResults( batch );
+        batch.clear();
+        batchTimer.restart();
+      }
+      return matchCount < maximumResults && !isCancelled();
+    } );
+
+    if ( isCancelled() )
+      return;
+
+    if ( !batch.isEmpty() )
+      postResults( batch );
+
+    QMetaObject::invokeMethod( this, [this, matchCount, generation]()
+    {
+      if ( !isSearchStale( generation ) )
+        emit searchFinished( matchCount );
+    }, Qt::QueuedConnection );
+  } );
+}
+
+/*!
+   Abandons the running search
+ */
+void fileSearch_c::cancelSearch()
+{
+  ++_searchGeneration;
+  _pendingPattern.clear();
+}
+
+/*!
+   Refreshes the index for changed folders \a directories, without a full rebuild
+   The index is rebuilt once refreshes left more removed entries in it than live ones.
+   \param directories absolute paths to the changed folders
+ */
+void fileSearch_c::refreshDirectories( const QStringList &directories )
+{
+  if ( !_index )
+    return;
+
+  QStringList indexedDirectories;
+  for ( const auto &directory : directories )
+  {
+    if ( fileInspector_n::util_n::isWithinFolder( directory, _rootPath ) )
+      indexedDirectories.append( directory );
+  }
+  if ( indexedDirectories.isEmpty() )
+    return;
+
+  const quint64 generation = _indexGeneration.load();
+  QtConcurrent::run( &_indexPool, [this, index = _index, indexedDirectories, generation]()
+  {
+    for ( const auto &directory : indexedDirectories )
+      index->refreshDirectory( directory );
+
+    if ( index->removedCount() * 2 <= index->count() )
+      return;
+
+    QMetaObject::invokeMethod( this, [this, generation]()
+    {
+      if ( generation != _indexGeneration.load() )
+        return;
+
+      const QString rootPath = _rootPath;
+      _rootPath.clear();
+      setRootPath( rootPath );
+    }, Qt::QueuedConnection );
+  } );
+}
+
+/*!
+   Checks if a search of generation \a generation has been superseded by a newer one
+   \param generation the search generation
+   \return true if the search is stale
+ */
+bool fileSearch_c::isSearchStale( quint64 generation ) const
+{
+  return generation != _searchGeneration.load();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <atomic>
+#include <memory>
+
+#include "filenameindex.h"
+
+/*!
+   Searches entry names below the listed folder in the background
+   A \em fileNameIndex_c of the folder is built when the folder is set and refreshed in place for changed folders.
+   Matches of a search are delivered incrementally through \em resultsFound, a new search supersedes the running
+   one. A search issued before the index is ready runs once it is.
+ */
+class fileSearch_c : public QObject
+{
+  Q_OBJECT
+
+  public:
+    // Maximum number of matches of a single search
+    static constexpr int maximumResults = 5000;
+
+  private:
+    // Builds and refreshes the index, one task at a time
+    QThreadPool _indexPool;
+    // Runs the searches
+    QThreadPool _searchPool;
+    // The ready index, empty while building
+    std::shared_ptr<fileNameIndex_c> _index;
+    QString _rootPath;
+    // Generation of the latest index build
+    std::atomic<quint64> _indexGeneration;
+    // Set to abandon the running build
+    std::shared_ptr<std::atomic<bool>> _buildCancelled;
+    // Generation of the latest search
+    std::atomic<quint64> _searchGeneration;
+    // Search waiting for the index
+    QString _pendingPattern;
+    fileNameIndex_c::matchMode_e _pendingMode;
+
+  public:
+    fileSearch_c( QObject * = nullptr );
+    virtual ~fileSearch_c();
+
+    void setRootPath( const QString & );
+    QString rootPath() const;
+    bool isReady() const;
+
+    void search( const QString &, fileNameIndex_c::matchMode_e );
+    void cancelSearch();
+    void refreshDirectories( const QStringList & );
+
+  private:
+    bool isSearchStale( quint64 ) const;
+
+  signals:
+    void indexReady( qint64 );
+    void resultsFound( const QStringList & );
+    void searchFinished( int );
+};
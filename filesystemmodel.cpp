@@ -0,0 +1,1646 @@
+#include "filesystemmodel.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileIconProvider>
+#include <QFileInfo>
+#include <QLocale>
+#include <QTimer>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <numeric>
+#include <string_view>
+
+#if defined( Q_OS_UNIX )
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "batchio.h"
+#include "dirlister.h"
+#include "perftracer.h"
+#include "scanindex.h"
+#include "util.h"
+
+namespace
+{
+  // Number of workers, so listing an expanded folder does not wait for a huge folder being listed
+  constexpr int workerThreadCount = 4;
+  // Number of the known folder sizes kept at most, older ones are then taken from the scan index again
+  constexpr int maximumFolderSizes = 64 * 1024;
+
+#if defined( Q_OS_UNIX )
+  /*!
+     \param entryStat attributes of an entry
+     \return modification time of the entry in ms since epoch
+   */
+  qint64 modificationTime( const struct stat &entryStat )
+  {
+#if defined( Q_OS_DARWIN )
+    return static_cast<qint64>( entryStat.st_mtimespec.tv_sec ) * 1000 + entryStat.st_mtimespec.tv_nsec / 1000000;
+#else
+    return static_cast<qint64>( entryStat.st_mtim.tv_sec ) * 1000 + entryStat.st_mtim.tv_nsec / 1000000;
+#endif
+  }
+#endif
+
+  /*!
+     Stats entries \a entries of a folder given at \a folderPath, following symbolic links
+     \param folderPath absolute path to the folder
+     \param names names of the folder entries
+     \param entries indexes of the entries to stat within \a names
+     \param sizes output for the sizes, indexed like \a names, 0 if the stat failed
+     \param modified output for the modification times in ms since epoch, indexed like \a names, -1 if the stat
+     failed
+   */
+  void statEntries( const QString &folderPath, const nameArena_c &names, const std::vector<quint32> &entries,
+                    std::vector<qint64> &sizes, std::vector<qint64> &modified )
+  {
+#if defined( Q_OS_UNIX )
+    const int dirFd = open( QFile::encodeName( folderPath ).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+    std::vector<batchIo_c::statRequest_s> requests( dirFd >= 0 ? entries.size() : 0 );
+    for ( size_t index = 0; index < requests.size(); ++index )
+    {
+      requests[ index ].dirFd = dirFd;
+      requests[ index ].name = names.name( static_cast<int>( entries[ index ] ) );
+    }
+    {
+      // the stats of the folder are in flight at once, traced as a single operation
+      const perfScope_c statScope( perfTracer_c::operation_e::Stat );
+      batchIo_c::forThread().stat( requests );
+    }
+
+    for ( size_t index = 0; index < entries.size(); ++index )
+    {
+      const quint32 entry = entries[ index ];
+      if ( index < requests.size() && requests[ index ].error == 0 )
+      {
+        sizes[ entry ] = requests[ index ].status.st_size;
+        modified[ entry ] = modificationTime( requests[ index ].status );
+      }
+      else
+      {
+        sizes[ entry ] = 0;
+        modified[ entry ] = -1;
+      }
+    }
+
+    if ( dirFd >= 0 )
+      close( dirFd );
+#else
+    const QDir folderDir( folderPath );
+    for ( const quint32 entry : entries )
+    {
+      const perfScope_c statScope( perfTracer_c::operation_e::Stat );
+      const QFileInfo entryFileInfo( folderDir.filePath( names.toString( static_cast<int>( entry ) ) ) );
+      sizes[ entry ] = entryFileInfo.exists() ? entryFileInfo.size() : 0;
+      modified[ entry ] = entryFileInfo.exists() ? entryFileInfo.lastModified().toMSecsSinceEpoch() : -1;
+    }
+#endif
+  }
+
+  /*!
+     Looks up entries \a names of a folder given at \a folderPath, whether they exist, their types, sizes and dates
+     The type is taken from the entry itself, as a listing reports it, the size and the date follow symbolic links.
+     \param folderPath absolute path to the folder
+     \param names names of the entries
+     \param exists output, false for the entries not found
+     \param isDirectory output, true for the folders
+     \param sizes output for the sizes, 0 if the stat failed
+     \param modified output for the modification times in ms since epoch, -1 if the stat failed
+   */
+  void lookUpEntries( const QString &folderPath, const nameArena_c &names, std::vector<bool> &exists,
+                      std::vector<bool> &isDirectory, std::vector<qint64> &sizes, std::vector<qint64> &modified )
+  {
+    const size_t count = static_cast<size_t>( names.size() );
+    exists.assign( count, false );
+    isDirectory.assign( count, false );
+    sizes.assign( count, 0 );
+    modified.assign( count, -1 );
+
+#if defined( Q_OS_UNIX )
+    const int dirFd = open( QFile::encodeName( folderPath ).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+    if ( dirFd < 0 )
+      return;
+
+    // the entry itself and its target are stat-ed in the same batch
+    std::vector<batchIo_c::statRequest_s> requests( 2 * count );
+    for ( size_t index = 0; index < count; ++index )
+    {
+      for ( size_t request = 2 * index; request <= 2 * index + 1; ++request )
+      {
+        requests[ request ].dirFd = dirFd;
+        requests[ request ].name = names.name( static_cast<int>( index ) );
+      }
+      requests[ 2 * index ].flags = AT_SYMLINK_NOFOLLOW;
+    }
+    {
+      const perfScope_c statScope( perfTracer_c::operation_e::Stat );
+      batchIo_c::forThread().stat( requests );
+    }
+
+    for ( size_t index = 0; index < count; ++index )
+    {
+      const batchIo_c::statRequest_s &entryRequest = requests[ 2 * index ];
+      const batchIo_c::statRequest_s &targetRequest = requests[ 2 * index + 1 ];
+      exists[ index ] = ( entryRequest.error != ENOENT && entryRequest.error != ENOTDIR );
+      isDirectory[ index ] = ( entryRequest.error == 0 && S_ISDIR( entryRequest.status.st_mode ) );
+      if ( targetRequest.error == 0 )
+      {
+        sizes[ index ] = targetRequest.status.st_size;
+        modified[ index ] = modificationTime( targetRequest.status );
+      }
+    }
+
+    close( dirFd );
+#else
+    const QDir folderDir( folderPath );
+    for ( size_t index = 0; index < count; ++index )
+    {
+      const perfScope_c statScope( perfTracer_c::operation_e::Stat );
+      const QFileInfo entryFileInfo( folderDir.filePath( names.toString( static_cast<int>( index ) ) ) );
+      exists[ index ] = entryFileInfo.exists() || entryFileInfo.isSymLink();
+      isDirectory[ index ] = entryFileInfo.isDir() && !entryFileInfo.isSymLink();
+      if ( entryFileInfo.exists() )
+      {
+        sizes[ index ] = entryFileInfo.size();
+        modified[ index ] = entryFileInfo.lastModified().toMSecsSinceEpoch();
+      }
+    }
+#endif
+  }
+
+  /*!
+     \param names names of folder entries
+     \param entry index of an entry
+     \return name of the entry
+   */
+  std::string_view nameView( const nameArena_c &names, quint32 entry )
+  {
+    return std::string_view( names.name( static_cast<int>( entry ) ),
+                             static_cast<size_t>( names.length( static_cast<int>( entry ) ) ) );
+  }
+
+  /*!
+     \param name name of an entry
+     \return suffix of the name without the dot, empty for names without a suffix or hidden names without one
+   */
+  std::string_view suffixOf( std::string_view name )
+  {
+    const size_t dot = name.rfind( '.' );
+    return ( dot == std::string_view::npos || dot == 0 ) ? std::string_view() : name.substr( dot + 1 );
+  }
+
+  /*!
+     Compares names \a first and \a second ignoring the case of the ASCII letters, exactly if equal otherwise
+     \param first the first name
+     \param second the second name
+     \return negative, zero or positive if the first name sorts before, equal or after the second one
+   */
+  int compareNames( std::string_view first, std::string_view second )
+  {
+    const auto fold = []( char character )
+    {
+      const auto byte = static_cast<unsigned char>( character );
+      return ( byte >= 'A' && byte <= 'Z' ) ? byte + ( 'a' - 'A' ) : byte;
+    };
+
+    const size_t length = std::min( first.size(), second.size() );
+    for ( size_t index = 0; index < length; index++ )
+    {
+      const int difference = fold( first[ index ] ) - fold( second[ index ] );
+      if ( difference != 0 )
+        return difference;
+    }
+
+    if ( first.size() != second.size() )
+      return ( first.size() < second.size() ) ? -1 : 1;
+    return first.compare( second );
+  }
+
+  /*!
+     \param name name of an entry
+     \return hash of the name
+   */
+  size_t nameHash( std::string_view name )
+  {
+    return std::hash<std::string_view>()( name );
+  }
+}
+
+/*!
+   C-tor
+   \param parent parent object
+ */
+fileSystemModel_c::fileSystemModel_c( QObject *parent ) :
+  QAbstractItemModel( parent ),
+  _nextNodeId{ 1 },
+  _statTimer{ nullptr },
+  _sortColumn{ NameColumn },
+  _sortOrder{ Qt::AscendingOrder },
+  _sortGeneration{ 0 }
+{
+  _workerPool.setMaxThreadCount( workerThreadCount );
+
+  const QFileIconProvider iconProvider;
+  _folderIcon = iconProvider.icon( QFileIconProvider::Folder );
+  _fileIcon = iconProvider.icon( QFileIconProvider::File );
+
+  _statTimer = new QTimer( this );
+  _statTimer->setSingleShot( true );
+  _statTimer->setInterval( 0 );
+  connect( _statTimer, &QTimer::timeout, this, &fileSystemModel_c::statQueuedEntries );
+}
+
+/*!
+   D-tor
+   Stops the listings and waits for the workers to finish.
+ */
+fileSystemModel_c::~fileSystemModel_c()
+{
+  if ( _root )
+    unregisterNode( _root.get() );
+  _workerPool.waitForDone();
+}
+
+/*!
+   \param row row of the entry
+   \param column column of the entry
+   \param parent the model index of the folder, invalid for the root folder
+   \return the model index of the entry, invalid if the row is not exposed
+ */
+QModelIndex fileSystemModel_c::index( int row, int column, const QModelIndex &parent ) const
+{
+  if ( parent.column() > 0 )
+    return QModelIndex();
+
+  const folderNode_s *node = parent.isValid() ? childNode( nodeOf( parent ), parent.row() ) : _root.get();
+  if ( node == nullptr || row < 0 || row >= node->rowCount || column < 0 || column >= ColumnCount )
+    return QModelIndex();
+
+  return createIndex( row, column, const_cast<folderNode_s *>( node ) );
+}
+
+/*!
+   \param index the model index of an entry
+   \return the model index of the folder containing the entry, invalid for the root folder
+ */
+QModelIndex fileSystemModel_c::parent( const QModelIndex &index ) const
+{
+  if ( !index.isValid() )
+    return QModelIndex();
+
+  return nodeIndex( nodeOf( index ) );
+}
+
+/*!
+   \param parent the model index of a folder, invalid for the root folder
+   \return number of the exposed rows of the folder
+ */
+int fileSystemModel_c::rowCount( const QModelIndex &parent ) const
+{
+  if ( parent.column() > 0 )
+    return 0;
+
+  const folderNode_s *node = parent.isValid() ? childNode( nodeOf( parent ), parent.row() ) : _root.get();
+  return ( node != nullptr ) ? node->rowCount : 0;
+}
+
+/*!
+   \return number of the columns: Name, Size, Type and Date Modified
+ */
+int fileSystemModel_c::columnCount( const QModelIndex &parent ) const
+{
+  return ( parent.column() > 0 ) ? 0 : ColumnCount;
+}
+
+/*!
+   \param parent the model index of an entry, invalid for the root folder
+   \return true for a folder not known to be empty
+ */
+bool fileSystemModel_c::hasChildren( const QModelIndex &parent ) const
+{
+  if ( !parent.isValid() )
+    return _root != nullptr;
+  if ( parent.column() > 0 || !isDir( parent ) )
+    return false;
+
+  const folderNode_s *node = childNode( nodeOf( parent ), parent.row() );
+  return node == nullptr || node->state != listingState_e::Listed || !node->rows.empty();
+}
+
+/*!
+   Provides the name, size, type and modification date of an entry
+   Sizes and dates not known yet are requested from a worker, they arrive through \em dataChanged.
+   \param index the model index
+   \param role the data role
+   \return the data
+ */
+QVariant fileSystemModel_c::data( const QModelIndex &index, int role ) const
+{
+  if ( !index.isValid() )
+    return QVariant();
+
+  folderNode_s *node = nodeOf( index );
+  const quint32 entry = node->rows[ static_cast<size_t>( index.row() ) ];
+  const quint8 entryFlags = node->flags[ entry ];
+  const bool isDirectory = ( entryFlags & Directory ) != 0;
+
+  switch ( index.column() )
+  {
+    case NameColumn:
+      if ( role == Qt::DisplayRole || role == Qt::EditRole )
+        return node->names.toString( static_cast<int>( entry ) );
+      if ( role == Qt::DecorationRole )
+        return isDirectory ? _folderIcon : _fileIcon;
+      break;
+
+    case SizeColumn:
+      if ( role == Qt::TextAlignmentRole )
+        return QVariant( Qt::AlignTrailing | Qt::AlignVCenter );
+      if ( role == Qt::DisplayRole )
+      {
+        qint64 size = 0;
+        if ( isDirectory )
+          return folderSize( index, size ) ? QLocale().formattedDataSize( size ) : QVariant();
+        if ( !( entryFlags & Stated ) )
+        {
+          queueStat( node, entry );
+          return QVariant();
+        }
+        return QLocale().formattedDataSize( node->sizes[ entry ] );
+      }
+      break;
+
+    case TypeColumn:
+      if ( role == Qt::DisplayRole )
+      {
+        if ( isDirectory )
+          return tr( "Folder" );
+        const std::string_view suffix = suffixOf( nameView( node->names, entry ) );
+        if ( suffix.empty() )
+          return tr( "File" );
+        return tr( "%1 File" ).arg( QFile::decodeName( QByteArray( suffix.data(),
+                                                                   static_cast<int>( suffix.size() ) ) ) );
+      }
+      break;
+
+    case DateColumn:
+      if ( role == Qt::DisplayRole )
+      {
+        if ( !( entryFlags & Stated ) )
+        {
+          queueStat( node, entry );
+          return QVariant();
+        }
+        if ( node->modified[ entry ] < 0 )
+          return QVariant();
+        return QLocale().toString( QDateTime::fromMSecsSinceEpoch( node->modified[ entry ] ), QLocale::ShortFormat );
+      }
+      break;
+  }
+
+  return QVariant();
+}
+
+/*!
+   \param section the column
+   \param orientation orientation of the header
+   \param role the data role
+   \return title of the column
+ */
+QVariant fileSystemModel_c::headerData( int section, Qt::Orientation orientation, int role ) const
+{
+  if ( orientation != Qt::Horizontal || role != Qt::DisplayRole )
+    return QAbstractItemModel::headerData( section, orientation, role );
+
+  switch ( section )
+  {
+    case NameColumn:
+      return tr( "Name" );
+    case SizeColumn:
+      return tr( "Size" );
+    case TypeColumn:
+      return tr( "Type" );
+    case DateColumn:
+      return tr( "Date Modified" );
+  }
+  return QVariant();
+}
+
+/*!
+   \param index the model index
+   \return flags of the entry, files never have children
+ */
+Qt::ItemFlags fileSystemModel_c::flags( const QModelIndex &index ) const
+{
+  if ( !index.isValid() )
+    return Qt::NoItemFlags;
+
+  const Qt::ItemFlags itemFlags = Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+  return isDir( index ) ? itemFlags : itemFlags | Qt::ItemNeverHasChildren;
+}
+
+/*!
+   \param parent the model index of a folder, invalid for the root folder
+   \return true if the folder is not listed yet or has more entries than rows exposed
+ */
+bool fileSystemModel_c::canFetchMore( const QModelIndex &parent ) const
+{
+  const folderNode_s *node = _root.get();
+  if ( parent.isValid() )
+  {
+    if ( parent.column() > 0 || !isDir( parent ) )
+      return false;
+
+    node = childNode( nodeOf( parent ), parent.row() );
+    if ( node == nullptr )
+      return true;
+  }
+
+  return node != nullptr && ( node->state != listingState_e::Listed ||
+                              node->rowCount < static_cast<int>( node->rows.size() ) );
+}
+
+/*!
+   Starts listing a folder at \a parent, or exposes another chunk of its listed entries
+   If all the listed entries are exposed already, the next entries are exposed as soon as they arrive.
+   \param parent the model index of the folder, invalid for the root folder
+ */
+void fileSystemModel_c::fetchMore( const QModelIndex &parent )
+{
+  folderNode_s *node = _root.get();
+  if ( parent.isValid() )
+  {
+    if ( parent.column() > 0 || !isDir( parent ) )
+      return;
+
+    node = createChild( nodeOf( parent ), parent.row() );
+  }
+
+  if ( node == nullptr )
+    return;
+
+  if ( node->state == listingState_e::Unlisted )
+    startListing( node );
+  else if ( node->rowCount < static_cast<int>( node->rows.size() ) )
+    insertRows( node, fetchChunkSize );
+  else if ( node->state == listingState_e::Listing )
+    node->fetchPending = true;
+}
+
+/*!
+   Sorts the entries of every listed folder by a column \a column, folders first
+   The sorting runs on a worker, folders listed later are sorted once listed.
+   \param column the column, -1 for the name
+   \param order the sort order
+ */
+void fileSystemModel_c::sort( int column, Qt::SortOrder order )
+{
+  _sortColumn = ( column >= 0 && column < ColumnCount ) ? column : NameColumn;
+  _sortOrder = order;
+  _sortGeneration++;
+
+  for ( folderNode_s *node : qAsConst( _nodes ) )
+  {
+    if ( node->state == listingState_e::Listed )
+      startSort( node );
+  }
+}
+
+/*!
+   Shows a folder given at \a path, dropping all the listed folders
+   \param path path to the folder
+   \return the model index of the folder, always invalid as the folder is the root of the model
+ */
+QModelIndex fileSystemModel_c::setRootPath( const QString &path )
+{
+  beginResetModel();
+  if ( _root )
+    unregisterNode( _root.get() );
+  _rootPath = QDir::cleanPath( QFileInfo( path ).absoluteFilePath() );
+  _root = createNode( _rootPath, nullptr, 0 );
+  endResetModel();
+
+  startListing( _root.get() );
+  return QModelIndex();
+}
+
+/*!
+   \return absolute path to the shown folder
+ */
+QString fileSystemModel_c::rootPath() const
+{
+  return _rootPath;
+}
+
+/*!
+   \return the shown folder
+ */
+QDir fileSystemModel_c::rootDirectory() const
+{
+  return QDir( _rootPath );
+}
+
+/*!
+   \param path absolute path to an entry below the shown folder
+   \param column the column
+   \return the model index of the entry, invalid for the shown folder itself or an entry not exposed as a row
+ */
+QModelIndex fileSystemModel_c::index( const QString &path, int column ) const
+{
+  const QString cleanPath = QDir::cleanPath( path );
+  if ( !_root || cleanPath == _rootPath || !fileInspector_n::util_n::isWithinFolder( cleanPath, _rootPath ) )
+    return QModelIndex();
+
+  const QStringList components = QDir( _rootPath ).relativeFilePath( cleanPath ).split( '/', Qt::SkipEmptyParts );
+  const folderNode_s *node = _root.get();
+  for ( int componentIndex = 0; node != nullptr && componentIndex < components.size(); componentIndex++ )
+  {
+    const int entry = findEntry( node, components.at( componentIndex ) );
+    const int row = ( entry >= 0 ) ? rowOfEntry( node, entry ) : -1;
+    if ( row < 0 || row >= node->rowCount )
+      return QModelIndex();
+
+    if ( componentIndex == components.size() - 1 )
+      return createIndex( row, column, const_cast<folderNode_s *>( node ) );
+
+    node = childNode( node, row );
+  }
+
+  return QModelIndex();
+}
+
+/*!
+   \param index the model index of an entry
+   \return absolute path to the entry, empty for an invalid index
+ */
+QString fileSystemModel_c::filePath( const QModelIndex &index ) const
+{
+  if ( !index.isValid() )
+    return QString();
+
+  const folderNode_s *node = nodeOf( index );
+  const QString name = node->names.toString( static_cast<int>( node->rows[ static_cast<size_t>( index.row() ) ] ) );
+  return node->path.endsWith( '/' ) ? node->path + name : node->path + '/' + name;
+}
+
+/*!
+   \param index the model index of an entry
+   \return true if the entry is a folder
+ */
+bool fileSystemModel_c::isDir( const QModelIndex &index ) const
+{
+  if ( !index.isValid() )
+    return false;
+
+  const folderNode_s *node = nodeOf( index );
+  return ( node->flags[ node->rows[ static_cast<size_t>( index.row() ) ] ] & Directory ) != 0;
+}
+
+/*!
+   Makes an entry given at \a path reachable through \em index, listing the folders along the path
+   The folders are listed on a worker, one at a time, \em directoryLoaded is emitted for each of them. Calling
+   again once a folder is listed proceeds with the next one.
+   \param path absolute path to the entry
+   \return true if the entry is exposed as a row, false if a folder along the path is still to be listed or the
+   entry does not exist
+ */
+bool fileSystemModel_c::fetchPath( const QString &path )
+{
+  const QString cleanPath = QDir::cleanPath( path );
+  if ( !_root || cleanPath == _rootPath || !fileInspector_n::util_n::isWithinFolder( cleanPath, _rootPath ) )
+    return false;
+
+  const QStringList components = QDir( _rootPath ).relativeFilePath( cleanPath ).split( '/', Qt::SkipEmptyParts );
+  folderNode_s *node = _root.get();
+  for ( int componentIndex = 0; componentIndex < components.size(); componentIndex++ )
+  {
+    if ( node->state == listingState_e::Unlisted )
+      startListing( node );
+    if ( node->state != listingState_e::Listed )
+      return false;
+
+    const int entry = findEntry( node, components.at( componentIndex ) );
+    if ( entry < 0 )
+      return false;
+
+    const int row = rowOfEntry( node, entry );
+    if ( row >= node->rowCount )
+      insertRows( node, row + 1 - node->rowCount );
+
+    if ( componentIndex == components.size() - 1 )
+      return true;
+
+    node = createChild( node, row );
+    if ( node == nullptr )
+      return false;
+  }
+
+  return false;
+}
+
+/*!
+   Lists again a listed folder given at \a path, on a worker
+   The listing is compared with the entries on the worker, rows of the removed entries are removed and rows of the
+   new entries are inserted at their sorted positions. The entries with a known size and date are stat-ed again,
+   their rows are updated if changed.
+   \param path absolute path to the folder
+ */
+void fileSystemModel_c::refreshDirectory( const QString &path )
+{
+  folderNode_s *node = findNode( QDir::cleanPath( path ) );
+  if ( node == nullptr || node->state != listingState_e::Listed )
+    return;
+
+  nameArena_c knownNames;
+  std::vector<quint8> knownFlags;
+  knownFlags.reserve( node->rows.size() );
+  for ( const quint32 entry : node->rows )
+  {
+    knownNames.append( node->names.name( static_cast<int>( entry ) ), node->names.length( static_cast<int>( entry ) ) );
+    knownFlags.push_back( node->flags[ entry ] );
+  }
+
+  const quint64 id = node->id;
+  const QString folderPath = node->path;
+  QtConcurrent::run( &_workerPool, [this, id, folderPath, knownNames, knownFlags]()
+  {
+    dirLister_c lister;
+    lister.list( folderPath );
+
+    // listed entries by name, whether a folder; those known are dropped, the rest are new
+    const nameArena_c &listedNames = lister.names();
+    std::unordered_map<std::string_view, bool> listedEntries;
+    listedEntries.reserve( static_cast<size_t>( lister.count() ) );
+    for ( int entry = 0; entry < lister.count(); entry++ )
+    {
+      listedEntries.emplace( nameView( listedNames, static_cast<quint32>( entry ) ),
+                             lister.type( entry ) == dirLister_c::entryType_e::Directory );
+    }
+
+    nameArena_c changedNames;
+    for ( int entry = 0; entry < knownNames.size(); entry++ )
+    {
+      const quint8 entryFlags = knownFlags[ static_cast<size_t>( entry ) ];
+      const auto listedIt = listedEntries.find( nameView( knownNames, static_cast<quint32>( entry ) ) );
+      if ( listedIt == listedEntries.end() || listedIt->second != ( ( entryFlags & Directory ) != 0 ) ||
+           ( entryFlags & Stated ) )
+        changedNames.append( knownNames.name( entry ), knownNames.length( entry ) );
+      if ( listedIt != listedEntries.end() )
+        listedEntries.erase( listedIt );
+    }
+    for ( const auto &listedEntry : listedEntries )
+      changedNames.append( listedEntry.first.data(), static_cast<int>( listedEntry.first.size() ) );
+
+    resolveRefresh( id, folderPath, changedNames );
+  } );
+}
+
+/*!
+   Brings entries named \a names of a listed folder given at \a path up to date, on a worker
+   Rows of the removed entries are removed, rows of the new entries are inserted at their sorted positions, the
+   sizes and dates of the rest are stat-ed again.
+   \param path absolute path to the folder
+   \param names names of the changed entries
+ */
+void fileSystemModel_c::refreshEntries( const QString &path, const QStringList &names )
+{
+  folderNode_s *node = findNode( QDir::cleanPath( path ) );
+  if ( node == nullptr || node->state != listingState_e::Listed || names.isEmpty() )
+    return;
+
+  nameArena_c entryNames;
+  for ( const QString &name : names )
+  {
+    const QByteArray encodedName = QFile::encodeName( name );
+    entryNames.append( encodedName.constData(), encodedName.size() );
+  }
+
+  const quint64 id = node->id;
+  const QString folderPath = node->path;
+  QtConcurrent::run( &_workerPool, [this, id, folderPath, entryNames]()
+  {
+    resolveRefresh( id, folderPath, entryNames );
+  } );
+}
+
+/*!
+   Sets a recursive size \a size of a folder given at \a path
+   The known sizes are forgotten once there are too many of them, so browsing many scanned folders does not grow
+   the model without bounds.
+   \param path absolute path to the folder
+   \param size the size in bytes
+ */
+void fileSystemModel_c::setFolderSize( const QString &path, qint64 size )
+{
+  if ( _folderSizes.size() >= maximumFolderSizes && !_folderSizes.contains( path ) )
+    _folderSizes.clear();
+  _folderSizes.insert( path, size );
+
+  const QModelIndex sizeIndex = index( path, sizeColumn );
+  if ( sizeIndex.isValid() )
+    emit dataChanged( sizeIndex, sizeIndex, { Qt::DisplayRole } );
+}
+
+/*!
+   Forgets all the folder sizes
+ */
+void fileSystemModel_c::clearFolderSizes()
+{
+  _folderSizes.clear();
+}
+
+/*!
+   Sets an index \a scanIndex of a previous scan to take folder sizes from
+   Sizes set by \em setFolderSize take precedence over the index.
+   \param scanIndex the index, may be empty
+ */
+void fileSystemModel_c::setScanIndex( const std::shared_ptr<const scanIndex_c> &scanIndex )
+{
+  _scanIndex = scanIndex;
+
+  const int rows = rowCount();
+  if ( rows > 0 )
+    emit dataChanged( index( 0, sizeColumn ), index( rows - 1, sizeColumn ), { Qt::DisplayRole } );
+}
+
+/*!
+   \return index of a previous scan, may be empty
+ */
+const std::shared_ptr<const scanIndex_c> &fileSystemModel_c::scanIndex() const
+{
+  return _scanIndex;
+}
+
+/*!
+   Creates and registers a node of a folder given at \a path
+   \param path absolute path to the folder
+   \param parent node of the folder containing this one, nullptr for the root
+   \param row row of the folder within its parent
+   \return the node
+ */
+std::unique_ptr<fileSystemModel_c::folderNode_s> fileSystemModel_c::createNode( const QString &path,
+                                                                                folderNode_s *parent, int row )
+{
+  auto node = std::make_unique<folderNode_s>();
+  node->id = _nextNodeId++;
+  node->path = path;
+  node->parent = parent;
+  node->row = row;
+  _nodes.insert( node->id, node.get() );
+  return node;
+}
+
+/*!
+   Stops the listing of a node \a node and of its descendants and unregisters them, results of the workers are
+   dropped from now on
+   \param node the node
+ */
+void fileSystemModel_c::unregisterNode( folderNode_s *node )
+{
+  for ( auto &child : node->children )
+    unregisterNode( child.second.get() );
+
+  if ( node->cancelled )
+    node->cancelled->store( true );
+  _nodes.remove( node->id );
+  _statQueue.remove( node->id );
+}
+
+/*!
+   \param index the model index of an entry
+   \return node of the folder containing the entry
+ */
+fileSystemModel_c::folderNode_s *fileSystemModel_c::nodeOf( const QModelIndex &index ) const
+{
+  return static_cast<folderNode_s *>( index.internalPointer() );
+}
+
+/*!
+   \param node node of a folder
+   \param row row of a sub-folder
+   \return node of the sub-folder, nullptr if not created yet or the entry is a file
+ */
+fileSystemModel_c::folderNode_s *fileSystemModel_c::childNode( const folderNode_s *node, int row ) const
+{
+  if ( node == nullptr || row < 0 || row >= static_cast<int>( node->rows.size() ) )
+    return nullptr;
+
+  const auto childIt = node->children.find( node->rows[ static_cast<size_t>( row ) ] );
+  return ( childIt != node->children.end() ) ? childIt->second.get() : nullptr;
+}
+
+/*!
+   \param node node of a folder
+   \param row row of a sub-folder
+   \return node of the sub-folder, created unlisted if not created yet, nullptr if the entry is a file
+ */
+fileSystemModel_c::folderNode_s *fileSystemModel_c::createChild( folderNode_s *node, int row )
+{
+  folderNode_s *child = childNode( node, row );
+  if ( child != nullptr || node == nullptr || row < 0 || row >= static_cast<int>( node->rows.size() ) )
+    return child;
+
+  const quint32 entry = node->rows[ static_cast<size_t>( row ) ];
+  if ( !( node->flags[ entry ] & Directory ) )
+    return nullptr;
+
+  const QString name = node->names.toString( static_cast<int>( entry ) );
+  auto newChild = createNode( node->path.endsWith( '/' ) ? node->path + name : node->path + '/' + name, node, row );
+  child = newChild.get();
+  node->children.emplace( entry, std::move( newChild ) );
+  return child;
+}
+
+/*!
+   \param path absolute path to a folder
+   \return node of the folder, nullptr if the folder is not the shown one or one of its listed sub-folders
+ */
+fileSystemModel_c::folderNode_s *fileSystemModel_c::findNode( const QString &path ) const
+{
+  if ( !_root || !fileInspector_n::util_n::isWithinFolder( path, _rootPath ) )
+    return nullptr;
+
+  folderNode_s *node = _root.get();
+  if ( path == _rootPath )
+    return node;
+
+  const QStringList components = QDir( _rootPath ).relativeFilePath( path ).split( '/', Qt::SkipEmptyParts );
+  for ( const QString &component : components )
+  {
+    const int entry = findEntry( node, component );
+    if ( entry < 0 )
+      return nullptr;
+
+    const auto childIt = node->children.find( static_cast<quint32>( entry ) );
+    if ( childIt == node->children.end() )
+      return nullptr;
+    node = childIt->second.get();
+  }
+
+  return node;
+}
+
+/*!
+   \param node node of a folder
+   \return the model index of the folder, invalid for the root
+ */
+QModelIndex fileSystemModel_c::nodeIndex( const folderNode_s *node ) const
+{
+  if ( node == nullptr || node->parent == nullptr )
+    return QModelIndex();
+
+  return createIndex( node->row, 0, node->parent );
+}
+
+/*!
+   \param node node of a folder
+   \param name name of an entry
+   \return index of the entry named \a name, -1 if none
+ */
+int fileSystemModel_c::findEntry( const folderNode_s *node, const QString &name ) const
+{
+  const QByteArray encodedName = QFile::encodeName( name );
+  return findEntry( node, std::string_view( encodedName.constData(), static_cast<size_t>( encodedName.size() ) ) );
+}
+
+/*!
+   \param node node of a folder
+   \param name encoded name of an entry
+   \return index of the entry named \a name, -1 if none or removed
+ */
+int fileSystemModel_c::findEntry( const folderNode_s *node, std::string_view name ) const
+{
+  const auto entryRange = node->entryHashes.equal_range( nameHash( name ) );
+  for ( auto entryIt = entryRange.first; entryIt != entryRange.second; ++entryIt )
+  {
+    if ( nameView( node->names, entryIt->second ) == name )
+      return static_cast<int>( entryIt->second );
+  }
+  return -1;
+}
+
+/*!
+   \param node node of a folder
+   \param entry index of an entry
+   \return row of the entry, may be past the exposed rows, -1 if none
+ */
+int fileSystemModel_c::rowOfEntry( const folderNode_s *node, int entry ) const
+{
+  return ( entry >= 0 && entry < static_cast<int>( node->entryRows.size() ) ) ?
+         node->entryRows[ static_cast<size_t>( entry ) ] : -1;
+}
+
+/*!
+   Adds an entry named \a name of flags \a flags to a node \a node, without a row
+   \param node the node
+   \param name the name, does not need to be NUL terminated
+   \param length length of the name in bytes
+   \param flags flags of the entry
+   \return index of the entry
+ */
+quint32 fileSystemModel_c::addEntry( folderNode_s *node, const char *name, int length, quint8 flags )
+{
+  const auto entry = static_cast<quint32>( node->names.append( name, length ) );
+  node->flags.push_back( flags );
+  node->sizes.push_back( 0 );
+  node->modified.push_back( -1 );
+  node->entryRows.push_back( -1 );
+  node->entryHashes.emplace( nameHash( std::string_view( name, static_cast<size_t>( length ) ) ), entry );
+  return entry;
+}
+
+/*!
+   Inserts a row of an entry \a entry of a node \a node at its sorted position
+   The row is exposed unless it falls among the rows of the shown folder a view did not fetch yet.
+   \param node the node
+   \param entry index of the entry
+ */
+void fileSystemModel_c::insertEntryRow( folderNode_s *node, quint32 entry )
+{
+  const auto rowIt = std::upper_bound( node->rows.begin(), node->rows.end(), entry,
+                                       [this, node]( quint32 first, quint32 second )
+  {
+    return sortsBefore( node->names, node->flags, node->sizes, node->modified, _sortColumn, _sortOrder, first,
+                        second );
+  } );
+  const int row = static_cast<int>( rowIt - node->rows.begin() );
+  const bool exposed = ( row < node->rowCount || node->rowCount == static_cast<int>( node->rows.size() ) );
+
+  if ( exposed )
+    beginInsertRows( nodeIndex( node ), row, row );
+  node->rows.insert( rowIt, entry );
+  if ( exposed )
+    node->rowCount++;
+  renumberRows( node, row );
+  if ( exposed )
+    endInsertRows();
+}
+
+/*!
+   Removes an entry \a entry of a node \a node and its row
+   The name stays in the arena until the entries are compacted, see \em compactEntries.
+   \param node the node
+   \param entry index of the entry
+ */
+void fileSystemModel_c::removeEntry( folderNode_s *node, quint32 entry )
+{
+  const int row = node->entryRows[ entry ];
+  const bool exposed = ( row < node->rowCount );
+
+  if ( exposed )
+    beginRemoveRows( nodeIndex( node ), row, row );
+  const auto childIt = node->children.find( entry );
+  if ( childIt != node->children.end() )
+  {
+    unregisterNode( childIt->second.get() );
+    node->children.erase( childIt );
+  }
+  node->rows.erase( node->rows.begin() + row );
+  if ( exposed )
+    node->rowCount--;
+  node->entryRows[ entry ] = -1;
+  renumberRows( node, row );
+  if ( exposed )
+    endRemoveRows();
+
+  const auto entryRange = node->entryHashes.equal_range( nameHash( nameView( node->names, entry ) ) );
+  for ( auto entryIt = entryRange.first; entryIt != entryRange.second; ++entryIt )
+  {
+    if ( entryIt->second == entry )
+    {
+      node->entryHashes.erase( entryIt );
+      break;
+    }
+  }
+  node->flags[ entry ] = Removed;
+  node->removedCount++;
+}
+
+/*!
+   Updates the rows by entry of a node \a node and the rows of its sub-folders once its rows from \a firstRow on
+   moved
+   \param node the node
+   \param firstRow the first moved row
+ */
+void fileSystemModel_c::renumberRows( folderNode_s *node, int firstRow )
+{
+  for ( size_t row = static_cast<size_t>( firstRow ); row < node->rows.size(); row++ )
+    node->entryRows[ node->rows[ row ] ] = static_cast<int>( row );
+  for ( auto &child : node->children )
+    child.second->row = node->entryRows[ child.first ];
+}
+
+/*!
+   Drops the names of the removed entries of a node \a node, renumbering the rest
+   The renumbering makes results of the workers started before stale, the entries to stat are stat-ed again once
+   shown and the entries are sorted again.
+   \param node the node
+ */
+void fileSystemModel_c::compactEntries( folderNode_s *node )
+{
+  std::vector<quint32> renumbered( node->flags.size(), 0 );
+  nameArena_c keptNames;
+  std::vector<quint8> keptFlags;
+  std::vector<qint64> keptSizes;
+  std::vector<qint64> keptModified;
+  for ( int entry = 0; entry < node->names.size(); entry++ )
+  {
+    const size_t oldEntry = static_cast<size_t>( entry );
+    if ( node->flags[ oldEntry ] & Removed )
+      continue;
+
+    renumbered[ oldEntry ] =
+      static_cast<quint32>( keptNames.append( node->names.name( entry ), node->names.length( entry ) ) );
+    keptFlags.push_back( static_cast<quint8>( node->flags[ oldEntry ] & ~StatQueued ) );
+    keptSizes.push_back( node->sizes[ oldEntry ] );
+    keptModified.push_back( node->modified[ oldEntry ] );
+  }
+
+  for ( quint32 &entry : node->rows )
+    entry = renumbered[ entry ];
+
+  std::unordered_map<quint32, std::unique_ptr<folderNode_s>> children;
+  for ( auto &child : node->children )
+    children.emplace( renumbered[ child.first ], std::move( child.second ) );
+
+  node->names = std::move( keptNames );
+  node->flags = std::move( keptFlags );
+  node->sizes = std::move( keptSizes );
+  node->modified = std::move( keptModified );
+  node->children = std::move( children );
+  node->removedCount = 0;
+  node->entryHashes.clear();
+  for ( quint32 entry = 0; entry < node->flags.size(); entry++ )
+    node->entryHashes.emplace( nameHash( nameView( node->names, entry ) ), entry );
+  node->entryRows.assign( node->flags.size(), -1 );
+  renumberRows( node, 0 );
+
+  node->generation++;
+  _statQueue.remove( node->id );
+  startSort( node );
+}
+
+/*!
+   Lists a folder of a node \a node on a worker
+   The entries are delivered after every listed batch, see \em appendEntries.
+   \param node the node
+ */
+void fileSystemModel_c::startListing( folderNode_s *node )
+{
+  node->state = listingState_e::Listing;
+  node->cancelled = std::make_shared<std::atomic<bool>>( false );
+  perfTracer_c &tracer = perfTracer_c::instance();
+  node->listingStart = tracer.isEnabled() ? tracer.now() : -1;
+
+  const quint64 id = node->id;
+  const quint64 generation = node->generation;
+  const QString folderPath = node->path;
+  const std::shared_ptr<std::atomic<bool>> cancelled = node->cancelled;
+  QtConcurrent::run( &_workerPool, [this, id, generation, folderPath, cancelled]()
+  {
+    dirLister_c lister;
+    int delivered = 0;
+
+    const auto deliver = [&]()
+    {
+      const nameArena_c &listedNames = lister.names();
+      nameArena_c names;
+      std::vector<quint8> flags;
+      flags.reserve( static_cast<size_t>( lister.count() - delivered ) );
+      for ( int entry = delivered; entry < lister.count(); entry++ )
+      {
+        names.append( listedNames.name( entry ), listedNames.length( entry ) );
+        flags.push_back( ( lister.type( entry ) == dirLister_c::entryType_e::Directory ) ? Directory : 0 );
+      }
+      delivered = lister.count();
+
+      QMetaObject::invokeMethod( this, [this, id, generation, names, flags]()
+      {
+        appendEntries( id, generation, names, flags );
+      }, Qt::QueuedConnection );
+    };
+
+    lister.list( folderPath, -1, [&]()
+    {
+      if ( *cancelled )
+        return false;
+      if ( lister.count() > delivered )
+        deliver();
+      return true;
+    } );
+
+    if ( *cancelled )
+      return;
+    if ( lister.count() > delivered )
+      deliver();
+
+    QMetaObject::invokeMethod( this, [this, id, generation]()
+    {
+      finishListing( id, generation );
+    }, Qt::QueuedConnection );
+  } );
+}
+
+/*!
+   Appends a listed batch of entries \a names of types \a flags to a node identified by \a id
+   Rows are added right away while the first chunk is not complete, for a sub-folder, or if a view asked for
+   more in the meantime.
+   \param id id of the node
+   \param generation generation of the node at the listing start
+   \param names names of the entries
+   \param flags flags of the entries
+ */
+void fileSystemModel_c::appendEntries( quint64 id, quint64 generation, const nameArena_c &names,
+                                       const std::vector<quint8> &flags )
+{
+  folderNode_s *node = _nodes.value( id );
+  if ( node == nullptr || node->generation != generation || node->state != listingState_e::Listing )
+    return;
+
+  for ( int entry = 0; entry < names.size(); entry++ )
+  {
+    const quint32 addedEntry = addEntry( node, names.name( entry ), names.length( entry ),
+                                         flags[ static_cast<size_t>( entry ) ] );
+    node->entryRows[ addedEntry ] = static_cast<int>( node->rows.size() );
+    node->rows.push_back( addedEntry );
+  }
+
+  // a view fetches more rows of the shown folder only, rows of sub-folders are exposed as they arrive
+  if ( node->parent != nullptr )
+  {
+    insertRows( node, static_cast<int>( node->rows.size() ) );
+  }
+  else if ( node->rowCount < fetchChunkSize || node->fetchPending )
+  {
+    node->fetchPending = false;
+    insertRows( node, fetchChunkSize - node->rowCount % fetchChunkSize );
+  }
+}
+
+/*!
+   Completes the listing of a node identified by \a id and starts sorting it
+   \param id id of the node
+   \param generation generation of the node at the listing start
+ */
+void fileSystemModel_c::finishListing( quint64 id, quint64 generation )
+{
+  folderNode_s *node = _nodes.value( id );
+  if ( node == nullptr || node->generation != generation || node->state != listingState_e::Listing )
+    return;
+
+  node->state = listingState_e::Listed;
+  node->cancelled.reset();
+  node->fetchPending = false;
+  if ( node->listingStart >= 0 )
+  {
+    perfTracer_c &tracer = perfTracer_c::instance();
+    tracer.record( perfTracer_c::operation_e::ModelPopulation, node->listingStart,
+                   tracer.now() - node->listingStart );
+    node->listingStart = -1;
+  }
+
+  if ( node->rows.empty() && node->parent != nullptr )
+  {
+    // the view drops the expansion indicator
+    const QModelIndex folderIndex = nodeIndex( node );
+    emit dataChanged( folderIndex, folderIndex );
+  }
+
+  emit directoryLoaded( node->path );
+  startSort( node );
+}
+
+/*!
+   Looks up entries \a names of a node identified by \a id, runs on a worker, the result is applied by
+   \em applyRefresh
+   \param id id of the node
+   \param folderPath absolute path to the folder of the node
+   \param names names of the entries
+ */
+void fileSystemModel_c::resolveRefresh( quint64 id, const QString &folderPath, const nameArena_c &names )
+{
+  if ( names.size() == 0 )
+    return;
+
+  std::vector<bool> exists;
+  std::vector<bool> isDirectory;
+  std::vector<qint64> sizes;
+  std::vector<qint64> modified;
+  lookUpEntries( folderPath, names, exists, isDirectory, sizes, modified );
+
+  std::vector<quint8> flags( exists.size(), Removed );
+  for ( size_t entry = 0; entry < flags.size(); entry++ )
+  {
+    if ( exists[ entry ] )
+      flags[ entry ] = static_cast<quint8>( isDirectory[ entry ] ? Directory | Stated : Stated );
+  }
+
+  QMetaObject::invokeMethod( this, [this, id, names, flags, sizes, modified]()
+  {
+    applyRefresh( id, names, flags, sizes, modified );
+  }, Qt::QueuedConnection );
+}
+
+/*!
+   Brings entries \a names of a node identified by \a id up to date
+   Removed entries and entries whose type changed lose their rows, new entries get rows at their sorted positions,
+   rows of the entries whose size or date changed are updated. The rows are sorted again only if sorted by size or
+   date and such an entry changed. The entries are matched by name, so the result stays valid once the entries
+   are renumbered.
+   \param id id of the node
+   \param names names of the entries
+   \param flags flags of the entries, Removed for the entries not found
+   \param sizes sizes of the entries
+   \param modified modification times of the entries
+ */
+void fileSystemModel_c::applyRefresh( quint64 id, const nameArena_c &names, const std::vector<quint8> &flags,
+                                      const std::vector<qint64> &sizes, const std::vector<qint64> &modified )
+{
+  folderNode_s *node = _nodes.value( id );
+  if ( node == nullptr || node->state != listingState_e::Listed )
+    return;
+
+  std::vector<quint32> changedEntries;
+  for ( int index = 0; index < names.size(); index++ )
+  {
+    const size_t refreshed = static_cast<size_t>( index );
+    const bool exists = !( flags[ refreshed ] & Removed );
+    int entry = findEntry( node, nameView( names, static_cast<quint32>( index ) ) );
+    const bool typeChanged = ( entry >= 0 && ( node->flags[ static_cast<size_t>( entry ) ] & Directory ) !=
+                                             ( flags[ refreshed ] & Directory ) );
+    if ( entry >= 0 && ( !exists || typeChanged ) )
+    {
+      removeEntry( node, static_cast<quint32>( entry ) );
+      entry = -1;
+    }
+    if ( !exists )
+      continue;
+
+    if ( entry < 0 )
+    {
+      const quint32 addedEntry = addEntry( node, names.name( index ), names.length( index ), flags[ refreshed ] );
+      node->sizes[ addedEntry ] = sizes[ refreshed ];
+      node->modified[ addedEntry ] = modified[ refreshed ];
+      insertEntryRow( node, addedEntry );
+      continue;
+    }
+
+    const auto keptEntry = static_cast<quint32>( entry );
+    if ( ( node->flags[ keptEntry ] & Stated ) && node->sizes[ keptEntry ] == sizes[ refreshed ] &&
+         node->modified[ keptEntry ] == modified[ refreshed ] )
+      continue;
+
+    node->sizes[ keptEntry ] = sizes[ refreshed ];
+    node->modified[ keptEntry ] = modified[ refreshed ];
+    node->flags[ keptEntry ] |= Stated;
+    changedEntries.push_back( keptEntry );
+  }
+
+  int firstChangedRow = node->rowCount;
+  int lastChangedRow = -1;
+  for ( const quint32 entry : changedEntries )
+  {
+    const int row = node->entryRows[ entry ];
+    if ( row >= 0 && row < node->rowCount )
+    {
+      firstChangedRow = qMin( firstChangedRow, row );
+      lastChangedRow = qMax( lastChangedRow, row );
+    }
+  }
+  if ( lastChangedRow >= 0 )
+  {
+    const QModelIndex folderIndex = nodeIndex( node );
+    emit dataChanged( index( firstChangedRow, SizeColumn, folderIndex ),
+                      index( lastChangedRow, DateColumn, folderIndex ), { Qt::DisplayRole } );
+  }
+
+  if ( node->removedCount > static_cast<int>( node->rows.size() ) )
+    compactEntries( node );
+  else if ( !changedEntries.empty() && ( _sortColumn == SizeColumn || _sortColumn == DateColumn ) )
+    startSort( node );
+}
+
+/*!
+   Exposes up to \a count more listed entries of a node \a node as rows
+   \param node the node
+   \param count number of the rows to add
+ */
+void fileSystemModel_c::insertRows( folderNode_s *node, int count )
+{
+  const int addedCount = qMin( count, static_cast<int>( node->rows.size() ) - node->rowCount );
+  if ( addedCount <= 0 )
+    return;
+
+  beginInsertRows( nodeIndex( node ), node->rowCount, node->rowCount + addedCount - 1 );
+  node->rowCount += addedCount;
+  endInsertRows();
+}
+
+/*!
+   Schedules a stat of an entry \a entry of a node \a node
+   The entries requested while a view paints are stat-ed together, see \em statQueuedEntries.
+   \param node the node
+   \param entry index of the entry
+ */
+void fileSystemModel_c::queueStat( folderNode_s *node, quint32 entry ) const
+{
+  if ( node->flags[ entry ] & StatQueued )
+    return;
+
+  node->flags[ entry ] |= StatQueued;
+  _statQueue[ node->id ].push_back( entry );
+  if ( !_statTimer->isActive() )
+    _statTimer->start();
+}
+
+/*!
+   Slot to stat the queued entries on a worker, a batch per folder
+ */
+void fileSystemModel_c::statQueuedEntries()
+{
+  for ( auto queueIt = _statQueue.cbegin(); queueIt != _statQueue.cend(); ++queueIt )
+  {
+    const folderNode_s *node = _nodes.value( queueIt.key() );
+    if ( node == nullptr )
+      continue;
+
+    const std::vector<quint32> &entries = queueIt.value();
+    nameArena_c names;
+    for ( const quint32 entry : entries )
+      names.append( node->names.name( static_cast<int>( entry ) ), node->names.length( static_cast<int>( entry ) ) );
+
+    const quint64 id = node->id;
+    const quint64 generation = node->generation;
+    const QString folderPath = node->path;
+    QtConcurrent::run( &_workerPool, [this, id, generation, folderPath, names, entries]()
+    {
+      std::vector<quint32> statedEntries( entries.size() );
+      std::iota( statedEntries.begin(), statedEntries.end(), 0 );
+      std::vector<qint64> sizes( entries.size(), 0 );
+      std::vector<qint64> modified( entries.size(), -1 );
+      statEntries( folderPath, names, statedEntries, sizes, modified );
+
+      QMetaObject::invokeMethod( this, [this, id, generation, entries, sizes, modified]()
+      {
+        applyStat( id, generation, entries, sizes, modified );
+      }, Qt::QueuedConnection );
+    } );
+  }
+
+  _statQueue.clear();
+}
+
+/*!
+   Stores stat-ed sizes \a sizes and dates \a modified of entries \a entries of a node identified by \a id
+   \param id id of the node
+   \param generation generation of the node when the stat was scheduled
+   \param entries indexes of the entries
+   \param sizes the sizes, in the order of the entries
+   \param modified the modification times, in the order of the entries
+ */
+void fileSystemModel_c::applyStat( quint64 id, quint64 generation, const std::vector<quint32> &entries,
+                                   const std::vector<qint64> &sizes, const std::vector<qint64> &modified )
+{
+  folderNode_s *node = _nodes.value( id );
+  if ( node == nullptr || node->generation != generation )
+    return;
+
+  for ( size_t index = 0; index < entries.size(); index++ )
+  {
+    const quint32 entry = entries[ index ];
+    node->sizes[ entry ] = sizes[ index ];
+    node->modified[ entry ] = modified[ index ];
+    node->flags[ entry ] = static_cast<quint8>( ( node->flags[ entry ] & ~StatQueued ) | Stated );
+  }
+
+  emitEntriesChanged( node );
+}
+
+/*!
+   Sorts the entries of a node \a node on a worker, the result is applied by \em applySort
+   Sorting by size or date stats the entries not stat-ed yet. The result is dropped if the model is sorted again
+   in the meantime.
+   \param node the node
+ */
+void fileSystemModel_c::startSort( folderNode_s *node )
+{
+  const quint64 id = node->id;
+  const quint64 generation = node->generation;
+  const quint64 sortGeneration = _sortGeneration;
+  const QString folderPath = node->path;
+  const int column = _sortColumn;
+  const Qt::SortOrder order = _sortOrder;
+  const nameArena_c names = node->names;
+  std::vector<quint8> flags = node->flags;
+  std::vector<quint32> rows = node->rows;
+  std::vector<qint64> sizes;
+  std::vector<qint64> modified;
+  if ( column == SizeColumn || column == DateColumn )
+  {
+    sizes = node->sizes;
+    modified = node->modified;
+  }
+
+  QtConcurrent::run( &_workerPool, [this, id, generation, sortGeneration, folderPath, column, order, names, flags,
+                                    rows, sizes, modified]() mutable
+  {
+    if ( column == SizeColumn || column == DateColumn )
+    {
+      std::vector<quint32> unstatedEntries;
+      for ( const quint32 entry : rows )
+      {
+        if ( !( flags[ entry ] & Stated ) )
+          unstatedEntries.push_back( entry );
+      }
+      statEntries( folderPath, names, unstatedEntries, sizes, modified );
+      for ( const quint32 entry : unstatedEntries )
+        flags[ entry ] |= Stated;
+    }
+
+    std::sort( rows.begin(), rows.end(), [&]( quint32 first, quint32 second )
+    {
+      return sortsBefore( names, flags, sizes, modified, column, order, first, second );
+    } );
+
+    QMetaObject::invokeMethod( this, [this, id, generation, sortGeneration, rows, sizes, modified, flags]()
+    {
+      if ( sortGeneration == _sortGeneration )
+        applySort( id, generation, rows, sizes, modified, flags );
+    }, Qt::QueuedConnection );
+  } );
+}
+
+/*!
+   Reorders the rows of a node identified by \a id to a sorted order \a rows, as a layout change
+   Entries removed since the sort started are dropped from the order, entries added since are inserted at their
+   sorted positions. Rows kept by a view past the exposed ones are exposed before the layout change.
+   \param id id of the node
+   \param generation generation of the node at the sort start
+   \param rows the entries in the sorted order
+   \param sizes sizes of the entries if stat-ed for the sort, otherwise empty
+   \param modified modification times of the entries if stat-ed for the sort, otherwise empty
+   \param flags flags of the entries at the sort start
+ */
+void fileSystemModel_c::applySort( quint64 id, quint64 generation, const std::vector<quint32> &rows,
+                                   const std::vector<qint64> &sizes, const std::vector<qint64> &modified,
+                                   const std::vector<quint8> &flags )
+{
+  folderNode_s *node = _nodes.value( id );
+  if ( node == nullptr || node->generation != generation )
+    return;
+
+  if ( !sizes.empty() )
+  {
+    for ( size_t entry = 0; entry < flags.size(); entry++ )
+    {
+      if ( ( flags[ entry ] & Stated ) && !( node->flags[ entry ] & ( Stated | Removed ) ) )
+      {
+        node->sizes[ entry ] = sizes[ entry ];
+        node->modified[ entry ] = modified[ entry ];
+        node->flags[ entry ] |= Stated;
+      }
+    }
+  }
+
+  std::vector<quint32> sortedRows;
+  sortedRows.reserve( node->rows.size() );
+  for ( const quint32 entry : rows )
+  {
+    if ( !( node->flags[ entry ] & Removed ) )
+      sortedRows.push_back( entry );
+  }
+  for ( const quint32 entry : node->rows )
+  {
+    if ( entry < flags.size() )
+      continue;
+
+    const auto rowIt = std::upper_bound( sortedRows.begin(), sortedRows.end(), entry,
+                                         [this, node]( quint32 first, quint32 second )
+    {
+      return sortsBefore( node->names, node->flags, node->sizes, node->modified, _sortColumn, _sortOrder, first,
+                          second );
+    } );
+    sortedRows.insert( rowIt, entry );
+  }
+  if ( sortedRows.size() != node->rows.size() )
+    return;
+
+  std::vector<int> rowOf( node->flags.size(), -1 );
+  for ( size_t row = 0; row < sortedRows.size(); row++ )
+    rowOf[ sortedRows[ row ] ] = static_cast<int>( row );
+
+  // an entry kept by a view stays exposed, the rows needed are inserted before the layout change
+  const QModelIndexList persistentIndexes = persistentIndexList();
+  int exposedCount = node->rowCount;
+  for ( const QModelIndex &persistentIndex : persistentIndexes )
+  {
+    if ( nodeOf( persistentIndex ) == node )
+      exposedCount = qMax( exposedCount, rowOf[ node->rows[ static_cast<size_t>( persistentIndex.row() ) ] ] + 1 );
+  }
+  for ( const auto &child : node->children )
+    exposedCount = qMax( exposedCount, rowOf[ child.first ] + 1 );
+  insertRows( node, exposedCount - node->rowCount );
+
+  QList<QPersistentModelIndex> parents;
+  if ( node->parent != nullptr )
+    parents.append( nodeIndex( node ) );
+  emit layoutAboutToBeChanged( parents, QAbstractItemModel::VerticalSortHint );
+
+  const std::vector<quint32> previousRows = node->rows;
+  node->rows = std::move( sortedRows );
+  node->entryRows = std::move( rowOf );
+  for ( const QModelIndex &persistentIndex : persistentIndexList() )
+  {
+    if ( nodeOf( persistentIndex ) != node )
+      continue;
+
+    const int row = node->entryRows[ previousRows[ static_cast<size_t>( persistentIndex.row() ) ] ];
+    changePersistentIndex( persistentIndex, createIndex( row, persistentIndex.column(), node ) );
+  }
+  renumberRows( node, static_cast<int>( node->rows.size() ) );
+
+  emit layoutChanged( parents, QAbstractItemModel::VerticalSortHint );
+}
+
+/*!
+   Notifies the views of changed sizes, types and dates of the exposed entries of a node \a node
+   \param node the node
+ */
+void fileSystemModel_c::emitEntriesChanged( folderNode_s *node )
+{
+  if ( node->rowCount == 0 )
+    return;
+
+  const QModelIndex folderIndex = nodeIndex( node );
+  emit dataChanged( index( 0, SizeColumn, folderIndex ), index( node->rowCount - 1, DateColumn, folderIndex ),
+                    { Qt::DisplayRole } );
+}
+
+/*!
+   Looks up a recursive size of a folder at \a index
+   \param index the model index
+   \param size the size in bytes, if known
+   \return false if the entry is not a folder or its size is not known
+ */
+bool fileSystemModel_c::folderSize( const QModelIndex &index, qint64 &size ) const
+{
+  if ( ( _folderSizes.isEmpty() && !_scanIndex ) || !isDir( index ) )
+    return false;
+
+  const QString path = filePath( index );
+  const auto folderSizeIt = _folderSizes.constFind( path );
+  if ( folderSizeIt != _folderSizes.constEnd() )
+  {
+    size = folderSizeIt.value();
+    return true;
+  }
+
+  if ( _scanIndex )
+  {
+    const quint32 id = _scanIndex->find( path );
+    if ( id != scanIndex_c::invalidId && ( _scanIndex->entry( id ).flags & scanIndex_c::Directory ) )
+    {
+      size = _scanIndex->entry( id ).size;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/*!
+   Compares entries \a first and \a second of a folder by a column \a column, folders first, by name if equal
+   \param names names of the entries
+   \param flags flags of the entries
+   \param sizes sizes of the entries, used when sorting by size only
+   \param modified modification times of the entries, used when sorting by date only
+   \param column the sort column
+   \param order the sort order
+   \param first index of the first entry
+   \param second index of the second entry
+   \return true if the first entry sorts before the second one
+ */
+bool fileSystemModel_c::sortsBefore( const nameArena_c &names, const std::vector<quint8> &flags,
+                                     const std::vector<qint64> &sizes, const std::vector<qint64> &modified, int column,
+                                     Qt::SortOrder order, quint32 first, quint32 second )
+{
+  const bool firstIsDirectory = ( flags[ first ] & Directory ) != 0;
+  if ( firstIsDirectory != ( ( flags[ second ] & Directory ) != 0 ) )
+    return firstIsDirectory;
+
+  int result = 0;
+  if ( column == SizeColumn && !firstIsDirectory )
+    result = ( sizes[ first ] < sizes[ second ] ) ? -1 : ( sizes[ first ] > sizes[ second ] ) ? 1 : 0;
+  else if ( column == DateColumn )
+    result = ( modified[ first ] < modified[ second ] ) ? -1 : ( modified[ first ] > modified[ second ] ) ? 1 : 0;
+  else if ( column == TypeColumn && !firstIsDirectory )
+    result = compareNames( suffixOf( nameView( names, first ) ), suffixOf( nameView( names, second ) ) );
+
+  if ( result == 0 )
+    result = compareNames( nameView( names, first ), nameView( names, second ) );
+  return ( order == Qt::AscendingOrder ) ? result < 0 : result > 0;
+}
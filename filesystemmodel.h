@@ -0,0 +1,211 @@
+#pragma once
+
+#include <QAbstractItemModel>
+#include <QDir>
+#include <QHash>
+#include <QIcon>
+#include <QThreadPool>
+
+#include <atomic>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "namearena.h"
+
+class QTimer;
+class scanIndex_c;
+
+/*!
+   Lazily populated model of a folder tree, showing recursive sizes of folders
+   Replaces \em QFileSystemModel, which stats every entry and keeps a heavyweight node per entry. A folder is listed
+   by \em dirLister_c on a worker thread and the entries are kept in a struct of arrays with the names in a
+   \em nameArena_c, about 25 bytes per entry besides the name. Listed entries are delivered in chunks, the view
+   receives them as rows through \em canFetchMore and \em fetchMore. An entry is stat-ed on a worker thread only
+   once a view asks for its size or date, i.e. once its row becomes visible. Sorting runs on a worker thread as
+   well, applied as a layout change once done.
+   The Size column of folders shows sizes computed by a folder size scan, falling back to the sizes stored in a
+   scan index. The model does not watch the folders, \em refreshEntries brings changed entries of a folder up to
+   date, \em refreshDirectory all of them. Both keep the known sizes and dates and the sorted order of the rows.
+ */
+class fileSystemModel_c : public QAbstractItemModel
+{
+  Q_OBJECT
+
+  public:
+    enum column_e
+    {
+      NameColumn,
+      SizeColumn,
+      TypeColumn,
+      DateColumn,
+      ColumnCount
+    };
+
+    // Column of the entry size
+    static constexpr int sizeColumn = SizeColumn;
+    // Number of rows a fetch adds to a folder
+    static constexpr int fetchChunkSize = 4096;
+
+  private:
+    enum entryFlag_e : quint8
+    {
+      Directory = 0x01,
+      // the size and the date are known
+      Stated = 0x02,
+      // a stat is scheduled
+      StatQueued = 0x04,
+      // the entry was removed, its name is kept until the entries are compacted
+      Removed = 0x08
+    };
+
+    enum class listingState_e
+    {
+      Unlisted,
+      Listing,
+      Listed
+    };
+
+    /*!
+       A listed folder
+       The entries are kept in the listing order, \em rows maps the rows to the entries.
+     */
+    struct folderNode_s
+    {
+      // Unique id, stays valid while the node exists
+      quint64 id = 0;
+      // Absolute path to the folder
+      QString path;
+      // The folder containing this one, nullptr for the root
+      folderNode_s *parent = nullptr;
+      // Row of the folder within its parent
+      int row = 0;
+      listingState_e state = listingState_e::Unlisted;
+      // Changes whenever the entries are renumbered, results of workers started before are dropped
+      quint64 generation = 0;
+      // Stops a listing in progress
+      std::shared_ptr<std::atomic<bool>> cancelled;
+      // Start of the traced listing, see perfTracer_c
+      qint64 listingStart = -1;
+      // Rows are added as soon as they arrive, a view asked for more while the listing was in progress
+      bool fetchPending = false;
+
+      // The entries
+      nameArena_c names;
+      std::vector<quint8> flags;
+      std::vector<qint64> sizes;
+      // Modification times in ms since epoch
+      std::vector<qint64> modified;
+
+      // Entries by the hash of their name, the removed entries excluded
+      std::unordered_multimap<size_t, quint32> entryHashes;
+      // Number of the removed entries
+      int removedCount = 0;
+
+      // Entries by row, the first rowCount of them are exposed
+      std::vector<quint32> rows;
+      int rowCount = 0;
+      // Rows by entry, -1 for the removed entries
+      std::vector<int> entryRows;
+      // Listed sub-folders by entry
+      std::unordered_map<quint32, std::unique_ptr<folderNode_s>> children;
+    };
+
+    // Absolute path to the folder the model shows
+    QString _rootPath;
+    std::unique_ptr<folderNode_s> _root;
+    // All the nodes by id, for the results of the workers
+    QHash<quint64, folderNode_s *> _nodes;
+    quint64 _nextNodeId;
+    // Workers listing, stat-ing and sorting
+    QThreadPool _workerPool;
+    // Entries to stat by node id
+    mutable QHash<quint64, std::vector<quint32>> _statQueue;
+    // Collects the entries to stat requested while painting
+    QTimer *_statTimer;
+    int _sortColumn;
+    Qt::SortOrder _sortOrder;
+    // Changes whenever the sort order changes, sort results of workers started before are dropped
+    quint64 _sortGeneration;
+    QIcon _folderIcon;
+    QIcon _fileIcon;
+    // Known recursive folder sizes by absolute path
+    QHash<QString, qint64> _folderSizes;
+    // Index of a previous scan
+    std::shared_ptr<const scanIndex_c> _scanIndex;
+
+  public:
+    fileSystemModel_c( QObject * = nullptr );
+    virtual ~fileSystemModel_c();
+
+    QModelIndex index( int, int, const QModelIndex & = QModelIndex() ) const override;
+    QModelIndex parent( const QModelIndex & ) const override;
+    int rowCount( const QModelIndex & = QModelIndex() ) const override;
+    int columnCount( const QModelIndex & = QModelIndex() ) const override;
+    bool hasChildren( const QModelIndex & = QModelIndex() ) const override;
+    QVariant data( const QModelIndex &, int = Qt::DisplayRole ) const override;
+    QVariant headerData( int, Qt::Orientation, int = Qt::DisplayRole ) const override;
+    Qt::ItemFlags flags( const QModelIndex & ) const override;
+    bool canFetchMore( const QModelIndex & ) const override;
+    void fetchMore( const QModelIndex & ) override;
+    void sort( int, Qt::SortOrder = Qt::AscendingOrder ) override;
+
+    QModelIndex setRootPath( const QString & );
+    QString rootPath() const;
+    QDir rootDirectory() const;
+    QModelIndex index( const QString &, int = 0 ) const;
+    QString filePath( const QModelIndex & ) const;
+    bool isDir( const QModelIndex & ) const;
+    bool fetchPath( const QString & );
+    void refreshDirectory( const QString & );
+    void refreshEntries( const QString &, const QStringList & );
+
+    void setFolderSize( const QString &, qint64 );
+    void clearFolderSizes();
+    void setScanIndex( const std::shared_ptr<const scanIndex_c> & );
+    const std::shared_ptr<const scanIndex_c> &scanIndex() const;
+
+  private:
+    std::unique_ptr<folderNode_s> createNode( const QString &, folderNode_s *, int );
+    void unregisterNode( folderNode_s * );
+    folderNode_s *nodeOf( const QModelIndex & ) const;
+    folderNode_s *childNode( const folderNode_s *, int ) const;
+    folderNode_s *createChild( folderNode_s *, int );
+    folderNode_s *findNode( const QString & ) const;
+    QModelIndex nodeIndex( const folderNode_s * ) const;
+    int findEntry( const folderNode_s *, const QString & ) const;
+    int findEntry( const folderNode_s *, std::string_view ) const;
+    int rowOfEntry( const folderNode_s *, int ) const;
+    quint32 addEntry( folderNode_s *, const char *, int, quint8 );
+    void insertEntryRow( folderNode_s *, quint32 );
+    void removeEntry( folderNode_s *, quint32 );
+    void renumberRows( folderNode_s *, int );
+    void compactEntries( folderNode_s * );
+
+    void startListing( folderNode_s * );
+    void appendEntries( quint64, quint64, const nameArena_c &, const std::vector<quint8> & );
+    void finishListing( quint64, quint64 );
+    void resolveRefresh( quint64, const QString &, const nameArena_c & );
+    void applyRefresh( quint64, const nameArena_c &, const std::vector<quint8> &, const std::vector<qint64> &,
+                       const std::vector<qint64> & );
+    void insertRows( folderNode_s *, int );
+
+    void queueStat( folderNode_s *, quint32 ) const;
+    void applyStat( quint64, quint64, const std::vector<quint32> &, const std::vector<qint64> &,
+                    const std::vector<qint64> & );
+    void startSort( folderNode_s * );
+    void applySort( quint64, quint64, const std::vector<quint32> &, const std::vector<qint64> &,
+                    const std::vector<qint64> &, const std::vector<quint8> & );
+    void emitEntriesChanged( folderNode_s * );
+    static bool sortsBefore( const nameArena_c &, const std::vector<quint8> &, const std::vector<qint64> &,
+                             const std::vector<qint64> &, int, Qt::SortOrder, quint32, quint32 );
+
+    bool folderSize( const QModelIndex &, qint64 & ) const;
+
+  private slots:
+    void statQueuedEntries();
+
+  signals:
+    void directoryLoaded( const QString & );
+};
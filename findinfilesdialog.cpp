@@ -0,0 +1,158 @@
+#include "findinfilesdialog.h"
+
+#include <QCheckBox>
+#include <QDir>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QLocale>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+#include "contentgrep.h"
+
+namespace
+{
+  // Item data role of the hit line number, the file path is stored under Qt::UserRole
+  constexpr int lineRole = Qt::UserRole + 1;
+}
+
+/*!
+   C-tor
+   \param folderPath absolute path to the searched folder
+   \param parent parent widget
+ */
+findInFilesDialog_c::findInFilesDialog_c( const QString &folderPath, QWidget *parent ) :
+  QDialog( parent ),
+  _folderPath{ folderPath },
+  _patternLine{ nullptr },
+  _regularExpressionBox{ nullptr },
+  _caseSensitiveBox{ nullptr },
+  _findButton{ nullptr },
+  _hitList{ nullptr },
+  _statusLabel{ nullptr },
+  _contentGrep{ nullptr }
+{
+  setAttribute( Qt::WA_DeleteOnClose );
+  setWindowTitle( tr( "Find in %1" ).arg( QDir::toNativeSeparators( folderPath ) ) );
+
+  _patternLine = new QLineEdit( this );
+  _patternLine->setPlaceholderText( tr( "Text to find" ) );
+  _regularExpressionBox = new QCheckBox( tr( "Regex" ), this );
+  _caseSensitiveBox = new QCheckBox( tr( "Match case" ), this );
+  _findButton = new QPushButton( tr( "Find" ), this );
+  _findButton->setDefault( true );
+
+  QHBoxLayout *patternLayout = new QHBoxLayout;
+  patternLayout->addWidget( _patternLine );
+  patternLayout->addWidget( _regularExpressionBox );
+  patternLayout->addWidget( _caseSensitiveBox );
+  patternLayout->addWidget( _findButton );
+
+  _hitList = new QListWidget( this );
+  _hitList->setUniformItemSizes( true );
+  _statusLabel = new QLabel( this );
+
+  QVBoxLayout *mainLayout = new QVBoxLayout;
+  mainLayout->addLayout( patternLayout );
+  mainLayout->addWidget( _hitList );
+  mainLayout->addWidget( _statusLabel );
+  setLayout( mainLayout );
+  resize( 720, 480 );
+
+  _contentGrep = new contentGrep_c( this );
+
+  connect( _findButton, &QPushButton::clicked, this, &findInFilesDialog_c::handleFindButton );
+  connect( _patternLine, &QLineEdit::returnPressed, this, &findInFilesDialog_c::handleFindButton );
+  connect( _hitList, &QListWidget::itemActivated, this, &findInFilesDialog_c::handleHitActivated );
+  connect( _contentGrep, &contentGrep_c::hitsFound, this, &findInFilesDialog_c::handleHits );
+  connect( _contentGrep, &contentGrep_c::progressUpdated, this, &findInFilesDialog_c::handleProgress );
+  connect( _contentGrep, &contentGrep_c::finished, this, &findInFilesDialog_c::handleFinished );
+}
+
+/*!
+   Slot to start a search of the pattern of \em _patternLine, or to stop the running one
+ */
+void findInFilesDialog_c::handleFindButton()
+{
+  if ( _contentGrep->isRunning() )
+  {
+    _contentGrep->cancel();
+    _findButton->setText( tr( "Find" ) );
+    _statusLabel->setText( tr( "Stopped, %1 hits" ).arg( QLocale().toString( _hitList->count() ) ) );
+    return;
+  }
+
+  grepRequest_s request;
+  request.folderPath = _folderPath;
+  request.pattern = _patternLine->text();
+  request.regularExpression = _regularExpressionBox->isChecked();
+  request.caseSensitive = _caseSensitiveBox->isChecked();
+
+  _hitList->clear();
+  if ( request.pattern.isEmpty() )
+  {
+    _statusLabel->clear();
+    return;
+  }
+
+  if ( !_contentGrep->start( request ) )
+  {
+    _statusLabel->setText( tr( "Invalid regular expression" ) );
+    return;
+  }
+
+  _findButton->setText( tr( "Stop" ) );
+  _statusLabel->setText( tr( "Searching..." ) );
+}
+
+/*!
+   Slot to list a batch of hits \a hits
+   \param hits the hits
+ */
+void findInFilesDialog_c::handleHits( const QVector<grepHit_s> &hits )
+{
+  const QDir folderDir( _folderPath );
+  for ( const auto &hit : hits )
+  {
+    QListWidgetItem *item = new QListWidgetItem( QString( "%1:%2: %3" ).arg( folderDir.relativeFilePath( hit.path ) ).
+                                                 arg( hit.line + 1 ).arg( hit.text.trimmed() ), _hitList );
+    item->setData( Qt::UserRole, hit.path );
+    item->setData( lineRole, hit.line );
+  }
+}
+
+/*!
+   Slot to show progress of the search
+   \param filesSearched number of the searched files
+   \param filesSkipped number of the skipped non-text files
+ */
+void findInFilesDialog_c::handleProgress( qint64 filesSearched, qint64 filesSkipped )
+{
+  const QLocale locale;
+  _statusLabel->setText( tr( "Searching... %1 hits in %2 files, %3 non-text files skipped" ).
+                         arg( locale.toString( _hitList->count() ) ).arg( locale.toString( filesSearched ) ).
+                         arg( locale.toString( filesSkipped ) ) );
+}
+
+/*!
+   Slot to handle the end of the search
+   \param complete false if the search stopped at the hit limit
+ */
+void findInFilesDialog_c::handleFinished( bool complete )
+{
+  _findButton->setText( tr( "Find" ) );
+
+  const QString hitCount = QLocale().toString( _hitList->count() );
+  _statusLabel->setText( complete ? tr( "%1 hits" ).arg( hitCount ) : tr( "First %1 hits shown" ).arg( hitCount ) );
+}
+
+/*!
+   Slot to report an activated hit \a item
+   \param item the activated hit
+ */
+void findInFilesDialog_c::handleHitActivated( QListWidgetItem *item )
+{
+  emit hitActivated( item->data( Qt::UserRole ).toString(), item->data( lineRole ).toLongLong() );
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QDialog>
+#include <QVector>
+
+class contentGrep_c;
+class QCheckBox;
+class QLabel;
+class QLineEdit;
+class QListWidget;
+class QListWidgetItem;
+class QPushButton;
+
+struct grepHit_s;
+
+/*!
+   Dialog searching contents of the text files below a folder
+   Hits are listed as they are found by \em contentGrep_c, an activated hit is reported through \em hitActivated.
+ */
+class findInFilesDialog_c : public QDialog
+{
+  Q_OBJECT
+
+  private:
+    // Absolute path to the searched folder
+    QString _folderPath;
+    // Searched pattern
+    QLineEdit *_patternLine;
+    // The pattern is a regular expression
+    QCheckBox *_regularExpressionBox;
+    QCheckBox *_caseSensitiveBox;
+    // Starts or stops the search
+    QPushButton *_findButton;
+    // Hits of the search
+    QListWidget *_hitList;
+    // Progress of the search
+    QLabel *_statusLabel;
+    // Background content search
+    contentGrep_c *_contentGrep;
+
+  public:
+    findInFilesDialog_c( const QString &, QWidget * = nullptr );
+    virtual ~findInFilesDialog_c() = default;
+
+  private slots:
+    void handleFindButton();
+    void handleHits( const QVector<grepHit_s> & );
+    void handleProgress( qint64, qint64 );
+    void handleFinished( bool );
+    void handleHitActivated( QListWidgetItem * );
+
+  signals:
+    // Absolute path to the file and zero-based line number of the hit
+    void hitActivated( const QString &, qint64 );
+};
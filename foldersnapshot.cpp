@@ -0,0 +1,801 @@
+#include "foldersnapshot.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QThread>
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#if defined( Q_OS_UNIX )
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "contenthasher.h"
+#include "dirlister.h"
+#include "namearena.h"
+#include "workstealingpool.h"
+
+namespace
+{
+  constexpr char snapshotMagic[ 8 ] = { 'F', 'I', 'S', 'N', 'A', 'P', 'S', 'H' };
+  constexpr quint32 snapshotVersion = 1;
+  // Snapshot flag of content hashes captured
+  constexpr quint32 hashedSnapshot = 0x01;
+  // Longest relative path stored, limited by the front coding
+  constexpr size_t maximumPathLength = 0xFFFF;
+  // Bytes read at once while hashing a file
+  constexpr qint64 hashReadSize = 1024 * 1024;
+  // Number of entries compared between two checks of the abort flag
+  constexpr quint64 cancelCheckInterval = 64 * 1024;
+
+  /*!
+     Entry collected by a capture
+   */
+  struct record_s
+  {
+    // Index of the relative path within the arena of the record buffer
+    int pathIndex;
+    quint8 flags;
+    qint64 size;
+    qint64 modified;
+    quint64 inode;
+    quint64 hash;
+  };
+
+  /*!
+     Records collected by a single worker of a capture
+   */
+  struct recordBuffer_s
+  {
+    std::vector<record_s> records;
+    nameArena_c paths;
+  };
+
+  /*!
+     Shared state of a single capture
+   */
+  struct captureState_s
+  {
+    bool hashContents = false;
+    // Device of the captured folder, the capture stays on it
+    quint64 device = 0;
+    const std::atomic<bool> *cancelled = nullptr;
+    std::atomic<qint64> *progress = nullptr;
+    // Records, a buffer per worker
+    std::vector<recordBuffer_s> buffers;
+  };
+
+  /*!
+     Hashes the whole content of an opened file \a file
+     \param file the file
+     \param size size of the file
+     \param cancelled stops the hashing once set
+     \param hash receives the hash
+     \return false if the file cannot be read or the capture was cancelled
+   */
+  bool hashFile( QFile &file, qint64 size, const std::atomic<bool> &cancelled, quint64 &hash )
+  {
+#if defined( Q_OS_UNIX ) && !defined( Q_OS_DARWIN )
+    // no sequential advice on macOS, which lacks posix_fadvise
+    posix_fadvise( file.handle(), 0, 0, POSIX_FADV_SEQUENTIAL );
+#endif
+
+    // read in chunks rather than mapped, a file truncated during the capture would fault on its mapped pages
+    contentHasher_c hasher;
+    for ( qint64 offset = 0; offset < size; )
+    {
+      if ( cancelled )
+        return false;
+
+      const qint64 chunkSize = std::min( hashReadSize, size - offset );
+      const QByteArray data = file.read( chunkSize );
+      if ( data.size() != chunkSize )
+        return false;
+
+      hasher.update( data.constData(), static_cast<size_t>( chunkSize ) );
+      offset += chunkSize;
+    }
+
+    hash = hasher.digest();
+    return true;
+  }
+
+  /*!
+     Records an entry of a capture
+     \param state the capture state
+     \param worker index of the worker
+     \param relativePath path to the entry relative to the captured folder
+     \param record the entry, its path index is set
+   */
+  void addRecord( captureState_s &state, int worker, const std::string &relativePath, record_s record )
+  {
+    recordBuffer_s &buffer = state.buffers[ static_cast<size_t>( worker ) ];
+    record.pathIndex = buffer.paths.append( relativePath.c_str(), static_cast<int>( relativePath.size() ) );
+    buffer.records.push_back( record );
+    if ( state.progress != nullptr )
+      ( *state.progress )++;
+  }
+
+#if defined( Q_OS_UNIX )
+  /*!
+     \param entryStat attributes of an entry
+     \return modification time of the entry in ns since epoch
+   */
+  qint64 modificationTime( const struct stat &entryStat )
+  {
+#if defined( Q_OS_DARWIN )
+    return static_cast<qint64>( entryStat.st_mtimespec.tv_sec ) * 1000000000 + entryStat.st_mtimespec.tv_nsec;
+#else
+    return static_cast<qint64>( entryStat.st_mtim.tv_sec ) * 1000000000 + entryStat.st_mtim.tv_nsec;
+#endif
+  }
+#endif
+
+  /*!
+     Captures the entries of a folder given at \a path, submitting a task for every sub-folder
+     \param state the capture state
+     \param pool the pool running the capture
+     \param worker index of the worker
+     \param path absolute path to the folder
+     \param relativePrefix path to the folder relative to the captured folder, followed by a separator unless empty
+   */
+  void captureDirectory( captureState_s &state, workStealingPool_c &pool, int worker, const std::string &path,
+                         const std::string &relativePrefix )
+  {
+    if ( *state.cancelled )
+      return;
+
+    const auto submitDirectory = [&state, &pool]( std::string directoryPath, std::string directoryPrefix )
+    {
+      pool.submit( [&state, &pool, directoryPath, directoryPrefix]( int nextWorker )
+      {
+        captureDirectory( state, pool, nextWorker, directoryPath, directoryPrefix );
+      } );
+    };
+
+#if defined( Q_OS_UNIX )
+    const int dirFd = open( path.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC );
+    if ( dirFd < 0 )
+      return;
+
+    dirLister_c::readEntries( dirFd, [&]( const char *name, unsigned char )
+    {
+      struct stat entryStat;
+      if ( fstatat( dirFd, name, &entryStat, AT_SYMLINK_NOFOLLOW ) != 0 )
+        return true;
+
+      const bool isDir = S_ISDIR( entryStat.st_mode );
+      if ( isDir && static_cast<quint64>( entryStat.st_dev ) != state.device )
+        return true;
+
+      const std::string relativePath = relativePrefix + name;
+      if ( relativePath.size() > maximumPathLength )
+        return true;
+
+      record_s record{ 0, static_cast<quint8>( isDir ? folderSnapshot_c::Directory : 0 ),
+                       isDir ? 0 : static_cast<qint64>( entryStat.st_size ), modificationTime( entryStat ),
+                       static_cast<quint64>( entryStat.st_ino ), 0 };
+      if ( state.hashContents && S_ISREG( entryStat.st_mode ) )
+      {
+        QFile file;
+        const int fileFd = openat( dirFd, name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC );
+        if ( fileFd >= 0 && file.open( fileFd, QIODevice::ReadOnly, QFileDevice::AutoCloseHandle ) &&
+             hashFile( file, record.size, *state.cancelled, record.hash ) )
+          record.flags |= folderSnapshot_c::Hashed;
+        else if ( fileFd >= 0 && !file.isOpen() )
+          close( fileFd );
+      }
+      addRecord( state, worker, relativePath, record );
+
+      if ( isDir )
+        submitDirectory( path + '/' + name, relativePath + '/' );
+      return !*state.cancelled;
+    }, [&state]() { return !*state.cancelled; } );
+
+    close( dirFd );
+#else
+    QDirIterator dirIt( QFile::decodeName( path.c_str() ), QDir::AllEntries | QDir::Hidden | QDir::System |
+                        QDir::NoDotAndDotDot | QDir::NoSymLinks );
+    while ( dirIt.hasNext() && !*state.cancelled )
+    {
+      dirIt.next();
+      const QFileInfo entryInfo = dirIt.fileInfo();
+      const std::string name = QFile::encodeName( entryInfo.fileName() ).toStdString();
+      const std::string relativePath = relativePrefix + name;
+      if ( relativePath.size() > maximumPathLength )
+        continue;
+
+      record_s record{ 0, static_cast<quint8>( entryInfo.isDir() ? folderSnapshot_c::Directory : 0 ),
+                       entryInfo.isDir() ? 0 : entryInfo.size(),
+                       entryInfo.lastModified().toMSecsSinceEpoch() * 1000000, 0, 0 };
+      if ( state.hashContents && entryInfo.isFile() )
+      {
+        QFile file( entryInfo.absoluteFilePath() );
+        if ( file.open( QIODevice::ReadOnly ) && hashFile( file, record.size, *state.cancelled, record.hash ) )
+          record.flags |= folderSnapshot_c::Hashed;
+      }
+      addRecord( state, worker, relativePath, record );
+
+      if ( entryInfo.isDir() )
+        submitDirectory( path + '/' + name, relativePath + '/' );
+    }
+#endif
+  }
+
+  /*!
+     \param entry an entry of the older snapshot
+     \param other the entry of the same path in the newer snapshot
+     \return true if the content of the file changed
+   */
+  bool isModified( const folderSnapshot_c::entry_s &entry, const folderSnapshot_c::entry_s &other )
+  {
+    if ( entry.size != other.size || entry.modified != other.modified )
+      return true;
+    return ( entry.flags & other.flags & folderSnapshot_c::Hashed ) && entry.hash != other.hash;
+  }
+
+  /*!
+     \param path a relative path
+     \return relative path to the folder containing the entry, empty for an entry of the snapshot folder
+   */
+  std::string parentPath( const std::string &path )
+  {
+    const size_t separator = path.rfind( '/' );
+    return ( separator == std::string::npos ) ? std::string() : path.substr( 0, separator );
+  }
+
+  /*!
+     \param path a relative path
+     \return name of the entry, the last component of \a path
+   */
+  std::string_view entryName( const std::string &path )
+  {
+    const size_t separator = path.rfind( '/' );
+    return std::string_view( path ).substr( ( separator == std::string::npos ) ? 0 : separator + 1 );
+  }
+
+  /*!
+     Checks that an entry at \a path and an entry at \a otherPath of the same inode are the same file moved
+     Inodes are reused once freed, so the inode alone pairs an entry removed and a new one created meanwhile. The
+     entries have to share their name as well, or their size and their content hash, or their modification time
+     where either is not hashed.
+     \param entry the entry in the older snapshot
+     \param path relative path to the entry
+     \param other the entry in the newer snapshot
+     \param otherPath relative path to the other entry
+     \return true if the entries are the same moved file
+   */
+  bool isSameMoved( const folderSnapshot_c::entry_s &entry, const std::string &path,
+                    const folderSnapshot_c::entry_s &other, const std::string &otherPath )
+  {
+    if ( entryName( path ) == entryName( otherPath ) )
+      return true;
+
+    if ( entry.size != other.size )
+      return false;
+    if ( entry.flags & other.flags & folderSnapshot_c::Hashed )
+      return entry.hash == other.hash;
+    return entry.modified == other.modified;
+  }
+
+  /*!
+     \param kind the kind of the change
+     \param path relative path to the changed entry
+     \param previous the entry in the older snapshot, nullptr for an added one
+     \param current the entry in the newer snapshot, nullptr for a removed one
+     \return the change
+   */
+  snapshotChange_s makeChange( snapshotChange_s::kind_e kind, const std::string &path,
+                               const folderSnapshot_c::entry_s *previous, const folderSnapshot_c::entry_s *current )
+  {
+    snapshotChange_s change;
+    change.kind = kind;
+    change.path = QFile::decodeName( path.c_str() );
+    change.isDir = ( ( current != nullptr ) ? current->flags : previous->flags ) & folderSnapshot_c::Directory;
+    change.previousSize = ( previous != nullptr ) ? previous->size : 0;
+    change.size = ( current != nullptr ) ? current->size : 0;
+    return change;
+  }
+}
+
+/*!
+   Header of a snapshot file
+ */
+struct folderSnapshot_c::header_s
+{
+  char magic[ 8 ];
+  quint32 version;
+  quint32 entryCount;
+  quint32 flags;
+  quint32 reserved;
+  // Capture time in ms since epoch
+  qint64 captured;
+  quint64 rootOffset;
+  quint64 rootSize;
+  quint64 suffixesOffset;
+  quint64 suffixesSize;
+};
+
+/*!
+   C-tor
+ */
+folderSnapshot_c::folderSnapshot_c() :
+  _data{ nullptr },
+  _dataSize{ 0 },
+  _entries{ nullptr },
+  _suffixes{ nullptr },
+  _entryCount{ 0 },
+  _captured{ 0 },
+  _hashed{ false }
+{
+}
+
+/*!
+   D-tor
+ */
+folderSnapshot_c::~folderSnapshot_c()
+{
+  reset();
+}
+
+/*!
+   Maps a snapshot file given at \a snapshotFilePath
+   \param snapshotFilePath path to the snapshot file
+   \return false if the file does not exist or is not a valid snapshot
+ */
+bool folderSnapshot_c::load( const QString &snapshotFilePath )
+{
+  reset();
+
+  _file.setFileName( snapshotFilePath );
+  if ( !_file.open( QIODevice::ReadOnly ) )
+    return false;
+
+  const qint64 fileSize = _file.size();
+  const uchar *data = ( fileSize >= static_cast<qint64>( sizeof( header_s ) ) ) ? _file.map( 0, fileSize ) : nullptr;
+  if ( data == nullptr || !attach( data, fileSize ) )
+  {
+    if ( data != nullptr )
+      _file.unmap( const_cast<uchar *>( data ) );
+    reset();
+    return false;
+  }
+
+  return true;
+}
+
+/*!
+   Captures a folder given at \a rootPath into memory, replacing the current snapshot
+   The tree is walked by the workers of a \em workStealingPool_c, staying on the device of the folder and not
+   following symbolic links. The collected entries are sorted by their relative paths and front coded.
+   \param rootPath absolute path to the folder
+   \param hashContents true to hash the contents of the regular files, see contentHasher_c
+   \param cancelled stops the capture once set
+   \param progress receives the number of the captured entries, may be nullptr
+   \return false if the folder cannot be read or the capture was cancelled
+ */
+bool folderSnapshot_c::capture( const QString &rootPath, bool hashContents, const std::atomic<bool> &cancelled,
+                                std::atomic<qint64> *progress )
+{
+  reset();
+
+  const std::string rootBytes = QFile::encodeName( rootPath ).toStdString();
+  const int threadCount = qMax( 4, QThread::idealThreadCount() * 2 );
+
+  captureState_s state;
+  state.hashContents = hashContents;
+  state.cancelled = &cancelled;
+  state.progress = progress;
+  state.buffers.resize( static_cast<size_t>( threadCount ) );
+
+#if defined( Q_OS_UNIX )
+  struct stat rootStat;
+  if ( stat( rootBytes.c_str(), &rootStat ) != 0 || !S_ISDIR( rootStat.st_mode ) )
+    return false;
+  state.device = static_cast<quint64>( rootStat.st_dev );
+#else
+  if ( !QFileInfo( rootPath ).isDir() )
+    return false;
+#endif
+
+  {
+    workStealingPool_c pool( threadCount );
+    pool.submit( [&state, &pool, &rootBytes]( int worker )
+    {
+      captureDirectory( state, pool, worker, rootBytes, std::string() );
+    } );
+    pool.wait();
+  }
+
+  if ( cancelled )
+    return false;
+
+  // sorted by relative path, the order of the merge pass of a diff
+  struct sortedRecord_s
+  {
+    std::string_view path;
+    const record_s *record;
+  };
+
+  std::vector<sortedRecord_s> sorted;
+  for ( const auto &buffer : state.buffers )
+  {
+    for ( const auto &record : buffer.records )
+      sorted.push_back( { std::string_view( buffer.paths.name( record.pathIndex ),
+                                            static_cast<size_t>( buffer.paths.length( record.pathIndex ) ) ),
+                          &record } );
+  }
+  std::sort( sorted.begin(), sorted.end(), []( const sortedRecord_s &left, const sortedRecord_s &right )
+  {
+    return left.path < right.path;
+  } );
+
+  std::vector<entry_s> entries( sorted.size() );
+  std::vector<char> suffixes;
+  std::string_view previousPath;
+  for ( size_t index = 0; index < sorted.size(); index++ )
+  {
+    const std::string_view path = sorted[ index ].path;
+    const record_s &record = *sorted[ index ].record;
+
+    size_t sharedLength = 0;
+    const size_t commonLength = std::min( path.size(), previousPath.size() );
+    while ( sharedLength < commonLength && path[ sharedLength ] == previousPath[ sharedLength ] )
+      sharedLength++;
+
+    entry_s &entry = entries[ index ];
+    std::memset( &entry, 0, sizeof( entry ) );
+    entry.suffixOffset = static_cast<quint32>( suffixes.size() );
+    entry.sharedLength = static_cast<quint16>( sharedLength );
+    entry.suffixLength = static_cast<quint16>( path.size() - sharedLength );
+    entry.size = record.size;
+    entry.modified = record.modified;
+    entry.inode = record.inode;
+    entry.hash = record.hash;
+    entry.flags = record.flags;
+
+    suffixes.insert( suffixes.end(), path.begin() + static_cast<std::ptrdiff_t>( sharedLength ), path.end() );
+    if ( suffixes.size() > 0xFFFFFFFFu )
+      return false;
+    previousPath = path;
+  }
+
+  header_s header;
+  std::memset( &header, 0, sizeof( header ) );
+  std::memcpy( header.magic, snapshotMagic, sizeof( snapshotMagic ) );
+  header.version = snapshotVersion;
+  header.entryCount = static_cast<quint32>( entries.size() );
+  header.flags = hashContents ? hashedSnapshot : 0;
+  header.captured = QDateTime::currentMSecsSinceEpoch();
+  header.rootOffset = sizeof( header_s ) + entries.size() * sizeof( entry_s );
+  header.rootSize = rootBytes.size();
+  header.suffixesOffset = header.rootOffset + header.rootSize;
+  header.suffixesSize = suffixes.size();
+
+  _buffer.resize( static_cast<int>( header.suffixesOffset + header.suffixesSize ) );
+  char *data = _buffer.data();
+  std::memcpy( data, &header, sizeof( header ) );
+  std::memcpy( data + sizeof( header ), entries.data(), entries.size() * sizeof( entry_s ) );
+  std::memcpy( data + header.rootOffset, rootBytes.data(), rootBytes.size() );
+  std::memcpy( data + header.suffixesOffset, suffixes.data(), suffixes.size() );
+
+  return attach( reinterpret_cast<const uchar *>( _buffer.constData() ), _buffer.size() );
+}
+
+/*!
+   Writes the snapshot to a file given at \a snapshotFilePath
+   \param snapshotFilePath path to the snapshot file
+   \return false on a write error or if there is no snapshot
+ */
+bool folderSnapshot_c::save( const QString &snapshotFilePath ) const
+{
+  if ( _data == nullptr )
+    return false;
+
+  QDir().mkpath( QFileInfo( snapshotFilePath ).absolutePath() );
+
+  QSaveFile snapshotFile( snapshotFilePath );
+  if ( !snapshotFile.open( QIODevice::WriteOnly ) )
+    return false;
+
+  snapshotFile.write( reinterpret_cast<const char *>( _data ), _dataSize );
+  return snapshotFile.commit();
+}
+
+/*!
+   \return number of the entries below the snapshot folder
+ */
+quint32 folderSnapshot_c::count() const
+{
+  return _entryCount;
+}
+
+/*!
+   \param id id of the entry
+   \return the entry
+ */
+const folderSnapshot_c::entry_s &folderSnapshot_c::entry( quint32 id ) const
+{
+  return _entries[ id ];
+}
+
+/*!
+   Turns the relative path of the entry preceding an entry \a id into the relative path of the entry
+   The paths are front coded, so they are decoded in order, starting with the entry 0 and an empty path.
+   \param id id of the entry
+   \param path relative path to the entry \a id - 1, receives the path to the entry \a id
+ */
+void folderSnapshot_c::nextPath( quint32 id, std::string &path ) const
+{
+  const entry_s &current = _entries[ id ];
+  path.resize( current.sharedLength );
+  path.append( _suffixes + current.suffixOffset, current.suffixLength );
+}
+
+/*!
+   \return absolute path to the snapshot folder
+ */
+QString folderSnapshot_c::rootPath() const
+{
+  return _rootPath;
+}
+
+/*!
+   \return capture time in ms since epoch
+ */
+qint64 folderSnapshot_c::captured() const
+{
+  return _captured;
+}
+
+/*!
+   \return true if the contents of the files were hashed
+ */
+bool folderSnapshot_c::hasHashes() const
+{
+  return _hashed;
+}
+
+/*!
+   Compares two snapshots \a older and \a newer of a folder
+   A single merge pass over both sorted snapshots finds the entries added, removed and modified at the same path.
+   An added entry of the same inode, or of the same size and content hash, as a removed one is reported as moved
+   instead; the entries moved along with a moved folder are implied by the folder and not reported.
+   \param older the older snapshot
+   \param newer the newer snapshot
+   \param cancelled stops the comparison once set
+   \return the changes sorted by path, empty if cancelled
+ */
+QVector<snapshotChange_s> folderSnapshot_c::diff( const folderSnapshot_c &older, const folderSnapshot_c &newer,
+                                                  const std::atomic<bool> &cancelled )
+{
+  /*!
+     Entry present in one of the snapshots only
+   */
+  struct unmatched_s
+  {
+    quint32 id;
+    std::string path;
+  };
+
+  QVector<snapshotChange_s> changes;
+  std::vector<unmatched_s> removed;
+  std::vector<unmatched_s> added;
+
+  std::string olderPath;
+  std::string newerPath;
+  quint32 olderId = 0;
+  quint32 newerId = 0;
+  if ( older.count() > 0 )
+    older.nextPath( 0, olderPath );
+  if ( newer.count() > 0 )
+    newer.nextPath( 0, newerPath );
+
+  const auto advanceOlder = [&]()
+  {
+    if ( ++olderId < older.count() )
+      older.nextPath( olderId, olderPath );
+  };
+  const auto advanceNewer = [&]()
+  {
+    if ( ++newerId < newer.count() )
+      newer.nextPath( newerId, newerPath );
+  };
+
+  for ( quint64 step = 0; olderId < older.count() || newerId < newer.count(); step++ )
+  {
+    if ( step % cancelCheckInterval == 0 && cancelled )
+      return {};
+
+    int comparison = 0;
+    if ( olderId >= older.count() )
+      comparison = 1;
+    else if ( newerId >= newer.count() )
+      comparison = -1;
+    else
+      comparison = olderPath.compare( newerPath );
+
+    if ( comparison < 0 )
+    {
+      removed.push_back( { olderId, olderPath } );
+      advanceOlder();
+    }
+    else if ( comparison > 0 )
+    {
+      added.push_back( { newerId, newerPath } );
+      advanceNewer();
+    }
+    else
+    {
+      const entry_s &olderEntry = older.entry( olderId );
+      const entry_s &newerEntry = newer.entry( newerId );
+      if ( ( olderEntry.flags ^ newerEntry.flags ) & Directory )
+      {
+        removed.push_back( { olderId, olderPath } );
+        added.push_back( { newerId, newerPath } );
+      }
+      else if ( !( newerEntry.flags & Directory ) && isModified( olderEntry, newerEntry ) )
+      {
+        changes.append( makeChange( snapshotChange_s::kind_e::Modified, newerPath, &olderEntry, &newerEntry ) );
+      }
+      advanceOlder();
+      advanceNewer();
+    }
+  }
+
+  // moves pair the removed and the added entries by inode and a further match, or by content for the files copied
+  // and deleted
+  std::unordered_map<quint64, size_t> removedByInode;
+  std::unordered_map<quint64, size_t> removedByHash;
+  for ( size_t index = 0; index < removed.size(); index++ )
+  {
+    const entry_s &olderEntry = older.entry( removed[ index ].id );
+    if ( olderEntry.inode != 0 )
+      removedByInode.emplace( olderEntry.inode, index );
+    if ( ( olderEntry.flags & Hashed ) && olderEntry.size > 0 )
+      removedByHash.emplace( olderEntry.hash, index );
+  }
+
+  std::vector<bool> removedMatched( removed.size(), false );
+  // previous paths of the moved folders to their new paths, the added entries come in path order, parents first
+  std::unordered_map<std::string, std::string> movedFolders;
+  for ( size_t index = 0; index < added.size(); index++ )
+  {
+    if ( index % cancelCheckInterval == 0 && cancelled )
+      return {};
+
+    const unmatched_s &addedEntry = added[ index ];
+    const entry_s &newerEntry = newer.entry( addedEntry.id );
+    const auto isMatch = [&]( size_t candidate )
+    {
+      const entry_s &olderEntry = older.entry( removed[ candidate ].id );
+      return !removedMatched[ candidate ] && !( ( olderEntry.flags ^ newerEntry.flags ) & Directory );
+    };
+
+    size_t match = removed.size();
+    const auto byInode = removedByInode.find( newerEntry.inode );
+    if ( newerEntry.inode != 0 && byInode != removedByInode.end() && isMatch( byInode->second ) &&
+         isSameMoved( older.entry( removed[ byInode->second ].id ), removed[ byInode->second ].path, newerEntry,
+                      addedEntry.path ) )
+    {
+      match = byInode->second;
+    }
+    else if ( ( newerEntry.flags & Hashed ) && newerEntry.size > 0 )
+    {
+      const auto byHash = removedByHash.find( newerEntry.hash );
+      if ( byHash != removedByHash.end() && isMatch( byHash->second ) &&
+           older.entry( removed[ byHash->second ].id ).size == newerEntry.size )
+        match = byHash->second;
+    }
+
+    if ( match == removed.size() )
+    {
+      changes.append( makeChange( snapshotChange_s::kind_e::Added, addedEntry.path, nullptr, &newerEntry ) );
+      continue;
+    }
+
+    removedMatched[ match ] = true;
+    const unmatched_s &removedEntry = removed[ match ];
+    const entry_s &olderEntry = older.entry( removedEntry.id );
+    if ( newerEntry.flags & Directory )
+      movedFolders.emplace( removedEntry.path, addedEntry.path );
+
+    const auto folder = movedFolders.find( parentPath( removedEntry.path ) );
+    const bool modified = !( newerEntry.flags & Directory ) && isModified( olderEntry, newerEntry );
+    if ( folder != movedFolders.end() && !modified &&
+         addedEntry.path == folder->second + removedEntry.path.substr( folder->first.size() ) )
+      continue;
+
+    snapshotChange_s change = makeChange( snapshotChange_s::kind_e::Moved, addedEntry.path, &olderEntry,
+                                          &newerEntry );
+    change.previousPath = QFile::decodeName( removedEntry.path.c_str() );
+    changes.append( change );
+  }
+
+  for ( size_t index = 0; index < removed.size(); index++ )
+  {
+    if ( !removedMatched[ index ] )
+      changes.append( makeChange( snapshotChange_s::kind_e::Removed, removed[ index ].path,
+                                  &older.entry( removed[ index ].id ), nullptr ) );
+  }
+
+  std::stable_sort( changes.begin(), changes.end(), []( const snapshotChange_s &left, const snapshotChange_s &right )
+  {
+    return left.path < right.path;
+  } );
+
+  return changes;
+}
+
+/*!
+   Drops the current snapshot
+ */
+void folderSnapshot_c::reset()
+{
+  if ( _data != nullptr && _buffer.isEmpty() )
+    _file.unmap( const_cast<uchar *>( _data ) );
+  _file.close();
+  _buffer.clear();
+
+  _data = nullptr;
+  _dataSize = 0;
+  _entries = nullptr;
+  _suffixes = nullptr;
+  _entryCount = 0;
+  _rootPath.clear();
+  _captured = 0;
+  _hashed = false;
+}
+
+/*!
+   Uses a snapshot \a data in place, once validated
+   \param data the snapshot, stays valid while in use
+   \param dataSize size of the snapshot in bytes
+   \return false if the data is not a valid snapshot
+ */
+bool folderSnapshot_c::attach( const uchar *data, qint64 dataSize )
+{
+  if ( dataSize < static_cast<qint64>( sizeof( header_s ) ) )
+    return false;
+
+  const auto *header = reinterpret_cast<const header_s *>( data );
+  const quint64 entriesEnd = sizeof( header_s ) + static_cast<quint64>( header->entryCount ) * sizeof( entry_s );
+  if ( std::memcmp( header->magic, snapshotMagic, sizeof( snapshotMagic ) ) != 0 ||
+       header->version != snapshotVersion || header->rootOffset < entriesEnd ||
+       header->suffixesOffset < header->rootOffset + header->rootSize ||
+       header->suffixesOffset + header->suffixesSize != static_cast<quint64>( dataSize ) )
+    return false;
+
+  // every path has to decode within the suffixes
+  const auto *entries = reinterpret_cast<const entry_s *>( data + sizeof( header_s ) );
+  size_t previousLength = 0;
+  for ( quint32 id = 0; id < header->entryCount; id++ )
+  {
+    const entry_s &current = entries[ id ];
+    if ( current.sharedLength > previousLength ||
+         static_cast<quint64>( current.suffixOffset ) + current.suffixLength > header->suffixesSize )
+      return false;
+    previousLength = static_cast<size_t>( current.sharedLength ) + current.suffixLength;
+  }
+
+  _data = data;
+  _dataSize = dataSize;
+  _entries = entries;
+  _suffixes = reinterpret_cast<const char *>( data + header->suffixesOffset );
+  _entryCount = header->entryCount;
+  _rootPath = QFile::decodeName( QByteArray( reinterpret_cast<const char *>( data + header->rootOffset ),
+                                             static_cast<int>( header->rootSize ) ) );
+  _captured = header->captured;
+  _hashed = ( header->flags & hashedSnapshot ) != 0;
+
+  return true;
+}
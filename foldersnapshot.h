@@ -0,0 +1,118 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+#include <string>
+
+/*!
+   Difference of an entry between two snapshots
+ */
+struct snapshotChange_s
+{
+  enum class kind_e
+  {
+    Added,
+    Removed,
+    Modified,
+    Moved
+  };
+
+  kind_e kind = kind_e::Added;
+  // Path relative to the snapshot folder, the new one of a moved entry
+  QString path;
+  // Previous relative path of a moved entry
+  QString previousPath;
+  bool isDir = false;
+  // Size before and after the change, in bytes
+  qint64 previousSize = 0;
+  qint64 size = 0;
+};
+
+/*!
+   Snapshot of a folder tree: names, sizes, modification times, inodes and optionally content hashes
+   The snapshot is a single binary file, memory-mapped on load and used in place. Entries are sorted by their path
+   relative to the folder, so two snapshots are compared by a single merge pass over both. The paths are front
+   coded, every entry stores the length of the prefix shared with the previous path and the remaining suffix only,
+   which keeps a snapshot of a deep tree at a fraction of the size of the full paths.
+
+   Layout: header_s, entry_s[ entryCount ], absolute path to the folder, suffixes of the paths.
+ */
+class folderSnapshot_c
+{
+  public:
+    enum entryFlag_e : quint8
+    {
+      Directory = 0x01,
+      // The content hash is set
+      Hashed = 0x02
+    };
+
+    /*!
+       Stored entry
+     */
+    struct entry_s
+    {
+      // Offset of the path suffix within the suffixes
+      quint32 suffixOffset;
+      // Length of the prefix shared with the path of the previous entry
+      quint16 sharedLength;
+      quint16 suffixLength;
+      // Size in bytes, 0 for folders
+      qint64 size;
+      // Modification time in ns since epoch
+      qint64 modified;
+      quint64 inode;
+      // Content hash of a file, see contentHasher_c
+      quint64 hash;
+      quint8 flags;
+      quint8 reserved[ 7 ];
+    };
+
+    // Suffix of the snapshot files
+    static constexpr char fileSuffix[] = "fsnap";
+
+  private:
+    struct header_s;
+
+    QFile _file;
+    // Snapshot captured in memory, not mapped from a file
+    QByteArray _buffer;
+    const uchar *_data;
+    qint64 _dataSize;
+    const entry_s *_entries;
+    const char *_suffixes;
+    quint32 _entryCount;
+    QString _rootPath;
+    // Capture time in ms since epoch
+    qint64 _captured;
+    bool _hashed;
+
+  public:
+    folderSnapshot_c();
+    ~folderSnapshot_c();
+
+    folderSnapshot_c( const folderSnapshot_c & ) = delete;
+    folderSnapshot_c &operator=( const folderSnapshot_c & ) = delete;
+
+    bool load( const QString & );
+    bool capture( const QString &, bool, const std::atomic<bool> &, std::atomic<qint64> * = nullptr );
+    bool save( const QString & ) const;
+
+    quint32 count() const;
+    const entry_s &entry( quint32 ) const;
+    void nextPath( quint32, std::string & ) const;
+    QString rootPath() const;
+    qint64 captured() const;
+    bool hasHashes() const;
+
+    static QVector<snapshotChange_s> diff( const folderSnapshot_c &, const folderSnapshot_c &,
+                                           const std::atomic<bool> & );
+
+  private:
+    void reset();
+    bool attach( const uchar *, qint64 );
+};
@@ -0,0 +1,158 @@
+#include "hexformatter.h"
+
+#include <cstring>
+
+#if defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+  constexpr char hexDigits[] = "0123456789abcdef";
+  // Number of spaces separating the offset, the hex digits and the printable characters
+  constexpr int columnGap = 2;
+  // Longest possible row, with a 16-digit offset
+  constexpr int maximumRowLength = 16 + columnGap + hexFormatter_c::bytesPerRow * 3 + 1 + columnGap +
+                                   hexFormatter_c::bytesPerRow;
+
+#if defined( __SSE2__ )
+  /*!
+     \param nibbles 16 values of 0 to 15
+     \return the values as lower case hex digits
+   */
+  inline __m128i nibblesToHex( __m128i nibbles )
+  {
+    const __m128i letters = _mm_and_si128( _mm_cmpgt_epi8( nibbles, _mm_set1_epi8( 9 ) ),
+                                           _mm_set1_epi8( 'a' - '0' - 10 ) );
+    return _mm_add_epi8( _mm_add_epi8( nibbles, _mm_set1_epi8( '0' ) ), letters );
+  }
+#endif
+}
+
+/*!
+   Converts \a size bytes given at \a data to hex digits, two per byte
+   \param data the bytes
+   \param size number of the bytes
+   \param hex receives 2 * \a size hex digits
+ */
+void hexFormatter_c::formatHex( const uchar *data, int size, char *hex )
+{
+  int index = 0;
+#if defined( __SSE2__ )
+  const __m128i lowNibble = _mm_set1_epi8( 0x0f );
+  for ( ; index + 16 <= size; index += 16 )
+  {
+    const __m128i bytes = _mm_loadu_si128( reinterpret_cast<const __m128i *>( data + index ) );
+    const __m128i high = _mm_and_si128( _mm_srli_epi16( bytes, 4 ), lowNibble );
+    const __m128i low = _mm_and_si128( bytes, lowNibble );
+
+    // interleaved, the high digit of every byte precedes the low one
+    _mm_storeu_si128( reinterpret_cast<__m128i *>( hex + 2 * index ), nibblesToHex( _mm_unpacklo_epi8( high, low ) ) );
+    _mm_storeu_si128( reinterpret_cast<__m128i *>( hex + 2 * index + 16 ),
+                      nibblesToHex( _mm_unpackhi_epi8( high, low ) ) );
+  }
+#endif
+
+  for ( ; index < size; index++ )
+  {
+    hex[ 2 * index ] = hexDigits[ data[ index ] >> 4 ];
+    hex[ 2 * index + 1 ] = hexDigits[ data[ index ] & 0x0f ];
+  }
+}
+
+/*!
+   Converts \a size bytes given at \a data to printable ASCII characters, replacing other bytes by '.'
+   \param data the bytes
+   \param size number of the bytes
+   \param printable receives \a size characters
+ */
+void hexFormatter_c::formatPrintable( const uchar *data, int size, char *printable )
+{
+  int index = 0;
+#if defined( __SSE2__ )
+  const __m128i dots = _mm_set1_epi8( '.' );
+  for ( ; index + 16 <= size; index += 16 )
+  {
+    const __m128i bytes = _mm_loadu_si128( reinterpret_cast<const __m128i *>( data + index ) );
+    // signed comparisons, bytes of 0x80 and more fail the first one
+    const __m128i isPrintable = _mm_and_si128( _mm_cmpgt_epi8( bytes, _mm_set1_epi8( 0x1f ) ),
+                                               _mm_cmplt_epi8( bytes, _mm_set1_epi8( 0x7f ) ) );
+    _mm_storeu_si128( reinterpret_cast<__m128i *>( printable + index ),
+                      _mm_or_si128( _mm_and_si128( isPrintable, bytes ), _mm_andnot_si128( isPrintable, dots ) ) );
+  }
+#endif
+
+  for ( ; index < size; index++ )
+    printable[ index ] = ( data[ index ] >= 0x20 && data[ index ] < 0x7f ) ? static_cast<char>( data[ index ] ) : '.';
+}
+
+/*!
+   Formats a row of a hex dump
+   \param offset offset of the first byte of the row
+   \param offsetDigits number of hex digits of the offset, see offsetDigits()
+   \param data the bytes of the row
+   \param size number of the bytes, at most bytesPerRow
+   \return the row
+ */
+QString hexFormatter_c::formatRow( qint64 offset, int offsetDigits, const uchar *data, int size )
+{
+  char row[ maximumRowLength ];
+  const int length = rowLength( offsetDigits );
+  std::memset( row, ' ', static_cast<size_t>( length ) );
+
+  for ( int digit = offsetDigits - 1; digit >= 0; digit-- )
+  {
+    row[ digit ] = hexDigits[ offset & 0x0f ];
+    offset >>= 4;
+  }
+
+  char hex[ 2 * bytesPerRow ];
+  formatHex( data, size, hex );
+  for ( int index = 0; index < size; index++ )
+    std::memcpy( row + hexColumn( offsetDigits, index ), hex + 2 * index, 2 );
+
+  formatPrintable( data, size, row + printableColumn( offsetDigits, 0 ) );
+
+  return QString::fromLatin1( row, printableColumn( offsetDigits, size ) );
+}
+
+/*!
+   \param size size of the dumped data
+   \return number of hex digits showing every offset of the data, at least 8
+ */
+int hexFormatter_c::offsetDigits( qint64 size )
+{
+  int digits = 8;
+  while ( digits < 16 && ( size - 1 ) >> ( 4 * digits ) != 0 )
+    digits++;
+  return digits;
+}
+
+/*!
+   \param offsetDigits number of hex digits of the offset
+   \param index index of a byte within its row
+   \return column of the first hex digit of the byte
+ */
+int hexFormatter_c::hexColumn( int offsetDigits, int index )
+{
+  return offsetDigits + columnGap + index * 3 + ( ( index >= bytesPerRow / 2 ) ? 1 : 0 );
+}
+
+/*!
+   \param offsetDigits number of hex digits of the offset
+   \param index index of a byte within its row
+   \return column of the printable character of the byte
+ */
+int hexFormatter_c::printableColumn( int offsetDigits, int index )
+{
+  return hexColumn( offsetDigits, bytesPerRow ) + columnGap - 1 + index;
+}
+
+/*!
+   \param offsetDigits number of hex digits of the offset
+   \return number of characters of a full row
+ */
+int hexFormatter_c::rowLength( int offsetDigits )
+{
+  return printableColumn( offsetDigits, bytesPerRow );
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <QString>
+
+/*!
+   Formats bytes as rows of a hex dump
+   A row shows the offset of its first byte, the bytes in hex in two groups of eight and the bytes as printable
+   ASCII, other bytes as '.'. With SSE2, 16 bytes are converted to hex digits, or to printable characters, at once.
+ */
+class hexFormatter_c
+{
+  public:
+    // Number of bytes of a row
+    static constexpr int bytesPerRow = 16;
+
+    static void formatHex( const uchar *, int, char * );
+    static void formatPrintable( const uchar *, int, char * );
+    static QString formatRow( qint64, int, const uchar *, int );
+
+    static int offsetDigits( qint64 );
+    static int hexColumn( int, int );
+    static int printableColumn( int, int );
+    static int rowLength( int );
+};
@@ -0,0 +1,446 @@
+#include "hexviewer.h"
+
+#include <QFontDatabase>
+#include <QInputDialog>
+#include <QKeyEvent>
+#include <QLineEdit>
+#include <QPainter>
+#include <QRegularExpression>
+#include <QScrollBar>
+#include <QToolTip>
+#include <QtConcurrent>
+
+#include <limits>
+
+#include "hexformatter.h"
+#include "literalmatcher.h"
+
+namespace
+{
+  // Left margin of the painted rows
+  constexpr int textMargin = 4;
+  // Number of bytes read and searched at once, between two checks of the abort flag
+  constexpr qint64 searchChunkSize = 4 * 1024 * 1024;
+  // Number of bytes read at least for the viewport, so scrolling by a few rows does not read again
+  constexpr qint64 windowSize = 64 * 1024;
+  // Opacity of the highlight of a found pattern
+  constexpr int matchHighlightAlpha = 96;
+}
+
+/*!
+   C-tor
+   \param parent parent widget
+ */
+hexViewer_c::hexViewer_c( QWidget *parent ) :
+  QAbstractScrollArea( parent ),
+  _size{ 0 },
+  _windowOffset{ 0 },
+  _offsetDigits{ 8 },
+  _topRow{ 0 },
+  _matchOffset{ -1 }
+{
+  setFont( QFontDatabase::systemFont( QFontDatabase::FixedFont ) );
+  setFocusPolicy( Qt::StrongFocus );
+  setVerticalScrollBarPolicy( Qt::ScrollBarAsNeeded );
+  setHorizontalScrollBarPolicy( Qt::ScrollBarAlwaysOff );
+  verticalScrollBar()->setSingleStep( 1 );
+}
+
+/*!
+   D-tor
+ */
+hexViewer_c::~hexViewer_c()
+{
+  clear();
+}
+
+/*!
+   Opens a file with a path \a path for viewing
+   \param path path to the file
+   \return true if the file could be opened
+ */
+bool hexViewer_c::setFile( const QString &path )
+{
+  clear();
+
+  _file.setFileName( path );
+  if ( !_file.open( QIODevice::ReadOnly | QIODevice::Unbuffered ) )
+    return false;
+
+  _size = _file.size();
+  _offsetDigits = hexFormatter_c::offsetDigits( _size );
+  updateScrollRange();
+
+  return true;
+}
+
+/*!
+   Opens the viewed file again, keeping the top row
+   \return false if the file could not be opened again
+ */
+bool hexViewer_c::reload()
+{
+  const QString path = filePath();
+  const qint64 topOffset = _topRow * hexFormatter_c::bytesPerRow;
+  if ( path.isEmpty() || !setFile( path ) )
+    return false;
+
+  scrollToOffset( topOffset );
+  return true;
+}
+
+/*!
+   Closes the viewed file, aborting the pattern search
+ */
+void hexViewer_c::clear()
+{
+  cancelSearch();
+
+  _file.close();
+  _file.setFileName( QString() );
+
+  _size = 0;
+  _window.clear();
+  _windowOffset = 0;
+  _topRow = 0;
+  _matchOffset = -1;
+
+  updateScrollRange();
+}
+
+/*!
+   \return path to the viewed file
+ */
+QString hexViewer_c::filePath() const
+{
+  return _file.fileName();
+}
+
+/*!
+   Slot to scroll the view, so the row containing byte offset \a offset is on top
+   \param offset the byte offset
+ */
+void hexViewer_c::scrollToOffset( qint64 offset )
+{
+  _topRow = qBound<qint64>( 0, offset / hexFormatter_c::bytesPerRow, maximumTopRow() );
+  verticalScrollBar()->setValue( valueForRow( _topRow ) );
+  viewport()->update();
+}
+
+/*!
+   Slot to find the next occurrence of the last searched pattern
+   The search starts after the highlighted occurrence, or at the top row, and runs on a worker thread.
+ */
+void hexViewer_c::findNext()
+{
+  if ( _pattern.isEmpty() )
+  {
+    askForPattern();
+    return;
+  }
+  if ( !_file.isOpen() )
+    return;
+
+  cancelSearch();
+
+  const qint64 from = ( _matchOffset >= 0 ) ? _matchOffset + 1 : _topRow * hexFormatter_c::bytesPerRow;
+  auto cancelled = std::make_shared<std::atomic<bool>>( false );
+  _searchCancelled = cancelled;
+
+  const QString path = filePath();
+  const qint64 size = _size;
+  const QByteArray pattern = _pattern;
+
+  _searchFuture = QtConcurrent::run( [this, cancelled, path, size, pattern, from]()
+  {
+    const literalMatcher_c matcher( pattern, true );
+    qint64 found = -1;
+    QFile file( path );
+    if ( file.open( QIODevice::ReadOnly ) )
+    {
+      for ( qint64 chunkStart = from; chunkStart < size && found < 0 && !*cancelled; chunkStart += searchChunkSize )
+      {
+        // occurrences may cross the chunk end
+        const qint64 length = qMin( size - chunkStart, searchChunkSize + pattern.size() - 1 );
+        if ( !file.seek( chunkStart ) )
+          break;
+        const QByteArray chunk = file.read( length );
+        const qint64 index = matcher.find( chunk.constData(), chunk.size() );
+        if ( index >= 0 )
+          found = chunkStart + index;
+        // a file truncated meanwhile ends the search
+        if ( chunk.size() < length )
+          break;
+      }
+    }
+
+    if ( !*cancelled )
+    {
+      QMetaObject::invokeMethod( this, [this, cancelled, found]()
+      {
+        if ( !*cancelled )
+          showMatch( found );
+      }, Qt::QueuedConnection );
+    }
+  } );
+}
+
+/*!
+   Paints the rows inside the viewport, highlighting the found pattern
+ */
+void hexViewer_c::paintEvent( QPaintEvent * )
+{
+  QPainter painter( viewport() );
+  painter.setFont( font() );
+
+  if ( !_file.isOpen() )
+    return;
+
+  const QFontMetrics fm( font() );
+  const int charWidth = fm.horizontalAdvance( QLatin1Char( '0' ) );
+  const int rowCount = visibleRowCount() + 1;
+
+  const qint64 topOffset = _topRow * hexFormatter_c::bytesPerRow;
+  const uchar *data = windowData( topOffset, static_cast<qint64>( rowCount ) * hexFormatter_c::bytesPerRow );
+  // the rows available, fewer than the file size promises once the file was truncated
+  const qint64 dataEnd = topOffset + ( ( data != nullptr ) ? _window.size() - ( topOffset - _windowOffset ) : 0 );
+
+  QColor matchColor = palette().color( QPalette::Highlight );
+  matchColor.setAlpha( matchHighlightAlpha );
+  const qint64 matchEnd = _matchOffset + _pattern.size();
+
+  int top = 0;
+  for ( int row = 0; row < rowCount; row++ )
+  {
+    const qint64 offset = ( _topRow + row ) * hexFormatter_c::bytesPerRow;
+    if ( offset >= dataEnd )
+      break;
+    const int size = static_cast<int>( qMin<qint64>( hexFormatter_c::bytesPerRow, dataEnd - offset ) );
+
+    if ( _matchOffset >= 0 && _matchOffset < offset + size && matchEnd > offset )
+    {
+      const int first = static_cast<int>( qMax( _matchOffset, offset ) - offset );
+      const int last = static_cast<int>( qMin( matchEnd, offset + size ) - offset );
+      for ( int index = first; index < last; index++ )
+      {
+        painter.fillRect( textMargin + hexFormatter_c::hexColumn( _offsetDigits, index ) * charWidth, top,
+                          2 * charWidth, fm.lineSpacing(), matchColor );
+        painter.fillRect( textMargin + hexFormatter_c::printableColumn( _offsetDigits, index ) * charWidth, top,
+                          charWidth, fm.lineSpacing(), matchColor );
+      }
+    }
+
+    painter.drawText( textMargin, top + fm.ascent(),
+                      hexFormatter_c::formatRow( offset, _offsetDigits, data + ( offset - topOffset ), size ) );
+    top += fm.lineSpacing();
+  }
+}
+
+/*!
+   Adapts the scroll range to the new viewport size
+ */
+void hexViewer_c::resizeEvent( QResizeEvent *event )
+{
+  QAbstractScrollArea::resizeEvent( event );
+  updateScrollRange();
+}
+
+/*!
+   Handles document navigation keys, Ctrl+G for the jump to an offset, Ctrl+F and F3 for the pattern search
+ */
+void hexViewer_c::keyPressEvent( QKeyEvent *event )
+{
+  if ( event->key() == Qt::Key_G && event->modifiers() == Qt::ControlModifier )
+    askForOffset();
+  else if ( event == QKeySequence::Find )
+    askForPattern();
+  else if ( event == QKeySequence::FindNext )
+    findNext();
+  else if ( event == QKeySequence::MoveToStartOfDocument )
+    scrollToOffset( 0 );
+  else if ( event == QKeySequence::MoveToEndOfDocument )
+    scrollToOffset( _size );
+  else
+    QAbstractScrollArea::keyPressEvent( event );
+}
+
+/*!
+   Repaints the viewport, the top row is defined by the vertical scroll bar position
+ */
+void hexViewer_c::scrollContentsBy( int, int )
+{
+  // keeps a top row set precisely, which a scaled scroll bar position cannot express
+  if ( valueForRow( _topRow ) != verticalScrollBar()->value() )
+    _topRow = rowForValue( verticalScrollBar()->value() );
+  viewport()->update();
+}
+
+/*!
+   \return number of rows of the file
+ */
+qint64 hexViewer_c::rowCount() const
+{
+  return ( _size + hexFormatter_c::bytesPerRow - 1 ) / hexFormatter_c::bytesPerRow;
+}
+
+/*!
+   \return number of rows fully fitting into the viewport
+ */
+int hexViewer_c::visibleRowCount() const
+{
+  return qMax( 1, viewport()->height() / QFontMetrics( font() ).lineSpacing() );
+}
+
+/*!
+   \return the last row that can be on top
+ */
+qint64 hexViewer_c::maximumTopRow() const
+{
+  return qMax<qint64>( 0, rowCount() - visibleRowCount() );
+}
+
+/*!
+   Maps a top row \a row to a scroll bar position, scaled if the file has more rows than the scroll bar positions
+   \param row the top row
+   \return the scroll bar position
+ */
+int hexViewer_c::valueForRow( qint64 row ) const
+{
+  const qint64 maximumRow = maximumTopRow();
+  if ( maximumRow <= std::numeric_limits<int>::max() )
+    return static_cast<int>( row );
+  return static_cast<int>( static_cast<double>( row ) / maximumRow * std::numeric_limits<int>::max() );
+}
+
+/*!
+   Maps a scroll bar position \a value to a top row, see valueForRow()
+   \param value the scroll bar position
+   \return the top row
+ */
+qint64 hexViewer_c::rowForValue( int value ) const
+{
+  const qint64 maximumRow = maximumTopRow();
+  if ( maximumRow <= std::numeric_limits<int>::max() )
+    return value;
+  return static_cast<qint64>( static_cast<double>( value ) / std::numeric_limits<int>::max() * maximumRow );
+}
+
+/*!
+   Adapts the vertical scroll range to the file size and the viewport size
+ */
+void hexViewer_c::updateScrollRange()
+{
+  const qint64 maximumRow = maximumTopRow();
+  _topRow = qMin( _topRow, maximumRow );
+
+  verticalScrollBar()->setPageStep( visibleRowCount() );
+  verticalScrollBar()->setRange( 0, valueForRow( maximumRow ) );
+  verticalScrollBar()->setValue( valueForRow( _topRow ) );
+  viewport()->update();
+}
+
+/*!
+   Provides bytes of the viewed file, read again only where the window read last does not cover them
+   \param offset offset of the first byte
+   \param length number of the bytes
+   \return the bytes at \a offset, fewer than \a length up to the end of the window, nullptr if none can be read
+ */
+const uchar *hexViewer_c::windowData( qint64 offset, qint64 length )
+{
+  const qint64 end = qMin( offset + length, _size );
+  const qint64 windowEnd = _windowOffset + _window.size();
+  if ( offset < _windowOffset || end > windowEnd || _window.isEmpty() )
+  {
+    _window.clear();
+    _windowOffset = offset;
+    if ( offset < _size && _file.seek( offset ) )
+      _window = _file.read( qMin( qMax( length, windowSize ), _size - offset ) );
+  }
+
+  if ( offset < _windowOffset || offset >= _windowOffset + _window.size() )
+    return nullptr;
+  return reinterpret_cast<const uchar *>( _window.constData() ) + ( offset - _windowOffset );
+}
+
+/*!
+   Aborts the pattern search in progress and waits for it to wind down
+ */
+void hexViewer_c::cancelSearch()
+{
+  if ( _searchCancelled )
+    *_searchCancelled = true;
+  _searchFuture.waitForFinished();
+  _searchCancelled.reset();
+}
+
+/*!
+   Highlights an occurrence of the pattern at offset \a offset and scrolls to it, unless visible already
+   \param offset offset of the occurrence, -1 if the pattern was not found
+ */
+void hexViewer_c::showMatch( qint64 offset )
+{
+  _matchOffset = offset;
+  if ( offset < 0 )
+    QToolTip::showText( viewport()->mapToGlobal( viewport()->rect().center() ), tr( "Pattern not found" ), viewport() );
+  else
+  {
+    const qint64 row = offset / hexFormatter_c::bytesPerRow;
+    if ( row < _topRow || row >= _topRow + visibleRowCount() )
+      scrollToOffset( offset );
+  }
+  viewport()->update();
+}
+
+/*!
+   Asks a user for a byte offset, decimal or hex prefixed with 0x, and scrolls to it
+ */
+void hexViewer_c::askForOffset()
+{
+  bool accepted = false;
+  const QString position = QInputDialog::getText( this, tr( "Go to" ), tr( "Byte offset:" ), QLineEdit::Normal,
+                                                  QString(), &accepted ).trimmed();
+  if ( !accepted || position.isEmpty() )
+    return;
+
+  bool valid = false;
+  const qint64 offset = position.toLongLong( &valid, 0 );
+  if ( valid )
+    scrollToOffset( offset );
+}
+
+/*!
+   Asks a user for a pattern and finds its first occurrence from the top row on
+ */
+void hexViewer_c::askForPattern()
+{
+  bool accepted = false;
+  const QString pattern = QInputDialog::getText( this, tr( "Find" ),
+                                                 tr( "Hex bytes, e.g. 7f 45 4c 46, or text, quoted if ambiguous:" ),
+                                                 QLineEdit::Normal, QString(), &accepted );
+  if ( !accepted || pattern.isEmpty() )
+    return;
+
+  _pattern = parsePattern( pattern );
+  _matchOffset = -1;
+  findNext();
+}
+
+/*!
+   Converts a pattern given at \a pattern to the searched bytes
+   Pairs of hex digits, optionally separated by white space, are bytes, text in double quotes or anything else is
+   taken as UTF-8 text.
+   \param pattern the pattern typed by a user
+   \return the searched bytes
+ */
+QByteArray hexViewer_c::parsePattern( const QString &pattern )
+{
+  const QString trimmed = pattern.trimmed();
+  if ( trimmed.size() >= 2 && trimmed.startsWith( '"' ) && trimmed.endsWith( '"' ) )
+    return trimmed.mid( 1, trimmed.size() - 2 ).toUtf8();
+
+  static const QRegularExpression hexBytes( QStringLiteral( "^([0-9A-Fa-f]{2}\\s*)+$" ) );
+  if ( hexBytes.match( trimmed ).hasMatch() )
+    return QByteArray::fromHex( trimmed.toLatin1() );
+
+  return pattern.toUtf8();
+}
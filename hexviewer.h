@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QAbstractScrollArea>
+#include <QByteArray>
+#include <QFile>
+#include <QFuture>
+
+#include <atomic>
+#include <memory>
+
+/*!
+   Read-only hex and ASCII viewer of arbitrarily large files
+   Only the rows inside the viewport are read, through a small window of the file, and formatted and painted, so
+   neither the memory use nor the scrolling cost depend on the file size. The file is never mapped, a file truncated
+   while viewed just shows fewer rows. Ctrl+G asks for a byte offset to jump to. Ctrl+F asks for a pattern, hex bytes
+   or text, searched for in chunks on a worker thread from the top row on, F3 finds the next occurrence.
+ */
+class hexViewer_c : public QAbstractScrollArea
+{
+  Q_OBJECT
+
+  private:
+    // The viewed file
+    QFile _file;
+    // Size of the file when opened
+    qint64 _size;
+    // Bytes of the file read last, covering the viewport
+    QByteArray _window;
+    // Offset of the window in the file
+    qint64 _windowOffset;
+    // Number of hex digits of the row offsets
+    int _offsetDigits;
+    // First row inside the viewport
+    qint64 _topRow;
+    // Last searched pattern
+    QByteArray _pattern;
+    // Occurrence of the pattern highlighted, -1 if none
+    qint64 _matchOffset;
+    // Pattern search in progress
+    QFuture<void> _searchFuture;
+    // Abort flag of the pattern search
+    std::shared_ptr<std::atomic<bool>> _searchCancelled;
+
+  public:
+    hexViewer_c( QWidget * = nullptr );
+    virtual ~hexViewer_c();
+
+    bool setFile( const QString & );
+    bool reload();
+    void clear();
+    QString filePath() const;
+
+  public slots:
+    void scrollToOffset( qint64 );
+    void findNext();
+
+  protected:
+    void paintEvent( QPaintEvent * ) override;
+    void resizeEvent( QResizeEvent * ) override;
+    void keyPressEvent( QKeyEvent * ) override;
+    void scrollContentsBy( int, int ) override;
+
+  private:
+    qint64 rowCount() const;
+    int visibleRowCount() const;
+    qint64 maximumTopRow() const;
+    int valueForRow( qint64 ) const;
+    qint64 rowForValue( int ) const;
+    void updateScrollRange();
+    const uchar *windowData( qint64, qint64 );
+    void cancelSearch();
+    void showMatch( qint64 );
+    void askForOffset();
+    void askForPattern();
+
+    static QByteArray parsePattern( const QString & );
+};
@@ -0,0 +1,389 @@
+#include "largefileviewer.h"
+
+#include <QElapsedTimer>
+#include <QFontDatabase>
+#include <QInputDialog>
+#include <QKeyEvent>
+#include <QLineEdit>
+#include <QPainter>
+#include <QScrollBar>
+#include <QtConcurrent>
+
+#include <cstring>
+#include <limits>
+
+#if defined( Q_OS_UNIX )
+#include <sys/stat.h>
+#endif
+
+#include "lineindex.h"
+
+namespace
+{
+  // Minimal interval between two scroll range updates while the line index is being built, in ms
+  constexpr qint64 indexProgressInterval = 100;
+  // Number of bytes of a single line decoded for painting
+  constexpr qint64 maximumPaintedLineLength = 4096;
+  // Number of bytes read at once for painting
+  constexpr qint64 paintChunkSize = 64 * 1024;
+  // Left margin of the painted text
+  constexpr int textMargin = 4;
+}
+
+/*!
+   C-tor
+   \param parent parent widget
+ */
+largeFileViewer_c::largeFileViewer_c( QWidget *parent ) :
+  QAbstractScrollArea( parent ),
+  _size{ 0 },
+  _pendingLine{ -1 }
+{
+  _indexPool.setMaxThreadCount( 1 );
+
+  setFont( QFontDatabase::systemFont( QFontDatabase::FixedFont ) );
+  setFocusPolicy( Qt::StrongFocus );
+  setVerticalScrollBarPolicy( Qt::ScrollBarAsNeeded );
+  setHorizontalScrollBarPolicy( Qt::ScrollBarAlwaysOff );
+  verticalScrollBar()->setSingleStep( 1 );
+}
+
+/*!
+   D-tor
+   Waits for the aborted line index builds to finish.
+ */
+largeFileViewer_c::~largeFileViewer_c()
+{
+  clear();
+  _indexPool.waitForDone();
+}
+
+/*!
+   Opens a file with a path \a path for viewing and starts indexing its lines
+   \param path path to the file
+   \return true if the file could be opened
+ */
+bool largeFileViewer_c::setFile( const QString &path )
+{
+  clear();
+
+  _file.setFileName( path );
+  if ( !_file.open( QIODevice::ReadOnly | QIODevice::Unbuffered ) )
+    return false;
+
+  _size = _file.size();
+  _lineIndex = std::make_shared<lineIndex_c>();
+  startIndexing();
+
+  verticalScrollBar()->setValue( 0 );
+  updateScrollRange();
+
+  return true;
+}
+
+/*!
+   Brings the view up to date with the viewed file, keeping the scroll position
+   Lines appended to the file are indexed on top of the lines indexed before. A truncated or replaced file is
+   indexed again, the view is scrolled back to its top line once indexed.
+   \return false if the file could not be opened again
+ */
+bool largeFileViewer_c::reload()
+{
+  const QString path = filePath();
+  if ( path.isEmpty() )
+    return false;
+
+  bool sameFile = true;
+#if defined( Q_OS_UNIX )
+  struct stat openedStat;
+  struct stat pathStat;
+  sameFile = ( fstat( _file.handle(), &openedStat ) == 0 &&
+               stat( QFile::encodeName( path ).constData(), &pathStat ) == 0 &&
+               openedStat.st_dev == pathStat.st_dev && openedStat.st_ino == pathStat.st_ino );
+#endif
+
+  const qint64 size = _file.size();
+  if ( !sameFile || size < _size )
+  {
+    const qint64 topLine = verticalScrollBar()->value();
+    if ( !setFile( path ) )
+      return false;
+    scrollToLine( topLine );
+    return true;
+  }
+
+  if ( size > _size )
+  {
+    // a build in progress continues up to the new size once done
+    _size = size;
+    if ( _lineIndex->isComplete() )
+      startIndexing();
+  }
+  viewport()->update();
+
+  return true;
+}
+
+/*!
+   Closes the viewed file, aborting the line index build
+   The aborted build is not waited for, it stops at its next chunk.
+ */
+void largeFileViewer_c::clear()
+{
+  if ( _indexCancelled )
+    *_indexCancelled = true;
+
+  _file.close();
+  _file.setFileName( QString() );
+
+  _size = 0;
+  _lineIndex.reset();
+  _indexCancelled.reset();
+  _pendingLine = -1;
+
+  updateScrollRange();
+}
+
+/*!
+   \return path to the viewed file
+ */
+QString largeFileViewer_c::filePath() const
+{
+  return _file.fileName();
+}
+
+/*!
+   Slot to scroll the view, so the line \a line is on top
+   A line not indexed yet is scrolled to once the line index build reaches it.
+   \param line zero-based line number
+ */
+void largeFileViewer_c::scrollToLine( qint64 line )
+{
+  _pendingLine = ( _lineIndex && !_lineIndex->isComplete() && line > verticalScrollBar()->maximum() ) ? line : -1;
+  verticalScrollBar()->setValue( static_cast<int>( qBound<qint64>( 0, line, verticalScrollBar()->maximum() ) ) );
+}
+
+/*!
+   Slot to scroll the view, so the line containing byte offset \a offset is on top
+   \param offset the byte offset
+ */
+void largeFileViewer_c::scrollToOffset( qint64 offset )
+{
+  if ( _lineIndex )
+    scrollToLine( _lineIndex->lineAt( _file, _size, offset ) );
+}
+
+/*!
+   Paints the lines inside the viewport
+ */
+void largeFileViewer_c::paintEvent( QPaintEvent * )
+{
+  QPainter painter( viewport() );
+  painter.setFont( font() );
+
+  if ( !_file.isOpen() || !_lineIndex )
+    return;
+
+  const QFontMetrics fm( font() );
+  const int lineCount = visibleLineCount() + 1;
+
+  qint64 offset = _lineIndex->lineOffset( _file, _size, verticalScrollBar()->value() );
+  int baseline = fm.ascent();
+
+  // the lines are read a chunk at a time, a chunk holds the painted part of a line at least
+  QByteArray chunk;
+  qint64 chunkOffset = offset;
+  for ( int row = 0; row < lineCount && offset < _size; row++ )
+  {
+    if ( offset + maximumPaintedLineLength > chunkOffset + chunk.size() && chunkOffset + chunk.size() < _size )
+    {
+      chunk = readAt( offset, paintChunkSize );
+      chunkOffset = offset;
+    }
+
+    const qint64 available = chunkOffset + chunk.size() - offset;
+    if ( available <= 0 )
+      break;
+
+    const char *line = chunk.constData() + ( offset - chunkOffset );
+    const qint64 paintedLimit = qMin( available, maximumPaintedLineLength );
+    const void *newLine = std::memchr( line, '\n', static_cast<size_t>( paintedLimit ) );
+
+    qint64 lineLength = newLine ? static_cast<const char *>( newLine ) - line : paintedLimit;
+    // the rest of a line longer than painted is skipped
+    const qint64 nextOffset = newLine ? offset + lineLength + 1 : nextLineOffset( offset + lineLength );
+
+    if ( lineLength > 0 && line[ lineLength - 1 ] == '\r' )
+      lineLength--;
+
+    painter.drawText( textMargin, baseline, QString::fromUtf8( line, static_cast<int>( lineLength ) ) );
+
+    baseline += fm.lineSpacing();
+    offset = nextOffset;
+  }
+}
+
+/*!
+   Adapts the scroll range to the new viewport size
+ */
+void largeFileViewer_c::resizeEvent( QResizeEvent *event )
+{
+  QAbstractScrollArea::resizeEvent( event );
+  updateScrollRange();
+}
+
+/*!
+   Handles document navigation keys and Ctrl+G for the jump to a position
+ */
+void largeFileViewer_c::keyPressEvent( QKeyEvent *event )
+{
+  if ( event->key() == Qt::Key_G && event->modifiers() == Qt::ControlModifier )
+    askForPosition();
+  else if ( event == QKeySequence::MoveToStartOfDocument )
+    verticalScrollBar()->triggerAction( QAbstractSlider::SliderToMinimum );
+  else if ( event == QKeySequence::MoveToEndOfDocument )
+    verticalScrollBar()->triggerAction( QAbstractSlider::SliderToMaximum );
+  else
+    QAbstractScrollArea::keyPressEvent( event );
+}
+
+/*!
+   Repaints the viewport, the top line is defined by the vertical scroll bar position
+ */
+void largeFileViewer_c::scrollContentsBy( int, int )
+{
+  viewport()->update();
+}
+
+/*!
+   Indexes the lines of the viewed file on a worker, from the end of the lines indexed before up to its size
+   Once done, the build continues if the file grew meanwhile, see \em reload.
+ */
+void largeFileViewer_c::startIndexing()
+{
+  _indexCancelled = std::make_shared<std::atomic<bool>>( false );
+
+  auto lineIndex = _lineIndex;
+  auto cancelled = _indexCancelled;
+  const QString path = _file.fileName();
+  const qint64 size = _size;
+
+  QtConcurrent::run( &_indexPool, [this, lineIndex, cancelled, path, size]()
+  {
+    QFile file( path );
+    if ( !file.open( QIODevice::ReadOnly | QIODevice::Unbuffered ) )
+      return;
+
+    QElapsedTimer progressTimer;
+    progressTimer.start();
+
+    lineIndex->build( file, size, *cancelled, [this, cancelled, &progressTimer]()
+    {
+      if ( progressTimer.elapsed() < indexProgressInterval || *cancelled )
+        return;
+
+      progressTimer.restart();
+      QMetaObject::invokeMethod( this, [this]() { updateScrollRange(); }, Qt::QueuedConnection );
+    } );
+
+    if ( *cancelled )
+      return;
+
+    QMetaObject::invokeMethod( this, [this, lineIndex, size]()
+    {
+      if ( lineIndex != _lineIndex )
+        return;
+
+      updateScrollRange();
+      if ( _size > size )
+        startIndexing();
+    }, Qt::QueuedConnection );
+  } );
+}
+
+/*!
+   Reads bytes of the viewed file
+   \param offset offset of the first byte
+   \param length number of bytes to read
+   \return the bytes, shorter than \a length at the end of the file, empty if the file was truncated before
+ */
+QByteArray largeFileViewer_c::readAt( qint64 offset, qint64 length )
+{
+  if ( offset >= _size || !_file.seek( offset ) )
+    return QByteArray();
+
+  return _file.read( qMin( length, _size - offset ) );
+}
+
+/*!
+   \param offset byte offset within a line
+   \return offset of the next line, the file size if none
+ */
+qint64 largeFileViewer_c::nextLineOffset( qint64 offset )
+{
+  for ( ;; )
+  {
+    const QByteArray chunk = readAt( offset, paintChunkSize );
+    if ( chunk.isEmpty() )
+      return _size;
+
+    const void *newLine = std::memchr( chunk.constData(), '\n', static_cast<size_t>( chunk.size() ) );
+    if ( newLine != nullptr )
+      return offset + ( static_cast<const char *>( newLine ) - chunk.constData() ) + 1;
+    offset += chunk.size();
+  }
+}
+
+/*!
+   \return number of lines fully fitting into the viewport
+ */
+int largeFileViewer_c::visibleLineCount() const
+{
+  return qMax( 1, viewport()->height() / QFontMetrics( font() ).lineSpacing() );
+}
+
+/*!
+   Adapts the vertical scroll range to the number of lines indexed so far
+ */
+void largeFileViewer_c::updateScrollRange()
+{
+  const qint64 lineCount = _lineIndex ? _lineIndex->lineCount() : 0;
+  const qint64 maximum = qMax<qint64>( 0, lineCount - visibleLineCount() );
+
+  verticalScrollBar()->setPageStep( visibleLineCount() );
+  verticalScrollBar()->setRange( 0, static_cast<int>( qMin<qint64>( maximum, std::numeric_limits<int>::max() ) ) );
+
+  if ( _pendingLine >= 0 && ( _pendingLine <= verticalScrollBar()->maximum() || _lineIndex->isComplete() ) )
+  {
+    const qint64 line = _pendingLine;
+    _pendingLine = -1;
+    verticalScrollBar()->setValue( static_cast<int>( qMin<qint64>( line, verticalScrollBar()->maximum() ) ) );
+  }
+  viewport()->update();
+}
+
+/*!
+   Asks a user for a line number or a byte offset prefixed with '@' and scrolls to it
+ */
+void largeFileViewer_c::askForPosition()
+{
+  bool accepted = false;
+  const QString position = QInputDialog::getText( this, tr( "Go to" ), tr( "Line number or @byte offset:" ),
+                                                  QLineEdit::Normal, QString(), &accepted ).trimmed();
+  if ( !accepted || position.isEmpty() )
+    return;
+
+  bool valid = false;
+  if ( position.startsWith( '@' ) )
+  {
+    const qint64 offset = position.mid( 1 ).toLongLong( &valid, 0 );
+    if ( valid )
+      scrollToOffset( offset );
+  }
+  else
+  {
+    const qint64 line = position.toLongLong( &valid );
+    if ( valid )
+      scrollToLine( line - 1 );
+  }
+}
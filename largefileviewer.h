@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QAbstractScrollArea>
+#include <QFile>
+#include <QThreadPool>
+
+#include <atomic>
+#include <memory>
+
+class lineIndex_c;
+
+/*!
+   Read-only viewer of arbitrarily large text files
+   A sparse line index is built on a worker thread, while only the lines inside the viewport are read, decoded
+   and painted. The file is read rather than memory-mapped, so a file truncated while viewed shows fewer lines
+   instead of crashing the process. Any line or byte offset can be jumped to at once, Ctrl+G asks for a line
+   number, or a byte offset prefixed with '@'.
+ */
+class largeFileViewer_c : public QAbstractScrollArea
+{
+  Q_OBJECT
+
+  private:
+    // The viewed file, read by the GUI thread only
+    QFile _file;
+    // Size of the viewed file
+    qint64 _size;
+    // Line index of the file
+    std::shared_ptr<lineIndex_c> _lineIndex;
+    // Builds the line index
+    QThreadPool _indexPool;
+    // Abort flag of the line index build
+    std::shared_ptr<std::atomic<bool>> _indexCancelled;
+    // Line to scroll to once indexed, -1 if none
+    qint64 _pendingLine;
+
+  public:
+    largeFileViewer_c( QWidget * = nullptr );
+    virtual ~largeFileViewer_c();
+
+    bool setFile( const QString & );
+    bool reload();
+    void clear();
+    QString filePath() const;
+
+  public slots:
+    void scrollToLine( qint64 );
+    void scrollToOffset( qint64 );
+
+  protected:
+    void paintEvent( QPaintEvent * ) override;
+    void resizeEvent( QResizeEvent * ) override;
+    void keyPressEvent( QKeyEvent * ) override;
+    void scrollContentsBy( int, int ) override;
+
+  private:
+    void startIndexing();
+    QByteArray readAt( qint64, qint64 );
+    qint64 nextLineOffset( qint64 );
+    int visibleLineCount() const;
+    void updateScrollRange();
+    void askForPosition();
+};
@@ -0,0 +1,208 @@
+#include "lineindex.h"
+
+#include <QFile>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+  // Amount of bytes indexed between two publications of the progress
+  constexpr qint64 indexChunkSize = 4 * 1024 * 1024;
+  // Amount of bytes read at once while looking for a line
+  constexpr qint64 scanChunkSize = 64 * 1024;
+}
+
+/*!
+   C-tor
+ */
+lineIndex_c::lineIndex_c() :
+  _checkpoints{ 0 },
+  _lineCount{ 0 },
+  _lineFeedCount{ 0 },
+  _indexedSize{ 0 },
+  _endsWithLineFeed{ true },
+  _complete{ false }
+{
+}
+
+/*!
+   Indexes lines of a file \a file up to a size \a size, from the end of the part indexed before on
+   Intended to run on a worker thread. The progress is published after every indexed chunk. A read ending short
+   of \a size, the file was truncated meanwhile, completes the index.
+   \param file the file, open for reading
+   \param size size of the file to index
+   \param cancelled set to true to abort the build
+   \param progress called after every indexed chunk
+ */
+void lineIndex_c::build( QFile &file, qint64 size, const std::atomic<bool> &cancelled,
+                         const std::function<void()> &progress )
+{
+  qint64 line = 0;
+  qint64 position = 0;
+  bool endsWithLineFeed = true;
+  {
+    QMutexLocker locker( &_mutex );
+    line = _lineFeedCount;
+    position = _indexedSize;
+    endsWithLineFeed = _endsWithLineFeed;
+    _complete = false;
+  }
+
+  QByteArray chunk;
+  std::vector<qint64> chunkCheckpoints;
+  while ( position < size && !cancelled )
+  {
+    if ( !file.seek( position ) )
+      break;
+    chunk = file.read( std::min( size - position, indexChunkSize ) );
+    if ( chunk.isEmpty() )
+      break;
+
+    const char *data = chunk.constData();
+    const qint64 chunkSize = chunk.size();
+    chunkCheckpoints.clear();
+    for ( qint64 chunkPosition = 0; chunkPosition < chunkSize; )
+    {
+      const void *newLine = std::memchr( data + chunkPosition, '\n', static_cast<size_t>( chunkSize - chunkPosition ) );
+      if ( newLine == nullptr )
+        break;
+
+      chunkPosition = static_cast<const char *>( newLine ) - data + 1;
+      if ( ++line % checkpointInterval == 0 )
+        chunkCheckpoints.push_back( position + chunkPosition );
+    }
+    position += chunkSize;
+    endsWithLineFeed = ( data[ chunkSize - 1 ] == '\n' );
+
+    {
+      QMutexLocker locker( &_mutex );
+      _checkpoints.insert( _checkpoints.end(), chunkCheckpoints.begin(), chunkCheckpoints.end() );
+      _lineCount = line;
+      _lineFeedCount = line;
+      _indexedSize = position;
+      _endsWithLineFeed = endsWithLineFeed;
+    }
+
+    if ( progress )
+      progress();
+  }
+
+  if ( cancelled )
+    return;
+
+  QMutexLocker locker( &_mutex );
+  // the last line is not terminated by a line feed
+  _lineCount = endsWithLineFeed ? line : line + 1;
+  _complete = true;
+}
+
+/*!
+   \return number of lines indexed so far
+ */
+qint64 lineIndex_c::lineCount() const
+{
+  QMutexLocker locker( &_mutex );
+  return _lineCount;
+}
+
+/*!
+   \return number of bytes indexed so far
+ */
+qint64 lineIndex_c::indexedSize() const
+{
+  QMutexLocker locker( &_mutex );
+  return _indexedSize;
+}
+
+/*!
+   \return true if the file is indexed up to the size given to the last build
+ */
+bool lineIndex_c::isComplete() const
+{
+  QMutexLocker locker( &_mutex );
+  return _complete;
+}
+
+/*!
+   Finds byte offset of a line \a line in the indexed file \a file of size \a size
+   \param file the indexed file, open for reading
+   \param size size of the file
+   \param line zero-based line number
+   \return offset of the line, \a size if the line is beyond the end of the file
+ */
+qint64 lineIndex_c::lineOffset( QFile &file, qint64 size, qint64 line ) const
+{
+  qint64 checkpoint = 0;
+  qint64 offset = 0;
+  {
+    QMutexLocker locker( &_mutex );
+    checkpoint = std::min<qint64>( line / checkpointInterval, static_cast<qint64>( _checkpoints.size() ) - 1 );
+    offset = _checkpoints[ static_cast<size_t>( checkpoint ) ];
+  }
+
+  qint64 currentLine = checkpoint * checkpointInterval;
+  while ( currentLine < line && offset < size )
+  {
+    if ( !file.seek( offset ) )
+      return size;
+    const QByteArray chunk = file.read( std::min( size - offset, scanChunkSize ) );
+    if ( chunk.isEmpty() )
+      return size;
+
+    const char *data = chunk.constData();
+    qint64 chunkPosition = 0;
+    while ( currentLine < line && chunkPosition < chunk.size() )
+    {
+      const void *newLine = std::memchr( data + chunkPosition, '\n',
+                                         static_cast<size_t>( chunk.size() - chunkPosition ) );
+      if ( newLine == nullptr )
+      {
+        chunkPosition = chunk.size();
+        break;
+      }
+      chunkPosition = static_cast<const char *>( newLine ) - data + 1;
+      currentLine++;
+    }
+    offset += chunkPosition;
+  }
+
+  return ( currentLine < line ) ? size : std::min( offset, size );
+}
+
+/*!
+   Finds a line containing a byte offset \a offset in the indexed file \a file of size \a size
+   \param file the indexed file, open for reading
+   \param size size of the file
+   \param offset the byte offset
+   \return zero-based line number
+ */
+qint64 lineIndex_c::lineAt( QFile &file, qint64 size, qint64 offset ) const
+{
+  offset = std::max<qint64>( 0, std::min( offset, size ) );
+
+  qint64 checkpoint = 0;
+  qint64 position = 0;
+  {
+    QMutexLocker locker( &_mutex );
+    const auto checkpointIt = std::upper_bound( _checkpoints.begin(), _checkpoints.end(), offset );
+    checkpoint = ( checkpointIt - _checkpoints.begin() ) - 1;
+    position = _checkpoints[ static_cast<size_t>( checkpoint ) ];
+  }
+
+  qint64 line = checkpoint * checkpointInterval;
+  while ( position < offset )
+  {
+    if ( !file.seek( position ) )
+      break;
+    const QByteArray chunk = file.read( std::min( offset - position, scanChunkSize ) );
+    if ( chunk.isEmpty() )
+      break;
+
+    line += std::count( chunk.constData(), chunk.constData() + chunk.size(), '\n' );
+    position += chunk.size();
+  }
+
+  return line;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QMutex>
+#include <QtGlobal>
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+class QFile;
+
+/*!
+   Sparse index of line offsets within a text file
+   Only the offset of every \em checkpointInterval-th line is stored, so the index stays small even for huge files
+   while any line or byte offset is reached by scanning at most \em checkpointInterval lines from a checkpoint.
+   The file is read in chunks rather than mapped, so a file truncated meanwhile just ends the index early. The index
+   is built by a worker thread and can be queried concurrently while the build is in progress. A complete index is
+   extended by building it again once the file grew.
+ */
+class lineIndex_c
+{
+  public:
+    // Number of lines between two stored offsets
+    static constexpr qint64 checkpointInterval = 1024;
+
+  private:
+    mutable QMutex _mutex;
+    // Offsets of lines 0, checkpointInterval, 2 * checkpointInterval, ...
+    std::vector<qint64> _checkpoints;
+    // Number of lines indexed so far
+    qint64 _lineCount;
+    // Number of line feeds indexed so far
+    qint64 _lineFeedCount;
+    // Number of bytes indexed so far
+    qint64 _indexedSize;
+    // The last indexed byte is a line feed
+    bool _endsWithLineFeed;
+    // True once the file is indexed up to the size given to the build
+    bool _complete;
+
+  public:
+    lineIndex_c();
+
+    void build( QFile &, qint64, const std::atomic<bool> &, const std::function<void()> & );
+
+    qint64 lineCount() const;
+    qint64 indexedSize() const;
+    bool isComplete() const;
+
+    qint64 lineOffset( QFile &, qint64, qint64 ) const;
+    qint64 lineAt( QFile &, qint64, qint64 ) const;
+};
@@ -0,0 +1,162 @@
+#include "literalmatcher.h"
+
+#include <cstring>
+
+#if defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+  /*!
+     \param byte a byte
+     \return the byte with ASCII letters folded to lower case
+   */
+  inline char foldByte( char byte )
+  {
+    return ( byte >= 'A' && byte <= 'Z' ) ? static_cast<char>( byte + ( 'a' - 'A' ) ) : byte;
+  }
+
+  /*!
+     \param byte a byte
+     \return the byte with ASCII letters raised to upper case
+   */
+  inline char raiseByte( char byte )
+  {
+    return ( byte >= 'a' && byte <= 'z' ) ? static_cast<char>( byte - ( 'a' - 'A' ) ) : byte;
+  }
+}
+
+/*!
+   C-tor
+   \param literal the searched literal
+   \param caseSensitive false to ignore case of ASCII letters
+ */
+literalMatcher_c::literalMatcher_c( const QByteArray &literal, bool caseSensitive ) :
+  _literal{ literal },
+  _caseSensitive{ caseSensitive }
+{
+  if ( !_caseSensitive )
+  {
+    for ( auto &byte : _literal )
+      byte = foldByte( byte );
+  }
+}
+
+/*!
+   \return true if the literal is empty
+ */
+bool literalMatcher_c::isEmpty() const
+{
+  return _literal.isEmpty();
+}
+
+/*!
+   \return length of the literal in bytes
+ */
+int literalMatcher_c::length() const
+{
+  return _literal.size();
+}
+
+/*!
+   Finds the first occurrence of the literal in a buffer \a data at or after an offset \a from
+   \param data the buffer
+   \param size size of the buffer
+   \param from offset to search from
+   \return offset of the occurrence, -1 if there is none
+ */
+qint64 literalMatcher_c::find( const char *data, qint64 size, qint64 from ) const
+{
+  const qint64 length = _literal.size();
+  if ( length == 0 || from < 0 || size - from < length )
+    return -1;
+
+#if defined( __SSE2__ )
+  const char first = _literal.at( 0 );
+  const char last = _literal.at( static_cast<int>( length - 1 ) );
+  const __m128i firstLower = _mm_set1_epi8( first );
+  const __m128i lastLower = _mm_set1_epi8( last );
+  const __m128i firstUpper = _mm_set1_epi8( _caseSensitive ? first : raiseByte( first ) );
+  const __m128i lastUpper = _mm_set1_epi8( _caseSensitive ? last : raiseByte( last ) );
+
+  qint64 position = from;
+  // both 16-byte loads stay inside the buffer
+  for ( ; position + length - 1 + 16 <= size; position += 16 )
+  {
+    const __m128i firstBlock = _mm_loadu_si128( reinterpret_cast<const __m128i *>( data + position ) );
+    const __m128i lastBlock = _mm_loadu_si128( reinterpret_cast<const __m128i *>( data + position + length - 1 ) );
+    const __m128i firstMatches = _mm_or_si128( _mm_cmpeq_epi8( firstBlock, firstLower ),
+                                               _mm_cmpeq_epi8( firstBlock, firstUpper ) );
+    const __m128i lastMatches = _mm_or_si128( _mm_cmpeq_epi8( lastBlock, lastLower ),
+                                              _mm_cmpeq_epi8( lastBlock, lastUpper ) );
+
+    unsigned mask = static_cast<unsigned>( _mm_movemask_epi8( _mm_and_si128( firstMatches, lastMatches ) ) );
+    while ( mask != 0 )
+    {
+      const int bit = __builtin_ctz( mask );
+      if ( matchesAt( data + position + bit ) )
+        return position + bit;
+      mask &= mask - 1;
+    }
+  }
+
+  return findScalar( data, size, position );
+#else
+  return findScalar( data, size, from );
+#endif
+}
+
+/*!
+   Checks if the literal occurs at a position \a data
+   \param data the position, at least the literal length of bytes available
+   \return true if the literal occurs
+ */
+bool literalMatcher_c::matchesAt( const char *data ) const
+{
+  if ( _caseSensitive )
+    return std::memcmp( data, _literal.constData(), static_cast<size_t>( _literal.size() ) ) == 0;
+
+  for ( int index = 0; index < _literal.size(); index++ )
+  {
+    if ( foldByte( data[ index ] ) != _literal.at( index ) )
+      return false;
+  }
+  return true;
+}
+
+/*!
+   Finds the first occurrence of the literal byte by byte, skipping to the candidates with \em memchr
+   \param data the buffer
+   \param size size of the buffer
+   \param from offset to search from
+   \return offset of the occurrence, -1 if there is none
+ */
+qint64 literalMatcher_c::findScalar( const char *data, qint64 size, qint64 from ) const
+{
+  const qint64 length = _literal.size();
+  const char first = _literal.at( 0 );
+  const char firstUpper = raiseByte( first );
+  const bool foldFirst = !_caseSensitive && firstUpper != first;
+
+  for ( qint64 position = from; position + length <= size; position++ )
+  {
+    if ( !foldFirst )
+    {
+      const void *candidate = std::memchr( data + position, first,
+                                           static_cast<size_t>( size - length + 1 - position ) );
+      if ( candidate == nullptr )
+        return -1;
+      position = static_cast<const char *>( candidate ) - data;
+    }
+    else if ( data[ position ] != first && data[ position ] != firstUpper )
+    {
+      continue;
+    }
+
+    if ( matchesAt( data + position ) )
+      return position;
+  }
+
+  return -1;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QByteArray>
+
+/*!
+   Finds occurrences of a byte literal in a buffer
+   With SSE2, 16 candidate positions are tested at once by comparing the first and the last byte of the literal,
+   only positions matching both are compared in full. Elsewhere, \em memchr skips to the candidates of the first
+   byte. Case-insensitive matching folds ASCII letters only.
+ */
+class literalMatcher_c
+{
+  private:
+    // The literal, folded to lower case if case-insensitive
+    QByteArray _literal;
+    bool _caseSensitive;
+
+  public:
+    literalMatcher_c( const QByteArray &, bool );
+
+    bool isEmpty() const;
+    int length() const;
+    qint64 find( const char *, qint64, qint64 = 0 ) const;
+
+  private:
+    bool matchesAt( const char * ) const;
+    qint64 findScalar( const char *, qint64, qint64 ) const;
+};
@@ -0,0 +1,513 @@
+#include "logtailer.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <vector>
+
+#if defined( Q_OS_UNIX )
+#include <sys/stat.h>
+#endif
+
+#if defined( Q_OS_LINUX )
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+  // Interval collecting the changes of the file into a single read, in ms
+  constexpr int batchInterval = 100;
+  // Interval between two polls of a file that cannot be watched, in ms
+  constexpr int pollInterval = 500;
+  // Number of bytes scanned backwards for the last lines at once
+  constexpr qint64 scanChunkSize = 64 * 1024;
+  // Number of bytes of the lines delivered in a single batch at most, a larger batch is skipped to its last lines
+  constexpr qint64 maximumTailSize = 1024 * 1024;
+  // Number of bytes of an unfinished line held back at most, a longer one is delivered as it is
+  constexpr int maximumPartialLineSize = 64 * 1024;
+  // Size of the event read buffer
+  constexpr size_t eventBufferSize = 16 * 1024;
+}
+
+/*!
+   Followed file, used by the reader only
+ */
+struct logTailer_c::tailState_s
+{
+  QFile file;
+  // Offset of the next byte to be read
+  qint64 offset = 0;
+  // Identity of the open file, compared to the file at the path to detect a rotation
+  quint64 device = 0;
+  quint64 inode = 0;
+  // Read bytes of the last line, not finished yet
+  QByteArray partialLine;
+};
+
+namespace
+{
+  using tailState_t = logTailer_c::tailState_s;
+
+  /*!
+     Outcome of a read of the followed file
+   */
+  struct tailRead_s
+  {
+    // The text replaces the followed text rather than being appended to it
+    bool reset = false;
+    QByteArray text;
+  };
+
+  /*!
+     Opens the file given at \a path for \a state, to be read from its start
+     \param state the followed file
+     \param path absolute path to the file
+     \return false if the file cannot be opened
+   */
+  bool openFile( tailState_t &state, const QString &path )
+  {
+    state.file.close();
+    state.file.setFileName( path );
+    state.offset = 0;
+    state.partialLine.clear();
+    // unbuffered, so the data appended after the end was read once are not missed
+    if ( !state.file.open( QIODevice::ReadOnly | QIODevice::Unbuffered ) )
+      return false;
+
+#if defined( Q_OS_UNIX )
+    struct stat fileStat;
+    if ( fstat( state.file.handle(), &fileStat ) == 0 )
+    {
+      state.device = static_cast<quint64>( fileStat.st_dev );
+      state.inode = static_cast<quint64>( fileStat.st_ino );
+    }
+#endif
+    return true;
+  }
+
+  /*!
+     \param state the followed file
+     \param path absolute path to the file
+     \return true if the file open in \a state was replaced by another file at \a path
+   */
+  bool isRotated( const tailState_t &state, const QString &path )
+  {
+#if defined( Q_OS_UNIX )
+    // a file moved away and not created again yet is followed further
+    struct stat pathStat;
+    return stat( QFile::encodeName( path ).constData(), &pathStat ) == 0 &&
+           ( static_cast<quint64>( pathStat.st_dev ) != state.device ||
+             static_cast<quint64>( pathStat.st_ino ) != state.inode );
+#else
+    Q_UNUSED( state )
+    Q_UNUSED( path )
+    return false;
+#endif
+  }
+
+  /*!
+     Finds the last lines of the file open in \a state by scanning it backwards from \a end in chunks
+     \param state the followed file
+     \param end end of the scanned part of the file
+     \param lineCount number of the lines
+     \return offset of the first of the lines, no further than \em maximumTailSize from \a end
+   */
+  qint64 tailStart( tailState_t &state, qint64 end, int lineCount )
+  {
+    if ( lineCount <= 0 )
+      return end;
+
+    const qint64 limit = std::max<qint64>( end - maximumTailSize, 0 );
+    std::vector<char> chunk( static_cast<size_t>( scanChunkSize ) );
+    int newlineCount = 0;
+    qint64 firstNewline = -1;
+    for ( qint64 position = end; position > limit; )
+    {
+      const qint64 chunkStart = std::max( position - scanChunkSize, limit );
+      const qint64 chunkLength = position - chunkStart;
+      if ( !state.file.seek( chunkStart ) || state.file.read( chunk.data(), chunkLength ) != chunkLength )
+        return end;
+
+      for ( qint64 index = chunkLength - 1; index >= 0; index-- )
+      {
+        // a newline ending the part ends its last line rather than starting another one
+        if ( chunk[ static_cast<size_t>( index ) ] != '\n' || chunkStart + index == end - 1 )
+          continue;
+        if ( ++newlineCount == lineCount )
+          return chunkStart + index + 1;
+        firstNewline = chunkStart + index;
+      }
+      position = chunkStart;
+    }
+
+    // the lines cut by the size limit start after a newline, unless a single line exceeds the limit
+    return ( limit == 0 || firstNewline < 0 ) ? limit : firstNewline + 1;
+  }
+
+  /*!
+     Reads the file open in \a state from its read position up to \a end
+     Complete lines are delivered, the last line is held back in \a state until it is finished.
+     \param state the followed file
+     \param end end of the read part of the file
+     \param text receives the lines
+   */
+  void readLines( tailState_t &state, qint64 end, QByteArray &text )
+  {
+    if ( end <= state.offset || !state.file.seek( state.offset ) )
+      return;
+
+    QByteArray bytes = state.partialLine;
+    const int heldSize = bytes.size();
+    bytes.resize( heldSize + static_cast<int>( end - state.offset ) );
+    const qint64 bytesRead = state.file.read( bytes.data() + heldSize, end - state.offset );
+    if ( bytesRead <= 0 )
+      return;
+    bytes.truncate( heldSize + static_cast<int>( bytesRead ) );
+    state.offset += bytesRead;
+
+    const int lineEnd = bytes.lastIndexOf( '\n' ) + 1;
+    if ( bytes.size() - lineEnd >= maximumPartialLineSize )
+    {
+      text.append( bytes );
+      state.partialLine.clear();
+    }
+    else
+    {
+      text.append( bytes.constData(), lineEnd );
+      state.partialLine = bytes.mid( lineEnd );
+    }
+  }
+
+  /*!
+     Reads the last lines of the file open in \a state up to \a end, the file is read from \a end further
+     \param state the followed file
+     \param end end of the read part of the file
+     \param lineCount number of the lines
+     \param result receives the lines, replacing the followed text
+   */
+  void readTail( tailState_t &state, qint64 end, int lineCount, tailRead_s &result )
+  {
+    state.partialLine.clear();
+    state.offset = tailStart( state, end, lineCount );
+    result.reset = true;
+    result.text.clear();
+    readLines( state, end, result.text );
+  }
+
+  /*!
+     Cuts lines \a text to its last \a lineCount lines
+     \param text the lines, each ended by a newline but an unfinished last one
+     \param lineCount number of the lines kept
+     \return false if \a text has no more lines than \a lineCount
+   */
+  bool keepLastLines( QByteArray &text, int lineCount )
+  {
+    if ( lineCount <= 0 )
+      return false;
+
+    // a newline ending the text ends its last line rather than starting another one
+    int position = text.size() - 1;
+    if ( position >= 0 && text.at( position ) == '\n' )
+      position--;
+
+    for ( int newlineCount = 0; position >= 0; position-- )
+    {
+      if ( text.at( position ) == '\n' && ++newlineCount == lineCount )
+      {
+        text.remove( 0, position + 1 );
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /*!
+     Reads the changes of the file given at \a path since the previous read
+     A batch of more than \a lineCount lines or of more than \em maximumTailSize bytes is skipped to its last lines,
+     replacing the followed text.
+     \param state the followed file, not open before the first read
+     \param path absolute path to the file
+     \param lineCount number of the last lines read on a start or a reset
+     \return the changes
+   */
+  tailRead_s readFileChanges( tailState_t &state, const QString &path, int lineCount )
+  {
+    tailRead_s result;
+    if ( !state.file.isOpen() )
+    {
+      // a file not created yet is shown empty until it is
+      result.reset = true;
+      if ( openFile( state, path ) )
+        readTail( state, state.file.size(), lineCount, result );
+      return result;
+    }
+
+    if ( isRotated( state, path ) )
+    {
+      // the rest of the rotated file comes before the new file
+      const qint64 rotatedSize = state.file.size();
+      if ( rotatedSize - state.offset > maximumTailSize )
+        readTail( state, rotatedSize, lineCount, result );
+      else
+        readLines( state, rotatedSize, result.text );
+      if ( !state.partialLine.isEmpty() )
+        result.text.append( state.partialLine ).append( '\n' );
+      if ( !openFile( state, path ) )
+        return result;
+    }
+
+    const qint64 size = state.file.size();
+    if ( size < state.offset || size - state.offset > maximumTailSize )
+    {
+      // a truncated file starts again, the lines appended faster than they can be shown are skipped
+      readTail( state, size, lineCount, result );
+      return result;
+    }
+
+    readLines( state, size, result.text );
+    if ( keepLastLines( result.text, lineCount ) )
+      result.reset = true;
+    return result;
+  }
+}
+
+/*!
+   C-tor
+   \param parent parent object
+ */
+logTailer_c::logTailer_c( QObject *parent ) :
+  QObject( parent ),
+  _lineCount{ 0 },
+  _generation{ 0 },
+  _reading{ false },
+  _readPending{ false },
+  _inotifyFd{ -1 },
+  _inotifyNotifier{ nullptr },
+  _fileWatch{ -1 },
+  _folderWatch{ -1 },
+  _batchTimer{ nullptr }
+{
+  _readerPool.setMaxThreadCount( 1 );
+
+  _batchTimer = new QTimer( this );
+  connect( _batchTimer, &QTimer::timeout, this, &logTailer_c::readChanges );
+
+#if defined( Q_OS_LINUX )
+  _inotifyFd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+  if ( _inotifyFd >= 0 )
+  {
+    _inotifyNotifier = new QSocketNotifier( _inotifyFd, QSocketNotifier::Read, this );
+    connect( _inotifyNotifier, QOverload<int>::of( &QSocketNotifier::activated ),
+             this, &logTailer_c::readInotifyEvents );
+  }
+#endif
+}
+
+/*!
+   D-tor
+   Stops the following and waits for the reader to finish.
+ */
+logTailer_c::~logTailer_c()
+{
+  stop();
+  _readerPool.waitForDone();
+
+#if defined( Q_OS_LINUX )
+  if ( _inotifyFd >= 0 )
+    close( _inotifyFd );
+#endif
+}
+
+/*!
+   Starts following a file given at \a path, any previously followed file is not followed anymore
+   The last lines of the file are delivered through \em tailReset, the lines appended later through
+   \em tailAppended.
+   \param path absolute path to the file
+   \param lineCount number of the last lines delivered on the start or a reset
+ */
+void logTailer_c::follow( const QString &path, int lineCount )
+{
+  stop();
+  if ( path.isEmpty() )
+    return;
+
+  _path = path;
+  _lineCount = lineCount;
+  _state = std::make_shared<tailState_s>();
+
+  addWatches();
+  if ( _fileWatch < 0 && _folderWatch < 0 )
+  {
+    _batchTimer->setSingleShot( false );
+    _batchTimer->setInterval( pollInterval );
+    _batchTimer->start();
+  }
+  else
+  {
+    _batchTimer->setSingleShot( true );
+    _batchTimer->setInterval( batchInterval );
+  }
+
+  startRead();
+}
+
+/*!
+   Stops following the file, a read in progress is dropped
+ */
+void logTailer_c::stop()
+{
+  ++_generation;
+  removeWatches();
+  _batchTimer->stop();
+  _path.clear();
+  _state.reset();
+  _reading = false;
+  _readPending = false;
+}
+
+/*!
+   \return absolute path to the followed file, empty if none
+ */
+QString logTailer_c::path() const
+{
+  return _path;
+}
+
+/*!
+   Watches the followed file and its folder, where a rotated file is created again
+   The file is watched again if it was watched already, so a new file replacing a rotated one is watched.
+ */
+void logTailer_c::addWatches()
+{
+#if defined( Q_OS_LINUX )
+  if ( _inotifyFd < 0 )
+    return;
+
+  if ( _fileWatch >= 0 )
+    inotify_rm_watch( _inotifyFd, _fileWatch );
+  _fileWatch = inotify_add_watch( _inotifyFd, QFile::encodeName( _path ).constData(),
+                                  IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF );
+
+  if ( _folderWatch < 0 )
+  {
+    _folderWatch = inotify_add_watch( _inotifyFd, QFile::encodeName( QFileInfo( _path ).absolutePath() ).constData(),
+                                      IN_CREATE | IN_MOVED_TO | IN_ONLYDIR );
+  }
+#endif
+}
+
+/*!
+   Stops watching the followed file and its folder
+ */
+void logTailer_c::removeWatches()
+{
+#if defined( Q_OS_LINUX )
+  if ( _fileWatch >= 0 )
+    inotify_rm_watch( _inotifyFd, _fileWatch );
+  if ( _folderWatch >= 0 )
+    inotify_rm_watch( _inotifyFd, _folderWatch );
+#endif
+  _fileWatch = -1;
+  _folderWatch = -1;
+}
+
+/*!
+   Reads the changes of the followed file on the reader, unless a read is in flight, which is followed by another
+ */
+void logTailer_c::startRead()
+{
+  if ( _reading )
+  {
+    _readPending = true;
+    return;
+  }
+
+  _reading = true;
+  const quint64 generation = _generation;
+  QtConcurrent::run( &_readerPool, [this, state = _state, path = _path, lineCount = _lineCount, generation]()
+  {
+    const tailRead_s result = readFileChanges( *state, path, lineCount );
+    // decoded here rather than on the thread of the tailer
+    const bool reset = result.reset;
+    const QString text = QString::fromUtf8( result.text );
+    QMetaObject::invokeMethod( this, [this, reset, text, generation]()
+    {
+      if ( generation != _generation )
+        return;
+
+      _reading = false;
+      if ( reset )
+        emit tailReset( text );
+      else if ( !text.isEmpty() )
+        emit tailAppended( text );
+
+      if ( _readPending )
+      {
+        _readPending = false;
+        if ( !_batchTimer->isActive() )
+          _batchTimer->start();
+      }
+    }, Qt::QueuedConnection );
+  } );
+}
+
+/*!
+   Slot to read pending inotify events of the followed file
+   The events start the batch interval, the file is read once it elapses.
+ */
+void logTailer_c::readInotifyEvents()
+{
+#if defined( Q_OS_LINUX )
+  alignas( struct inotify_event ) char buffer[ eventBufferSize ];
+  const QByteArray fileName = QFile::encodeName( QFileInfo( _path ).fileName() );
+  bool changed = false;
+
+  for ( ;; )
+  {
+    const ssize_t length = read( _inotifyFd, buffer, sizeof( buffer ) );
+    if ( length <= 0 )
+      break;
+
+    for ( ssize_t position = 0; position < length; )
+    {
+      const auto *event = reinterpret_cast<const struct inotify_event *>( buffer + position );
+      position += static_cast<ssize_t>( sizeof( struct inotify_event ) + event->len );
+
+      if ( event->mask & IN_Q_OVERFLOW )
+      {
+        changed = true;
+      }
+      else if ( event->wd == _fileWatch && _fileWatch >= 0 )
+      {
+        if ( event->mask & IN_IGNORED )
+          _fileWatch = -1;
+        changed = true;
+      }
+      else if ( event->wd == _folderWatch && _folderWatch >= 0 && event->len > 0 && fileName == event->name )
+      {
+        // a new file of the followed path, e.g. after a rotation
+        addWatches();
+        changed = true;
+      }
+    }
+  }
+
+  if ( changed && !_path.isEmpty() && !_batchTimer->isActive() )
+    _batchTimer->start();
+#endif
+}
+
+/*!
+   Slot to read the changes of the followed file, once the batch interval elapsed or on a poll
+ */
+void logTailer_c::readChanges()
+{
+  if ( !_path.isEmpty() )
+    startRead();
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+#include <memory>
+
+class QSocketNotifier;
+class QTimer;
+
+/*!
+   Follows the end of a growing text file, e.g. a log
+   The last lines of the file are found by scanning it backwards in chunks from its end, then the data appended to
+   the file are read as it grows. Changes are reported by inotify, or polled where it is not available, and are
+   collected for a short interval, so a file written at a high rate is read in a few large batches, each delivered
+   by a single \em tailAppended. Complete lines are delivered only. A batch of more lines than delivered on a start,
+   or of more than about 1 MiB, is skipped to its last lines, which replace the followed text. A truncated file is
+   followed from its start again; a rotated file, i.e. one replaced by a new file of the same path, is read up to its
+   end and the new file is followed from its start. Reads and the decoding of the text run on a worker thread.
+ */
+class logTailer_c : public QObject
+{
+  Q_OBJECT
+
+  public:
+    struct tailState_s;
+
+  private:
+    // Absolute path to the followed file, empty if none
+    QString _path;
+    // Number of the last lines delivered on a start or a reset
+    int _lineCount;
+    // Open file and read position, used by the reader only
+    std::shared_ptr<tailState_s> _state;
+    // Reader of the file
+    QThreadPool _readerPool;
+    // Generation of the following, results of a previous one are dropped
+    quint64 _generation;
+    // A read is in flight
+    bool _reading;
+    // Changes arrived during the read in flight
+    bool _readPending;
+    // inotify instance, -1 if not available
+    int _inotifyFd;
+    QSocketNotifier *_inotifyNotifier;
+    // Watch of the file and of its folder, -1 if none
+    int _fileWatch;
+    int _folderWatch;
+    // Collects the changes into a single read, or polls the file without inotify
+    QTimer *_batchTimer;
+
+  public:
+    logTailer_c( QObject * = nullptr );
+    virtual ~logTailer_c();
+
+    void follow( const QString &, int );
+    void stop();
+    QString path() const;
+
+  private:
+    void addWatches();
+    void removeWatches();
+    void startRead();
+
+  private slots:
+    void readInotifyEvents();
+    void readChanges();
+
+  signals:
+    // Text replacing the followed text, on a start or once the file was truncated or too much was appended
+    void tailReset( const QString & );
+    // Lines appended to the file
+    void tailAppended( const QString & );
+};
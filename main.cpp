@@ -2,9 +2,23 @@
 
 #include <QApplication>
 
+#include "batchinspector.h"
+
 int main( int argc, char *argv[] )
 {
+  // the headless inspection needs no display server
+  if ( batchInspector_c::isBatchMode( argc, argv ) )
+  {
+    QCoreApplication a( argc, argv );
+    QCoreApplication::setOrganizationName( "FileInspector" );
+    QCoreApplication::setApplicationName( "FileInspector" );
+    return batchInspector_c::runBatch( QCoreApplication::arguments() );
+  }
+
   QApplication a( argc, argv );
+  // names the settings and the cache location
+  QApplication::setOrganizationName( "FileInspector" );
+  QApplication::setApplicationName( "FileInspector" );
   pathInspectorMain_c w;
   w.show();
   return a.exec();
@@ -0,0 +1,328 @@
+#include "mimeclassifier.h"
+
+#include <QFile>
+#include <QMimeDatabase>
+#include <QMutexLocker>
+
+#include <cstring>
+
+#if defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+#include "perftracer.h"
+#include "util.h"
+
+namespace
+{
+  enum class sniff_e
+  {
+    Text,
+    Binary,
+    Ambiguous
+  };
+
+  /*!
+     Extension table entry
+   */
+  struct extensionClass_s
+  {
+    const char *suffix;
+    const char *mimeName;
+    bool isText;
+  };
+
+  // Common extensions of an unambiguous type, lower case
+  constexpr extensionClass_s extensionClasses[] =
+  {
+    { "c", "text/x-csrc", true },
+    { "cc", "text/x-c++src", true },
+    { "cpp", "text/x-c++src", true },
+    { "css", "text/css", true },
+    { "csv", "text/csv", true },
+    { "cxx", "text/x-c++src", true },
+    { "diff", "text/x-patch", true },
+    { "go", "text/x-go", true },
+    { "h", "text/x-chdr", true },
+    { "hh", "text/x-c++hdr", true },
+    { "hpp", "text/x-c++hdr", true },
+    { "htm", "text/html", true },
+    { "html", "text/html", true },
+    { "java", "text/x-java", true },
+    { "js", "application/javascript", true },
+    { "json", "application/json", true },
+    { "log", "text/x-log", true },
+    { "md", "text/markdown", true },
+    { "patch", "text/x-patch", true },
+    { "py", "text/x-python", true },
+    { "rs", "text/rust", true },
+    { "sh", "application/x-shellscript", true },
+    { "svg", "image/svg+xml", true },
+    { "txt", "text/plain", true },
+    { "xml", "application/xml", true },
+    { "yaml", "application/x-yaml", true },
+    { "yml", "application/x-yaml", true },
+    { "7z", "application/x-7z-compressed", false },
+    { "avi", "video/x-msvideo", false },
+    { "bmp", "image/bmp", false },
+    { "bz2", "application/x-bzip", false },
+    { "class", "application/x-java", false },
+    { "flac", "audio/flac", false },
+    { "gif", "image/gif", false },
+    { "gz", "application/gzip", false },
+    { "iso", "application/x-cd-image", false },
+    { "jar", "application/x-java-archive", false },
+    { "jpeg", "image/jpeg", false },
+    { "jpg", "image/jpeg", false },
+    { "mkv", "video/x-matroska", false },
+    { "mp3", "audio/mpeg", false },
+    { "mp4", "video/mp4", false },
+    { "o", "application/x-object", false },
+    { "ogg", "audio/ogg", false },
+    { "pdf", "application/pdf", false },
+    { "png", "image/png", false },
+    { "so", "application/x-sharedlib", false },
+    { "tar", "application/x-tar", false },
+    { "wav", "audio/x-wav", false },
+    { "webm", "video/webm", false },
+    { "webp", "image/webp", false },
+    { "xz", "application/x-xz", false },
+    { "zip", "application/zip", false }
+  };
+
+  /*!
+     Classifies a file by the extension of its name \a fileName
+     \param fileName name of or path to the file
+     \param mimeClass output for the classification
+     \return true if the extension is in the table
+   */
+  bool classifyExtension( const QString &fileName, mimeClassifier_c::mimeClass_s &mimeClass )
+  {
+    static const QHash<QString, mimeClassifier_c::mimeClass_s> extensionTable = []()
+    {
+      QHash<QString, mimeClassifier_c::mimeClass_s> table;
+      for ( const auto &extensionClass : extensionClasses )
+        table.insert( QString::fromLatin1( extensionClass.suffix ),
+                      { extensionClass.isText, QString::fromLatin1( extensionClass.mimeName ) } );
+      return table;
+    }();
+
+    const int dotIndex = fileName.lastIndexOf( '.' );
+    if ( dotIndex < 0 || fileName.indexOf( '/', dotIndex ) >= 0 )
+      return false;
+
+    const auto tableIt = extensionTable.constFind( fileName.mid( dotIndex + 1 ).toLower() );
+    if ( tableIt == extensionTable.constEnd() )
+      return false;
+
+    mimeClass = tableIt.value();
+    return true;
+  }
+
+  /*!
+     \param byte a byte below 0x80
+     \return true for a control character other than white space
+   */
+  inline bool isControl( unsigned char byte )
+  {
+    return byte < 0x20 && ( byte < '\t' || byte > '\r' ) && byte != 0x1b;
+  }
+
+  /*!
+     Checks a head \a data of a file for NUL bytes, control characters and UTF-8 validity
+     With SSE2, blocks of 16 printable ASCII characters are skipped at once, other characters are checked one by one.
+     \param data the head
+     \param size size of the head
+     \return Text for valid UTF-8 with few control characters, Binary if a NUL byte is found, Ambiguous otherwise
+   */
+  sniff_e sniffHead( const unsigned char *data, qint64 size )
+  {
+    if ( size == 0 )
+      return sniff_e::Ambiguous;
+
+    qint64 controlCount = 0;
+    qint64 position = 0;
+    while ( position < size )
+    {
+#if defined( __SSE2__ )
+      const __m128i whiteSpaceLow = _mm_set1_epi8( '\t' - 1 );
+      const __m128i whiteSpaceHigh = _mm_set1_epi8( '\r' + 1 );
+      const __m128i printableLow = _mm_set1_epi8( 0x20 );
+      for ( ; position + 16 <= size; position += 16 )
+      {
+        const __m128i block = _mm_loadu_si128( reinterpret_cast<const __m128i *>( data + position ) );
+        // signed comparison, so bytes from 0x80 count as below 0x20 too
+        const __m128i belowPrintable = _mm_cmplt_epi8( block, printableLow );
+        const __m128i whiteSpace = _mm_and_si128( _mm_cmpgt_epi8( block, whiteSpaceLow ),
+                                                  _mm_cmplt_epi8( block, whiteSpaceHigh ) );
+        if ( _mm_movemask_epi8( _mm_andnot_si128( whiteSpace, belowPrintable ) ) != 0 )
+          break;
+      }
+      if ( position >= size )
+        break;
+#endif
+
+      const unsigned char byte = data[ position ];
+      if ( byte < 0x80 )
+      {
+        if ( byte == 0 )
+          return sniff_e::Binary;
+        if ( isControl( byte ) )
+          controlCount++;
+        position++;
+        continue;
+      }
+
+      const int sequenceLength = ( byte >= 0xc2 && byte <= 0xdf ) ? 2 : ( byte >= 0xe0 && byte <= 0xef ) ? 3 :
+                                 ( byte >= 0xf0 && byte <= 0xf4 ) ? 4 : 0;
+      if ( sequenceLength == 0 )
+        return sniff_e::Ambiguous;
+      // a sequence cut by the end of the head
+      if ( position + sequenceLength > size )
+        break;
+
+      for ( int index = 1; index < sequenceLength; index++ )
+      {
+        if ( ( data[ position + index ] & 0xc0 ) != 0x80 )
+          return sniff_e::Ambiguous;
+      }
+      position += sequenceLength;
+    }
+
+    // occasional escape sequences or form feeds are fine, more control characters suggest a binary format
+    return ( controlCount * 32 <= size ) ? sniff_e::Text : sniff_e::Ambiguous;
+  }
+}
+
+/*!
+   Classifies a file given at \a path, reading at most \em headSize bytes of it
+   \param path absolute path to the file
+   \return the classification, not text for a missing file
+ */
+mimeClassifier_c::mimeClass_s mimeClassifier_c::classify( const QString &path )
+{
+  const perfScope_c probeScope( perfTracer_c::operation_e::MimeProbe );
+  mimeClass_s mimeClass;
+  // a text extension is confirmed by the head, which is memoized
+  if ( classifyExtension( path, mimeClass ) && !mimeClass.isText )
+    return mimeClass;
+
+  return classifyFile( path, statCache_c::statPath( path ) );
+}
+
+/*!
+   Classifies a file given at \a path with known attributes \a status, reading at most \em headSize bytes of it
+   Saves the stat of the file if its attributes are known already, e.g. from \em statCache_c.
+   \param path absolute path to the file
+   \param status attributes of the file
+   \return the classification, not text for a missing file
+ */
+mimeClassifier_c::mimeClass_s mimeClassifier_c::classify( const QString &path, const statCache_c::status_s &status )
+{
+  const perfScope_c probeScope( perfTracer_c::operation_e::MimeProbe );
+  mimeClass_s mimeClass;
+  // a text extension is confirmed by the head, which is memoized
+  if ( classifyExtension( path, mimeClass ) && !mimeClass.isText )
+    return mimeClass;
+
+  return classifyFile( path, status );
+}
+
+/*!
+   Classifies a file given at \a path with attributes \a status by its head, memoizing the classification
+   \param path absolute path to the file
+   \param status attributes of the file
+   \return the classification, not text for a missing file
+ */
+mimeClassifier_c::mimeClass_s mimeClassifier_c::classifyFile( const QString &path,
+                                                              const statCache_c::status_s &status )
+{
+  mimeClass_s mimeClass;
+  if ( !status.exists )
+    return mimeClass;
+
+  if ( !status.isFile )
+  {
+    // special files are named by their kind, without reading them
+    const QMimeType mimeType = QMimeDatabase().mimeTypeForFile( path );
+    return { fileInspector_n::util_n::isTextMimeType( mimeType ), mimeType.name() };
+  }
+
+  // without an identity of the file, e.g. on Windows, the classification is not memoized
+  const bool memoized = ( status.device != 0 || status.inode != 0 );
+  const QPair<quint64, quint64> key( status.device, status.inode );
+  if ( memoized )
+  {
+    QMutexLocker locker( &_mutex );
+    const auto memoIt = _memo.constFind( key );
+    if ( memoIt != _memo.constEnd() && memoIt->modified == status.modified && memoIt->size == status.size )
+      return memoIt->mimeClass;
+  }
+
+  QFile file( path );
+  if ( !file.open( QIODevice::ReadOnly ) )
+  {
+    const QMimeType mimeType = QMimeDatabase().mimeTypeForFile( path, QMimeDatabase::MatchExtension );
+    return { fileInspector_n::util_n::isTextMimeType( mimeType ), mimeType.name() };
+  }
+
+  const QByteArray head = file.read( headSize );
+  mimeClass = classifyData( path, head.constData(), head.size() );
+
+  if ( memoized )
+  {
+    QMutexLocker locker( &_mutex );
+    if ( _memo.size() >= maximumMemoSize )
+      _memo.clear();
+    _memo.insert( key, { status.modified, status.size, mimeClass } );
+  }
+
+  return mimeClass;
+}
+
+/*!
+   Drops all the memoized classifications
+ */
+void mimeClassifier_c::clear()
+{
+  QMutexLocker locker( &_mutex );
+  _memo.clear();
+}
+
+/*!
+   Classifies a file by its name \a fileName and its head \a data, without memoizing the classification
+   \param fileName name of or path to the file
+   \param data the head of the file
+   \param size size of the head, at most \em headSize bytes are checked
+   \return the classification
+ */
+mimeClassifier_c::mimeClass_s mimeClassifier_c::classifyData( const QString &fileName, const char *data, qint64 size )
+{
+  const qint64 sniffedSize = qMin( size, headSize );
+  mimeClass_s mimeClass;
+  if ( classifyExtension( fileName, mimeClass ) )
+  {
+    // a NUL byte marks a binary file whatever its name, e.g. a UTF-16 text or a misnamed file
+    if ( !mimeClass.isText || std::memchr( data, '\0', static_cast<size_t>( sniffedSize ) ) == nullptr )
+      return mimeClass;
+    return { false, QStringLiteral( "application/octet-stream" ) };
+  }
+
+  const QMimeDatabase mimeDatabase;
+  const sniff_e sniff = sniffHead( reinterpret_cast<const unsigned char *>( data ), sniffedSize );
+  if ( sniff != sniff_e::Ambiguous )
+  {
+    const QMimeType globType = mimeDatabase.mimeTypeForFile( fileName, QMimeDatabase::MatchExtension );
+    const bool globText = fileInspector_n::util_n::isTextMimeType( globType );
+
+    if ( sniff == sniff_e::Text && ( globType.isDefault() || globText ) )
+      return { true, globType.isDefault() ? QStringLiteral( "text/plain" ) : globType.name() };
+    if ( sniff == sniff_e::Binary && !globType.isDefault() && !globText )
+      return { false, globType.name() };
+  }
+
+  // the head and the extension disagree, or the head alone is not conclusive
+  const QMimeType mimeType = mimeDatabase.mimeTypeForFileNameAndData(
+                               fileName, QByteArray::fromRawData( data, static_cast<int>( sniffedSize ) ) );
+  return { fileInspector_n::util_n::isTextMimeType( mimeType ), mimeType.name() };
+}
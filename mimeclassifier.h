@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+
+#include "statcache.h"
+
+/*!
+   Decides whether a file is a text file without a full MIME probe where possible
+   A file is classified by its extension first, a text extension still being checked for NUL bytes in the head, then
+   by a single read of its head checked for NUL bytes, control characters and UTF-8 validity. Only when the head and
+   the extension disagree, or the head is not valid UTF-8, is the full glob and magic matching of \em QMimeDatabase
+   used. Classifications are memoized per device and inode, validated against the modification time and the size of
+   the file. The class is thread-safe.
+ */
+class mimeClassifier_c
+{
+  public:
+    /*!
+       Outcome of a classification
+     */
+    struct mimeClass_s
+    {
+      // True if the file inherits text/plain
+      bool isText = false;
+      QString mimeName;
+    };
+
+    // Number of leading bytes of a file the classification reads
+    static constexpr qint64 headSize = 4096;
+    // Number of memoized classifications kept at most
+    static constexpr int maximumMemoSize = 65536;
+
+  private:
+    struct memoEntry_s
+    {
+      // Modification time of the file in ns since epoch
+      qint64 modified;
+      qint64 size;
+      mimeClass_s mimeClass;
+    };
+
+    mutable QMutex _mutex;
+    // Classifications keyed by device and inode
+    QHash<QPair<quint64, quint64>, memoEntry_s> _memo;
+
+  public:
+    mimeClassifier_c() = default;
+
+    mimeClass_s classify( const QString & );
+    mimeClass_s classify( const QString &, const statCache_c::status_s & );
+    void clear();
+
+    static mimeClass_s classifyData( const QString &, const char *, qint64 );
+
+  private:
+    mimeClass_s classifyFile( const QString &, const statCache_c::status_s & );
+};
@@ -0,0 +1,82 @@
+#include "namearena.h"
+
+#include <QFile>
+
+/*!
+   Stores a name \a name of length \a length
+   \param name the name, does not need to be NUL terminated
+   \param length length of the name in bytes
+   \return index of the stored name
+ */
+int nameArena_c::append( const char *name, int length )
+{
+  _offsets.push_back( static_cast<quint32>( _storage.size() ) );
+  _storage.insert( _storage.end(), name, name + length );
+  _storage.push_back( '\0' );
+  return static_cast<int>( _offsets.size() ) - 1;
+}
+
+/*!
+   Drops all the stored names
+ */
+void nameArena_c::clear()
+{
+  _storage.clear();
+  _offsets.clear();
+}
+
+/*!
+   Pre-allocates storage for \a entries names of total length \a bytes
+   \param entries expected number of names
+   \param bytes expected total length of the names
+ */
+void nameArena_c::reserve( int entries, int bytes )
+{
+  _offsets.reserve( static_cast<size_t>( entries ) );
+  _storage.reserve( static_cast<size_t>( bytes + entries ) );
+}
+
+/*!
+   \return number of stored names
+ */
+int nameArena_c::size() const
+{
+  return static_cast<int>( _offsets.size() );
+}
+
+/*!
+   \param index index of the name
+   \return NUL terminated name
+ */
+const char *nameArena_c::name( int index ) const
+{
+  return _storage.data() + _offsets[ static_cast<size_t>( index ) ];
+}
+
+/*!
+   \param index index of the name
+   \return length of the name in bytes
+ */
+int nameArena_c::length( int index ) const
+{
+  const size_t next = ( static_cast<size_t>( index ) + 1 < _offsets.size() ) ? _offsets[ static_cast<size_t>( index ) + 1 ] :
+                                                                                _storage.size();
+  return static_cast<int>( next - _offsets[ static_cast<size_t>( index ) ] - 1 );
+}
+
+/*!
+   \param index index of the name
+   \return the name decoded from the local file name encoding
+ */
+QString nameArena_c::toString( int index ) const
+{
+  return QFile::decodeName( QByteArray::fromRawData( name( index ), length( index ) ) );
+}
+
+/*!
+   \return number of bytes allocated for the names
+ */
+qint64 nameArena_c::memoryUsage() const
+{
+  return static_cast<qint64>( _storage.capacity() + _offsets.capacity() * sizeof( quint32 ) );
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QString>
+
+#include <vector>
+
+/*!
+   Compact storage of file system entry names
+   The names are stored back to back in a single buffer, NUL terminated, and are addressed by their index.
+   Compared to a QString per entry, it avoids a heap allocation and the UTF-16 conversion for every name.
+ */
+class nameArena_c
+{
+  private:
+    // The names, each followed by NUL
+    std::vector<char> _storage;
+    // Offsets of the names within the storage
+    std::vector<quint32> _offsets;
+
+  public:
+    nameArena_c() = default;
+
+    int append( const char *, int );
+    void clear();
+    void reserve( int, int );
+
+    int size() const;
+    const char *name( int ) const;
+    int length( int ) const;
+    QString toString( int ) const;
+    qint64 memoryUsage() const;
+};
@@ -0,0 +1,307 @@
+#include "pathcompleter.h"
+
+#include <QAbstractItemView>
+#include <QCompleter>
+#include <QDir>
+#include <QLineEdit>
+#include <QStandardItemModel>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <numeric>
+
+#include "dirlister.h"
+
+namespace
+{
+  // Role of the candidate model holding the completed path
+  constexpr int pathRole = Qt::UserRole;
+  // Number of folder listing workers, more than one so a listing hanging on a slow mount does not block the next
+  constexpr int listingThreadCount = 2;
+
+  /*!
+     Checks if the characters of \a fragment appear in \a name in the same order
+     \param fragment case folded typed name
+     \param name case folded entry name
+     \return score of the match, lower for earlier and tighter matches, -1 if the name does not match
+   */
+  int fuzzyScore( const QString &fragment, const QString &name )
+  {
+    int position = 0;
+    int score = 0;
+    for ( const QChar character : fragment )
+    {
+      const int found = name.indexOf( character, position );
+      if ( found < 0 )
+        return -1;
+
+      // the first character counts its offset, the following ones the gap to their predecessor
+      score += found - position;
+      position = found + 1;
+    }
+    return score;
+  }
+}
+
+/*!
+   C-tor
+   \param lineEdit line edit to complete the paths of
+   \param parent parent object
+ */
+pathCompleter_c::pathCompleter_c( QLineEdit *lineEdit, QObject *parent ) :
+  QObject( parent ),
+  _lineEdit{ lineEdit },
+  _completer{ nullptr },
+  _candidateModel{ nullptr },
+  _cancelled{ std::make_shared<std::atomic<bool>>( false ) }
+{
+  _clock.start();
+  _listingPool.setMaxThreadCount( listingThreadCount );
+
+  _candidateModel = new QStandardItemModel( this );
+  _completer = new QCompleter( _candidateModel, this );
+  // the candidates are narrowed here, the completer only shows them
+  _completer->setCompletionMode( QCompleter::UnfilteredPopupCompletion );
+  _completer->setCompletionRole( pathRole );
+  _completer->setMaxVisibleItems( 12 );
+  _completer->setWidget( _lineEdit );
+
+  connect( _lineEdit, &QLineEdit::textEdited, this, &pathCompleter_c::updateCompletions );
+  connect( _completer, QOverload<const QString &>::of( &QCompleter::activated ),
+           this, &pathCompleter_c::insertCompletion );
+}
+
+/*!
+   D-tor
+ */
+pathCompleter_c::~pathCompleter_c()
+{
+  _cancelled->store( true );
+  _listingPool.clear();
+  _listingPool.waitForDone();
+}
+
+/*!
+   Slot to offer the candidates of the path given at \a text
+   The candidates are narrowed at once if the folder of the path is listed, otherwise the folder is listed on a
+   worker and the candidates offered once it is done.
+   \param text typed path
+ */
+void pathCompleter_c::updateCompletions( const QString &text )
+{
+  const QString path = QDir::fromNativeSeparators( text );
+  const int separator = path.lastIndexOf( QLatin1Char( '/' ) );
+  if ( separator < 0 || !QDir::isAbsolutePath( path ) )
+  {
+    _completer->popup()->hide();
+    return;
+  }
+
+  const QString folderPath = path.left( separator + 1 );
+  const auto listing = _listings.constFind( folderPath );
+  if ( listing == _listings.constEnd() )
+  {
+    listFolder( folderPath );
+    return;
+  }
+
+  if ( _clock.elapsed() - ( *listing )->listedAt > listingTimeToLive )
+    listFolder( folderPath );
+  narrow( *listing, path.mid( separator + 1 ) );
+}
+
+/*!
+   Slot to put the candidate path given at \a path into the line edit
+   A chosen folder is completed further right away.
+   \param path the candidate path
+ */
+void pathCompleter_c::insertCompletion( const QString &path )
+{
+  _lineEdit->setText( QDir::toNativeSeparators( path ) );
+  if ( path.endsWith( QLatin1Char( '/' ) ) )
+    updateCompletions( path );
+}
+
+/*!
+   Lists the folder given at \a folderPath on a worker, unless already being listed
+   \param folderPath path to the folder, with a trailing separator
+ */
+void pathCompleter_c::listFolder( const QString &folderPath )
+{
+  if ( _pendingFolders.contains( folderPath ) )
+    return;
+  _pendingFolders.insert( folderPath );
+
+  const std::shared_ptr<std::atomic<bool>> cancelled = _cancelled;
+  QtConcurrent::run( &_listingPool, [this, folderPath, cancelled]()
+  {
+    dirLister_c lister;
+    lister.list( folderPath, -1, [&cancelled]() { return !*cancelled; } );
+    if ( *cancelled )
+      return;
+
+    const nameArena_c &names = lister.names();
+    const int count = lister.count();
+    std::vector<QString> entryNames( static_cast<size_t>( count ) );
+    std::vector<QString> foldedNames( static_cast<size_t>( count ) );
+    for ( int index = 0; index < count; index++ )
+    {
+      entryNames[ static_cast<size_t>( index ) ] = names.toString( index );
+      foldedNames[ static_cast<size_t>( index ) ] = entryNames[ static_cast<size_t>( index ) ].toCaseFolded();
+    }
+
+    std::vector<int> order( static_cast<size_t>( count ) );
+    std::iota( order.begin(), order.end(), 0 );
+    std::sort( order.begin(), order.end(), [&foldedNames, &entryNames]( int left, int right )
+    {
+      const QString &leftFolded = foldedNames[ static_cast<size_t>( left ) ];
+      const QString &rightFolded = foldedNames[ static_cast<size_t>( right ) ];
+      if ( leftFolded != rightFolded )
+        return leftFolded < rightFolded;
+      return entryNames[ static_cast<size_t>( left ) ] < entryNames[ static_cast<size_t>( right ) ];
+    } );
+
+    auto listing = std::make_shared<listing_s>();
+    listing->folderPath = folderPath;
+    listing->names.reserve( count );
+    listing->foldedNames.reserve( count );
+    listing->isDir.reserve( static_cast<size_t>( count ) );
+    for ( const int index : order )
+    {
+      listing->names.append( entryNames[ static_cast<size_t>( index ) ] );
+      listing->foldedNames.append( foldedNames[ static_cast<size_t>( index ) ] );
+      listing->isDir.push_back( lister.type( index ) == dirLister_c::entryType_e::Directory );
+    }
+
+    listing->listedAt = _clock.elapsed();
+    QMetaObject::invokeMethod( this, [this, listing]()
+    {
+      storeListing( listing );
+    }, Qt::QueuedConnection );
+  } );
+}
+
+/*!
+   Caches the folder listing given at \a listing, evicting the oldest listing if the cache is full, and offers the
+   candidates if the typed path is still in the listed folder
+   \param listing the folder listing
+ */
+void pathCompleter_c::storeListing( const std::shared_ptr<const listing_s> &listing )
+{
+  _pendingFolders.remove( listing->folderPath );
+
+  _listings.insert( listing->folderPath, listing );
+  if ( _listings.size() > maximumCachedFolders )
+  {
+    auto oldest = _listings.begin();
+    for ( auto cached = _listings.begin(); cached != _listings.end(); ++cached )
+      if ( ( *cached )->listedAt < ( *oldest )->listedAt )
+        oldest = cached;
+    _listings.erase( oldest );
+  }
+
+  const QString path = QDir::fromNativeSeparators( _lineEdit->text() );
+  if ( _lineEdit->hasFocus() && path.startsWith( listing->folderPath ) &&
+       path.indexOf( QLatin1Char( '/' ), listing->folderPath.size() ) < 0 )
+    narrow( listing, path.mid( listing->folderPath.size() ) );
+}
+
+/*!
+   Offers the entries of the listed folder given at \a listing matching the name given at \a fragment
+   Entries starting with the name come first in name order, followed by the fuzzy matches by their score.
+   \param listing the folder listing
+   \param fragment typed name
+ */
+void pathCompleter_c::narrow( const std::shared_ptr<const listing_s> &listing, const QString &fragment )
+{
+  const QString foldedFragment = fragment.toCaseFolded();
+  const QStringList &foldedNames = listing->foldedNames;
+
+  // entries starting with the name are adjacent in the sorted listing
+  const auto prefixBegin = std::lower_bound( foldedNames.cbegin(), foldedNames.cend(), foldedFragment );
+  const auto hasPrefix = [&foldedFragment]( const QString &name ) { return name.startsWith( foldedFragment ); };
+  const auto prefixEnd = std::partition_point( prefixBegin, foldedNames.cend(), hasPrefix );
+  const int firstPrefix = static_cast<int>( prefixBegin - foldedNames.cbegin() );
+  const int lastPrefix = static_cast<int>( prefixEnd - foldedNames.cbegin() );
+
+  const size_t candidateLimit = static_cast<size_t>( maximumCandidates );
+  std::vector<int> candidates;
+  for ( int index = firstPrefix; index < lastPrefix && candidates.size() < candidateLimit; index++ )
+    candidates.push_back( index );
+
+  if ( !foldedFragment.isEmpty() && candidates.size() < candidateLimit )
+  {
+    fuzzyMatches_t matches;
+    for ( const std::pair<int, int> &match : fuzzyMatches( listing, foldedFragment ) )
+      if ( match.second < firstPrefix || match.second >= lastPrefix )
+        matches.push_back( match );
+
+    const size_t fuzzyCount = std::min( matches.size(), candidateLimit - candidates.size() );
+    std::partial_sort( matches.begin(), matches.begin() + static_cast<std::ptrdiff_t>( fuzzyCount ), matches.end() );
+    for ( size_t index = 0; index < fuzzyCount; index++ )
+      candidates.push_back( matches[ index ].second );
+  }
+
+  _candidateModel->clear();
+  for ( const int index : candidates )
+  {
+    const bool isDir = listing->isDir[ static_cast<size_t>( index ) ];
+    const QString name = listing->names.at( index ) + ( isDir ? QStringLiteral( "/" ) : QString() );
+
+    QStandardItem *item = new QStandardItem( name );
+    item->setData( listing->folderPath + name, pathRole );
+    _candidateModel->appendRow( item );
+  }
+
+  if ( candidates.empty() || ( candidates.size() == 1 && listing->names.at( candidates.front() ) == fragment ) )
+    _completer->popup()->hide();
+  else
+    _completer->complete();
+}
+
+/*!
+   Filters the entries of the listed folder given at \a listing containing the characters of the name given at
+   \a foldedFragment in order
+   Only the matches of the longest name typed before, that the name extends, are filtered, so every keystroke narrows
+   the previous result instead of scanning the whole folder.
+   \param listing the folder listing
+   \param foldedFragment case folded typed name, not empty
+   \return the fuzzy matches, as score and index of the entry
+ */
+const pathCompleter_c::fuzzyMatches_t &pathCompleter_c::fuzzyMatches( const std::shared_ptr<const listing_s> &listing,
+                                                                       const QString &foldedFragment )
+{
+  if ( _fuzzyListing != listing )
+  {
+    _fuzzyListing = listing;
+    _fuzzyMatches.clear();
+  }
+
+  while ( !_fuzzyMatches.empty() && !foldedFragment.startsWith( _fuzzyMatches.back().first ) )
+    _fuzzyMatches.pop_back();
+  if ( !_fuzzyMatches.empty() && _fuzzyMatches.back().first == foldedFragment )
+    return _fuzzyMatches.back().second;
+
+  fuzzyMatches_t matches;
+  if ( _fuzzyMatches.empty() )
+  {
+    for ( int index = 0; index < listing->foldedNames.size(); index++ )
+    {
+      const int score = fuzzyScore( foldedFragment, listing->foldedNames.at( index ) );
+      if ( score >= 0 )
+        matches.emplace_back( score, index );
+    }
+  }
+  else
+  {
+    for ( const std::pair<int, int> &match : _fuzzyMatches.back().second )
+    {
+      const int score = fuzzyScore( foldedFragment, listing->foldedNames.at( match.second ) );
+      if ( score >= 0 )
+        matches.emplace_back( score, match.second );
+    }
+  }
+
+  _fuzzyMatches.emplace_back( foldedFragment, std::move( matches ) );
+  return _fuzzyMatches.back().second;
+}
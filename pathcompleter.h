@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class QCompleter;
+class QLineEdit;
+class QStandardItemModel;
+
+/*!
+   Completes paths typed into a line edit
+   The folder of a typed path is listed once on a worker, its entry names are kept sorted by their case folded
+   form. Every keystroke then narrows the candidates without touching the file system: entries starting with the
+   typed name are found by a binary search, entries containing the typed characters in order (fuzzy matches) are
+   filtered from the matches of the shorter name typed before. Listings of recently completed folders are cached
+   for a short time.
+ */
+class pathCompleter_c : public QObject
+{
+  Q_OBJECT
+
+  public:
+    // Number of candidates offered at most
+    static constexpr int maximumCandidates = 50;
+    // Number of folder listings cached at most
+    static constexpr int maximumCachedFolders = 16;
+    // Age in ms, after which a cached folder listing is listed again on the next use
+    static constexpr qint64 listingTimeToLive = 5000;
+
+  private:
+    /*!
+       Entries of a listed folder, sorted by the case folded names
+     */
+    struct listing_s
+    {
+      // Path to the folder, with a trailing separator
+      QString folderPath;
+      QStringList names;
+      QStringList foldedNames;
+      std::vector<bool> isDir;
+      // Time of the listing, see _clock
+      qint64 listedAt = 0;
+    };
+
+    // Fuzzy matches of a typed name, as score and index of the entry
+    using fuzzyMatches_t = std::vector<std::pair<int, int>>;
+
+    QLineEdit *_lineEdit;
+    QCompleter *_completer;
+    // Candidates of the typed path
+    QStandardItemModel *_candidateModel;
+    // Workers listing folders
+    QThreadPool _listingPool;
+    // Cached folder listings by folder path
+    QHash<QString, std::shared_ptr<const listing_s>> _listings;
+    // Folders being listed
+    QSet<QString> _pendingFolders;
+    // Stops the listings in progress
+    std::shared_ptr<std::atomic<bool>> _cancelled;
+    // Time base of the listing ages
+    QElapsedTimer _clock;
+    // Listing the fuzzy matches were narrowed in
+    std::shared_ptr<const listing_s> _fuzzyListing;
+    // Fuzzy matches of the names typed before, each extending the previous one
+    std::vector<std::pair<QString, fuzzyMatches_t>> _fuzzyMatches;
+
+  public:
+    pathCompleter_c( QLineEdit *, QObject * = nullptr );
+    virtual ~pathCompleter_c();
+
+  private slots:
+    void updateCompletions( const QString & );
+    void insertCompletion( const QString & );
+
+  private:
+    void listFolder( const QString & );
+    void storeListing( const std::shared_ptr<const listing_s> & );
+    void narrow( const std::shared_ptr<const listing_s> &, const QString & );
+    const fuzzyMatches_t &fuzzyMatches( const std::shared_ptr<const listing_s> &, const QString & );
+};
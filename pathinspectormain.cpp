@@ -6,8 +6,11 @@
 #include <QMenu>
 #include <QMenuBar>
 #include <QMessageBox>
+#include <QSettings>
 
 #include "pathinspectorwidget.h"
+#include "perfoverlay.h"
+#include "perftracer.h"
 
 /*!
    C-tor
@@ -15,7 +18,8 @@
  */
 pathInspectorMain_c::pathInspectorMain_c( QWidget *parent )
   : QMainWindow( parent ),
-    _pathInspectorWidget{ nullptr }
+    _pathInspectorWidget{ nullptr },
+    _perfOverlay{ nullptr }
 {
   setObjectName( "PathInspector" );
   setWindowTitle( tr( "Path Inspector" ) );
@@ -25,6 +29,26 @@ pathInspectorMain_c::pathInspectorMain_c( QWidget *parent )
   openAction->setShortcut( Qt::CTRL+Qt::Key_O );
   connect( openAction, &QAction::triggered, this, &pathInspectorMain_c::slotOpenDialog );
 
+  QAction *scanIndexAction = new QAction( tr( "Keep Scan Index" ), this );
+  scanIndexAction->setCheckable( true );
+  scanIndexAction->setChecked( QSettings().value( "scanIndex/enabled", false ).toBool() );
+
+  QAction *traceAction = new QAction( tr( "Trace Performance" ), this );
+  traceAction->setCheckable( true );
+  traceAction->setShortcut( Qt::CTRL+Qt::SHIFT+Qt::Key_P );
+  connect( traceAction, &QAction::toggled, this, &pathInspectorMain_c::slotTracePerformance );
+
+  QAction *treemapAction = new QAction( tr( "Show Treemap" ), this );
+  treemapAction->setCheckable( true );
+  treemapAction->setShortcut( Qt::CTRL+Qt::Key_T );
+
+  QAction *followAction = new QAction( tr( "Follow Log" ), this );
+  followAction->setCheckable( true );
+  followAction->setShortcut( Qt::CTRL+Qt::Key_L );
+
+  QAction *saveTraceAction = new QAction( tr( "Save Trace..." ), this );
+  connect( saveTraceAction, &QAction::triggered, this, &pathInspectorMain_c::slotSaveTrace );
+
   QAction *exitAction = new QAction( tr( "Exit" ), this );
   exitAction->setShortcut( Qt::ALT+Qt::Key_F4 );
   connect( exitAction, &QAction::triggered, this, &pathInspectorMain_c::close );
@@ -33,14 +57,36 @@ pathInspectorMain_c::pathInspectorMain_c( QWidget *parent )
 
   QMenu *menuFile = new QMenu( tr( "File" ), this );
   menuFile->addAction( openAction );
+  menuFile->addAction( scanIndexAction );
+  menuFile->addSeparator();
   menuFile->addAction( exitAction );
 
   mb->addMenu( menuFile );
 
+  QMenu *menuTools = new QMenu( tr( "Tools" ), this );
+  menuTools->addAction( treemapAction );
+  menuTools->addAction( followAction );
+  menuTools->addSeparator();
+  menuTools->addAction( traceAction );
+  menuTools->addAction( saveTraceAction );
+
+  mb->addMenu( menuTools );
+
   _pathInspectorWidget = new pathInspectorWidget_c( this );
   setCentralWidget( _pathInspectorWidget );
+  _perfOverlay = new perfOverlay_c( _pathInspectorWidget );
   connect( this, &pathInspectorMain_c::folderSelected, _pathInspectorWidget, &pathInspectorWidget_c::folderSelected );
 
+  // the folder listed at startup shows the indexed sizes right away
+  _pathInspectorWidget->setScanIndexEnabled( scanIndexAction->isChecked() );
+  connect( scanIndexAction, &QAction::toggled, _pathInspectorWidget, &pathInspectorWidget_c::setScanIndexEnabled );
+  connect( treemapAction, &QAction::toggled, _pathInspectorWidget, &pathInspectorWidget_c::setTreemapVisible );
+  connect( followAction, &QAction::toggled, _pathInspectorWidget, &pathInspectorWidget_c::setLogFollowed );
+  connect( scanIndexAction, &QAction::toggled, this, []( bool enabled )
+  {
+    QSettings().setValue( "scanIndex/enabled", enabled );
+  } );
+
   resize( 850, 600 );
 }
 
@@ -62,3 +108,32 @@ void pathInspectorMain_c::slotOpenDialog()
   }
 }
 
+/*!
+   Slot to start or stop tracing the inspector operations
+   The recent latencies are shown in an overlay while tracing, a new trace drops the timings of the previous one.
+   \param enabled true to start tracing
+ */
+void pathInspectorMain_c::slotTracePerformance( bool enabled )
+{
+  perfTracer_c &tracer = perfTracer_c::instance();
+  if ( enabled )
+    tracer.clear();
+  tracer.setEnabled( enabled );
+  _perfOverlay->setActive( enabled );
+}
+
+/*!
+   Slot to save the recorded timings as a Chrome trace-event file
+   The file can be opened with chrome://tracing or Perfetto.
+ */
+void pathInspectorMain_c::slotSaveTrace()
+{
+  const QString filePath = QFileDialog::getSaveFileName( this, tr( "Save Trace" ), QDir::homePath() + "/trace.json",
+                                                         tr( "Trace Files (*.json)" ) );
+  if ( filePath.isEmpty() )
+    return;
+
+  if ( !perfTracer_c::instance().writeChromeTrace( filePath ) )
+    QMessageBox::warning( this, tr( "Save Trace" ),
+                          tr( "Cannot write %1." ).arg( QDir::toNativeSeparators( filePath ) ) );
+}
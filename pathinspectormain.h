@@ -3,6 +3,7 @@
 #include <QMainWindow>
 
 class pathInspectorWidget_c;
+class perfOverlay_c;
 
 /*!
    Main window of the application
@@ -15,11 +16,15 @@ class pathInspectorMain_c : public QMainWindow
   private:
     // The central widget
     pathInspectorWidget_c *_pathInspectorWidget;
+    // Latencies of the traced operations, shown while tracing
+    perfOverlay_c *_perfOverlay;
   public:
     pathInspectorMain_c( QWidget * = nullptr );
     ~pathInspectorMain_c() = default;
   private slots:
     void slotOpenDialog();
+    void slotTracePerformance( bool );
+    void slotSaveTrace();
   signals:
     void folderSelected( const QString & );
 };
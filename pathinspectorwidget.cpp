@@ -1,15 +1,42 @@
 #include "pathinspectorwidget.h"
 
+#include <QComboBox>
+#include <QDateTime>
 #include <QDir>
-#include <QFileSystemModel>
+#include <QFileInfo>
+#include <QHash>
 #include <QItemSelection>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QLocale>
 #include <QMenu>
 #include <QPushButton>
+#include <QTimer>
 #include <QTreeView>
 #include <QHBoxLayout>
 #include <QVBoxLayout>
 
+#include <algorithm>
+
+#include "changetracker.h"
 #include "detailwidget.h"
+#include "duplicatesdialog.h"
+#include "filesearch.h"
+#include "filesystemmodel.h"
+#include "findinfilesdialog.h"
+#include "scanindex.h"
+#include "sizescanner.h"
+#include "snapshotdialog.h"
+#include "treemapwidget.h"
+#include "util.h"
+
+namespace
+{
+  // Number of the next and of the previous siblings of the selection, whose previews are prefetched
+  constexpr int prefetchSiblingCount = 4;
+  // Minimal delay between the end of a scan and its restart for changes in its folder, in ms
+  constexpr qint64 minimumRescanDelay = 2000;
+}
 
 /*!
    C-tor
@@ -22,7 +49,21 @@ pathInspectorWidget_c::pathInspectorWidget_c( QWidget *parent ) :
   _navigateHomeButton{ nullptr },
   _fileSystemModel{ nullptr },
   _fileTreeView{ nullptr },
-  _fileTreeContextMenu{ nullptr }
+  _fileTreeContextMenu{ nullptr },
+  _searchLine{ nullptr },
+  _searchModeBox{ nullptr },
+  _searchResults{ nullptr },
+  _fileSearch{ nullptr },
+  _sizeScanner{ nullptr },
+  _indexScanner{ nullptr },
+  _scanIndexEnabled{ false },
+  _changeTracker{ nullptr },
+  _sizeRescanPending{ false },
+  _indexRescanPending{ false },
+  _rescanTimer{ nullptr },
+  _rescanStart{ -1 },
+  _rescanDuration{ 0 },
+  _treemap{ nullptr }
 {
   _navigateUpButton = new QPushButton( tr( "Up" ), this );
   _navigateHomeButton = new QPushButton( tr( "Home" ), this );
@@ -31,21 +72,57 @@ pathInspectorWidget_c::pathInspectorWidget_c( QWidget *parent ) :
   buttonHboxLayout->addWidget( _navigateUpButton );
   buttonHboxLayout->addWidget( _navigateHomeButton );
 
-  _fileSystemModel = new QFileSystemModel( this );
+  _fileSystemModel = new fileSystemModel_c( this );
   setupModel();
 
   _fileTreeView = new QTreeView( this );
   setupTree();
 
+  _searchLine = new QLineEdit( this );
+  _searchLine->setClearButtonEnabled( true );
+  _searchLine->setPlaceholderText( tr( "Search" ) );
+  _searchModeBox = new QComboBox( this );
+  _searchModeBox->addItem( tr( "Substring" ), static_cast<int>( fileNameIndex_c::matchMode_e::Substring ) );
+  _searchModeBox->addItem( tr( "Glob" ), static_cast<int>( fileNameIndex_c::matchMode_e::Glob ) );
+  _searchModeBox->addItem( tr( "Regex" ), static_cast<int>( fileNameIndex_c::matchMode_e::RegularExpression ) );
+  _searchResults = new QListWidget( this );
+  _searchResults->hide();
+
+  QHBoxLayout *searchHboxLayout = new QHBoxLayout;
+  searchHboxLayout->addWidget( _searchLine );
+  searchHboxLayout->addWidget( _searchModeBox );
+
+  _fileSearch = new fileSearch_c( this );
+  _fileSearch->setRootPath( _fileSystemModel->rootPath() );
+
   _detailWidget = new detailWidget_c;
 
+  _treemap = new treemapWidget_c;
+  _treemap->setFolder( _fileSystemModel->rootPath() );
+  _treemap->hide();
+
+  _sizeScanner = new sizeScanner_c( this );
+  _indexScanner = new sizeScanner_c( this );
+  _rescanTimer = new QTimer( this );
+  _rescanTimer->setSingleShot( true );
+
+  _changeTracker = new changeTracker_c( this );
+  _changeTracker->watch( _fileSystemModel->rootPath() );
+  _changeTracker->trackTree( _fileSystemModel->rootPath() );
+
   QVBoxLayout *navigationLayout = new QVBoxLayout;
   navigationLayout->addLayout( buttonHboxLayout );
+  navigationLayout->addLayout( searchHboxLayout );
+  navigationLayout->addWidget( _searchResults );
   navigationLayout->addWidget( _fileTreeView );
 
+  QVBoxLayout *detailLayout = new QVBoxLayout;
+  detailLayout->addWidget( _detailWidget );
+  detailLayout->addWidget( _treemap );
+
   QHBoxLayout *mainLayout = new QHBoxLayout;
   mainLayout->addLayout( navigationLayout );
-  mainLayout->addWidget( _detailWidget );
+  mainLayout->addLayout( detailLayout );
 
   setLayout( mainLayout );
 
@@ -56,6 +133,23 @@ pathInspectorWidget_c::pathInspectorWidget_c( QWidget *parent ) :
            this, &pathInspectorWidget_c::fileTreeSelectionChanged );
   connect( _detailWidget, &detailWidget_c::listPath, this, &pathInspectorWidget_c::folderSelected );
   connect( this, &pathInspectorWidget_c::selectionChanged, _detailWidget, &detailWidget_c::handleSelectionPath );
+  connect( _sizeScanner, &sizeScanner_c::scanUpdated, this, &pathInspectorWidget_c::handleSelectionScanUpdate );
+  connect( _sizeScanner, &sizeScanner_c::scanUpdated, _detailWidget, &detailWidget_c::handleSizeScanUpdate );
+  connect( _indexScanner, &sizeScanner_c::scanUpdated, this, &pathInspectorWidget_c::handleIndexScanUpdate );
+  connect( _indexScanner, &sizeScanner_c::scanUpdated, _detailWidget, &detailWidget_c::handleSizeScanUpdate );
+  connect( _indexScanner, &sizeScanner_c::indexUpdated, this, &pathInspectorWidget_c::handleScanIndexUpdate );
+  connect( _changeTracker, &changeTracker_c::pathsChanged, this, &pathInspectorWidget_c::handleTrackedChanges );
+  connect( _rescanTimer, &QTimer::timeout, this, &pathInspectorWidget_c::restartScans );
+  connect( _fileTreeView, &QTreeView::expanded, this, &pathInspectorWidget_c::handleTreeExpanded );
+  connect( _fileTreeView, &QTreeView::collapsed, this, &pathInspectorWidget_c::handleTreeCollapsed );
+  connect( _searchLine, &QLineEdit::textChanged, this, &pathInspectorWidget_c::startSearch );
+  connect( _searchModeBox, QOverload<int>::of( &QComboBox::currentIndexChanged ),
+           this, &pathInspectorWidget_c::startSearch );
+  connect( _searchResults, &QListWidget::itemActivated, this, &pathInspectorWidget_c::handleSearchResultActivated );
+  connect( _fileSearch, &fileSearch_c::resultsFound, this, &pathInspectorWidget_c::handleSearchResults );
+  connect( _fileSearch, &fileSearch_c::searchFinished, this, &pathInspectorWidget_c::handleSearchFinished );
+  connect( _fileSearch, &fileSearch_c::indexReady, this, &pathInspectorWidget_c::handleSearchIndexReady );
+  connect( _treemap, &treemapWidget_c::entryActivated, this, &pathInspectorWidget_c::handleTreemapActivated );
 }
 
 /*!
@@ -63,8 +157,8 @@ pathInspectorWidget_c::pathInspectorWidget_c( QWidget *parent ) :
  */
 void pathInspectorWidget_c::setupModel()
 {
-  _fileSystemModel->setOption( QFileSystemModel::DontWatchForChanges );
-  _fileSystemModel->setFilter( QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot | QDir::AllDirs );
+  // entries of folders not listed yet are selected once listed
+  connect( _fileSystemModel, &fileSystemModel_c::directoryLoaded, this, &pathInspectorWidget_c::revealPendingPath );
 }
 
 /*!
@@ -77,6 +171,10 @@ void pathInspectorWidget_c::setupTree()
 
   _fileTreeView->setModel( _fileSystemModel );
   _fileTreeView->setRootIndex( index );
+  // rows of huge folders are laid out without measuring each of them
+  _fileTreeView->setUniformRowHeights( true );
+  _fileTreeView->setSortingEnabled( true );
+  _fileTreeView->sortByColumn( 0, Qt::AscendingOrder );
   // hiding Date Modified from the view
   _fileTreeView->hideColumn( columnCount - 1 );
 
@@ -84,9 +182,18 @@ void pathInspectorWidget_c::setupTree()
   _fileTreeContextMenu = new QMenu( _fileTreeView );
   QAction *listAction = new QAction( tr( "List" ), this );
   _fileTreeContextMenu->addAction( listAction );
+  QAction *findAction = new QAction( tr( "Find in Files..." ), this );
+  _fileTreeContextMenu->addAction( findAction );
+  QAction *duplicatesAction = new QAction( tr( "Find Duplicates..." ), this );
+  _fileTreeContextMenu->addAction( duplicatesAction );
+  QAction *snapshotsAction = new QAction( tr( "Snapshots..." ), this );
+  _fileTreeContextMenu->addAction( snapshotsAction );
   connect( _fileTreeView, &QTreeView::customContextMenuRequested, this,
            &pathInspectorWidget_c::handleCustomMenuActivation );
   connect( listAction, &QAction::triggered, this, &pathInspectorWidget_c::handleContextMenuListAction );
+  connect( findAction, &QAction::triggered, this, &pathInspectorWidget_c::handleContextMenuFindAction );
+  connect( duplicatesAction, &QAction::triggered, this, &pathInspectorWidget_c::handleContextMenuDuplicatesAction );
+  connect( snapshotsAction, &QAction::triggered, this, &pathInspectorWidget_c::handleContextMenuSnapshotsAction );
 }
 
 /*!
@@ -101,9 +208,89 @@ void pathInspectorWidget_c::folderSelected( const QString &folderPath )
     _fileTreeView->setRootIndex( index );
     _fileTreeView->scrollTo( index );
     emit selectionChanged( folderPath );
+
+    _revealPath.clear();
+    _selectionWatchPath.clear();
+    _changeTracker->unwatchAll();
+    _changeTracker->watch( folderPath );
+    _changeTracker->trackTree( folderPath );
+    _sizeRescanPending = false;
+    _indexRescanPending = false;
+
+    _fileSearch->setRootPath( folderPath );
+    startSearch();
+    _treemap->setFolder( folderPath );
+
+    if ( _scanIndexEnabled )
+    {
+      // the index scan of the listed folder provides its totals as well
+      _sizeScanner->cancel();
+      loadScanIndex( folderPath );
+    }
+    else
+    {
+      _sizeScanner->scan( folderPath );
+    }
   }
 }
 
+/*!
+   Loads the index of a listed folder given at \a folderPath, if any, and starts a scan refreshing it
+   The sizes stored in the index are shown right away, the scan lists again only the folders modified since.
+   \param folderPath absolute path to the folder
+ */
+void pathInspectorWidget_c::loadScanIndex( const QString &folderPath )
+{
+  auto scanIndex = std::make_shared<scanIndex_c>();
+  if ( scanIndex->load( scanIndex_c::indexFilePath( folderPath ) ) && scanIndex->rootPath() == folderPath )
+    _fileSystemModel->setScanIndex( scanIndex );
+  else
+    _fileSystemModel->setScanIndex( {} );
+  _treemap->setScanIndex( _fileSystemModel->scanIndex() );
+
+  _indexScanner->scan( folderPath, _fileSystemModel->scanIndex(), true );
+}
+
+/*!
+   Slot to turn indexing of the listed folder on or off
+   \param enabled true to keep an index of the listed folder
+ */
+void pathInspectorWidget_c::setScanIndexEnabled( bool enabled )
+{
+  if ( enabled == _scanIndexEnabled )
+    return;
+
+  _scanIndexEnabled = enabled;
+  if ( enabled )
+  {
+    loadScanIndex( _fileSystemModel->rootPath() );
+  }
+  else
+  {
+    _indexScanner->cancel();
+    _fileSystemModel->setScanIndex( {} );
+    _treemap->setScanIndex( {} );
+  }
+}
+
+/*!
+   Slot to show or hide the treemap of the selected folder
+   \param visible true to show the treemap
+ */
+void pathInspectorWidget_c::setTreemapVisible( bool visible )
+{
+  _treemap->setVisible( visible );
+}
+
+/*!
+   Slot to turn the following of the selected text files on or off
+   \param followed true to follow the end of the selected text files as they grow
+ */
+void pathInspectorWidget_c::setLogFollowed( bool followed )
+{
+  _detailWidget->setLogFollowed( followed );
+}
+
 /*!
    Slot to handle the tree view menu activation
    \param menuActivationPoint a point where the menu was requested
@@ -125,10 +312,48 @@ void pathInspectorWidget_c::handleContextMenuListAction()
   folderSelected( _fileSystemModel->filePath( index ) );
 }
 
+/*!
+   Slot to handle activation of Find in Files context menu item
+   Opens a dialog searching contents of the files below the folder.
+ */
+void pathInspectorWidget_c::handleContextMenuFindAction()
+{
+  QModelIndex index = _fileTreeView->currentIndex();
+  findInFilesDialog_c *findDialog = new findInFilesDialog_c( _fileSystemModel->filePath( index ), this );
+  connect( findDialog, &findInFilesDialog_c::hitActivated, this, &pathInspectorWidget_c::handleFindHitActivated );
+  findDialog->show();
+}
+
+/*!
+   Slot to handle activation of Find Duplicates context menu item
+   Opens a dialog finding files of equal contents below the folder.
+ */
+void pathInspectorWidget_c::handleContextMenuDuplicatesAction()
+{
+  QModelIndex index = _fileTreeView->currentIndex();
+  duplicatesDialog_c *duplicatesDialog = new duplicatesDialog_c( _fileSystemModel->filePath( index ), this );
+  connect( duplicatesDialog, &duplicatesDialog_c::fileActivated, this,
+           &pathInspectorWidget_c::handleDuplicateActivated );
+  duplicatesDialog->show();
+}
+
+/*!
+   Slot to capture and compare snapshots of the folder the context menu was requested for
+ */
+void pathInspectorWidget_c::handleContextMenuSnapshotsAction()
+{
+  QModelIndex index = _fileTreeView->currentIndex();
+  snapshotDialog_c *snapshotDialog = new snapshotDialog_c( _fileSystemModel->filePath( index ), this );
+  connect( snapshotDialog, &snapshotDialog_c::fileActivated, this,
+           &pathInspectorWidget_c::handleSnapshotChangeActivated );
+  snapshotDialog->show();
+}
+
 /*!
    Slot to respond on tree view selection changes
    \param selected selected tree view item
    Emits \em selectionChanges signal with the selection path
+   A recursive size scan is started for a selected folder.
  */
 void pathInspectorWidget_c::fileTreeSelectionChanged( const QItemSelection &selected, const QItemSelection & )
 {
@@ -140,9 +365,36 @@ void pathInspectorWidget_c::fileTreeSelectionChanged( const QItemSelection &sele
     const auto selectedIndex = selectedIndexes.at( 0 );
     const QString selectionPath = _fileSystemModel->filePath( selectedIndex );
     emit selectionChanged( selectionPath );
+    prefetchSiblings( selectedIndex );
+
+    const bool isDir = _fileSystemModel->isDir( selectedIndex );
+    watchSelection( isDir ? selectionPath : QFileInfo( selectionPath ).absolutePath() );
+    _sizeRescanPending = false;
+
+    if ( isDir )
+    {
+      _treemap->setFolder( selectionPath );
+      _sizeScanner->scan( selectionPath, _fileSystemModel->scanIndex() );
+    }
+    else
+      _sizeScanner->cancel();
   }
 }
 
+/*!
+   Watches a folder given at \a folderPath for the selection, in place of the previously watched one
+   \param folderPath absolute path to the folder
+ */
+void pathInspectorWidget_c::watchSelection( const QString &folderPath )
+{
+  if ( folderPath == _selectionWatchPath )
+    return;
+
+  _changeTracker->unwatch( _selectionWatchPath );
+  _selectionWatchPath = folderPath;
+  _changeTracker->watch( _selectionWatchPath );
+}
+
 /*!
    Slot to handle activation of Up push button
  */
@@ -160,3 +412,319 @@ void pathInspectorWidget_c::handleNavigateHome()
 {
   folderSelected( QDir::homePath() );
 }
+
+/*!
+   Slot to show a folder size computed by \em _sizeScanner in the tree view
+   \param result the scan totals
+   Sizes of the sub-folders are set once the scan is complete.
+ */
+void pathInspectorWidget_c::handleSizeScanUpdate( const sizeScanResult_s &result )
+{
+  _fileSystemModel->setFolderSize( result.path, result.totalBytes );
+  _treemap->setScanResult( result );
+
+  if ( !result.complete )
+    return;
+
+  const QDir scannedDir( result.path );
+  for ( const auto &child : result.children )
+  {
+    if ( child.isDir )
+      _fileSystemModel->setFolderSize( scannedDir.filePath( child.name ), child.bytes );
+  }
+}
+
+/*!
+   Slot to reload the index of the listed folder written by \em _indexScanner
+   \param folderPath absolute path to the indexed folder
+ */
+void pathInspectorWidget_c::handleScanIndexUpdate( const QString &folderPath )
+{
+  if ( !_scanIndexEnabled || folderPath != _fileSystemModel->rootPath() )
+    return;
+
+  auto scanIndex = std::make_shared<scanIndex_c>();
+  if ( scanIndex->load( scanIndex_c::indexFilePath( folderPath ) ) )
+  {
+    _fileSystemModel->setScanIndex( scanIndex );
+    _treemap->setScanIndex( scanIndex );
+  }
+}
+
+/*!
+   Slot to handle totals of the selected folder scan, scheduling its restart if the folder changed meanwhile
+   \param result the scan totals
+ */
+void pathInspectorWidget_c::handleSelectionScanUpdate( const sizeScanResult_s &result )
+{
+  handleSizeScanUpdate( result );
+
+  if ( result.complete && _sizeRescanPending )
+    scheduleRescans();
+}
+
+/*!
+   Slot to handle totals of the listed folder index scan, scheduling its restart if the folder changed meanwhile
+   \param result the scan totals
+ */
+void pathInspectorWidget_c::handleIndexScanUpdate( const sizeScanResult_s &result )
+{
+  handleSizeScanUpdate( result );
+
+  if ( result.complete && _indexRescanPending )
+    scheduleRescans();
+}
+
+/*!
+   Schedules a restart of the pending scans
+   The delay is the duration of the last restarted scan, \em minimumRescanDelay at least, so a steady stream of
+   changes keeps the scanners busy half of the time at most.
+ */
+void pathInspectorWidget_c::scheduleRescans()
+{
+  if ( _rescanStart >= 0 && !_sizeScanner->isScanning() && !_indexScanner->isScanning() )
+  {
+    _rescanDuration = QDateTime::currentMSecsSinceEpoch() - _rescanStart;
+    _rescanStart = -1;
+  }
+
+  if ( !_rescanTimer->isActive() )
+    _rescanTimer->start( static_cast<int>( qMax( minimumRescanDelay, _rescanDuration ) ) );
+}
+
+/*!
+   Slot to restart the pending scans that are not running, a running one is rescheduled once complete
+ */
+void pathInspectorWidget_c::restartScans()
+{
+  if ( _sizeRescanPending && !_sizeScanner->isScanning() )
+  {
+    _sizeRescanPending = false;
+    _rescanStart = QDateTime::currentMSecsSinceEpoch();
+    _sizeScanner->scan( _sizeScanner->scannedPath(), _fileSystemModel->scanIndex() );
+  }
+
+  if ( _indexRescanPending && !_indexScanner->isScanning() )
+  {
+    _indexRescanPending = false;
+    if ( _scanIndexEnabled )
+    {
+      _rescanStart = QDateTime::currentMSecsSinceEpoch();
+      _indexScanner->scan( _fileSystemModel->rootPath(), _fileSystemModel->scanIndex(), true );
+    }
+  }
+}
+
+/*!
+   Slot to bring the views up to date with changed entries reported by \em _changeTracker
+   The preview of a changed entry is refreshed, the tree refreshes the changed entries and the scans of the folders
+   containing the changes are restarted, see \em scheduleRescans. A scan still running is restarted once complete,
+   so a steady stream of changes does not starve it. With an index, the restarted scans list the changed folders
+   only.
+   \param directories absolute paths to the folders with changed entries
+   \param entries absolute paths to the changed entries
+ */
+void pathInspectorWidget_c::handleTrackedChanges( const QStringList &directories, const QStringList &entries )
+{
+  _detailWidget->refreshPaths( directories + entries );
+  _fileSearch->refreshDirectories( directories );
+
+  // a folder reported as an entry itself changed as a whole, otherwise its changed entries are refreshed only
+  QHash<QString, QStringList> changedNames;
+  for ( const auto &entry : entries )
+  {
+    const int slash = entry.lastIndexOf( '/' );
+    if ( slash >= 0 )
+      changedNames[ ( slash > 0 ) ? entry.left( slash ) : QStringLiteral( "/" ) ].append( entry.mid( slash + 1 ) );
+  }
+  for ( const auto &directory : directories )
+  {
+    if ( entries.contains( directory ) )
+      _fileSystemModel->refreshDirectory( directory );
+    else
+      _fileSystemModel->refreshEntries( directory, changedNames.value( directory ) );
+  }
+
+  const auto containsChange = [&directories]( const QString &folderPath )
+  {
+    return std::any_of( directories.begin(), directories.end(), [&folderPath]( const QString &directory )
+    {
+      return fileInspector_n::util_n::isWithinFolder( directory, folderPath );
+    } );
+  };
+
+  if ( containsChange( _sizeScanner->scannedPath() ) )
+    _sizeRescanPending = true;
+  if ( _scanIndexEnabled && containsChange( _fileSystemModel->rootPath() ) )
+    _indexRescanPending = true;
+  if ( _sizeRescanPending || _indexRescanPending )
+    scheduleRescans();
+}
+
+/*!
+   Slot to start watching a folder expanded in the tree view
+   \param index the model index of the folder
+ */
+void pathInspectorWidget_c::handleTreeExpanded( const QModelIndex &index )
+{
+  _changeTracker->watch( _fileSystemModel->filePath( index ) );
+}
+
+/*!
+   Slot to stop watching a folder collapsed in the tree view
+   \param index the model index of the folder
+ */
+void pathInspectorWidget_c::handleTreeCollapsed( const QModelIndex &index )
+{
+  _changeTracker->unwatch( _fileSystemModel->filePath( index ) );
+}
+
+/*!
+   Slot to search entry names below the listed folder for the text of \em _searchLine
+   The results replace the previous ones and are shown as they arrive.
+ */
+void pathInspectorWidget_c::startSearch()
+{
+  _searchResults->clear();
+
+  const QString pattern = _searchLine->text();
+  if ( pattern.isEmpty() )
+  {
+    _fileSearch->cancelSearch();
+    _searchResults->hide();
+    return;
+  }
+
+  _searchResults->show();
+  const auto mode = static_cast<fileNameIndex_c::matchMode_e>( _searchModeBox->currentData().toInt() );
+  _fileSearch->search( pattern, mode );
+}
+
+/*!
+   Slot to show a batch of search matches \a paths
+   \param paths absolute paths to the matches
+ */
+void pathInspectorWidget_c::handleSearchResults( const QStringList &paths )
+{
+  const QDir rootDir( _fileSearch->rootPath() );
+  for ( const auto &path : paths )
+  {
+    QListWidgetItem *item = new QListWidgetItem( rootDir.relativeFilePath( path ), _searchResults );
+    item->setData( Qt::UserRole, path );
+  }
+}
+
+/*!
+   Slot to handle the end of a search
+   \param matchCount number of the matches
+ */
+void pathInspectorWidget_c::handleSearchFinished( int matchCount )
+{
+  _searchLine->setToolTip( ( matchCount >= fileSearch_c::maximumResults )
+                           ? tr( "First %1 matches shown" ).arg( matchCount ) : tr( "%1 matches" ).arg( matchCount ) );
+}
+
+/*!
+   Slot to handle a finished index build of the search
+   \param entryCount number of the indexed entries
+ */
+void pathInspectorWidget_c::handleSearchIndexReady( qint64 entryCount )
+{
+  _searchLine->setPlaceholderText( tr( "Search %1 entries" ).arg( QLocale().toString( entryCount ) ) );
+}
+
+/*!
+   Slot to select a search match \a item in the tree view
+   \param item the activated match
+ */
+void pathInspectorWidget_c::handleSearchResultActivated( QListWidgetItem *item )
+{
+  revealPath( item->data( Qt::UserRole ).toString() );
+}
+
+/*!
+   Slot to select a file of a content search hit in the tree view and to show the hit line
+   \param path absolute path to the file
+   \param line zero-based line number
+ */
+void pathInspectorWidget_c::handleFindHitActivated( const QString &path, qint64 line )
+{
+  revealPath( path );
+  _detailWidget->showPathLine( path, line );
+}
+
+/*!
+   Slot to select a file given at \a path, activated in the duplicates dialog
+   \param path absolute path to the file
+ */
+void pathInspectorWidget_c::handleDuplicateActivated( const QString &path )
+{
+  revealPath( path );
+}
+
+/*!
+   Slot to select an entry given at \a path, clicked in the treemap
+   \param path absolute path to the entry
+ */
+void pathInspectorWidget_c::handleTreemapActivated( const QString &path )
+{
+  revealPath( path );
+}
+
+/*!
+   Slot to select an entry given at \a path, activated in the snapshots dialog
+   \param path absolute path to the entry
+ */
+void pathInspectorWidget_c::handleSnapshotChangeActivated( const QString &path )
+{
+  revealPath( path );
+}
+
+/*!
+   Prefetches previews of the siblings next to the entry given at \a index, for a quick walk along the tree
+   The nearest siblings go first, the following one before the preceding one.
+   \param index index of the selected entry
+ */
+void pathInspectorWidget_c::prefetchSiblings( const QModelIndex &index )
+{
+  const QModelIndex parent = index.parent();
+  const int rowCount = _fileSystemModel->rowCount( parent );
+
+  QStringList paths;
+  for ( int distance = 1; distance <= prefetchSiblingCount; distance++ )
+  {
+    for ( const int row : { index.row() + distance, index.row() - distance } )
+    {
+      if ( row >= 0 && row < rowCount )
+        paths.append( _fileSystemModel->filePath( _fileSystemModel->index( row, 0, parent ) ) );
+    }
+  }
+  _detailWidget->prefetchPreviews( paths );
+}
+
+/*!
+   Selects an entry given at \a path in the tree view, once the folders along the path are listed
+   \param path absolute path to the entry
+ */
+void pathInspectorWidget_c::revealPath( const QString &path )
+{
+  _revealPath = path;
+  revealPendingPath();
+}
+
+/*!
+   Slot to select the entry requested by \em revealPath, or to list the next folder along its path
+ */
+void pathInspectorWidget_c::revealPendingPath()
+{
+  if ( _revealPath.isEmpty() || !_fileSystemModel->fetchPath( _revealPath ) )
+    return;
+
+  const QModelIndex index = _fileSystemModel->index( _revealPath );
+  _revealPath.clear();
+  if ( index.isValid() )
+  {
+    _fileTreeView->setCurrentIndex( index );
+    _fileTreeView->scrollTo( index );
+  }
+}
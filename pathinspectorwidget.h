@@ -2,14 +2,26 @@
 
 #include <QWidget>
 
+class changeTracker_c;
 class detailWidget_c;
-class QFileSystemModel;
+class fileSearch_c;
+class fileSystemModel_c;
+class sizeScanner_c;
+class treemapWidget_c;
+class QComboBox;
 class QItemSelection;
+class QLineEdit;
+class QListWidget;
+class QListWidgetItem;
 class QMenu;
+class QModelIndex;
 class QPoint;
 class QPushButton;
+class QTimer;
 class QTreeView;
 
+struct sizeScanResult_s;
+
 /*!
    Defines a central widget of the application.
    Contains a tree view and some buttons for navigation along with preview logic \em detailWidget_c
@@ -27,11 +39,42 @@ class pathInspectorWidget_c : public QWidget
     // Navigation Home button
     QPushButton *_navigateHomeButton;
     // File system data model
-    QFileSystemModel *_fileSystemModel;
+    fileSystemModel_c *_fileSystemModel;
     // File system tree view
     QTreeView *_fileTreeView;
     // Context menu for the file system tree view
     QMenu *_fileTreeContextMenu;
+    // Entry name search below the listed folder
+    QLineEdit *_searchLine;
+    // Search mode: substring, glob or regular expression
+    QComboBox *_searchModeBox;
+    // Matches of the search
+    QListWidget *_searchResults;
+    // Indexed search of entry names
+    fileSearch_c *_fileSearch;
+    // Recursive size scanner of the selected folder
+    sizeScanner_c *_sizeScanner;
+    // Size scanner maintaining the index of the listed folder
+    sizeScanner_c *_indexScanner;
+    // The listed folder is indexed
+    bool _scanIndexEnabled;
+    // Tracks changes of the listed, expanded and selected folders
+    changeTracker_c *_changeTracker;
+    // Folder watched for the selection, the selected folder or the folder of the selected file
+    QString _selectionWatchPath;
+    // Scans to restart, as their folders changed meanwhile
+    bool _sizeRescanPending;
+    bool _indexRescanPending;
+    // Restarts the pending scans, not sooner than the last restarted scan took after a scan ended
+    QTimer *_rescanTimer;
+    // Start of the last restarted scan in ms since epoch, -1 once complete
+    qint64 _rescanStart;
+    // Duration of the last restarted scan in ms
+    qint64 _rescanDuration;
+    // Disk usage of the selected folder
+    treemapWidget_c *_treemap;
+    // Entry to select once the folders along its path are listed
+    QString _revealPath;
 
   public:
     pathInspectorWidget_c( QWidget * = nullptr );
@@ -40,16 +83,45 @@ class pathInspectorWidget_c : public QWidget
     virtual ~pathInspectorWidget_c() = default;
     virtual void setupModel();
     virtual void setupTree();
+    void loadScanIndex( const QString & );
+    void watchSelection( const QString & );
+    void revealPath( const QString & );
+    void prefetchSiblings( const QModelIndex & );
+    void scheduleRescans();
 
   public slots:
     void folderSelected( const QString & );
     void handleCustomMenuActivation( const QPoint & );
     void handleContextMenuListAction();
+    void handleContextMenuFindAction();
+    void handleContextMenuDuplicatesAction();
+    void handleContextMenuSnapshotsAction();
+    void setScanIndexEnabled( bool );
+    void setTreemapVisible( bool );
+    void setLogFollowed( bool );
 
   private slots:
     void fileTreeSelectionChanged( const QItemSelection &, const QItemSelection & );
     void handleNavigateUp();
     void handleNavigateHome();
+    void handleSizeScanUpdate( const sizeScanResult_s & );
+    void handleSelectionScanUpdate( const sizeScanResult_s & );
+    void handleIndexScanUpdate( const sizeScanResult_s & );
+    void handleScanIndexUpdate( const QString & );
+    void handleTrackedChanges( const QStringList &, const QStringList & );
+    void restartScans();
+    void handleTreeExpanded( const QModelIndex & );
+    void handleTreeCollapsed( const QModelIndex & );
+    void startSearch();
+    void handleSearchResults( const QStringList & );
+    void handleSearchFinished( int );
+    void handleSearchIndexReady( qint64 );
+    void handleSearchResultActivated( QListWidgetItem * );
+    void handleFindHitActivated( const QString &, qint64 );
+    void handleDuplicateActivated( const QString & );
+    void handleTreemapActivated( const QString & );
+    void handleSnapshotChangeActivated( const QString & );
+    void revealPendingPath();
 
   signals:
     void selectionChanged( const QString & );
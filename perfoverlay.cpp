@@ -0,0 +1,114 @@
+#include "perfoverlay.h"
+
+#include <QEvent>
+#include <QLocale>
+#include <QTimer>
+
+#include "perftracer.h"
+
+namespace
+{
+  // Margin between the overlay and the corner of its parent
+  constexpr int overlayMargin = 8;
+
+  /*!
+     \param duration a duration in ns
+     \return the duration formatted in the fitting unit
+   */
+  QString formatDuration( qint64 duration )
+  {
+    if ( duration < 1000 )
+      return QString( "%1 ns" ).arg( duration );
+    if ( duration < 1000 * 1000 )
+      return QString( "%1 µs" ).arg( static_cast<double>( duration ) / 1e3, 0, 'f', 1 );
+    return QString( "%1 ms" ).arg( static_cast<double>( duration ) / 1e6, 0, 'f', 1 );
+  }
+}
+
+/*!
+   C-tor
+   \param parent the widget the overlay floats over
+ */
+perfOverlay_c::perfOverlay_c( QWidget *parent ) :
+  QLabel( parent ),
+  _refreshTimer{ nullptr }
+{
+  setAttribute( Qt::WA_TransparentForMouseEvents );
+  setTextFormat( Qt::RichText );
+  setStyleSheet( "QLabel { background-color: rgba( 0, 0, 0, 170 ); color: white; padding: 6px; "
+                 "border-radius: 4px; font-family: monospace; }" );
+  hide();
+
+  _refreshTimer = new QTimer( this );
+  _refreshTimer->setInterval( refreshInterval );
+  connect( _refreshTimer, &QTimer::timeout, this, &perfOverlay_c::refresh );
+
+  parent->installEventFilter( this );
+}
+
+/*!
+   Slot to show and refresh the overlay, or to hide it
+   \param active true to show
+ */
+void perfOverlay_c::setActive( bool active )
+{
+  if ( active )
+  {
+    refresh();
+    show();
+    raise();
+    _refreshTimer->start();
+  }
+  else
+  {
+    _refreshTimer->stop();
+    hide();
+  }
+}
+
+/*!
+   Keeps the overlay in the corner of its resized parent
+   \param watched the watched object
+   \param event the event
+   \return false, the event is passed on
+ */
+bool perfOverlay_c::eventFilter( QObject *watched, QEvent *event )
+{
+  if ( watched == parentWidget() && event->type() == QEvent::Resize )
+    place();
+
+  return QLabel::eventFilter( watched, event );
+}
+
+/*!
+   Slot to show the current latency percentiles of the traced operations
+ */
+void perfOverlay_c::refresh()
+{
+  QString text = "<table><tr><th align=left>operation</th><th align=right>&nbsp;count</th>"
+                 "<th align=right>&nbsp;p50</th><th align=right>&nbsp;p99</th></tr>";
+  for ( const perfTracer_c::statistics_s &statistics : perfTracer_c::instance().statistics() )
+  {
+    text += QString( "<tr><td>%1</td><td align=right>&nbsp;%2</td>" ).
+            arg( perfTracer_c::operationName( statistics.operation ) ).
+            arg( QLocale().toString( statistics.count ) );
+    if ( statistics.count > 0 )
+      text += QString( "<td align=right>&nbsp;%1</td><td align=right>&nbsp;%2</td></tr>" ).
+              arg( formatDuration( statistics.p50 ), formatDuration( statistics.p99 ) );
+    else
+      text += "<td align=right>&nbsp;-</td><td align=right>&nbsp;-</td></tr>";
+  }
+  text += "</table>";
+
+  setText( text );
+  adjustSize();
+  place();
+}
+
+/*!
+   Moves the overlay to the top right corner of its parent
+ */
+void perfOverlay_c::place()
+{
+  move( qMax( 0, parentWidget()->width() - width() - overlayMargin ), overlayMargin );
+}
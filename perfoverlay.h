@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QLabel>
+
+class QTimer;
+
+/*!
+   Overlay showing the recent latencies recorded by \em perfTracer_c
+   Floats translucent over the top right corner of its parent widget and lets mouse events through. The
+   percentiles are refreshed periodically while the overlay is visible.
+ */
+class perfOverlay_c : public QLabel
+{
+  Q_OBJECT
+
+  public:
+    // Period of the refresh in ms
+    static constexpr int refreshInterval = 500;
+
+  private:
+    QTimer *_refreshTimer;
+
+  public:
+    explicit perfOverlay_c( QWidget * );
+    virtual ~perfOverlay_c() = default;
+
+  public slots:
+    void setActive( bool );
+
+  protected:
+    bool eventFilter( QObject *, QEvent * ) override;
+
+  private slots:
+    void refresh();
+
+  private:
+    void place();
+};
@@ -0,0 +1,224 @@
+#include "perftracer.h"
+
+#include <QSaveFile>
+
+#include <algorithm>
+
+namespace
+{
+  // Source of the small thread ids
+  std::atomic<quint32> nextThreadId{ 1 };
+
+  /*!
+     \return small id of the calling thread, assigned on its first event
+   */
+  quint32 currentThreadId()
+  {
+    thread_local const quint32 threadId = nextThreadId.fetch_add( 1, std::memory_order_relaxed );
+    return threadId;
+  }
+
+  /*!
+     \param samples sorted durations
+     \param percentile the percentile, 0 to 100
+     \return duration of the percentile
+   */
+  qint64 percentileOf( const std::vector<qint64> &samples, double percentile )
+  {
+    const size_t index = static_cast<size_t>( percentile / 100.0 * static_cast<double>( samples.size() - 1 ) + 0.5 );
+    return samples[ std::min( index, samples.size() - 1 ) ];
+  }
+}
+
+/*!
+   C-tor
+ */
+perfTracer_c::perfTracer_c() :
+  _enabled{ false },
+  _nextEvent{ 0 },
+  _slots{ std::make_unique<std::array<slot_s, capacity>>() }
+{
+  _clock.start();
+}
+
+/*!
+   \return the tracer shared by all threads
+ */
+perfTracer_c &perfTracer_c::instance()
+{
+  static perfTracer_c tracer;
+  return tracer;
+}
+
+/*!
+   Turns the recording on or off
+   \param enabled true to record
+ */
+void perfTracer_c::setEnabled( bool enabled )
+{
+  _enabled.store( enabled, std::memory_order_relaxed );
+}
+
+/*!
+   \return true if recording
+ */
+bool perfTracer_c::isEnabled() const
+{
+  return _enabled.load( std::memory_order_relaxed );
+}
+
+/*!
+   \return current time of the tracer, in ns
+ */
+qint64 perfTracer_c::now() const
+{
+  return _clock.nsecsElapsed();
+}
+
+/*!
+   Records a timing of an operation \a operation, overwriting the oldest one if the ring is full
+   \param operation the operation
+   \param start start of the operation, see now()
+   \param duration duration of the operation, in ns
+ */
+void perfTracer_c::record( operation_e operation, qint64 start, qint64 duration )
+{
+  const quint64 eventNumber = _nextEvent.fetch_add( 1, std::memory_order_relaxed );
+  slot_s &slot = ( *_slots )[ eventNumber % capacity ];
+
+  slot.sequence.store( 2 * eventNumber + 1, std::memory_order_relaxed );
+  std::atomic_thread_fence( std::memory_order_release );
+  slot.operation.store( static_cast<quint32>( operation ), std::memory_order_relaxed );
+  slot.thread.store( currentThreadId(), std::memory_order_relaxed );
+  slot.start.store( start, std::memory_order_relaxed );
+  slot.duration.store( duration, std::memory_order_relaxed );
+  slot.sequence.store( 2 * eventNumber + 2, std::memory_order_release );
+}
+
+/*!
+   Forgets the recorded timings
+   Timings recorded concurrently may survive.
+ */
+void perfTracer_c::clear()
+{
+  for ( slot_s &slot : *_slots )
+    slot.sequence.store( 0, std::memory_order_relaxed );
+}
+
+/*!
+   \return the recorded timings still in the ring, oldest first
+ */
+std::vector<perfTracer_c::event_s> perfTracer_c::events() const
+{
+  const quint64 eventEnd = _nextEvent.load( std::memory_order_acquire );
+  const quint64 eventBegin = ( eventEnd > capacity ) ? eventEnd - capacity : 0;
+
+  std::vector<event_s> result;
+  result.reserve( static_cast<size_t>( eventEnd - eventBegin ) );
+  for ( quint64 eventNumber = eventBegin; eventNumber < eventEnd; eventNumber++ )
+  {
+    const slot_s &slot = ( *_slots )[ eventNumber % capacity ];
+    const quint64 sequence = slot.sequence.load( std::memory_order_acquire );
+    if ( sequence != 2 * eventNumber + 2 )
+      continue;
+
+    event_s event;
+    event.operation = static_cast<operation_e>( slot.operation.load( std::memory_order_relaxed ) );
+    event.thread = slot.thread.load( std::memory_order_relaxed );
+    event.start = slot.start.load( std::memory_order_relaxed );
+    event.duration = slot.duration.load( std::memory_order_relaxed );
+
+    // skips the slot if a writer claimed it meanwhile
+    std::atomic_thread_fence( std::memory_order_acquire );
+    if ( slot.sequence.load( std::memory_order_relaxed ) == sequence )
+      result.push_back( event );
+  }
+  return result;
+}
+
+/*!
+   \return latency summary of every operation over the timings still in the ring
+ */
+std::vector<perfTracer_c::statistics_s> perfTracer_c::statistics() const
+{
+  std::array<std::vector<qint64>, static_cast<size_t>( operation_e::Count )> durations;
+  for ( const event_s &event : events() )
+    durations[ static_cast<size_t>( event.operation ) ].push_back( event.duration );
+
+  std::vector<statistics_s> result;
+  for ( size_t index = 0; index < durations.size(); index++ )
+  {
+    std::vector<qint64> &samples = durations[ index ];
+    statistics_s operationStatistics;
+    operationStatistics.operation = static_cast<operation_e>( index );
+    operationStatistics.count = static_cast<int>( samples.size() );
+    if ( !samples.empty() )
+    {
+      std::sort( samples.begin(), samples.end() );
+      operationStatistics.p50 = percentileOf( samples, 50 );
+      operationStatistics.p99 = percentileOf( samples, 99 );
+    }
+    result.push_back( operationStatistics );
+  }
+  return result;
+}
+
+/*!
+   Writes the timings still in the ring to a file given at \a filePath in the Chrome trace-event format
+   \param filePath path to the file
+   \return true on success
+ */
+bool perfTracer_c::writeChromeTrace( const QString &filePath ) const
+{
+  QSaveFile file( filePath );
+  if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    return false;
+
+  QByteArray content = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  bool first = true;
+  for ( const event_s &event : events() )
+  {
+    if ( !first )
+      content += ",\n";
+    first = false;
+
+    content += "{\"name\":\"";
+    content += operationName( event.operation );
+    content += "\",\"cat\":\"fileinspector\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+    content += QByteArray::number( event.thread );
+    content += ",\"ts\":";
+    content += QByteArray::number( static_cast<double>( event.start ) / 1000.0, 'f', 3 );
+    content += ",\"dur\":";
+    content += QByteArray::number( static_cast<double>( event.duration ) / 1000.0, 'f', 3 );
+    content += '}';
+  }
+  content += "\n]}\n";
+
+  return file.write( content ) == content.size() && file.commit();
+}
+
+/*!
+   \param operation an operation
+   \return name of the operation
+ */
+const char *perfTracer_c::operationName( operation_e operation )
+{
+  switch ( operation )
+  {
+    case operation_e::Stat:
+      return "stat";
+    case operation_e::DirListing:
+      return "dir listing";
+    case operation_e::MimeProbe:
+      return "MIME probe";
+    case operation_e::FileRead:
+      return "file read";
+    case operation_e::TextLayout:
+      return "text layout";
+    case operation_e::ModelPopulation:
+      return "model population";
+    case operation_e::Count:
+      break;
+  }
+  return "";
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QString>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/*!
+   Records timings of the inspector operations into a lock-free ring buffer
+   Recording costs a single relaxed load while the tracer is disabled. Enabled, every timed operation claims a
+   slot of the ring with an atomic increment and publishes it with a sequence number, so readers never block the
+   writers and skip slots being overwritten. The recent timings are summarized as latency percentiles and can be
+   written out as a Chrome trace-event file, see chrome://tracing or Perfetto.
+ */
+class perfTracer_c
+{
+  public:
+    enum class operation_e : quint8
+    {
+      Stat,
+      DirListing,
+      MimeProbe,
+      FileRead,
+      TextLayout,
+      ModelPopulation,
+      Count
+    };
+
+    /*!
+       A recorded timing
+     */
+    struct event_s
+    {
+      operation_e operation;
+      // Small id of the recording thread
+      quint32 thread;
+      // Start and duration in ns, the start relative to the tracer creation
+      qint64 start;
+      qint64 duration;
+    };
+
+    /*!
+       Latency summary of an operation over the recent timings
+     */
+    struct statistics_s
+    {
+      operation_e operation;
+      int count = 0;
+      qint64 p50 = 0;
+      qint64 p99 = 0;
+    };
+
+    // Number of the slots of the ring
+    static constexpr size_t capacity = 16384;
+
+  private:
+    /*!
+       Slot of the ring
+       The sequence is odd while the slot is written, twice the event number plus two once published.
+     */
+    struct slot_s
+    {
+      std::atomic<quint64> sequence{ 0 };
+      std::atomic<quint32> operation{ 0 };
+      std::atomic<quint32> thread{ 0 };
+      std::atomic<qint64> start{ 0 };
+      std::atomic<qint64> duration{ 0 };
+    };
+
+    std::atomic<bool> _enabled;
+    // Number of the events recorded so far, the next event goes to the slot of this number modulo capacity
+    std::atomic<quint64> _nextEvent;
+    std::unique_ptr<std::array<slot_s, capacity>> _slots;
+    // Time base of the events
+    QElapsedTimer _clock;
+
+  public:
+    static perfTracer_c &instance();
+
+    void setEnabled( bool );
+    bool isEnabled() const;
+
+    qint64 now() const;
+    void record( operation_e, qint64, qint64 );
+    void clear();
+
+    std::vector<event_s> events() const;
+    std::vector<statistics_s> statistics() const;
+    bool writeChromeTrace( const QString & ) const;
+
+    static const char *operationName( operation_e );
+
+  private:
+    perfTracer_c();
+};
+
+/*!
+   Times the enclosing scope as an operation of the tracer, if enabled when the scope starts
+ */
+class perfScope_c
+{
+  private:
+    perfTracer_c::operation_e _operation;
+    // Start of the scope, -1 if the tracer is disabled
+    qint64 _start;
+
+  public:
+    explicit perfScope_c( perfTracer_c::operation_e operation ) :
+      _operation{ operation },
+      _start{ perfTracer_c::instance().isEnabled() ? perfTracer_c::instance().now() : -1 }
+    {
+    }
+
+    ~perfScope_c()
+    {
+      if ( _start >= 0 )
+        perfTracer_c::instance().record( _operation, _start, perfTracer_c::instance().now() - _start );
+    }
+
+    perfScope_c( const perfScope_c & ) = delete;
+    perfScope_c &operator=( const perfScope_c & ) = delete;
+};
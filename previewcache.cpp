@@ -0,0 +1,176 @@
+#include "previewcache.h"
+
+#include <QMutexLocker>
+
+namespace
+{
+  /*!
+     Estimates memory occupied by a cached preview \a result
+     \param result the preview
+     \return estimated size in bytes
+   */
+  qint64 previewCost( const previewResult_s &result )
+  {
+    return static_cast<qint64>( sizeof( previewResult_s ) ) +
+           ( result.path.size() + result.mimeName.size() + result.content.size() + result.summary.size() ) *
+           static_cast<qint64>( sizeof( QChar ) );
+  }
+}
+
+/*!
+   C-tor
+   \param byteBudget maximum estimated size of the cached previews in bytes
+ */
+previewCache_c::previewCache_c( qint64 byteBudget ) :
+  _byteBudget{ byteBudget }
+{
+}
+
+/*!
+   Looks up a preview matching the \a request
+   The cached preview is only valid if it was produced for the same preview budgets and the entry on disk
+   still has the modification time \a modified and the size \a size. Outdated previews are dropped.
+   \param request the preview parameters
+   \param modified current modification time of the entry in ns since epoch
+   \param size current size of the entry
+   \param result output for the cached preview
+   \return true on a cache hit
+ */
+bool previewCache_c::lookup( const previewRequest_s &request, qint64 modified, qint64 size, previewResult_s &result )
+{
+  QMutexLocker locker( &_mutex );
+
+  auto indexIt = _index.find( request.path );
+  if ( indexIt == _index.end() )
+  {
+    _statistics.misses++;
+    return false;
+  }
+
+  auto entryIt = indexIt.value();
+  if ( entryIt->modified != modified || entryIt->size != size ||
+       entryIt->maxContentSize != request.maxContentSize || entryIt->maxContentLines != request.maxContentLines ||
+       entryIt->readTextContent != request.readTextContent )
+  {
+    _statistics.bytes -= entryIt->cost;
+    _entries.erase( entryIt );
+    _index.erase( indexIt );
+    _statistics.misses++;
+    return false;
+  }
+
+  _entries.splice( _entries.begin(), _entries, entryIt );
+  _statistics.hits++;
+  result = entryIt->result;
+  return true;
+}
+
+/*!
+   Stores a preview \a result produced for the \a request
+   \param request the preview parameters
+   \param modified modification time of the entry in ns since epoch at the time of the preview
+   \param size size of the entry at the time of the preview
+   \param result the preview
+ */
+void previewCache_c::insert( const previewRequest_s &request, qint64 modified, qint64 size, const previewResult_s &result )
+{
+  const qint64 cost = previewCost( result );
+
+  QMutexLocker locker( &_mutex );
+
+  auto indexIt = _index.find( request.path );
+  if ( indexIt != _index.end() )
+  {
+    _statistics.bytes -= indexIt.value()->cost;
+    _entries.erase( indexIt.value() );
+    _index.erase( indexIt );
+  }
+
+  if ( cost > _byteBudget )
+    return;
+
+  _entries.push_front( { modified, size, request.maxContentSize, request.maxContentLines, request.readTextContent,
+                         result, cost } );
+  _index.insert( request.path, _entries.begin() );
+  _statistics.bytes += cost;
+
+  evict();
+}
+
+/*!
+   Drops a cached preview of the entry given at \a path
+   \param path absolute path to the entry
+ */
+void previewCache_c::remove( const QString &path )
+{
+  QMutexLocker locker( &_mutex );
+
+  auto indexIt = _index.find( path );
+  if ( indexIt != _index.end() )
+  {
+    _statistics.bytes -= indexIt.value()->cost;
+    _entries.erase( indexIt.value() );
+    _index.erase( indexIt );
+  }
+}
+
+/*!
+   Drops all the cached previews
+ */
+void previewCache_c::clear()
+{
+  QMutexLocker locker( &_mutex );
+
+  _entries.clear();
+  _index.clear();
+  _statistics.bytes = 0;
+}
+
+/*!
+   Changes the cache byte budget to \a byteBudget, evicting entries if necessary
+   \param byteBudget maximum estimated size of the cached previews in bytes
+ */
+void previewCache_c::setByteBudget( qint64 byteBudget )
+{
+  QMutexLocker locker( &_mutex );
+
+  _byteBudget = byteBudget;
+  evict();
+}
+
+/*!
+   \return maximum estimated size of the cached previews in bytes
+ */
+qint64 previewCache_c::byteBudget() const
+{
+  QMutexLocker locker( &_mutex );
+  return _byteBudget;
+}
+
+/*!
+   \return snapshot of the cache usage counters
+ */
+previewCache_c::statistics_s previewCache_c::statistics() const
+{
+  QMutexLocker locker( &_mutex );
+
+  statistics_s retvalue = _statistics;
+  retvalue.entries = _index.size();
+  return retvalue;
+}
+
+/*!
+   Evicts the least recently used entries until the cache fits into the byte budget
+   Expects \em _mutex to be locked.
+ */
+void previewCache_c::evict()
+{
+  while ( _statistics.bytes > _byteBudget && !_entries.empty() )
+  {
+    auto &entry = _entries.back();
+    _statistics.bytes -= entry.cost;
+    _statistics.evictions++;
+    _index.remove( entry.result.path );
+    _entries.pop_back();
+  }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+#include <list>
+
+#include "previewtypes.h"
+
+/*!
+   Bounded LRU cache of produced previews
+   Entries are keyed by the path and validated against the modification time and the size of the entry,
+   so a repeated selection costs a single stat. The least recently used entries are evicted once the total
+   size of the cached previews exceeds the byte budget. The class is thread-safe.
+ */
+class previewCache_c
+{
+  public:
+    /*!
+       Cache usage counters
+     */
+    struct statistics_s
+    {
+      quint64 hits = 0;
+      quint64 misses = 0;
+      quint64 evictions = 0;
+      // Estimated size of the cached previews in bytes
+      qint64 bytes = 0;
+      int entries = 0;
+    };
+
+    // Byte budget used if none is configured
+    static constexpr qint64 defaultByteBudget = 32 * 1024 * 1024;
+
+  private:
+    struct entry_s
+    {
+      // Modification time of the entry in ns since epoch
+      qint64 modified;
+      // Size of the entry
+      qint64 size;
+      // Preview budgets the preview was produced for
+      int maxContentSize;
+      int maxContentLines;
+      bool readTextContent;
+      previewResult_s result;
+      // Estimated size of the cache entry in bytes
+      qint64 cost;
+    };
+
+    using entryList_t = std::list<entry_s>;
+
+    mutable QMutex _mutex;
+    // Entries, most recently used first
+    entryList_t _entries;
+    // Path to entry lookup
+    QHash<QString, entryList_t::iterator> _index;
+    qint64 _byteBudget;
+    statistics_s _statistics;
+
+  public:
+    explicit previewCache_c( qint64 = defaultByteBudget );
+
+    bool lookup( const previewRequest_s &, qint64, qint64, previewResult_s & );
+    void insert( const previewRequest_s &, qint64, qint64, const previewResult_s & );
+    void remove( const QString & );
+    void clear();
+
+    void setByteBudget( qint64 );
+    qint64 byteBudget() const;
+    statistics_s statistics() const;
+
+  private:
+    void evict();
+};
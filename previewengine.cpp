@@ -0,0 +1,357 @@
+#include "previewengine.h"
+
+#include <QFile>
+#include <QLoggingCategory>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <vector>
+
+#include "archivepreview.h"
+#include "batchio.h"
+#include "dirlister.h"
+#include "util.h"
+
+namespace
+{
+  // Number of workers, more than one so a request hanging on a slow mount does not block the following ones
+  constexpr int previewThreadCount = 4;
+  // Environment variable overriding the preview cache byte budget
+  constexpr char previewCacheBudgetVariable[] = "FILEINSPECTOR_PREVIEW_CACHE_BYTES";
+  // Number of leading bytes of a prefetched file read ahead
+  constexpr qint64 prefetchReadAheadBytes = 256 * 1024;
+  // Number of bytes read ahead for a whole prefetch batch at most
+  constexpr qint64 prefetchByteBudget = 4 * 1024 * 1024;
+  // Interval of the checks whether the requested previews are done, in ms
+  constexpr unsigned long foregroundPollInterval = 5;
+
+  /*!
+     Counts a requested preview as in progress for the lifetime of the scope
+   */
+  class foregroundScope_c
+  {
+    private:
+      std::atomic<int> &_foregroundRequests;
+
+    public:
+      explicit foregroundScope_c( std::atomic<int> &foregroundRequests ) :
+        _foregroundRequests{ foregroundRequests }
+      {
+      }
+
+      ~foregroundScope_c()
+      {
+        _foregroundRequests--;
+      }
+
+      foregroundScope_c( const foregroundScope_c & ) = delete;
+      foregroundScope_c &operator=( const foregroundScope_c & ) = delete;
+  };
+
+  /*!
+     Asks the kernel to read the heads of the files given at \a requests into the page cache in the background
+     \param requests the preview parameters, files read ahead in the given order while within the byte budget
+   */
+  void readAhead( const QVector<previewRequest_s> &requests )
+  {
+    std::vector<batchIo_c::readRequest_s> reads;
+    qint64 readAheadBudget = prefetchByteBudget;
+    for ( const auto &request : requests )
+    {
+      const statCache_c::status_s status = statCache_c::instance().status( request.path );
+      if ( !status.isFile || readAheadBudget <= 0 )
+        continue;
+
+      batchIo_c::readRequest_s read;
+      read.path = QFile::encodeName( request.path ).toStdString();
+      read.length = std::min( { status.size, prefetchReadAheadBytes, readAheadBudget } );
+      readAheadBudget -= read.length;
+      reads.push_back( std::move( read ) );
+    }
+
+    // only advised, the prefetch does not wait for the storage
+    batchIo_c::forThread().readAhead( reads );
+  }
+}
+
+Q_LOGGING_CATEGORY( previewCacheLog, "fileinspector.previewcache", QtInfoMsg )
+
+/*!
+   C-tor
+   \param parent parent object
+ */
+previewEngine_c::previewEngine_c( QObject *parent ) :
+  QObject( parent ),
+  _generation{ 0 },
+  _prefetchGeneration{ 0 },
+  _foregroundRequests{ 0 }
+{
+  _threadPool.setMaxThreadCount( previewThreadCount );
+  _prefetchPool.setMaxThreadCount( 1 );
+
+  bool budgetValid = false;
+  const qint64 cacheBudget = qgetenv( previewCacheBudgetVariable ).toLongLong( &budgetValid );
+  if ( budgetValid && cacheBudget >= 0 )
+    _cache.setByteBudget( cacheBudget );
+}
+
+/*!
+   D-tor
+   Invalidates pending requests and prefetches and waits for the workers to finish.
+ */
+previewEngine_c::~previewEngine_c()
+{
+  cancel();
+  ++_prefetchGeneration;
+  _threadPool.waitForDone();
+  _prefetchPool.waitForDone();
+
+  const auto cacheStatistics = _cache.statistics();
+  qCInfo( previewCacheLog ) << "hits" << cacheStatistics.hits << "misses" << cacheStatistics.misses
+                            << "evictions" << cacheStatistics.evictions << "entries" << cacheStatistics.entries
+                            << "bytes" << cacheStatistics.bytes << "budget" << _cache.byteBudget();
+}
+
+/*!
+   Schedules a preview of the entry given at \a request on the worker pool
+   Any previously requested preview becomes stale.
+   \param request the preview parameters
+   \return generation of the request
+ */
+quint64 previewEngine_c::requestPreview( const previewRequest_s &request )
+{
+  const quint64 generation = ++_generation;
+
+  _foregroundRequests++;
+  QtConcurrent::run( &_threadPool, [this, request, generation]()
+  {
+    const foregroundScope_c foregroundScope( _foregroundRequests );
+    const auto isCancelled = [this, generation]() { return isStale( generation ); };
+    if ( isCancelled() )
+      return;
+
+    const auto postPartialResult = [this, generation]( const previewResult_s &partialResult )
+    {
+      previewResult_s result = partialResult;
+      result.generation = generation;
+      postResult( result );
+    };
+
+    previewResult_s result = producePreview( request, isCancelled, postPartialResult );
+    result.generation = generation;
+    if ( isCancelled() )
+      return;
+
+    postResult( result );
+  } );
+
+  return generation;
+}
+
+/*!
+   Prefetches previews of the entries given at \a requests into the cache, in the given order
+   Any previously requested prefetch is abandoned. The prefetch runs on a single low priority worker, which waits
+   while requested previews are in progress, and reads ahead the heads of the files within a byte budget in a single
+   batch.
+   \param requests the preview parameters, the entry most likely to be selected next first
+ */
+void previewEngine_c::prefetch( const QVector<previewRequest_s> &requests )
+{
+  const quint64 generation = ++_prefetchGeneration;
+  if ( requests.isEmpty() )
+    return;
+
+  QtConcurrent::run( &_prefetchPool, [this, requests, generation]()
+  {
+    QThread::currentThread()->setPriority( QThread::LowestPriority );
+    const auto isCancelled = [this, generation]() { return generation != _prefetchGeneration.load(); };
+
+    bool readAheadDone = false;
+    for ( const auto &request : requests )
+    {
+      while ( _foregroundRequests.load() > 0 && !isCancelled() )
+        QThread::msleep( foregroundPollInterval );
+      if ( isCancelled() )
+        return;
+
+      // the heads of all the files are read ahead at once before the first preview
+      if ( !readAheadDone )
+      {
+        readAhead( requests );
+        readAheadDone = true;
+        if ( isCancelled() )
+          return;
+      }
+
+      producePreview( request, isCancelled, {} );
+    }
+  } );
+}
+
+/*!
+   Delivers a \a result through \em previewReady on the thread the engine lives in, unless it is stale by then
+   \param result the preview
+ */
+void previewEngine_c::postResult( const previewResult_s &result )
+{
+  QMetaObject::invokeMethod( this, [this, result]()
+  {
+    if ( !isStale( result.generation ) )
+      emit previewReady( result );
+  }, Qt::QueuedConnection );
+}
+
+/*!
+   Makes all the pending requests stale
+ */
+void previewEngine_c::cancel()
+{
+  ++_generation;
+}
+
+/*!
+   \return cache of recently produced previews
+ */
+previewCache_c &previewEngine_c::cache()
+{
+  return _cache;
+}
+
+/*!
+   Checks if a request of generation \a generation has been superseded by a newer one
+   \param generation the request generation
+   \return true if the request is stale
+ */
+bool previewEngine_c::isStale( quint64 generation ) const
+{
+  return generation != _generation.load();
+}
+
+/*!
+   Produces a preview of the entry given at \a request, serving it from \em _cache if the entry is unchanged
+   \param request the preview parameters
+   \param isCancelled returns true once the preview is not needed anymore
+   \param partialResult receives intermediate results
+   \return the preview, may be incomplete if cancelled
+ */
+previewResult_s previewEngine_c::producePreview( const previewRequest_s &request,
+                                                 const std::function<bool()> &isCancelled,
+                                                 const std::function<void( const previewResult_s & )> &partialResult )
+{
+  previewResult_s result;
+  result.path = request.path;
+
+  // the path validation of the selection stat-ed the entry already
+  const statCache_c::status_s selectionStatus = statCache_c::instance().status( request.path );
+  if ( !selectionStatus.exists )
+    return result;
+
+  if ( _cache.lookup( request, selectionStatus.modified, selectionStatus.size, result ) )
+    return result;
+
+  result = buildPreview( request, selectionStatus, _mimeClassifier, isCancelled, partialResult );
+  if ( !isCancelled() )
+    _cache.insert( request, selectionStatus.modified, selectionStatus.size, result );
+
+  return result;
+}
+
+/*!
+   Builds a preview of the entry given at \a request
+   For a folder, a short listing is produced.
+   For a text file, small portion is read unless the requester renders text files itself.
+   For a compressed file or an archive, the head of the decompressed contents or the members are listed, see
+   \em archivePreview_c.
+   For other files, file attributes name, size and type are produced.
+   \param request the preview parameters
+   \param selectionStatus attributes of the entry
+   \param mimeClassifier detects text files
+   \param isCancelled returns true once the preview is not needed anymore
+   \param partialResult receives intermediate results of a folder or an archive listing, may be empty
+   \return the preview, may be incomplete if cancelled
+ */
+previewResult_s previewEngine_c::buildPreview( const previewRequest_s &request,
+                                               const statCache_c::status_s &selectionStatus,
+                                               mimeClassifier_c &mimeClassifier,
+                                               const std::function<bool()> &isCancelled,
+                                               const std::function<void( const previewResult_s & )> &partialResult )
+{
+  previewResult_s result;
+  result.path = request.path;
+
+  if ( !selectionStatus.exists )
+    return result;
+
+  if ( selectionStatus.isFile )
+  {
+    result.size = selectionStatus.size;
+
+    const mimeClassifier_c::mimeClass_s mimeClass = mimeClassifier.classify( request.path, selectionStatus );
+    result.mimeName = mimeClass.mimeName;
+
+    if ( isCancelled() )
+      return result;
+
+    if ( mimeClass.isText )
+    {
+      result.kind = previewResult_s::kind_e::TextFile;
+      if ( request.readTextContent )
+        result.content = fileInspector_n::util_n::getTextFileContent( request.path, selectionStatus,
+                                                                       request.maxContentSize );
+    }
+    else
+    {
+      result.kind = previewResult_s::kind_e::OtherFile;
+      result.summary = QString( "Name: %1\nType: %2\nSize: %3" ).arg( request.path ).arg( result.mimeName ).
+                       arg( result.size );
+      result.content = result.summary;
+
+      const auto partialListing = [&]( const QString &partialContent )
+      {
+        if ( partialResult )
+        {
+          previewResult_s partial = result;
+          partial.kind = previewResult_s::kind_e::Archive;
+          partial.content = partialContent;
+          partial.complete = false;
+          partialResult( partial );
+        }
+      };
+
+      const archivePreview_c::format_e format = archivePreview_c::detect( request.path );
+      QString content;
+      if ( archivePreview_c::isSupported( format ) &&
+           archivePreview_c::preview( request.path, format, request.maxContentSize, request.maxContentLines,
+                                      isCancelled, partialListing, content ) )
+      {
+        result.kind = previewResult_s::kind_e::Archive;
+        result.content = content;
+      }
+    }
+  }
+  else if ( selectionStatus.isDir )
+  {
+    result.kind = previewResult_s::kind_e::Folder;
+
+    dirLister_c lister;
+    lister.list( request.path, request.maxContentLines, [&]()
+    {
+      if ( isCancelled() )
+        return false;
+
+      if ( partialResult )
+      {
+        result.content = lister.entryPaths( request.path, request.maxContentLines ).join( "\n" );
+        result.complete = false;
+        partialResult( result );
+      }
+      return true;
+    } );
+
+    result.content = lister.entryPaths( request.path, request.maxContentLines ).join( "\n" );
+    result.complete = true;
+  }
+
+  return result;
+}
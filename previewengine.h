@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QObject>
+#include <QThreadPool>
+#include <QVector>
+
+#include <atomic>
+#include <functional>
+
+#include "mimeclassifier.h"
+#include "previewcache.h"
+#include "previewtypes.h"
+
+/*!
+   Performs preview I/O and MIME detection on a worker thread pool
+   Every request gets a new generation. A result is delivered through \em previewReady on the thread the engine
+   lives in, only if no newer request has been issued in the meantime, so stale results never reach the preview pane.
+   Folder listings are delivered incrementally, as intermediate results, while the listing is in progress.
+   Previews of entries likely to be selected next can be prefetched into the cache by a single low priority worker,
+   which yields to the requested previews and reads ahead only a bounded number of bytes per batch.
+ */
+class previewEngine_c : public QObject
+{
+  Q_OBJECT
+
+  private:
+    // Workers performing the preview I/O
+    QThreadPool _threadPool;
+    // Generation of the latest request
+    std::atomic<quint64> _generation;
+    // Recently produced previews
+    previewCache_c _cache;
+    // Memoized text file detection
+    mimeClassifier_c _mimeClassifier;
+    // Worker prefetching previews
+    QThreadPool _prefetchPool;
+    // Generation of the latest prefetch batch
+    std::atomic<quint64> _prefetchGeneration;
+    // Number of requested previews in progress, the prefetching waits for them
+    std::atomic<int> _foregroundRequests;
+
+  public:
+    previewEngine_c( QObject * = nullptr );
+    virtual ~previewEngine_c();
+
+    quint64 requestPreview( const previewRequest_s & );
+    void prefetch( const QVector<previewRequest_s> & );
+    void cancel();
+    previewCache_c &cache();
+
+    static previewResult_s buildPreview( const previewRequest_s &, const statCache_c::status_s &, mimeClassifier_c &,
+                                         const std::function<bool()> &,
+                                         const std::function<void( const previewResult_s & )> & = {} );
+
+  private:
+    bool isStale( quint64 ) const;
+    previewResult_s producePreview( const previewRequest_s &, const std::function<bool()> &,
+                                    const std::function<void( const previewResult_s & )> & );
+    void postResult( const previewResult_s & );
+
+  signals:
+    void previewReady( const previewResult_s & );
+};
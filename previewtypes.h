@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QString>
+
+/*!
+   Parameters of a preview request, prepared on the GUI thread
+ */
+struct previewRequest_s
+{
+  // Absolute path to the file system entry
+  QString path;
+  // Maximum number of characters of a text file to preview
+  int maxContentSize = -1;
+  // Maximum number of folder entries to preview
+  int maxContentLines = -1;
+  // False if text files are rendered by the requester itself, only their kind is detected then
+  bool readTextContent = true;
+};
+
+/*!
+   Outcome of a preview request, produced by a worker thread
+ */
+struct previewResult_s
+{
+  enum class kind_e
+  {
+    Missing,
+    TextFile,
+    OtherFile,
+    // Compressed file or archive, previewed by its decompressed head or its members
+    Archive,
+    Folder
+  };
+
+  // Request generation the result belongs to
+  quint64 generation = 0;
+  // Absolute path to the file system entry
+  QString path;
+  // Kind of the file system entry
+  kind_e kind = kind_e::Missing;
+  // MIME type name, files only
+  QString mimeName;
+  // Size in bytes, files only
+  qint64 size = 0;
+  // Text to be displayed in the preview pane
+  QString content;
+  // Attributes name, type and size to be displayed above the preview, other files and archives only
+  QString summary;
+  // False for an intermediate result delivered while the preview is still in progress
+  bool complete = true;
+};
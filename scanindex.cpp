@@ -0,0 +1,377 @@
+#include "scanindex.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+
+namespace
+{
+  constexpr char indexMagic[ 8 ] = { 'F', 'I', 'S', 'C', 'A', 'N', 'I', 'X' };
+  constexpr quint32 indexVersion = 1;
+  // Number of entries written at once
+  constexpr size_t writeChunkEntries = 16 * 1024;
+}
+
+/*!
+   Header of an index file
+ */
+struct scanIndex_c::header_s
+{
+  char magic[ 8 ];
+  quint32 version;
+  quint32 entryCount;
+  quint64 namesOffset;
+  quint64 namesSize;
+};
+
+/*!
+   C-tor
+ */
+scanIndex_c::scanIndex_c() :
+  _data{ nullptr },
+  _entries{ nullptr },
+  _names{ nullptr },
+  _entryCount{ 0 },
+  _namesSize{ 0 }
+{
+}
+
+/*!
+   D-tor
+ */
+scanIndex_c::~scanIndex_c()
+{
+  if ( _data != nullptr )
+    _file.unmap( const_cast<uchar *>( _data ) );
+}
+
+/*!
+   Maps an index file given at \a indexFilePath
+   \param indexFilePath path to the index file
+   \return false if the file does not exist or is not a valid index
+ */
+bool scanIndex_c::load( const QString &indexFilePath )
+{
+  _file.setFileName( indexFilePath );
+  if ( !_file.open( QIODevice::ReadOnly ) )
+    return false;
+
+  const qint64 fileSize = _file.size();
+  if ( fileSize < static_cast<qint64>( sizeof( header_s ) ) )
+    return false;
+
+  _data = _file.map( 0, fileSize );
+  if ( _data == nullptr )
+    return false;
+
+  const auto *header = reinterpret_cast<const header_s *>( _data );
+  const quint64 entriesEnd = sizeof( header_s ) + static_cast<quint64>( header->entryCount ) * sizeof( entry_s );
+  if ( std::memcmp( header->magic, indexMagic, sizeof( indexMagic ) ) != 0 || header->version != indexVersion ||
+       header->entryCount == 0 || header->namesOffset < entriesEnd ||
+       header->namesOffset + header->namesSize != static_cast<quint64>( fileSize ) || header->namesSize == 0 ||
+       _data[ fileSize - 1 ] != '\0' ||
+       !isConsistent( reinterpret_cast<const entry_s *>( _data + sizeof( header_s ) ), header->entryCount,
+                      header->namesSize ) )
+  {
+    _file.unmap( const_cast<uchar *>( _data ) );
+    _data = nullptr;
+    return false;
+  }
+
+  _entries = reinterpret_cast<const entry_s *>( _data + sizeof( header_s ) );
+  _names = reinterpret_cast<const char *>( _data + header->namesOffset );
+  _entryCount = header->entryCount;
+  _namesSize = header->namesSize;
+
+  return true;
+}
+
+/*!
+   Checks that entries \a entries of an index file are used in place safely
+   Every name has to start within the names, which end with a NUL, and the children of every folder have to be
+   entries following the folder, so the tree is walked within the entries and without cycles.
+   \param entries the entries
+   \param entryCount number of the entries
+   \param namesSize size of the names in bytes
+   \return false if an entry refers outside of the index
+ */
+bool scanIndex_c::isConsistent( const entry_s *entries, quint32 entryCount, quint64 namesSize )
+{
+  for ( quint32 id = 0; id < entryCount; id++ )
+  {
+    const entry_s &current = entries[ id ];
+    if ( current.nameOffset >= namesSize ||
+         ( id == 0 ? current.parent != invalidId : current.parent >= id ) )
+      return false;
+
+    if ( current.childCount > 0 &&
+         ( current.firstChild <= id ||
+           static_cast<quint64>( current.firstChild ) + current.childCount > entryCount ) )
+      return false;
+  }
+
+  return true;
+}
+
+/*!
+   \return number of the indexed entries
+ */
+quint32 scanIndex_c::count() const
+{
+  return _entryCount;
+}
+
+/*!
+   \param id id of the entry
+   \return the entry
+ */
+const scanIndex_c::entry_s &scanIndex_c::entry( quint32 id ) const
+{
+  return _entries[ id ];
+}
+
+/*!
+   \param id id of the entry
+   \return NUL terminated name of the entry
+ */
+const char *scanIndex_c::name( quint32 id ) const
+{
+  return _names + _entries[ id ].nameOffset;
+}
+
+/*!
+   \return absolute path to the indexed folder
+ */
+QString scanIndex_c::rootPath() const
+{
+  return ( _entryCount > 0 ) ? QFile::decodeName( name( 0 ) ) : QString();
+}
+
+/*!
+   Finds an entry given at an absolute path \a path
+   \param path absolute path to the entry
+   \return id of the entry, \em invalidId if not indexed
+ */
+quint32 scanIndex_c::find( const QString &path ) const
+{
+  if ( _entryCount == 0 )
+    return invalidId;
+
+  const QString root = rootPath();
+  if ( path == root )
+    return 0;
+
+  const QString rootPrefix = root.endsWith( '/' ) ? root : root + '/';
+  if ( !path.startsWith( rootPrefix ) )
+    return invalidId;
+
+  quint32 id = 0;
+  const auto components = path.midRef( rootPrefix.size() ).split( '/', Qt::SkipEmptyParts );
+  for ( const auto &component : components )
+  {
+    id = findChild( id, QFile::encodeName( component.toString() ).constData() );
+    if ( id == invalidId )
+      break;
+  }
+
+  return id;
+}
+
+/*!
+   Finds a child named \a childName of a folder entry \a id
+   \param id id of the folder entry
+   \param childName name of the child
+   \return id of the child, \em invalidId if not indexed
+ */
+quint32 scanIndex_c::findChild( quint32 id, const char *childName ) const
+{
+  if ( id >= _entryCount )
+    return invalidId;
+
+  const entry_s &parent = _entries[ id ];
+  quint32 low = parent.firstChild;
+  quint32 high = parent.firstChild + parent.childCount;
+  while ( low < high )
+  {
+    const quint32 middle = low + ( high - low ) / 2;
+    const int comparison = std::strcmp( name( middle ), childName );
+    if ( comparison == 0 )
+      return middle;
+    if ( comparison < 0 )
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  return invalidId;
+}
+
+/*!
+   Provides path to the index file of a folder given at \a rootPath
+   \param rootPath absolute path to the indexed folder
+   \return path to the index file in the cache location of the application
+ */
+QString scanIndex_c::indexFilePath( const QString &rootPath )
+{
+  const QString indexDir = QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) + "/scanindex";
+  const QByteArray rootHash = QCryptographicHash::hash( rootPath.toUtf8(), QCryptographicHash::Sha1 ).toHex();
+  return indexDir + '/' + QString::fromLatin1( rootHash ) + ".idx";
+}
+
+/*!
+   Writes records \a buffers collected by a scan to an index file given at \a indexFilePath
+   The record with id 0 is the scanned folder, every other record has a parent with a lower id.
+   \param indexFilePath path to the index file
+   \param buffers the collected records
+   \param entryCount number of the record ids allocated by the scan
+   \return false on a write error
+ */
+bool scanIndex_c::write( const QString &indexFilePath, const std::vector<recordBuffer_s> &buffers, quint32 entryCount )
+{
+  if ( entryCount == 0 )
+    return false;
+
+  // locate records by id
+  std::vector<const record_s *> records( entryCount, nullptr );
+  std::vector<const nameArena_c *> recordNames( entryCount, nullptr );
+  for ( const auto &buffer : buffers )
+  {
+    for ( const auto &record : buffer.records )
+    {
+      if ( record.id < entryCount )
+      {
+        records[ record.id ] = &record;
+        recordNames[ record.id ] = &buffer.names;
+      }
+    }
+  }
+
+  if ( records[ 0 ] == nullptr )
+    return false;
+
+  const auto recordName = [&records, &recordNames]( quint32 id )
+  {
+    return recordNames[ id ]->name( records[ id ]->nameIndex );
+  };
+
+  // recursive sizes, children have higher ids than their parents
+  std::vector<qint64> sizes( entryCount, 0 );
+  std::vector<quint32> childCounts( entryCount, 0 );
+  for ( quint32 id = entryCount - 1; id > 0; id-- )
+  {
+    const record_s *record = records[ id ];
+    if ( record == nullptr || record->parent >= id || records[ record->parent ] == nullptr )
+      continue;
+
+    if ( !( record->flags & DuplicateLink ) )
+      sizes[ id ] += record->size;
+    sizes[ record->parent ] += sizes[ id ];
+    childCounts[ record->parent ]++;
+  }
+
+  // children grouped by parent and sorted by name
+  std::vector<quint32> childOffsets( static_cast<size_t>( entryCount ) + 1, 0 );
+  for ( quint32 id = 0; id < entryCount; id++ )
+    childOffsets[ id + 1 ] = childOffsets[ id ] + childCounts[ id ];
+
+  std::vector<quint32> children( childOffsets[ entryCount ] );
+  std::vector<quint32> childFill( childOffsets.begin(), childOffsets.end() - 1 );
+  for ( quint32 id = 1; id < entryCount; id++ )
+  {
+    const record_s *record = records[ id ];
+    if ( record != nullptr && record->parent < id && records[ record->parent ] != nullptr )
+      children[ childFill[ record->parent ]++ ] = id;
+  }
+
+  for ( quint32 id = 0; id < entryCount; id++ )
+  {
+    std::sort( children.begin() + childOffsets[ id ], children.begin() + childOffsets[ id + 1 ],
+               [&recordName]( quint32 left, quint32 right )
+    {
+      return std::strcmp( recordName( left ), recordName( right ) ) < 0;
+    } );
+  }
+
+  // breadth-first order, interned names
+  std::vector<quint32> order;
+  order.reserve( entryCount );
+  order.push_back( 0 );
+
+  std::vector<entry_s> entries;
+  entries.reserve( entryCount );
+
+  std::vector<char> names;
+  std::unordered_map<std::string_view, quint32> nameOffsets;
+
+  std::vector<quint32> newIds( entryCount, invalidId );
+  newIds[ 0 ] = 0;
+
+  for ( size_t position = 0; position < order.size(); position++ )
+  {
+    const quint32 id = order[ position ];
+    const record_s &record = *records[ id ];
+
+    entry_s entry;
+    std::memset( &entry, 0, sizeof( entry ) );
+    entry.parent = ( id == 0 ) ? invalidId : newIds[ record.parent ];
+    entry.firstChild = static_cast<quint32>( order.size() );
+    entry.childCount = childCounts[ id ];
+    entry.size = sizes[ id ];
+    entry.modified = record.modified;
+    entry.inode = record.inode;
+    entry.flags = record.flags;
+
+    const std::string_view entryName( recordName( id ) );
+    const auto nameIt = nameOffsets.find( entryName );
+    if ( nameIt != nameOffsets.end() )
+    {
+      entry.nameOffset = nameIt->second;
+    }
+    else
+    {
+      entry.nameOffset = static_cast<quint32>( names.size() );
+      names.insert( names.end(), entryName.begin(), entryName.end() );
+      names.push_back( '\0' );
+      nameOffsets.emplace( entryName, entry.nameOffset );
+    }
+
+    entries.push_back( entry );
+
+    for ( quint32 childPosition = childOffsets[ id ]; childPosition < childOffsets[ id + 1 ]; childPosition++ )
+    {
+      newIds[ children[ childPosition ] ] = static_cast<quint32>( order.size() );
+      order.push_back( children[ childPosition ] );
+    }
+  }
+
+  header_s header;
+  std::memset( &header, 0, sizeof( header ) );
+  std::memcpy( header.magic, indexMagic, sizeof( indexMagic ) );
+  header.version = indexVersion;
+  header.entryCount = static_cast<quint32>( entries.size() );
+  header.namesOffset = sizeof( header_s ) + entries.size() * sizeof( entry_s );
+  header.namesSize = names.size();
+
+  QDir().mkpath( QFileInfo( indexFilePath ).absolutePath() );
+
+  QSaveFile indexFile( indexFilePath );
+  if ( !indexFile.open( QIODevice::WriteOnly ) )
+    return false;
+
+  indexFile.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+  for ( size_t first = 0; first < entries.size(); first += writeChunkEntries )
+  {
+    const size_t chunkSize = std::min( writeChunkEntries, entries.size() - first );
+    indexFile.write( reinterpret_cast<const char *>( entries.data() + first ),
+                     static_cast<qint64>( chunkSize * sizeof( entry_s ) ) );
+  }
+  indexFile.write( names.data(), static_cast<qint64>( names.size() ) );
+
+  return indexFile.commit();
+}
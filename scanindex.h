@@ -0,0 +1,110 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+
+#include <vector>
+
+#include "namearena.h"
+
+/*!
+   Persistent index of a scanned folder tree
+   The index is a single binary file, memory-mapped on load and used in place. Entries are stored in breadth-first
+   order, so children of every folder are contiguous and sorted by name, which makes a path lookup a binary search
+   per path component. Names are interned, folder sizes are recursive.
+
+   Layout: header_s, entry_s[ entryCount ], NUL terminated names. The entry 0 is the indexed folder itself,
+   named with its absolute path.
+ */
+class scanIndex_c
+{
+  public:
+    enum entryFlag_e : quint8
+    {
+      Directory = 0x01,
+      // The file has more than one hard link
+      HardLinked = 0x02,
+      // The file is a hard link counted at another entry already
+      DuplicateLink = 0x04
+    };
+
+    // Id of a non-existing entry
+    static constexpr quint32 invalidId = 0xFFFFFFFF;
+
+    /*!
+       Stored entry
+     */
+    struct entry_s
+    {
+      quint32 parent;
+      quint32 firstChild;
+      quint32 childCount;
+      // Offset of the name within the names
+      quint32 nameOffset;
+      // Size in bytes, recursive for folders
+      qint64 size;
+      // Modification time in ns since epoch
+      qint64 modified;
+      quint64 inode;
+      quint8 flags;
+      quint8 reserved[ 7 ];
+    };
+
+    /*!
+       Entry collected by a scan, input for writing an index
+     */
+    struct record_s
+    {
+      quint32 id;
+      quint32 parent;
+      // Index of the name within the arena of the record buffer
+      int nameIndex;
+      quint8 flags;
+      // Size in bytes, 0 for folders
+      qint64 size;
+      qint64 modified;
+      quint64 inode;
+    };
+
+    /*!
+       Records collected by a single thread of a scan
+     */
+    struct recordBuffer_s
+    {
+      std::vector<record_s> records;
+      nameArena_c names;
+    };
+
+  private:
+    struct header_s;
+
+    QFile _file;
+    const uchar *_data;
+    const entry_s *_entries;
+    const char *_names;
+    quint32 _entryCount;
+    quint64 _namesSize;
+
+  public:
+    scanIndex_c();
+    ~scanIndex_c();
+
+    scanIndex_c( const scanIndex_c & ) = delete;
+    scanIndex_c &operator=( const scanIndex_c & ) = delete;
+
+    bool load( const QString & );
+
+    quint32 count() const;
+    const entry_s &entry( quint32 ) const;
+    const char *name( quint32 ) const;
+    QString rootPath() const;
+
+    quint32 find( const QString & ) const;
+    quint32 findChild( quint32, const char * ) const;
+
+    static QString indexFilePath( const QString & );
+    static bool write( const QString &, const std::vector<recordBuffer_s> &, quint32 );
+
+  private:
+    static bool isConsistent( const entry_s *, quint32, quint64 );
+};
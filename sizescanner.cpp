@@ -0,0 +1,668 @@
+#include "sizescanner.h"
+
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QTimer>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#if defined( Q_OS_UNIX )
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "batchio.h"
+#include "dirlister.h"
+#include "namearena.h"
+#include "scanindex.h"
+#include "workstealingpool.h"
+
+namespace
+{
+  // Interval between two intermediate results, in ms
+  constexpr int progressInterval = 200;
+  // Number of shards of the hard link set, reduces contention of the workers
+  constexpr size_t inodeShardCount = 64;
+
+  struct openDirectory_s;
+  using openDirectory_t = std::shared_ptr<const openDirectory_s>;
+
+#if defined( Q_OS_UNIX )
+  /*!
+     Open folder, closed once the last of its sub-folders is opened
+   */
+  struct openDirectory_s
+  {
+    int fd;
+
+    explicit openDirectory_s( int dirFd ) : fd{ dirFd } {}
+    ~openDirectory_s() { close( fd ); }
+
+    openDirectory_s( const openDirectory_s & ) = delete;
+    openDirectory_s &operator=( const openDirectory_s & ) = delete;
+  };
+#endif
+
+  /*!
+     Set of inodes of the hard-linked files seen so far, thread-safe
+   */
+  class inodeSet_c
+  {
+    private:
+      struct shard_s
+      {
+        std::mutex mutex;
+        std::unordered_set<quint64> inodes;
+      };
+
+      shard_s _shards[ inodeShardCount ];
+
+    public:
+      /*!
+         Adds an inode \a inode
+         \param inode the inode
+         \return false if the inode was already present
+       */
+      bool insert( quint64 inode )
+      {
+        shard_s &shard = _shards[ inode % inodeShardCount ];
+        std::lock_guard<std::mutex> locker( shard.mutex );
+        return shard.inodes.insert( inode ).second;
+      }
+  };
+}
+
+/*!
+   Shared state of a single scan
+ */
+struct sizeScanner_c::scanState_s
+{
+  QString path;
+  std::atomic<bool> cancelled{ false };
+  std::atomic<qint64> totalBytes{ 0 };
+  std::atomic<qint64> fileCount{ 0 };
+  std::atomic<qint64> dirCount{ 0 };
+  // Immediate children of the scanned folder, fixed before \em childrenReady is set
+  std::vector<sizeScanChild_s> children;
+  std::unique_ptr<std::atomic<qint64>[]> childBytes;
+  std::atomic<bool> childrenReady{ false };
+  // Device of the scanned folder, the scan stays on it
+  quint64 device = 0;
+  inodeSet_c hardLinks;
+  // Index of a previous scan, folders not modified since are not listed again
+  std::shared_ptr<const scanIndex_c> previous;
+  // Entries are recorded for a new index
+  bool recording = false;
+  // Recorded entries, a buffer per worker and the last one for the scan of the immediate children
+  std::vector<scanIndex_c::recordBuffer_s> records;
+  std::atomic<quint32> nextId{ 0 };
+};
+
+namespace
+{
+  using scanState_t = sizeScanner_c::scanState_s;
+
+#if defined( Q_OS_UNIX )
+  /*!
+     \param entryStat attributes of an entry
+     \return modification time of the entry in ns since epoch
+   */
+  qint64 modificationTime( const struct stat &entryStat )
+  {
+#if defined( Q_OS_DARWIN )
+    return static_cast<qint64>( entryStat.st_mtimespec.tv_sec ) * 1000000000 + entryStat.st_mtimespec.tv_nsec;
+#else
+    return static_cast<qint64>( entryStat.st_mtim.tv_sec ) * 1000000000 + entryStat.st_mtim.tv_nsec;
+#endif
+  }
+
+  /*!
+     Stats entries named \a names of a folder opened as \a dirFd at once, not following symbolic links
+     \param dirFd descriptor of the folder
+     \param names names of the entries
+     \param requests receives a request per name in the order of \a names, with its result
+   */
+  void statNames( int dirFd, const nameArena_c &names, std::vector<batchIo_c::statRequest_s> &requests )
+  {
+    requests.resize( static_cast<size_t>( names.size() ) );
+    for ( int index = 0; index < names.size(); index++ )
+    {
+      batchIo_c::statRequest_s &request = requests[ static_cast<size_t>( index ) ];
+      request.dirFd = dirFd;
+      request.name = names.name( index );
+      request.flags = AT_SYMLINK_NOFOLLOW;
+    }
+    batchIo_c::forThread().stat( requests );
+  }
+
+  /*!
+     Counts a non-folder entry
+     \param state the scan state
+     \param size size of the entry
+     \param inode inode of the entry
+     \param flags index flags of the entry, \em scanIndex_c::DuplicateLink is added for an already counted hard link
+     \return size of the entry, 0 for an already counted hard link
+   */
+  qint64 countFile( scanState_t &state, qint64 size, quint64 inode, quint8 &flags )
+  {
+    if ( ( flags & scanIndex_c::HardLinked ) && !state.hardLinks.insert( inode ) )
+    {
+      flags |= scanIndex_c::DuplicateLink;
+      return 0;
+    }
+
+    state.fileCount++;
+    return size;
+  }
+
+  /*!
+     Records an entry for a new index, if the scan records
+     \param state the scan state
+     \param buffer index of the record buffer of the calling thread
+     \param parent id of the parent folder entry
+     \param name name of the entry
+     \param flags index flags of the entry
+     \param size size of the entry, 0 for a folder
+     \param modified modification time of the entry
+     \param inode inode of the entry
+     \return id of the entry, \em scanIndex_c::invalidId if the scan does not record
+   */
+  quint32 addRecord( scanState_t &state, int buffer, quint32 parent, const char *name, quint8 flags, qint64 size,
+                     qint64 modified, quint64 inode )
+  {
+    if ( !state.recording )
+      return scanIndex_c::invalidId;
+
+    scanIndex_c::recordBuffer_s &recordBuffer = state.records[ static_cast<size_t>( buffer ) ];
+    const quint32 id = state.nextId++;
+    const int nameIndex = recordBuffer.names.append( name, static_cast<int>( std::strlen( name ) ) );
+    recordBuffer.records.push_back( { id, parent, nameIndex, flags, size, modified, inode } );
+    return id;
+  }
+#endif
+
+  /*!
+     Scans a folder given at \a path, submitting a task for every sub-folder
+     A folder not modified since the previous scan is not listed, its files are taken from the previous index and
+     only its sub-folders are stat'ed.
+     \param state the scan state
+     \param pool the pool running the scan
+     \param worker index of the worker running the scan
+     \param parent the open parent folder, the folder is opened relative to it
+     \param path path to the folder, opened directly where it cannot be opened relative to \a parent
+     \param childIndex index of the immediate child of the scanned folder the folder belongs to
+     \param id id of the folder entry in the new index
+     \param previousId id of the folder entry in the previous index
+     \param modified modification time of the folder
+   */
+  void scanDirectory( const std::shared_ptr<scanState_t> &state, workStealingPool_c &pool, int worker,
+                      const openDirectory_t &parent, const std::string &path, int childIndex, quint32 id,
+                      quint32 previousId, qint64 modified )
+  {
+    if ( state->cancelled )
+      return;
+
+    qint64 bytes = 0;
+
+#if defined( Q_OS_UNIX )
+    // relative to the parent, the kernel does not resolve the whole path again
+    const int openFlags = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+    int dirFd = openat( parent->fd, path.c_str() + path.rfind( '/' ) + 1, openFlags );
+    if ( dirFd < 0 && errno == EMFILE )
+      dirFd = open( path.c_str(), openFlags );
+    if ( dirFd < 0 )
+      return;
+
+    const openDirectory_t directory = std::make_shared<const openDirectory_s>( dirFd );
+
+    const auto queueDirectory = [&]( const char *name, const struct stat &entryStat, quint32 previousChildId )
+    {
+      if ( static_cast<quint64>( entryStat.st_dev ) != state->device )
+        return;
+
+      state->dirCount++;
+      const qint64 childModified = modificationTime( entryStat );
+      const quint32 childId = addRecord( *state, worker, id, name, scanIndex_c::Directory, 0, childModified,
+                                         static_cast<quint64>( entryStat.st_ino ) );
+      std::string childPath = path + '/' + name;
+      pool.submit( [state, &pool, directory, childPath, childIndex, childId, previousChildId,
+                    childModified]( int childWorker )
+      {
+        scanDirectory( state, pool, childWorker, directory, childPath, childIndex, childId, previousChildId,
+                       childModified );
+      } );
+    };
+
+    const scanIndex_c *previous = state->previous.get();
+    if ( previous != nullptr && previousId < previous->count() && previous->entry( previousId ).modified == modified )
+    {
+      const scanIndex_c::entry_s &previousEntry = previous->entry( previousId );
+      const quint32 previousEnd = previousEntry.firstChild + previousEntry.childCount;
+
+      // the sub-folders are stat'ed at once, then taken in the order of the previous index
+      std::vector<batchIo_c::statRequest_s> requests;
+      for ( quint32 previousChildId = previousEntry.firstChild; previousChildId < previousEnd; previousChildId++ )
+      {
+        if ( previous->entry( previousChildId ).flags & scanIndex_c::Directory )
+        {
+          requests.emplace_back();
+          requests.back().dirFd = dirFd;
+          requests.back().name = previous->name( previousChildId );
+          requests.back().flags = AT_SYMLINK_NOFOLLOW;
+        }
+      }
+      batchIo_c::forThread().stat( requests );
+
+      size_t requestIndex = 0;
+      for ( quint32 previousChildId = previousEntry.firstChild; previousChildId < previousEnd && !state->cancelled;
+            previousChildId++ )
+      {
+        const scanIndex_c::entry_s &previousChild = previous->entry( previousChildId );
+        const char *name = previous->name( previousChildId );
+        if ( previousChild.flags & scanIndex_c::Directory )
+        {
+          const batchIo_c::statRequest_s &request = requests[ requestIndex++ ];
+          if ( request.error == 0 && S_ISDIR( request.status.st_mode ) )
+            queueDirectory( name, request.status, previousChildId );
+        }
+        else
+        {
+          quint8 flags = previousChild.flags & scanIndex_c::HardLinked;
+          bytes += countFile( *state, previousChild.size, previousChild.inode, flags );
+          addRecord( *state, worker, id, name, flags, previousChild.size, previousChild.modified, previousChild.inode );
+        }
+      }
+    }
+    else
+    {
+      // the entries of a listed batch are stat'ed at once
+      nameArena_c names;
+      std::vector<batchIo_c::statRequest_s> requests;
+      const auto statBatch = [&]()
+      {
+        statNames( dirFd, names, requests );
+        for ( const batchIo_c::statRequest_s &request : requests )
+        {
+          if ( request.error != 0 )
+            continue;
+
+          const char *name = request.name;
+          const struct stat &entryStat = request.status;
+          if ( S_ISDIR( entryStat.st_mode ) )
+          {
+            queueDirectory( name, entryStat, ( previous != nullptr ) ? previous->findChild( previousId, name )
+                                                                     : scanIndex_c::invalidId );
+          }
+          else
+          {
+            const qint64 size = static_cast<qint64>( entryStat.st_size );
+            const quint64 inode = static_cast<quint64>( entryStat.st_ino );
+            quint8 flags = ( entryStat.st_nlink > 1 ) ? scanIndex_c::HardLinked : 0;
+            bytes += countFile( *state, size, inode, flags );
+            addRecord( *state, worker, id, name, flags, size, modificationTime( entryStat ), inode );
+          }
+        }
+        names.clear();
+        return !state->cancelled;
+      };
+
+      dirLister_c::readEntries( dirFd, [&names]( const char *name, unsigned char )
+      {
+        names.append( name, static_cast<int>( std::strlen( name ) ) );
+        return true;
+      }, statBatch );
+      // the last batch is not reported where the listing is not batched by the file system
+      if ( names.size() > 0 )
+        statBatch();
+    }
+#else
+    Q_UNUSED( worker )
+    Q_UNUSED( parent )
+    Q_UNUSED( id )
+    Q_UNUSED( previousId )
+    Q_UNUSED( modified )
+
+    QDirIterator dirIt( QFile::decodeName( path.c_str() ), QDir::AllEntries | QDir::Hidden | QDir::System |
+                        QDir::NoDotAndDotDot | QDir::NoSymLinks );
+    while ( dirIt.hasNext() && !state->cancelled )
+    {
+      dirIt.next();
+      const QFileInfo entryInfo = dirIt.fileInfo();
+      if ( entryInfo.isDir() )
+      {
+        state->dirCount++;
+        std::string childPath = QFile::encodeName( entryInfo.absoluteFilePath() ).toStdString();
+        pool.submit( [state, &pool, childPath, childIndex]( int childWorker )
+        {
+          scanDirectory( state, pool, childWorker, nullptr, childPath, childIndex, scanIndex_c::invalidId,
+                         scanIndex_c::invalidId, 0 );
+        } );
+      }
+      else
+      {
+        state->fileCount++;
+        bytes += entryInfo.size();
+      }
+    }
+#endif
+
+    state->totalBytes += bytes;
+    if ( childIndex >= 0 )
+      state->childBytes[ static_cast<size_t>( childIndex ) ] += bytes;
+  }
+
+  /*!
+     Lists immediate children of the scanned folder, counting files and queueing the sub-folders
+     \param state the scan state
+     \param pool the pool running the scan
+   */
+  void scanRoot( const std::shared_ptr<scanState_t> &state, workStealingPool_c &pool )
+  {
+    /*!
+       Immediate child of the scanned folder
+     */
+    struct rootChild_s
+    {
+      qint64 fileBytes;
+      quint32 id;
+      quint32 previousId;
+      qint64 modified;
+    };
+
+    const std::string rootPath = QFile::encodeName( state->path ).toStdString();
+    std::vector<rootChild_s> rootChildren;
+
+#if defined( Q_OS_UNIX )
+    struct stat rootStat;
+    const int dirFd = open( rootPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+    if ( dirFd < 0 || fstat( dirFd, &rootStat ) != 0 )
+    {
+      if ( dirFd >= 0 )
+        close( dirFd );
+      state->childBytes.reset( new std::atomic<qint64>[ 0 ] );
+      state->childrenReady = true;
+      return;
+    }
+    const openDirectory_t rootDirectory = std::make_shared<const openDirectory_s>( dirFd );
+    state->device = static_cast<quint64>( rootStat.st_dev );
+
+    // the scanned folder is the entry 0 of a new index, named with its absolute path
+    const int rootBuffer = pool.threadCount();
+    const quint32 rootId = addRecord( *state, rootBuffer, scanIndex_c::invalidId, rootPath.c_str(),
+                                      scanIndex_c::Directory, 0, modificationTime( rootStat ),
+                                      static_cast<quint64>( rootStat.st_ino ) );
+
+    const scanIndex_c *previous = state->previous.get();
+    const quint32 previousRootId = ( previous != nullptr ) ? previous->find( state->path ) : scanIndex_c::invalidId;
+
+    nameArena_c names;
+    std::vector<batchIo_c::statRequest_s> requests;
+    const auto statBatch = [&]()
+    {
+      statNames( dirFd, names, requests );
+      for ( const batchIo_c::statRequest_s &request : requests )
+      {
+        if ( request.error != 0 )
+          continue;
+
+        const char *name = request.name;
+        const struct stat &entryStat = request.status;
+        const bool isDir = S_ISDIR( entryStat.st_mode );
+        if ( isDir && static_cast<quint64>( entryStat.st_dev ) != state->device )
+          continue;
+
+        const qint64 size = isDir ? 0 : static_cast<qint64>( entryStat.st_size );
+        const quint64 inode = static_cast<quint64>( entryStat.st_ino );
+        const qint64 modified = modificationTime( entryStat );
+        quint8 flags = isDir ? scanIndex_c::Directory : ( ( entryStat.st_nlink > 1 ) ? scanIndex_c::HardLinked : 0 );
+        const qint64 fileBytes = isDir ? 0 : countFile( *state, size, inode, flags );
+        const quint32 id = addRecord( *state, rootBuffer, rootId, name, flags, size, modified, inode );
+        const quint32 previousId = ( isDir && previous != nullptr ) ? previous->findChild( previousRootId, name )
+                                                                    : scanIndex_c::invalidId;
+
+        state->children.push_back( { QFile::decodeName( name ), 0, isDir } );
+        rootChildren.push_back( { fileBytes, id, previousId, modified } );
+      }
+      names.clear();
+      return !state->cancelled;
+    };
+
+    dirLister_c::readEntries( dirFd, [&names]( const char *name, unsigned char )
+    {
+      names.append( name, static_cast<int>( std::strlen( name ) ) );
+      return true;
+    }, statBatch );
+    if ( names.size() > 0 )
+      statBatch();
+#else
+    const openDirectory_t rootDirectory;
+
+    QDirIterator dirIt( state->path, QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot |
+                        QDir::NoSymLinks );
+    while ( dirIt.hasNext() && !state->cancelled )
+    {
+      dirIt.next();
+      const QFileInfo entryInfo = dirIt.fileInfo();
+      state->children.push_back( { entryInfo.fileName(), 0, entryInfo.isDir() } );
+      if ( !entryInfo.isDir() )
+        state->fileCount++;
+      rootChildren.push_back( { entryInfo.isDir() ? 0 : entryInfo.size(), scanIndex_c::invalidId,
+                                scanIndex_c::invalidId, 0 } );
+    }
+#endif
+
+    const size_t childCount = state->children.size();
+    state->childBytes.reset( new std::atomic<qint64>[ childCount ] );
+
+    qint64 totalRootFileBytes = 0;
+    for ( size_t index = 0; index < childCount; index++ )
+    {
+      state->childBytes[ index ] = rootChildren[ index ].fileBytes;
+      totalRootFileBytes += rootChildren[ index ].fileBytes;
+    }
+    state->totalBytes += totalRootFileBytes;
+    state->childrenReady = true;
+
+    const std::string prefix = ( !rootPath.empty() && rootPath.back() == '/' ) ? rootPath : rootPath + '/';
+    for ( size_t index = 0; index < childCount; index++ )
+    {
+      if ( !state->children[ index ].isDir )
+        continue;
+
+      state->dirCount++;
+      std::string childPath = prefix + QFile::encodeName( state->children[ index ].name ).toStdString();
+      const int childIndex = static_cast<int>( index );
+      const rootChild_s child = rootChildren[ index ];
+      pool.submit( [state, &pool, rootDirectory, childPath, childIndex, child]( int worker )
+      {
+        scanDirectory( state, pool, worker, rootDirectory, childPath, childIndex, child.id, child.previousId,
+                       child.modified );
+      } );
+    }
+  }
+
+  /*!
+     Takes a snapshot of the scan totals
+     \param state the scan state
+     \param complete true if the scan is finished
+     \return the totals
+   */
+  sizeScanResult_s snapshot( const scanState_t &state, bool complete )
+  {
+    sizeScanResult_s result;
+    result.path = state.path;
+    result.totalBytes = state.totalBytes;
+    result.fileCount = state.fileCount;
+    result.dirCount = state.dirCount;
+    result.complete = complete;
+
+    if ( !state.childrenReady )
+      return result;
+
+    result.children.reserve( static_cast<int>( state.children.size() ) );
+    for ( size_t index = 0; index < state.children.size(); index++ )
+    {
+      sizeScanChild_s child = state.children[ index ];
+      child.bytes = state.childBytes[ index ];
+      result.children.append( child );
+    }
+
+    const auto isLarger = []( const sizeScanChild_s &left, const sizeScanChild_s &right )
+    {
+      return left.bytes > right.bytes;
+    };
+
+    if ( complete || result.children.size() <= sizeScanner_c::largestChildrenCount )
+    {
+      std::sort( result.children.begin(), result.children.end(), isLarger );
+    }
+    else
+    {
+      std::partial_sort( result.children.begin(), result.children.begin() + sizeScanner_c::largestChildrenCount,
+                         result.children.end(), isLarger );
+      result.children.resize( sizeScanner_c::largestChildrenCount );
+    }
+
+    return result;
+  }
+}
+
+/*!
+   C-tor
+   \param parent parent object
+ */
+sizeScanner_c::sizeScanner_c( QObject *parent ) :
+  QObject( parent ),
+  _progressTimer{ nullptr }
+{
+  // the scan is bound by the file system latency rather than by the processors
+  _workerPool = std::make_unique<workStealingPool_c>( qMax( 4, QThread::idealThreadCount() * 2 ) );
+  _scanPool.setMaxThreadCount( 1 );
+
+  _progressTimer = new QTimer( this );
+  _progressTimer->setInterval( progressInterval );
+  connect( _progressTimer, &QTimer::timeout, this, &sizeScanner_c::reportProgress );
+}
+
+/*!
+   D-tor
+   Cancels the current scan and waits for all the scans to wind down.
+ */
+sizeScanner_c::~sizeScanner_c()
+{
+  cancel();
+  _scanPool.waitForDone();
+}
+
+/*!
+   Starts a scan of a folder given at \a path, abandoning the current scan
+   \param path absolute path to the folder
+   \param previous index of a previous scan containing the folder, if any
+   \param writeIndex true to write an index of the folder once the scan is complete
+ */
+void sizeScanner_c::scan( const QString &path, const std::shared_ptr<const scanIndex_c> &previous, bool writeIndex )
+{
+  cancel();
+
+  workStealingPool_c *pool = _workerPool.get();
+
+  auto state = std::make_shared<scanState_s>();
+  state->path = path;
+  state->previous = previous;
+  _scannedPath = path;
+#if defined( Q_OS_UNIX )
+  state->recording = writeIndex;
+  if ( writeIndex )
+    state->records.resize( static_cast<size_t>( pool->threadCount() ) + 1 );
+#else
+  Q_UNUSED( writeIndex )
+#endif
+  _state = state;
+
+  QtConcurrent::run( &_scanPool, [this, state, pool]()
+  {
+    // a scan abandoned before it started is not started at all
+    if ( state->cancelled )
+      return;
+
+    scanRoot( state, *pool );
+    pool->wait();
+
+    if ( state->cancelled )
+      return;
+
+    bool indexWritten = false;
+    if ( state->recording )
+    {
+      indexWritten = scanIndex_c::write( scanIndex_c::indexFilePath( state->path ), state->records, state->nextId );
+      state->records.clear();
+      state->records.shrink_to_fit();
+    }
+
+    const sizeScanResult_s result = snapshot( *state, true );
+    QMetaObject::invokeMethod( this, [this, state, result, indexWritten]()
+    {
+      if ( state != _state )
+        return;
+
+      _progressTimer->stop();
+      _state.reset();
+      if ( indexWritten )
+        emit indexUpdated( result.path );
+      emit scanUpdated( result );
+    }, Qt::QueuedConnection );
+  } );
+
+  _progressTimer->start();
+}
+
+/*!
+   Abandons the current scan
+ */
+void sizeScanner_c::cancel()
+{
+  _progressTimer->stop();
+  _scannedPath.clear();
+
+  if ( _state )
+  {
+    _state->cancelled = true;
+    _state.reset();
+  }
+}
+
+/*!
+   \return true if a scan is in progress
+ */
+bool sizeScanner_c::isScanning() const
+{
+  return _state != nullptr;
+}
+
+/*!
+   \return absolute path to the folder of the current or the last completed scan, empty if cancelled
+ */
+QString sizeScanner_c::scannedPath() const
+{
+  return _scannedPath;
+}
+
+/*!
+   Slot to report intermediate totals of the current scan
+ */
+void sizeScanner_c::reportProgress()
+{
+  if ( _state )
+    emit scanUpdated( snapshot( *_state, false ) );
+}
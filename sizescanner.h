@@ -0,0 +1,90 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+
+#include <memory>
+
+class QTimer;
+class scanIndex_c;
+class workStealingPool_c;
+
+/*!
+   Immediate child of a scanned folder
+ */
+struct sizeScanChild_s
+{
+  QString name;
+  // Recursive size in bytes
+  qint64 bytes = 0;
+  bool isDir = false;
+};
+
+/*!
+   Totals of a recursive folder size scan
+ */
+struct sizeScanResult_s
+{
+  // Absolute path to the scanned folder
+  QString path;
+  // Total size of the files in bytes, hard links counted once
+  qint64 totalBytes = 0;
+  qint64 fileCount = 0;
+  qint64 dirCount = 0;
+  // Immediate children, largest first. Intermediate results carry the largest ones only
+  QVector<sizeScanChild_s> children;
+  // False for an intermediate result delivered while the scan is still in progress
+  bool complete = false;
+};
+
+/*!
+   Computes recursive size, file and folder counts of a folder in the background
+   Every sub-folder is a task of a \em workStealingPool_c spread over more threads than cores, as the scan is
+   bound by the file system latency; the pool lives as long as the scanner and serves all its scans. Folders are
+   opened and entries are stat'ed relative to the descriptor of their parent folder, hard links are counted once
+   and the scan does not cross file system boundaries. Intermediate totals are reported periodically through
+   \em scanUpdated, starting a new scan or cancelling abandons the current one, which winds down before the next
+   one starts.
+   Given an index of a previous scan, folders whose modification time did not change are not listed again; a scan
+   can also write an index of the scanned folder for the next one.
+ */
+class sizeScanner_c : public QObject
+{
+  Q_OBJECT
+
+  public:
+    // Number of the largest children reported by intermediate results
+    static constexpr int largestChildrenCount = 10;
+
+    struct scanState_s;
+
+  private:
+    // State of the current scan
+    std::shared_ptr<scanState_s> _state;
+    // Path to the folder of the current or the last completed scan
+    QString _scannedPath;
+    // Workers of the scans
+    std::unique_ptr<workStealingPool_c> _workerPool;
+    // Runs the scans one after another, waiting for the workers of each
+    QThreadPool _scanPool;
+    // Triggers reporting of intermediate results
+    QTimer *_progressTimer;
+
+  public:
+    sizeScanner_c( QObject * = nullptr );
+    virtual ~sizeScanner_c();
+
+    void scan( const QString &, const std::shared_ptr<const scanIndex_c> & = {}, bool = false );
+    void cancel();
+    bool isScanning() const;
+    QString scannedPath() const;
+
+  private slots:
+    void reportProgress();
+
+  signals:
+    void scanUpdated( const sizeScanResult_s & );
+    void indexUpdated( const QString & );
+};
@@ -0,0 +1,349 @@
+#include "snapshotdialog.h"
+
+#include <QCheckBox>
+#include <QDateTime>
+#include <QDir>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLocale>
+#include <QPushButton>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+namespace
+{
+  // Interval between two progress reports, in ms
+  constexpr int progressInterval = 200;
+  // Number of the changes listed at most, the summary counts all of them
+  constexpr int listedChangeLimit = 100000;
+
+  /*!
+     \param kind kind of a change
+     \return name of the kind
+   */
+  QString changeName( snapshotChange_s::kind_e kind )
+  {
+    switch ( kind )
+    {
+      case snapshotChange_s::kind_e::Added:
+        return snapshotDialog_c::tr( "Added" );
+      case snapshotChange_s::kind_e::Removed:
+        return snapshotDialog_c::tr( "Removed" );
+      case snapshotChange_s::kind_e::Modified:
+        return snapshotDialog_c::tr( "Modified" );
+      case snapshotChange_s::kind_e::Moved:
+        return snapshotDialog_c::tr( "Moved" );
+    }
+    return QString();
+  }
+}
+
+/*!
+   C-tor
+   \param folderPath absolute path to the folder
+   \param parent parent widget
+ */
+snapshotDialog_c::snapshotDialog_c( const QString &folderPath, QWidget *parent ) :
+  QDialog( parent ),
+  _folderPath{ folderPath },
+  _captureButton{ nullptr },
+  _compareButton{ nullptr },
+  _stopButton{ nullptr },
+  _hashBox{ nullptr },
+  _changeTree{ nullptr },
+  _statusLabel{ nullptr },
+  _progressTimer{ nullptr }
+{
+  setAttribute( Qt::WA_DeleteOnClose );
+  setWindowTitle( tr( "Snapshots of %1" ).arg( QDir::toNativeSeparators( folderPath ) ) );
+  _workerPool.setMaxThreadCount( 1 );
+
+  _changeTree = new QTreeWidget( this );
+  _changeTree->setColumnCount( 3 );
+  _changeTree->setHeaderLabels( { tr( "Change" ), tr( "Path" ), tr( "Size" ) } );
+  _changeTree->setRootIsDecorated( false );
+  _changeTree->setUniformRowHeights( true );
+  _changeTree->header()->setSectionResizeMode( 1, QHeaderView::Stretch );
+  _changeTree->header()->setStretchLastSection( false );
+
+  _statusLabel = new QLabel( tr( "Capture a snapshot, or compare the folder with a captured one" ), this );
+  _hashBox = new QCheckBox( tr( "Hash contents" ), this );
+  _captureButton = new QPushButton( tr( "Capture..." ), this );
+  _compareButton = new QPushButton( tr( "Compare..." ), this );
+  _stopButton = new QPushButton( tr( "Stop" ), this );
+  _stopButton->setEnabled( false );
+
+  QHBoxLayout *buttonLayout = new QHBoxLayout;
+  buttonLayout->addWidget( _hashBox );
+  buttonLayout->addStretch( 1 );
+  buttonLayout->addWidget( _captureButton );
+  buttonLayout->addWidget( _compareButton );
+  buttonLayout->addWidget( _stopButton );
+
+  QVBoxLayout *mainLayout = new QVBoxLayout;
+  mainLayout->addWidget( _changeTree );
+  mainLayout->addWidget( _statusLabel );
+  mainLayout->addLayout( buttonLayout );
+  setLayout( mainLayout );
+  resize( 760, 480 );
+
+  _progressTimer = new QTimer( this );
+  _progressTimer->setInterval( progressInterval );
+
+  connect( _captureButton, &QPushButton::clicked, this, &snapshotDialog_c::handleCaptureButton );
+  connect( _compareButton, &QPushButton::clicked, this, &snapshotDialog_c::handleCompareButton );
+  connect( _stopButton, &QPushButton::clicked, this, &snapshotDialog_c::handleStopButton );
+  connect( _progressTimer, &QTimer::timeout, this, &snapshotDialog_c::reportProgress );
+  connect( _changeTree, &QTreeWidget::itemActivated, this, &snapshotDialog_c::handleItemActivated );
+}
+
+/*!
+   D-tor
+   Stops the running work and waits for it to wind down.
+ */
+snapshotDialog_c::~snapshotDialog_c()
+{
+  if ( _cancelled )
+    *_cancelled = true;
+  _workerPool.waitForDone();
+}
+
+/*!
+   Slot to capture a snapshot of the folder to a chosen file
+ */
+void snapshotDialog_c::handleCaptureButton()
+{
+  const QString snapshotDir = QStandardPaths::writableLocation( QStandardPaths::AppDataLocation ) + "/snapshots";
+  QDir().mkpath( snapshotDir );
+  const QString defaultName = QString( "%1-%2.%3" ).arg( QFileInfo( _folderPath ).fileName() ).
+                              arg( QDateTime::currentDateTime().toString( "yyyyMMdd-HHmmss" ) ).
+                              arg( folderSnapshot_c::fileSuffix );
+  const QString snapshotFilePath = QFileDialog::getSaveFileName( this, tr( "Capture Snapshot" ),
+                                                                 snapshotDir + '/' + defaultName,
+                                                                 tr( "Snapshots (*.%1)" ).
+                                                                 arg( folderSnapshot_c::fileSuffix ) );
+  if ( snapshotFilePath.isEmpty() )
+    return;
+
+  startWork();
+  _liveRootPath.clear();
+  _changeTree->clear();
+
+  const auto cancelled = _cancelled;
+  const auto progress = _progress;
+  const QString folderPath = _folderPath;
+  const bool hashContents = _hashBox->isChecked();
+  QtConcurrent::run( &_workerPool, [this, cancelled, progress, folderPath, hashContents, snapshotFilePath]()
+  {
+    folderSnapshot_c snapshot;
+    QString status;
+    if ( !snapshot.capture( folderPath, hashContents, *cancelled, progress.get() ) )
+      status = *cancelled ? tr( "Stopped" ) : tr( "Cannot read %1" ).arg( QDir::toNativeSeparators( folderPath ) );
+    else if ( !snapshot.save( snapshotFilePath ) )
+      status = tr( "Cannot write %1" ).arg( QDir::toNativeSeparators( snapshotFilePath ) );
+    else
+      status = tr( "Captured %1 entries to %2" ).arg( QLocale().toString( snapshot.count() ) ).
+               arg( QDir::toNativeSeparators( snapshotFilePath ) );
+
+    QMetaObject::invokeMethod( this, [this, cancelled, status]()
+    {
+      if ( cancelled == _cancelled )
+        finishWork( status );
+    }, Qt::QueuedConnection );
+  } );
+}
+
+/*!
+   Slot to compare chosen snapshots
+   A single snapshot is compared to the live tree of its folder, two snapshots to each other.
+ */
+void snapshotDialog_c::handleCompareButton()
+{
+  const QString snapshotDir = QStandardPaths::writableLocation( QStandardPaths::AppDataLocation ) + "/snapshots";
+  const QStringList snapshotFilePaths = QFileDialog::getOpenFileNames( this, tr( "Compare Snapshots" ), snapshotDir,
+                                                                       tr( "Snapshots (*.%1)" ).
+                                                                       arg( folderSnapshot_c::fileSuffix ) );
+  if ( snapshotFilePaths.isEmpty() )
+    return;
+  if ( snapshotFilePaths.size() > 2 )
+  {
+    _statusLabel->setText( tr( "Choose one snapshot to compare with the folder, or two to compare with each other" ) );
+    return;
+  }
+
+  startWork();
+  _liveRootPath.clear();
+  _changeTree->clear();
+
+  const auto cancelled = _cancelled;
+  const auto progress = _progress;
+  QtConcurrent::run( &_workerPool, [this, cancelled, progress, snapshotFilePaths]()
+  {
+    QVector<snapshotChange_s> changes;
+    QString liveRootPath;
+    QString status;
+
+    folderSnapshot_c older;
+    folderSnapshot_c newer;
+    if ( !older.load( snapshotFilePaths.first() ) )
+    {
+      status = tr( "Cannot read %1" ).arg( QDir::toNativeSeparators( snapshotFilePaths.first() ) );
+    }
+    else if ( snapshotFilePaths.size() > 1 && !newer.load( snapshotFilePaths.last() ) )
+    {
+      status = tr( "Cannot read %1" ).arg( QDir::toNativeSeparators( snapshotFilePaths.last() ) );
+    }
+    else if ( snapshotFilePaths.size() == 1 &&
+              !newer.capture( older.rootPath(), older.hasHashes(), *cancelled, progress.get() ) )
+    {
+      status = *cancelled ? tr( "Stopped" ) :
+                            tr( "Cannot read %1" ).arg( QDir::toNativeSeparators( older.rootPath() ) );
+    }
+    else
+    {
+      if ( snapshotFilePaths.size() == 1 )
+        liveRootPath = older.rootPath();
+
+      const bool swapped = newer.captured() < older.captured();
+      changes = folderSnapshot_c::diff( swapped ? newer : older, swapped ? older : newer, *cancelled );
+
+      const QLocale locale;
+      const folderSnapshot_c &base = swapped ? newer : older;
+      status = *cancelled ? tr( "Stopped" ) :
+                            tr( "%1 changes since %2" ).arg( locale.toString( changes.size() ) ).
+                            arg( locale.toString( QDateTime::fromMSecsSinceEpoch( base.captured() ),
+                                                  QLocale::ShortFormat ) );
+      if ( changes.size() > listedChangeLimit )
+        status += tr( ", the first %1 listed" ).arg( locale.toString( listedChangeLimit ) );
+    }
+
+    QMetaObject::invokeMethod( this, [this, cancelled, changes, liveRootPath, status]()
+    {
+      if ( cancelled != _cancelled )
+        return;
+
+      _liveRootPath = liveRootPath;
+      showChanges( changes );
+      finishWork( status );
+    }, Qt::QueuedConnection );
+  } );
+}
+
+/*!
+   Slot to stop the running capture or comparison
+ */
+void snapshotDialog_c::handleStopButton()
+{
+  if ( _cancelled )
+    *_cancelled = true;
+  finishWork( tr( "Stopped" ) );
+}
+
+/*!
+   Slot to show progress of the running work
+ */
+void snapshotDialog_c::reportProgress()
+{
+  if ( !_progress )
+    return;
+
+  const qint64 capturedCount = _progress->load();
+  _statusLabel->setText( ( capturedCount > 0 ) ? tr( "Capturing... %1 entries" ).
+                         arg( QLocale().toString( capturedCount ) ) : tr( "Working..." ) );
+}
+
+/*!
+   Slot to report an activated change \a item of the live tree
+   \param item the activated item
+ */
+void snapshotDialog_c::handleItemActivated( QTreeWidgetItem *item )
+{
+  const QString path = item->data( 1, Qt::UserRole ).toString();
+  if ( !_liveRootPath.isEmpty() && !path.isEmpty() )
+    emit fileActivated( QDir( _liveRootPath ).filePath( path ) );
+}
+
+/*!
+   Prepares the state of a new capture or comparison, abandoning the running one
+ */
+void snapshotDialog_c::startWork()
+{
+  if ( _cancelled )
+    *_cancelled = true;
+  _cancelled = std::make_shared<std::atomic<bool>>( false );
+  _progress = std::make_shared<std::atomic<qint64>>( 0 );
+
+  _captureButton->setEnabled( false );
+  _compareButton->setEnabled( false );
+  _stopButton->setEnabled( true );
+  _progressTimer->start();
+  reportProgress();
+}
+
+/*!
+   Ends the running capture or comparison
+   \param status summary of the work
+ */
+void snapshotDialog_c::finishWork( const QString &status )
+{
+  _cancelled.reset();
+  _progress.reset();
+  _progressTimer->stop();
+
+  _captureButton->setEnabled( true );
+  _compareButton->setEnabled( true );
+  _stopButton->setEnabled( false );
+  _statusLabel->setText( status );
+}
+
+/*!
+   Lists changes \a changes found by a comparison
+   \param changes the changes sorted by path
+ */
+void snapshotDialog_c::showChanges( const QVector<snapshotChange_s> &changes )
+{
+  const QLocale locale;
+  QList<QTreeWidgetItem *> changeItems;
+  const int listedCount = std::min( changes.size(), listedChangeLimit );
+  changeItems.reserve( listedCount );
+  for ( int index = 0; index < listedCount; index++ )
+  {
+    const snapshotChange_s &change = changes.at( index );
+    QString path = QDir::toNativeSeparators( change.path );
+    if ( change.isDir )
+      path += QDir::separator();
+
+    QTreeWidgetItem *changeItem = new QTreeWidgetItem;
+    changeItem->setText( 0, changeName( change.kind ) );
+    if ( change.kind == snapshotChange_s::kind_e::Moved )
+      changeItem->setText( 1, tr( "%1 from %2" ).arg( path ).arg( QDir::toNativeSeparators( change.previousPath ) ) );
+    else
+      changeItem->setText( 1, path );
+    if ( change.kind != snapshotChange_s::kind_e::Removed )
+      changeItem->setData( 1, Qt::UserRole, change.path );
+
+    if ( !change.isDir )
+    {
+      if ( change.kind == snapshotChange_s::kind_e::Modified && change.previousSize != change.size )
+        changeItem->setText( 2, tr( "%1 to %2" ).arg( locale.formattedDataSize( change.previousSize ) ).
+                             arg( locale.formattedDataSize( change.size ) ) );
+      else
+        changeItem->setText( 2, locale.formattedDataSize( change.kind == snapshotChange_s::kind_e::Removed ?
+                                                          change.previousSize : change.size ) );
+      changeItem->setTextAlignment( 2, Qt::AlignRight | Qt::AlignVCenter );
+    }
+    changeItems.append( changeItem );
+  }
+
+  _changeTree->addTopLevelItems( changeItems );
+  _changeTree->resizeColumnToContents( 0 );
+  _changeTree->resizeColumnToContents( 2 );
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QDialog>
+#include <QThreadPool>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+
+#include "foldersnapshot.h"
+
+class QCheckBox;
+class QLabel;
+class QPushButton;
+class QTimer;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+/*!
+   Dialog capturing snapshots of a folder and comparing them
+   A snapshot of the folder is captured to a file by \em folderSnapshot_c. A chosen snapshot is compared to a
+   snapshot of the live tree captured in memory, two chosen snapshots of a folder are compared to each other, the
+   older one first. Captures and comparisons run on a worker thread, the changes are listed once done. An activated
+   change of the live tree is reported through \em fileActivated.
+ */
+class snapshotDialog_c : public QDialog
+{
+  Q_OBJECT
+
+  private:
+    // Absolute path to the folder
+    QString _folderPath;
+    // Captures a snapshot of the folder
+    QPushButton *_captureButton;
+    // Compares chosen snapshots
+    QPushButton *_compareButton;
+    // Stops the running capture or comparison
+    QPushButton *_stopButton;
+    // Snapshots hash the contents of the files
+    QCheckBox *_hashBox;
+    // Changes found by the comparison
+    QTreeWidget *_changeTree;
+    // Progress and summary of the work
+    QLabel *_statusLabel;
+    // Worker running the captures and comparisons
+    QThreadPool _workerPool;
+    // Abort flag of the running work, empty if idle
+    std::shared_ptr<std::atomic<bool>> _cancelled;
+    // Number of the entries captured by the running work
+    std::shared_ptr<std::atomic<qint64>> _progress;
+    // Triggers the progress reports
+    QTimer *_progressTimer;
+    // Absolute path to the compared live tree, empty if two snapshots were compared
+    QString _liveRootPath;
+
+  public:
+    snapshotDialog_c( const QString &, QWidget * = nullptr );
+    virtual ~snapshotDialog_c();
+
+  private:
+    void startWork();
+    void finishWork( const QString & );
+    void showChanges( const QVector<snapshotChange_s> & );
+
+  private slots:
+    void handleCaptureButton();
+    void handleCompareButton();
+    void handleStopButton();
+    void reportProgress();
+    void handleItemActivated( QTreeWidgetItem * );
+
+  signals:
+    // Absolute path to the activated entry
+    void fileActivated( const QString & );
+};
@@ -0,0 +1,140 @@
+#include "statcache.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+#include <iterator>
+
+#if defined( Q_OS_UNIX )
+#include <sys/stat.h>
+#endif
+
+#include "perftracer.h"
+
+/*!
+   C-tor
+ */
+statCache_c::statCache_c()
+{
+  _clock.start();
+}
+
+/*!
+   \return the cache shared by all threads
+ */
+statCache_c &statCache_c::instance()
+{
+  static statCache_c cache;
+  return cache;
+}
+
+/*!
+   Provides attributes of an entry given at \a path, stat-ing it unless cached
+   Concurrent lookups of the same path are not coalesced, the stat runs outside the lock.
+   \param path path to the entry
+   \return the attributes
+ */
+statCache_c::status_s statCache_c::status( const QString &path )
+{
+  status_s entryStatus;
+  if ( peek( path, entryStatus ) )
+    return entryStatus;
+
+  entryStatus = statPath( path );
+
+  QMutexLocker locker( &_mutex );
+  const qint64 now = _clock.elapsed();
+  if ( _entries.size() >= maximumSize )
+  {
+    for ( auto entryIt = _entries.begin(); entryIt != _entries.end(); )
+      entryIt = ( entryIt->expiry <= now ) ? _entries.erase( entryIt ) : std::next( entryIt );
+    // still full of live entries, e.g. while a huge folder is walked
+    if ( _entries.size() >= maximumSize )
+      _entries.clear();
+  }
+
+  _entries.insert( path, { entryStatus, now + ( entryStatus.exists ? positiveTimeToLive : negativeTimeToLive ) } );
+  return entryStatus;
+}
+
+/*!
+   Looks up attributes of an entry given at \a path without stat-ing it
+   \param path path to the entry
+   \param entryStatus output for the attributes
+   \return true if the attributes are cached and did not expire
+ */
+bool statCache_c::peek( const QString &path, status_s &entryStatus ) const
+{
+  QMutexLocker locker( &_mutex );
+  const auto entryIt = _entries.constFind( path );
+  if ( entryIt == _entries.constEnd() || entryIt->expiry <= _clock.elapsed() )
+    return false;
+
+  entryStatus = entryIt->status;
+  return true;
+}
+
+/*!
+   Drops cached attributes of an entry given at \a path
+   \param path path to the entry
+ */
+void statCache_c::invalidate( const QString &path )
+{
+  QMutexLocker locker( &_mutex );
+  _entries.remove( path );
+}
+
+/*!
+   Drops all the cached attributes
+ */
+void statCache_c::clear()
+{
+  QMutexLocker locker( &_mutex );
+  _entries.clear();
+}
+
+/*!
+   Stats an entry given at \a path, bypassing the cache
+   \param path path to the entry
+   \return the attributes, not existing for an empty path
+ */
+statCache_c::status_s statCache_c::statPath( const QString &path )
+{
+  status_s entryStatus;
+  if ( path.isEmpty() )
+    return entryStatus;
+
+  const perfScope_c statScope( perfTracer_c::operation_e::Stat );
+#if defined( Q_OS_UNIX )
+  struct stat entryStat;
+  if ( stat( QFile::encodeName( path ).constData(), &entryStat ) != 0 )
+    return entryStatus;
+
+  entryStatus.exists = true;
+  entryStatus.isDir = S_ISDIR( entryStat.st_mode );
+  entryStatus.isFile = S_ISREG( entryStat.st_mode );
+  entryStatus.size = entryStat.st_size;
+#if defined( Q_OS_DARWIN )
+  entryStatus.modified = static_cast<qint64>( entryStat.st_mtimespec.tv_sec ) * 1000000000 +
+                         entryStat.st_mtimespec.tv_nsec;
+#else
+  entryStatus.modified = static_cast<qint64>( entryStat.st_mtim.tv_sec ) * 1000000000 + entryStat.st_mtim.tv_nsec;
+#endif
+  entryStatus.device = static_cast<quint64>( entryStat.st_dev );
+  entryStatus.inode = static_cast<quint64>( entryStat.st_ino );
+#else
+  const QFileInfo entryFileInfo( path );
+  if ( !entryFileInfo.exists() )
+    return entryStatus;
+
+  entryStatus.exists = true;
+  entryStatus.isDir = entryFileInfo.isDir();
+  entryStatus.isFile = entryFileInfo.isFile();
+  entryStatus.size = entryFileInfo.size();
+  entryStatus.modified = entryFileInfo.lastModified().toMSecsSinceEpoch() * 1000000;
+#endif
+
+  return entryStatus;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+/*!
+   Shared cache of file system entry attributes
+   Every path is stat-ed at most once per time to live, so the path validation of the UI, the preview producer and
+   the text file reader agree on a selection for the price of a single stat. Missing entries are cached too, for a
+   shorter time, as a path being typed is looked up for every keystroke. Entries known to change should be
+   invalidated. The class is thread-safe.
+ */
+class statCache_c
+{
+  public:
+    /*!
+       Attributes of an entry, symbolic links followed
+     */
+    struct status_s
+    {
+      bool exists = false;
+      bool isDir = false;
+      // True for a regular file
+      bool isFile = false;
+      qint64 size = 0;
+      // Modification time in ns since epoch
+      qint64 modified = 0;
+      // Identity of the entry, zero where not available
+      quint64 device = 0;
+      quint64 inode = 0;
+    };
+
+    // Time in ms an existing entry is cached
+    static constexpr qint64 positiveTimeToLive = 2000;
+    // Time in ms a missing entry is cached
+    static constexpr qint64 negativeTimeToLive = 500;
+    // Number of entries cached at most
+    static constexpr int maximumSize = 4096;
+
+  private:
+    struct cacheEntry_s
+    {
+      status_s status;
+      // Time the entry expires at, see _clock
+      qint64 expiry;
+    };
+
+    mutable QMutex _mutex;
+    QHash<QString, cacheEntry_s> _entries;
+    QElapsedTimer _clock;
+
+  public:
+    static statCache_c &instance();
+
+    status_s status( const QString & );
+    bool peek( const QString &, status_s & ) const;
+    void invalidate( const QString & );
+    void clear();
+
+    static status_s statPath( const QString & );
+
+  private:
+    statCache_c();
+};
@@ -0,0 +1,265 @@
+#include "treemaplayout.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <numeric>
+
+#include "sizescanner.h"
+
+namespace
+{
+  // Number of cells laid out between two checks of the abort flag
+  constexpr size_t cancelCheckInterval = 4096;
+
+  /*!
+     Sizes of the children of a folder to lay out, largest first
+     The children too small to show are merged into a single trailing entry of id invalidId.
+   */
+  struct children_s
+  {
+    std::vector<quint32> ids;
+    std::vector<double> areas;
+  };
+
+  /*!
+     Selects the children of a folder worth a cell and scales their sizes to areas
+     \param ids ids of the children
+     \param sizes sizes of the children, the same order
+     \param area area to lay out the children in
+     \return the children, largest first
+   */
+  children_s selectChildren( const std::vector<quint32> &ids, const std::vector<qint64> &sizes, double area )
+  {
+    children_s children;
+    std::vector<size_t> order( ids.size() );
+    std::iota( order.begin(), order.end(), 0 );
+    std::sort( order.begin(), order.end(), [&sizes]( size_t left, size_t right )
+    {
+      return sizes[ left ] > sizes[ right ];
+    } );
+
+    const double total = std::accumulate( sizes.begin(), sizes.end(), 0.0 );
+    if ( total <= 0 )
+      return children;
+
+    const double scale = area / total;
+    double mergedArea = 0;
+    for ( const size_t index : order )
+    {
+      const double childArea = static_cast<double>( sizes[ index ] ) * scale;
+      if ( childArea <= 0 )
+        break;
+
+      if ( childArea < treemapLayout_c::minimumCellArea )
+        mergedArea += childArea;
+      else
+      {
+        children.ids.push_back( ids[ index ] );
+        children.areas.push_back( childArea );
+      }
+    }
+
+    if ( mergedArea > 0 )
+    {
+      // the merged entry takes its place among the larger ones
+      const auto position = std::upper_bound( children.areas.begin(), children.areas.end(), mergedArea,
+                                              std::greater<double>() );
+      children.ids.insert( children.ids.begin() + ( position - children.areas.begin() ), treemapLayout_c::invalidId );
+      children.areas.insert( position, mergedArea );
+    }
+    return children;
+  }
+}
+
+/*!
+   Lays out areas \a areas in a rectangle \a bounds by the squarified algorithm
+   Rows of rectangles are placed along the shorter side of the remaining space, a row grows as long as its worst
+   aspect ratio improves.
+   \param areas the areas, largest first, summing up to the area of the rectangle
+   \param bounds the rectangle
+   \param rects receives a rectangle for every area, the same order
+ */
+void treemapLayout_c::squarify( const std::vector<double> &areas, const QRectF &bounds, std::vector<QRectF> &rects )
+{
+  rects.resize( areas.size() );
+  QRectF remaining = bounds;
+
+  size_t start = 0;
+  while ( start < areas.size() )
+  {
+    const double side = std::min( remaining.width(), remaining.height() );
+    const double sideSquared = std::max( side * side, std::numeric_limits<double>::min() );
+
+    double rowArea = 0;
+    double worstRatio = std::numeric_limits<double>::max();
+    size_t end = start;
+    while ( end < areas.size() )
+    {
+      // the areas are descending, the first of the row is the largest, the new one the smallest
+      const double newRowArea = rowArea + areas[ end ];
+      const double newRowAreaSquared = std::max( newRowArea * newRowArea, std::numeric_limits<double>::min() );
+      const double newWorstRatio = std::max( sideSquared * areas[ start ] / newRowAreaSquared,
+                                             newRowAreaSquared / ( sideSquared * std::max( areas[ end ], 1e-9 ) ) );
+      if ( end > start && newWorstRatio > worstRatio )
+        break;
+
+      worstRatio = newWorstRatio;
+      rowArea = newRowArea;
+      end++;
+    }
+
+    if ( remaining.width() >= remaining.height() )
+    {
+      // a column at the left
+      const double width = ( remaining.height() > 0 ) ? std::min( rowArea / remaining.height(), remaining.width() ) : 0;
+      double top = remaining.top();
+      for ( size_t index = start; index < end; index++ )
+      {
+        const double height = ( width > 0 ) ? areas[ index ] / width : 0;
+        rects[ index ] = QRectF( remaining.left(), top, width, height );
+        top += height;
+      }
+      remaining.setLeft( remaining.left() + width );
+    }
+    else
+    {
+      // a row at the top
+      const double height = ( remaining.width() > 0 ) ? std::min( rowArea / remaining.width(), remaining.height() ) : 0;
+      double left = remaining.left();
+      for ( size_t index = start; index < end; index++ )
+      {
+        const double width = ( height > 0 ) ? areas[ index ] / height : 0;
+        rects[ index ] = QRectF( left, remaining.top(), width, height );
+        left += width;
+      }
+      remaining.setTop( remaining.top() + height );
+    }
+
+    start = end;
+  }
+}
+
+/*!
+   Lays out the entries of a scan index below a folder \a rootId in a rectangle \a bounds
+   \param scanIndex the scan index
+   \param rootId id of the folder
+   \param bounds the rectangle
+   \param cancelled stops the layout once set
+   \return the cells, every folder before its content
+ */
+std::vector<treemapLayout_c::cell_s> treemapLayout_c::layout( const scanIndex_c &scanIndex, quint32 rootId,
+                                                              const QRectF &bounds, const std::atomic<bool> &cancelled )
+{
+  std::vector<cell_s> cells;
+  if ( rootId >= scanIndex.count() )
+    return cells;
+
+  cell_s root;
+  root.rect = bounds;
+  root.id = rootId;
+  root.isDir = ( scanIndex.entry( rootId ).flags & scanIndex_c::Directory ) != 0;
+
+  std::vector<cell_s> pending{ root };
+  std::vector<quint32> ids;
+  std::vector<qint64> sizes;
+  std::vector<QRectF> rects;
+  while ( !pending.empty() )
+  {
+    if ( cells.size() % cancelCheckInterval == 0 && cancelled )
+      return {};
+
+    const cell_s cell = pending.back();
+    pending.pop_back();
+    cells.push_back( cell );
+
+    if ( !cell.isDir || cell.id == invalidId || cell.depth >= maximumDepth )
+      continue;
+
+    const QRectF content = contentRect( cell.rect );
+    const double area = content.width() * content.height();
+    const scanIndex_c::entry_s &entry = scanIndex.entry( cell.id );
+    if ( area < minimumFolderArea || entry.childCount == 0 )
+      continue;
+
+    ids.clear();
+    sizes.clear();
+    for ( quint32 child = entry.firstChild; child < entry.firstChild + entry.childCount; child++ )
+    {
+      // hard links counted at another entry do not take space
+      if ( scanIndex.entry( child ).flags & scanIndex_c::DuplicateLink )
+        continue;
+      ids.push_back( child );
+      sizes.push_back( scanIndex.entry( child ).size );
+    }
+
+    const children_s children = selectChildren( ids, sizes, area );
+    squarify( children.areas, content, rects );
+
+    // pushed in reverse, so the largest child is laid out first
+    for ( size_t index = children.ids.size(); index-- > 0; )
+    {
+      cell_s childCell;
+      childCell.rect = rects[ index ];
+      childCell.id = children.ids[ index ];
+      childCell.depth = static_cast<quint8>( cell.depth + 1 );
+      childCell.isDir = childCell.id != invalidId &&
+                        ( scanIndex.entry( childCell.id ).flags & scanIndex_c::Directory ) != 0;
+      pending.push_back( childCell );
+    }
+  }
+
+  return cells;
+}
+
+/*!
+   Lays out the immediate children of a scanned folder \a children in a rectangle \a bounds
+   Used until an index of the folder is available, the children are not descended into.
+   \param children the children
+   \param bounds the rectangle
+   \return the cells, the folder first, the ids are indexes of the children
+ */
+std::vector<treemapLayout_c::cell_s> treemapLayout_c::layout( const QVector<sizeScanChild_s> &children,
+                                                              const QRectF &bounds )
+{
+  cell_s root;
+  root.rect = bounds;
+  root.isDir = true;
+  std::vector<cell_s> cells{ root };
+
+  std::vector<quint32> ids;
+  std::vector<qint64> sizes;
+  for ( int index = 0; index < children.size(); index++ )
+  {
+    ids.push_back( static_cast<quint32>( index ) );
+    sizes.push_back( children.at( index ).bytes );
+  }
+
+  const QRectF content = contentRect( bounds );
+  const children_s selected = selectChildren( ids, sizes, content.width() * content.height() );
+  std::vector<QRectF> rects;
+  squarify( selected.areas, content, rects );
+
+  for ( size_t index = 0; index < selected.ids.size(); index++ )
+  {
+    cell_s cell;
+    cell.rect = rects[ index ];
+    cell.id = selected.ids[ index ];
+    cell.depth = 1;
+    cell.isDir = cell.id != invalidId && children.at( static_cast<int>( cell.id ) ).isDir;
+    cells.push_back( cell );
+  }
+  return cells;
+}
+
+/*!
+   \param rect rectangle of a folder
+   \return rectangle the content of the folder is laid out in, inside the padding and below the name strip
+ */
+QRectF treemapLayout_c::contentRect( const QRectF &rect )
+{
+  QRectF content = rect.adjusted( folderPadding, folderPadding, -folderPadding, -folderPadding );
+  if ( content.height() > 4 * folderHeaderHeight )
+    content.setTop( content.top() + folderHeaderHeight );
+  return content.isValid() ? content : QRectF();
+}
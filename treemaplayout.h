@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QRectF>
+#include <QVector>
+
+#include <atomic>
+#include <vector>
+
+#include "scanindex.h"
+
+struct sizeScanChild_s;
+
+/*!
+   Squarified treemap layout of recursive folder sizes
+   Every entry gets a rectangle of an area proportional to its size, the children of a folder are laid out inside
+   the folder in rows keeping the rectangles as close to squares as possible. The layout reads the sizes straight
+   from a \em scanIndex_c, whose children are contiguous, and descends only into folders large enough to show
+   their content. Entries too small to show are merged into a single cell per folder, so the number of cells is
+   bounded by the laid out area rather than by the number of entries.
+ */
+class treemapLayout_c
+{
+  public:
+    /*!
+       Laid out rectangle of an entry
+     */
+    struct cell_s
+    {
+      QRectF rect;
+      // Id of the entry in the scan index, or index of the child of a scan result, invalidId for merged entries
+      quint32 id = invalidId;
+      quint8 depth = 0;
+      bool isDir = false;
+    };
+
+    // Id of the cell of the merged entries too small to show
+    static constexpr quint32 invalidId = scanIndex_c::invalidId;
+    // Smallest area of a cell in pixels, smaller entries are merged
+    static constexpr double minimumCellArea = 24.0;
+    // Smallest area of a folder in pixels, whose content is laid out
+    static constexpr double minimumFolderArea = 1600.0;
+    // Space between the border of a folder and its content, in pixels
+    static constexpr double folderPadding = 2.0;
+    // Height of the name strip on top of a folder, if high enough, in pixels
+    static constexpr double folderHeaderHeight = 14.0;
+    // Deepest level of folders laid out
+    static constexpr int maximumDepth = 64;
+
+    static void squarify( const std::vector<double> &, const QRectF &, std::vector<QRectF> & );
+    static std::vector<cell_s> layout( const scanIndex_c &, quint32, const QRectF &, const std::atomic<bool> & );
+    static std::vector<cell_s> layout( const QVector<sizeScanChild_s> &, const QRectF & );
+    static QRectF contentRect( const QRectF & );
+};
@@ -0,0 +1,387 @@
+#include "treemapwidget.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLocale>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QTimer>
+#include <QToolTip>
+#include <QtConcurrent>
+
+#include <cstring>
+
+namespace
+{
+  // Delay coalescing the changes of the sources and of the size into a single layout, in ms
+  constexpr int layoutDelay = 100;
+  // Smallest width of a cell labeled with its name, in pixels
+  constexpr double minimumLabelWidth = 40.0;
+  // Number of cells rendered between two checks of the abort flag
+  constexpr size_t cancelCheckInterval = 4096;
+
+  /*!
+     \param name name of a file
+     \return fill color of the file, derived from its extension
+   */
+  QColor fileColor( const QString &name )
+  {
+    const int dot = name.lastIndexOf( '.' );
+    if ( dot <= 0 )
+      return QColor::fromHsv( 0, 0, 200 );
+    return QColor::fromHsv( static_cast<int>( qHash( name.mid( dot + 1 ).toLower() ) % 360 ), 110, 225 );
+  }
+
+  /*!
+     \param depth depth of a folder below the shown one
+     \return fill color of the folder, darker with the depth
+   */
+  QColor folderColor( int depth )
+  {
+    return QColor::fromHsv( 210, 40, qMax( 120, 240 - 12 * depth ) );
+  }
+}
+
+/*!
+   C-tor
+   \param parent parent widget
+ */
+treemapWidget_c::treemapWidget_c( QWidget *parent ) :
+  QWidget( parent ),
+  _layoutGeneration{ 0 },
+  _layoutTimer{ nullptr }
+{
+  setMouseTracking( true );
+  setMinimumHeight( 120 );
+  _layoutPool.setMaxThreadCount( 1 );
+
+  _layoutTimer = new QTimer( this );
+  _layoutTimer->setSingleShot( true );
+  _layoutTimer->setInterval( layoutDelay );
+  connect( _layoutTimer, &QTimer::timeout, this, &treemapWidget_c::startLayout );
+}
+
+/*!
+   D-tor
+   Aborts the layout in progress and waits for it to wind down.
+ */
+treemapWidget_c::~treemapWidget_c()
+{
+  if ( _layoutCancelled )
+    *_layoutCancelled = true;
+  _layoutPool.waitForDone();
+}
+
+/*!
+   Shows the disk usage below a folder given at \a folderPath
+   \param folderPath absolute path to the folder
+ */
+void treemapWidget_c::setFolder( const QString &folderPath )
+{
+  if ( folderPath == _folderPath )
+    return;
+
+  _folderPath = folderPath;
+  _scanChildren.clear();
+  scheduleLayout();
+}
+
+/*!
+   Sets an index \a scanIndex of the listed folder as the source of the sizes
+   \param scanIndex the index, may be empty
+ */
+void treemapWidget_c::setScanIndex( const std::shared_ptr<const scanIndex_c> &scanIndex )
+{
+  if ( scanIndex == _scanIndex )
+    return;
+
+  _scanIndex = scanIndex;
+  scheduleLayout();
+}
+
+/*!
+   Takes the immediate children of the shown folder from a size scan result \a result, used without an index
+   \param result totals of a folder size scan
+ */
+void treemapWidget_c::setScanResult( const sizeScanResult_s &result )
+{
+  if ( result.path != _folderPath )
+    return;
+
+  _scanChildren = result.children;
+  if ( !_scanIndex || _scanIndex->find( _folderPath ) == scanIndex_c::invalidId )
+    scheduleLayout();
+}
+
+/*!
+   Paints the latest finished layout, stretched if the widget was resized since
+ */
+void treemapWidget_c::paintEvent( QPaintEvent * )
+{
+  QPainter painter( this );
+  if ( !_rendering || _rendering->image.isNull() )
+  {
+    painter.fillRect( rect(), palette().window() );
+    painter.drawText( rect(), Qt::AlignCenter, _folderPath.isEmpty() ? QString() : tr( "Scanning..." ) );
+    return;
+  }
+
+  painter.setRenderHint( QPainter::SmoothPixmapTransform );
+  painter.drawImage( rect(), _rendering->image );
+}
+
+/*!
+   Lays out the treemap again for the new size
+ */
+void treemapWidget_c::resizeEvent( QResizeEvent *event )
+{
+  QWidget::resizeEvent( event );
+  scheduleLayout();
+}
+
+/*!
+   Lays out the treemap skipped while hidden
+ */
+void treemapWidget_c::showEvent( QShowEvent *event )
+{
+  QWidget::showEvent( event );
+  scheduleLayout();
+}
+
+/*!
+   Shows path and size of the hovered entry
+ */
+void treemapWidget_c::mouseMoveEvent( QMouseEvent *event )
+{
+  const treemapLayout_c::cell_s *cell = cellAt( event->pos() );
+  if ( cell == nullptr )
+  {
+    QToolTip::hideText();
+    return;
+  }
+
+  const bool merged = cell->id == treemapLayout_c::invalidId && cell->depth > 0;
+  const QString text = merged ? tr( "Smaller entries" ) :
+                       QDir::toNativeSeparators( cellPath( *_rendering, *cell ) );
+  QToolTip::showText( event->globalPos(), QString( "%1\n%2" ).arg( text ).
+                      arg( QLocale().formattedDataSize( cellSize( *_rendering, *cell ) ) ), this );
+}
+
+/*!
+   Reports the clicked entry through \em entryActivated
+ */
+void treemapWidget_c::mousePressEvent( QMouseEvent *event )
+{
+  const treemapLayout_c::cell_s *cell = cellAt( event->pos() );
+  if ( event->button() == Qt::LeftButton && cell != nullptr &&
+       ( cell->id != treemapLayout_c::invalidId || cell->depth == 0 ) )
+    emit entryActivated( cellPath( *_rendering, *cell ) );
+  else
+    QWidget::mousePressEvent( event );
+}
+
+/*!
+   Starts a layout once the changes settle, a hidden treemap is not laid out
+ */
+void treemapWidget_c::scheduleLayout()
+{
+  if ( isVisible() )
+    _layoutTimer->start();
+}
+
+/*!
+   Slot to lay out and render the treemap of the shown folder on the worker
+   The layout of an indexed folder descends the index, otherwise the scanned children of the folder are shown.
+ */
+void treemapWidget_c::startLayout()
+{
+  if ( _layoutCancelled )
+    *_layoutCancelled = true;
+
+  const quint64 generation = ++_layoutGeneration;
+  auto cancelled = std::make_shared<std::atomic<bool>>( false );
+  _layoutCancelled = cancelled;
+
+  if ( _folderPath.isEmpty() || width() <= 0 || height() <= 0 )
+  {
+    _rendering.reset();
+    update();
+    return;
+  }
+
+  auto rendering = std::make_shared<rendering_s>();
+  rendering->folderPath = _folderPath;
+  rendering->scanIndex = _scanIndex;
+  rendering->children = _scanChildren;
+  const QSize imageSize = size() * devicePixelRatioF();
+  const qreal pixelRatio = devicePixelRatioF();
+  const QFont renderFont = font();
+
+  QtConcurrent::run( &_layoutPool, [this, generation, cancelled, rendering, imageSize, pixelRatio, renderFont]()
+  {
+    const QRectF bounds( QPointF( 0, 0 ), QSizeF( imageSize ) / pixelRatio );
+    const quint32 folderId = rendering->scanIndex ? rendering->scanIndex->find( rendering->folderPath ) :
+                             scanIndex_c::invalidId;
+    if ( folderId != scanIndex_c::invalidId )
+    {
+      rendering->children.clear();
+      rendering->cells = treemapLayout_c::layout( *rendering->scanIndex, folderId, bounds, *cancelled );
+    }
+    else
+    {
+      rendering->scanIndex.reset();
+      rendering->cells = treemapLayout_c::layout( rendering->children, bounds );
+    }
+    if ( *cancelled )
+      return;
+
+    rendering->image = QImage( imageSize, QImage::Format_ARGB32_Premultiplied );
+    rendering->image.setDevicePixelRatio( pixelRatio );
+    render( *rendering, renderFont, *cancelled );
+    if ( *cancelled )
+      return;
+
+    QMetaObject::invokeMethod( this, [this, generation, rendering]()
+    {
+      if ( generation != _layoutGeneration )
+        return;
+
+      _rendering = rendering;
+      update();
+    }, Qt::QueuedConnection );
+  } );
+}
+
+/*!
+   Finds the innermost cell of the latest layout at a point \a point
+   \param point the point in widget coordinates
+   \return the cell, nullptr if none
+ */
+const treemapLayout_c::cell_s *treemapWidget_c::cellAt( const QPoint &point ) const
+{
+  if ( !_rendering || _rendering->image.isNull() )
+    return nullptr;
+
+  // the layout may be older than the size of the widget
+  const QSizeF layoutSize = QSizeF( _rendering->image.size() ) / _rendering->image.devicePixelRatio();
+  const QPointF layoutPoint( point.x() * layoutSize.width() / width(), point.y() * layoutSize.height() / height() );
+
+  // folders precede their content, the last cell containing the point is the innermost
+  for ( auto cell = _rendering->cells.rbegin(); cell != _rendering->cells.rend(); ++cell )
+    if ( cell->rect.contains( layoutPoint ) )
+      return &*cell;
+  return nullptr;
+}
+
+/*!
+   \param rendering the layout
+   \param cell a cell of the layout
+   \return name of the entry of the cell
+ */
+QString treemapWidget_c::cellName( const rendering_s &rendering, const treemapLayout_c::cell_s &cell )
+{
+  if ( cell.id == treemapLayout_c::invalidId )
+    return cell.depth == 0 ? QFileInfo( rendering.folderPath ).fileName() : QString();
+  if ( rendering.scanIndex )
+    return cell.depth == 0 ? QFileInfo( rendering.folderPath ).fileName() :
+                             QFile::decodeName( rendering.scanIndex->name( cell.id ) );
+  return rendering.children.at( static_cast<int>( cell.id ) ).name;
+}
+
+/*!
+   \param rendering the layout
+   \param cell a cell of the layout, not a merged one
+   \return absolute path to the entry of the cell
+ */
+QString treemapWidget_c::cellPath( const rendering_s &rendering, const treemapLayout_c::cell_s &cell )
+{
+  if ( cell.depth == 0 )
+    return rendering.folderPath;
+  if ( !rendering.scanIndex )
+    return QDir( rendering.folderPath ).filePath( rendering.children.at( static_cast<int>( cell.id ) ).name );
+
+  // the entry 0 is named with the absolute path to the indexed folder
+  QStringList components;
+  for ( quint32 id = cell.id; id != 0 && id != scanIndex_c::invalidId; id = rendering.scanIndex->entry( id ).parent )
+    components.prepend( QFile::decodeName( rendering.scanIndex->name( id ) ) );
+  return QDir( rendering.scanIndex->rootPath() ).filePath( components.join( '/' ) );
+}
+
+/*!
+   \param rendering the layout
+   \param cell a cell of the layout
+   \return size of the entry of the cell, of the merged entries for a merged cell
+ */
+qint64 treemapWidget_c::cellSize( const rendering_s &rendering, const treemapLayout_c::cell_s &cell )
+{
+  if ( cell.id != treemapLayout_c::invalidId )
+  {
+    if ( rendering.scanIndex )
+      return rendering.scanIndex->entry( cell.id ).size;
+    if ( cell.depth > 0 )
+      return rendering.children.at( static_cast<int>( cell.id ) ).bytes;
+  }
+
+  // the area of a cell is proportional to the size, relative to the whole folder
+  const treemapLayout_c::cell_s &root = rendering.cells.front();
+  const double rootArea = root.rect.width() * root.rect.height();
+  qint64 rootSize = 0;
+  if ( rendering.scanIndex )
+    rootSize = rendering.scanIndex->entry( root.id ).size;
+  else
+    for ( const auto &child : rendering.children )
+      rootSize += child.bytes;
+  if ( &cell == &root || rootArea <= 0 )
+    return rootSize;
+
+  const QRectF content = treemapLayout_c::contentRect( root.rect );
+  const double contentArea = content.width() * content.height();
+  return contentArea > 0 ? static_cast<qint64>( cell.rect.width() * cell.rect.height() / contentArea * rootSize ) : 0;
+}
+
+/*!
+   Renders the cells of a layout \a rendering into its image
+   \param rendering the layout
+   \param font font of the names
+   \param cancelled stops the rendering once set
+ */
+void treemapWidget_c::render( rendering_s &rendering, const QFont &font, const std::atomic<bool> &cancelled )
+{
+  rendering.image.fill( Qt::white );
+
+  QPainter painter( &rendering.image );
+  painter.setFont( font );
+  const QFontMetrics fm( font );
+
+  for ( size_t index = 0; index < rendering.cells.size(); index++ )
+  {
+    if ( index % cancelCheckInterval == 0 && cancelled )
+      return;
+
+    const treemapLayout_c::cell_s &cell = rendering.cells[ index ];
+    const QString name = cellName( rendering, cell );
+    QColor color;
+    if ( cell.id == treemapLayout_c::invalidId && cell.depth > 0 )
+      color = QColor( 230, 230, 230 );
+    else
+      color = cell.isDir ? folderColor( cell.depth ) : fileColor( name );
+
+    painter.fillRect( cell.rect, color );
+    painter.setPen( color.darker( 140 ) );
+    painter.drawRect( cell.rect );
+
+    if ( cell.rect.width() < minimumLabelWidth || cell.rect.height() < treemapLayout_c::folderHeaderHeight ||
+         name.isEmpty() )
+      continue;
+
+    // folders are labeled in their name strip, files in their middle
+    const QRectF labelRect = cell.isDir ? QRectF( cell.rect.left() + treemapLayout_c::folderPadding, cell.rect.top(),
+                                                  cell.rect.width() - 2 * treemapLayout_c::folderPadding,
+                                                  treemapLayout_c::folderHeaderHeight ) :
+                                          cell.rect.adjusted( 2, 0, -2, 0 );
+    painter.setPen( Qt::black );
+    painter.drawText( labelRect, Qt::AlignCenter,
+                      fm.elidedText( name, Qt::ElideMiddle, static_cast<int>( labelRect.width() ) ) );
+  }
+}
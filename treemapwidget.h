@@ -0,0 +1,88 @@
+#pragma once
+
+#include <QImage>
+#include <QThreadPool>
+#include <QVector>
+#include <QWidget>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "sizescanner.h"
+#include "treemaplayout.h"
+
+class QTimer;
+
+/*!
+   Treemap of the disk usage below a folder
+   The sizes come from the index of the listed folder, see \em scanIndex_c. Without an index, the immediate children
+   reported by a size scan are shown, refined with every scan update. The layout and its rendering into an image run
+   on a worker thread, so only the finished image is painted on the GUI thread; until a new layout is done, the
+   previous one is shown. Hovering a cell shows its path and size, clicking it reports the entry.
+ */
+class treemapWidget_c : public QWidget
+{
+  Q_OBJECT
+
+  private:
+    /*!
+       Rendered layout with the sources its cells refer to
+     */
+    struct rendering_s
+    {
+      QString folderPath;
+      std::shared_ptr<const scanIndex_c> scanIndex;
+      QVector<sizeScanChild_s> children;
+      std::vector<treemapLayout_c::cell_s> cells;
+      QImage image;
+    };
+
+    // Absolute path to the shown folder
+    QString _folderPath;
+    // Index of the listed folder, may be empty
+    std::shared_ptr<const scanIndex_c> _scanIndex;
+    // Immediate children of the shown folder reported by a size scan
+    QVector<sizeScanChild_s> _scanChildren;
+    // The latest finished layout
+    std::shared_ptr<const rendering_s> _rendering;
+    // Worker running the layouts
+    QThreadPool _layoutPool;
+    // Generation of the latest layout, results of older ones are dropped
+    quint64 _layoutGeneration;
+    // Abort flag of the layout in progress
+    std::shared_ptr<std::atomic<bool>> _layoutCancelled;
+    // Coalesces the changes into a single layout
+    QTimer *_layoutTimer;
+
+  public:
+    treemapWidget_c( QWidget * = nullptr );
+    virtual ~treemapWidget_c();
+
+    void setFolder( const QString & );
+    void setScanIndex( const std::shared_ptr<const scanIndex_c> & );
+    void setScanResult( const sizeScanResult_s & );
+
+  protected:
+    void paintEvent( QPaintEvent * ) override;
+    void resizeEvent( QResizeEvent * ) override;
+    void showEvent( QShowEvent * ) override;
+    void mouseMoveEvent( QMouseEvent * ) override;
+    void mousePressEvent( QMouseEvent * ) override;
+
+  private:
+    void scheduleLayout();
+    const treemapLayout_c::cell_s *cellAt( const QPoint & ) const;
+
+    static QString cellName( const rendering_s &, const treemapLayout_c::cell_s & );
+    static QString cellPath( const rendering_s &, const treemapLayout_c::cell_s & );
+    static qint64 cellSize( const rendering_s &, const treemapLayout_c::cell_s & );
+    static void render( rendering_s &, const QFont &, const std::atomic<bool> & );
+
+  private slots:
+    void startLayout();
+
+  signals:
+    // Absolute path to the clicked entry
+    void entryActivated( const QString & );
+};
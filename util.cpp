@@ -1,41 +1,111 @@
 #include "util.h"
 
-#include <QDirIterator>
-#include <QFileInfo>
+#include <QFile>
 #include <QFont>
 #include <QFontMetrics>
+#include <QMimeType>
 #include <QSize>
 
+#include "dirlister.h"
+#include "perftracer.h"
+#include "statcache.h"
+
 namespace
 {
+  // Bytes of a text window read at most, also of a window reaching the end of the file
+  constexpr int maximumWindowSize = 4 * 1024 * 1024;
+
   /*!
-     Collects folder entries according to pre-configured directory iterator \a dirIt
-     \param maximumLines number of maximum lines to collect
-     \param collectedLines number of already collected lines
-     \param dirIt directory iterator
-     \param entries output container for the collected folder entries
+     Detects length of a UTF-8 buffer \a data without a trailing incomplete multi-byte sequence
+     \param data the buffer
+     \param length length of the buffer
+     \return length of the buffer to decode
    */
-  void getDirEntries( int maximumLines, int &collectedLines, QDirIterator &dirIt, QStringList &entries )
+  qint64 completeUtf8Length( const uchar *data, qint64 length )
   {
-    if ( collectedLines == maximumLines )
-      return;
-
-    while( dirIt.hasNext() )
+    qint64 leadPosition = length;
+    int continuationBytes = 0;
+    while ( leadPosition > 0 && continuationBytes < 3 && ( data[ leadPosition - 1 ] & 0xC0 ) == 0x80 )
     {
-      const auto dirEntry = dirIt.next();
-      collectedLines++;
-      if ( maximumLines != -1 && collectedLines == maximumLines )
-      {
-        entries << "...";
-        break;
-      }
-      entries << dirEntry;
+      leadPosition--;
+      continuationBytes++;
     }
+
+    if ( leadPosition == 0 )
+      return length;
+
+    const uchar lead = data[ leadPosition - 1 ];
+    int sequenceLength = 1;
+    if ( ( lead & 0xF8 ) == 0xF0 )
+      sequenceLength = 4;
+    else if ( ( lead & 0xF0 ) == 0xE0 )
+      sequenceLength = 3;
+    else if ( ( lead & 0xE0 ) == 0xC0 )
+      sequenceLength = 2;
+
+    return ( continuationBytes + 1 < sequenceLength ) ? leadPosition - 1 : length;
+  }
+
+  /*!
+     Detects number of leading UTF-8 continuation bytes in a buffer \a data, i.e. bytes of a multi-byte sequence
+     started before the buffer
+     \param data the buffer
+     \param length length of the buffer
+     \return number of bytes to skip
+   */
+  qint64 leadingContinuationBytes( const uchar *data, qint64 length )
+  {
+    qint64 skipped = 0;
+    while ( skipped < length && skipped < 3 && ( data[ skipped ] & 0xC0 ) == 0x80 )
+      skipped++;
+    return skipped;
+  }
+
+  /*!
+     Decodes a window of a text file with a path \a path
+     Only the window is read and decoded, so the cost does not depend on the file size, and a file truncated meanwhile
+     only gives a shorter window. Multi-byte UTF-8 sequences cut by the window borders are dropped.
+     \param path path to the file
+     \param status attributes of the file
+     \param offset byte offset of the window
+     \param maximumSize size of the window in bytes, at most \em maximumWindowSize. If -1 given, the window reaches
+            the end of the file or \em maximumWindowSize bytes
+     \param truncated output, true if the file continues after the window
+     \return the decoded window
+   */
+  QString readTextWindow( const QString &path, const statCache_c::status_s &status, qint64 offset, int maximumSize,
+                          bool &truncated )
+  {
+    const perfScope_c readScope( perfTracer_c::operation_e::FileRead );
+    truncated = false;
+
+    if ( !status.exists || !status.isFile || offset < 0 )
+      return {};
+
+    QFile file( path );
+    if ( !file.open( QIODevice::ReadOnly | QIODevice::Unbuffered ) || !file.seek( offset ) )
+      return {};
+
+    // a byte past the window tells whether the file continues, also for pseudo files reporting zero size
+    const int windowSize = ( maximumSize < 0 ) ? maximumWindowSize : qMin( maximumSize, maximumWindowSize );
+    QByteArray window = file.read( windowSize + 1 );
+    truncated = window.size() > windowSize;
+    if ( truncated )
+      window.truncate( windowSize );
+
+    const uchar *data = reinterpret_cast<const uchar *>( window.constData() );
+    const qint64 skipped = ( offset > 0 ) ? leadingContinuationBytes( data, window.size() ) : 0;
+    const qint64 decodedSize = truncated ? completeUtf8Length( data, window.size() ) : window.size();
+    if ( decodedSize <= skipped )
+      return {};
+
+    return QString::fromUtf8( window.constData() + skipped, static_cast<int>( decodedSize - skipped ) );
   }
 }
 
 /*!
    Checks if a path given at \a path is valid
+   The attributes of the path are taken from \em statCache_c, a path checked recently is not stat-ed again.
    \param path the path to check
    \param isDir true if the path points to a folder, otherwise to a file
    \return true if the path is valid
@@ -44,68 +114,191 @@ bool fileInspector_n::util_n::isValid( const QString &path, bool isDir )
 {
   if ( !path.isEmpty() )
   {
-    QFileInfo pathFileInfo( path );
-    return pathFileInfo.exists() && ( isDir ) ? pathFileInfo.isDir() : pathFileInfo.isFile();
+    const statCache_c::status_s pathStatus = statCache_c::instance().status( path );
+    return pathStatus.exists && ( isDir ? pathStatus.isDir : pathStatus.isFile );
   }
   return false;
 }
 
+/*!
+   Checks if a path \a path is a folder given at \a folderPath or lies within it
+   \param path absolute path to check
+   \param folderPath absolute path to the folder
+   \return true if the path is the folder or lies within it
+ */
+bool fileInspector_n::util_n::isWithinFolder( const QString &path, const QString &folderPath )
+{
+  if ( folderPath.isEmpty() || !path.startsWith( folderPath ) )
+    return false;
+
+  return path.size() == folderPath.size() || folderPath.endsWith( '/' ) || path.at( folderPath.size() ) == '/';
+}
+
+/*!
+   Checks if a MIME type \a mimeType is text, i.e. its content may be shown as text
+   \param mimeType the MIME type
+   \return true for text
+ */
+bool fileInspector_n::util_n::isTextMimeType( const QMimeType &mimeType )
+{
+  return mimeType.inherits( "text/plain" );
+}
+
+/*!
+   Extracts the longest literal every match of a regular expression \a pattern contains
+   The pattern is matched unanchored, as by QRegularExpression::match(), so a text containing a match contains the
+   literal as well and a text without the literal can be skipped. Only plain characters and escaped punctuation
+   outside groups form the literal; the contents of groups, which may be optional, bracket expressions and the
+   bounds of quantifiers are skipped. An alternation, a group opened by "(?", which may set inline options, or an
+   escape taking arguments, e.g. a character code, gives none.
+   \param pattern the regular expression
+   \return the literal, empty if there is none
+ */
+QString fileInspector_n::util_n::getRequiredLiteral( const QString &pattern )
+{
+  if ( pattern.contains( '|' ) )
+    return {};
+
+  const QString metaCharacters( ".^$*+?()[]{}\\|" );
+  const QString quantifiers( "*?{" );
+  const QString argumentEscapes( "0123456789cgkoxENPpQ" );
+
+  QString longest;
+  QString current;
+  const auto closeRun = [&longest, &current]()
+  {
+    if ( current.size() > longest.size() )
+      longest = current;
+    current.clear();
+  };
+
+  int groupDepth = 0;
+  for ( int position = 0; position < pattern.size(); position++ )
+  {
+    QChar character = pattern.at( position );
+    if ( character == '\\' && position + 1 < pattern.size() && !pattern.at( position + 1 ).isLetterOrNumber() )
+    {
+      character = pattern.at( ++position );
+    }
+    else if ( metaCharacters.contains( character ) )
+    {
+      // a class, a group or an anchor ends the run, a bracket expression and quantifier bounds are skipped as a whole
+      if ( character == '[' )
+      {
+        while ( position + 1 < pattern.size() && pattern.at( position + 1 ) != ']' )
+          position++;
+        position++;
+      }
+      else if ( character == '{' )
+      {
+        while ( position + 1 < pattern.size() && pattern.at( position + 1 ) != '}' )
+          position++;
+        position++;
+      }
+      else if ( character == '\\' )
+      {
+        // the arguments of an escape, e.g. the digits of \x41, would be taken for literal text
+        if ( ++position < pattern.size() && argumentEscapes.contains( pattern.at( position ) ) )
+          return {};
+      }
+      else if ( character == '(' )
+      {
+        // inline options may make the match case-insensitive or ignore the spaces of the pattern
+        if ( position + 1 < pattern.size() && pattern.at( position + 1 ) == '?' )
+          return {};
+        groupDepth++;
+      }
+      else if ( character == ')' && groupDepth > 0 )
+      {
+        groupDepth--;
+      }
+      closeRun();
+      continue;
+    }
+
+    // a character of a group is not required, the group may be optional
+    if ( groupDepth > 0 )
+      continue;
+
+    // a quantified character is optional or repeated, it ends the run
+    if ( position + 1 < pattern.size() && quantifiers.contains( pattern.at( position + 1 ) ) )
+    {
+      closeRun();
+      continue;
+    }
+
+    current += character;
+  }
+  closeRun();
+
+  return longest;
+}
+
 /*!
    Collects content of a folder given at path \a path
+   The folder is listed in a single pass that stops at \a maximumLines entries, the collected sub-folders
+   are given first.
    \param path the path to folder
    \param maximumLines number of maximum entries to collect
    \return collected folder entries
  */
 QStringList fileInspector_n::util_n::getDirContent( const QString &path, int maximumLines )
 {
-  if ( !isValid( path, true ) )
+  dirLister_c lister;
+  if ( !lister.list( path, maximumLines ) )
     return {};
 
-  int collectedLines = 0;
-  QStringList retvalue;
-
-  // first, collect all the sub-folders
-  QDirIterator dirDirIt( path, QDir::Dirs | QDir::NoDotAndDotDot | QDir::AllDirs );
-  getDirEntries( maximumLines, collectedLines, dirDirIt, retvalue );
-
-  // collect files if there is enough place
-  QDirIterator dirFileIt( path, QDir::Files );
-  getDirEntries( maximumLines, collectedLines, dirFileIt, retvalue );
-
-  return retvalue;
+  return lister.entryPaths( path, maximumLines );
 }
 
 /*!
    Reads up to \a maximumSize bytes from a file with a path \a path
+   The file is stat-ed without \em statCache_c, as the reader runs on workers, which would contend for the cache.
    \param path path to the file
-   \param maximumSize number of maximum bytes to read. If -1 given, no limitation is applied
-   \return the file content
+   \param maximumSize number of maximum bytes to read. If -1 given, a fixed bound of a few MB is applied
+   \return the file content, followed by an ellipsis line if truncated
  */
 QString fileInspector_n::util_n::getTextFileContent( const QString &path, int maximumSize )
 {
-  if ( !isValid( path, false ) )
-    return {};
-
-  QFile file( path );
-  if ( !file.open( QIODevice::ReadOnly ) )
-    return {};
+  return getTextFileContent( path, statCache_c::statPath( path ), maximumSize );
+}
 
-  QString retvalue;
-  if ( maximumSize == -1 )
-  {
-    retvalue = file.readAll();
-  }
-  else
-  {
-    retvalue = file.read( maximumSize - 4 );
-    retvalue.append( "\n..." );
-  }
+/*!
+   Reads up to \a maximumSize bytes from a file with a path \a path and known attributes \a status
+   Saves the stat of the file if its attributes are known already, e.g. from the listing of its folder.
+   \param path path to the file
+   \param status attributes of the file
+   \param maximumSize number of maximum bytes to read. If -1 given, a fixed bound of a few MB is applied
+   \return the file content, followed by an ellipsis line if truncated
+ */
+QString fileInspector_n::util_n::getTextFileContent( const QString &path, const statCache_c::status_s &status,
+                                                     int maximumSize )
+{
+  const QString ellipsis( "\n..." );
 
-  file.close();
+  bool truncated = false;
+  QString retvalue = readTextWindow( path, status, 0,
+                                     ( maximumSize == -1 ) ? -1 : qMax( 0, maximumSize - ellipsis.size() ), truncated );
+  if ( truncated )
+    retvalue.append( ellipsis );
 
   return retvalue;
 }
 
+/*!
+   Decodes a window of a text file with a path \a path
+   \param path path to the file
+   \param offset byte offset of the window
+   \param maximumSize size of the window in bytes. If -1 given, the window reaches the end of the file or a fixed
+          bound of a few MB
+   \return the decoded window
+ */
+QString fileInspector_n::util_n::getTextFileWindow( const QString &path, qint64 offset, int maximumSize )
+{
+  bool truncated = false;
+  return readTextWindow( path, statCache_c::statPath( path ), offset, maximumSize, truncated );
+}
+
 /*!
    Detects maximum size of content to be displayed on a widget without scrollbars with respect
    to widget size \a size and widget font \a font
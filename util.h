@@ -2,14 +2,22 @@
 
 #include <QStringList>
 
+#include "statcache.h"
+
 class QFont;
+class QMimeType;
 class QSize;
 
 namespace fileInspector_n::util_n
 {
   bool isValid( const QString &, bool );
+  bool isWithinFolder( const QString &, const QString & );
+  bool isTextMimeType( const QMimeType & );
+  QString getRequiredLiteral( const QString & );
   QStringList getDirContent( const QString &, int = -1 );
   QString getTextFileContent( const QString &, int = -1 );
+  QString getTextFileContent( const QString &, const statCache_c::status_s &, int = -1 );
+  QString getTextFileWindow( const QString &, qint64, int );
   int getMaxContentSize( const QSize &, const QFont & );
   int getMaxContentLines( const QSize &, const QFont & );
 }
@@ -0,0 +1,161 @@
+#include "workstealingpool.h"
+
+#include <QThread>
+
+namespace
+{
+  // Pool the current thread works for, nullptr for threads outside of any pool
+  thread_local const void *currentPool = nullptr;
+  // Index of the current worker within its pool
+  thread_local int currentWorker = -1;
+}
+
+/*!
+   C-tor
+   Starts the worker threads.
+   \param threadCount number of workers. If 0 given, the ideal thread count of the system is used
+ */
+workStealingPool_c::workStealingPool_c( int threadCount ) :
+  _pendingTasks{ 0 },
+  _queuedTasks{ 0 },
+  _nextQueue{ 0 },
+  _stopping{ false }
+{
+  if ( threadCount <= 0 )
+    threadCount = QThread::idealThreadCount();
+
+  for ( int index = 0; index < threadCount; index++ )
+    _queues.push_back( std::make_unique<workerQueue_s>() );
+
+  for ( int index = 0; index < threadCount; index++ )
+    _threads.emplace_back( &workStealingPool_c::run, this, index );
+}
+
+/*!
+   D-tor
+   Waits for all the submitted tasks and stops the workers.
+ */
+workStealingPool_c::~workStealingPool_c()
+{
+  wait();
+
+  {
+    std::lock_guard<std::mutex> locker( _idleMutex );
+    _stopping = true;
+  }
+  _workAvailable.notify_all();
+
+  for ( auto &thread : _threads )
+    thread.join();
+}
+
+/*!
+   Submits a task \a task
+   Called from a worker, the task is queued to the worker itself, otherwise the queues are taken in turns.
+   \param task the task
+ */
+void workStealingPool_c::submit( task_t task )
+{
+  const size_t queueIndex = ( currentPool == this ) ? static_cast<size_t>( currentWorker ) :
+                                                      _nextQueue++ % _queues.size();
+
+  _pendingTasks++;
+  {
+    std::lock_guard<std::mutex> locker( _queues[ queueIndex ]->mutex );
+    _queues[ queueIndex ]->tasks.push_back( std::move( task ) );
+  }
+
+  {
+    std::lock_guard<std::mutex> locker( _idleMutex );
+    _queuedTasks++;
+  }
+  _workAvailable.notify_one();
+}
+
+/*!
+   Blocks until all the submitted tasks, including the tasks they submit, are finished
+   Must not be called from a worker.
+ */
+void workStealingPool_c::wait()
+{
+  std::unique_lock<std::mutex> locker( _idleMutex );
+  _allDone.wait( locker, [this]() { return _pendingTasks == 0; } );
+}
+
+/*!
+   \return number of workers
+ */
+int workStealingPool_c::threadCount() const
+{
+  return static_cast<int>( _threads.size() );
+}
+
+/*!
+   Worker thread loop
+   \param workerIndex index of the worker
+ */
+void workStealingPool_c::run( int workerIndex )
+{
+  currentPool = this;
+  currentWorker = workerIndex;
+
+  task_t task;
+  while ( true )
+  {
+    if ( !takeTask( workerIndex, task ) )
+    {
+      std::unique_lock<std::mutex> locker( _idleMutex );
+      _workAvailable.wait( locker, [this]() { return _stopping || _queuedTasks > 0; } );
+      if ( _stopping )
+        return;
+      continue;
+    }
+
+    task( workerIndex );
+    task = nullptr;
+
+    if ( --_pendingTasks == 0 )
+    {
+      std::lock_guard<std::mutex> locker( _idleMutex );
+      _allDone.notify_all();
+    }
+  }
+}
+
+/*!
+   Takes a task from the own queue of a worker \a workerIndex, or steals one from another worker
+   \param workerIndex index of the worker
+   \param task output for the task
+   \return false if there is no task at all
+ */
+bool workStealingPool_c::takeTask( int workerIndex, task_t &task )
+{
+  const size_t queueCount = _queues.size();
+
+  for ( size_t attempt = 0; attempt < queueCount; attempt++ )
+  {
+    const size_t queueIndex = ( static_cast<size_t>( workerIndex ) + attempt ) % queueCount;
+    workerQueue_s &queue = *_queues[ queueIndex ];
+
+    std::lock_guard<std::mutex> locker( queue.mutex );
+    if ( queue.tasks.empty() )
+      continue;
+
+    // the own queue is served from its end, other queues are stolen from their front
+    if ( attempt == 0 )
+    {
+      task = std::move( queue.tasks.back() );
+      queue.tasks.pop_back();
+    }
+    else
+    {
+      task = std::move( queue.tasks.front() );
+      queue.tasks.pop_front();
+    }
+
+    _queuedTasks--;
+    return true;
+  }
+
+  return false;
+}
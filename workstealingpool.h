@@ -0,0 +1,66 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+   Thread pool with a task queue per worker
+   A task submitted from a worker goes to the worker's own queue, which the worker serves last in, first out,
+   so a recursive traversal proceeds depth-first and keeps its working set small. An idle worker steals the
+   oldest task of another worker, which for a traversal is the one closest to the root, i.e. the largest
+   chunk of remaining work. It suits recursive workloads, where a single task spawns an unknown number of
+   subtasks, far better than a single shared queue.
+ */
+class workStealingPool_c
+{
+  public:
+    // A task, receives index of the worker running it
+    using task_t = std::function<void( int )>;
+
+  private:
+    /*!
+       Task queue of a single worker
+     */
+    struct workerQueue_s
+    {
+      std::mutex mutex;
+      std::deque<task_t> tasks;
+    };
+
+    std::vector<std::unique_ptr<workerQueue_s>> _queues;
+    std::vector<std::thread> _threads;
+    // Number of submitted tasks not finished yet
+    std::atomic<qint64> _pendingTasks;
+    // Number of submitted tasks not started yet
+    std::atomic<qint64> _queuedTasks;
+    // Round-robin position for tasks submitted from outside of the pool
+    std::atomic<unsigned> _nextQueue;
+    std::atomic<bool> _stopping;
+    // Guards sleeping of idle workers and of waiters
+    std::mutex _idleMutex;
+    std::condition_variable _workAvailable;
+    std::condition_variable _allDone;
+
+  public:
+    explicit workStealingPool_c( int = 0 );
+    ~workStealingPool_c();
+
+    workStealingPool_c( const workStealingPool_c & ) = delete;
+    workStealingPool_c &operator=( const workStealingPool_c & ) = delete;
+
+    void submit( task_t );
+    void wait();
+    int threadCount() const;
+
+  private:
+    void run( int );
+    bool takeTask( int, task_t & );
+};